@@ -99,6 +99,8 @@ const char* const DEFAULT_DSI_SDCARD_DIR_NAME = "dsi_sd_card";
 const initializer_list<unsigned> CURSOR_TIMEOUTS = {1, 2, 3, 5, 10, 15, 20, 30, 60};
 const initializer_list<unsigned> DS_POWER_OK_THRESHOLDS = {0, 10, 20, 30, 40, 50, 60, 70, 80, 90, 100};
 const initializer_list<unsigned> POWER_UPDATE_INTERVALS = {1, 2, 3, 5, 10, 15, 20, 30, 60};
+const initializer_list<unsigned> BATTERY_PROFILE_THRESHOLDS = {10, 20, 30, 50, 75, 100};
+const initializer_list<unsigned> TRACE_RECORDER_DURATIONS = {10, 30, 60};
 const initializer_list<uint16_t> RUMBLE_INTENSITY_VALUES = {0, 6554, 13107, 19661, 26214, 32768, 39321, 45875, 52428, 58982, 65535};
 const initializer_list<int> RELATIVE_DAY_OFFSETS = {
     -364, -180, -150, -120, -90, -60, -30, -14, -13, -12, -11, -10, -9, -8, -7, -6, -5, -4, -3, -2, -1,
@@ -117,6 +119,7 @@ namespace MelonDsDs::config {
     static void ParseNetworkOptions(CoreConfig& config) noexcept;
     static void ParseScreenOptions(CoreConfig& config) noexcept;
     static void ParseVideoOptions(CoreConfig& config) noexcept;
+    static void ParsePowerOptions(CoreConfig& config) noexcept;
 
 }
 
@@ -158,6 +161,7 @@ void MelonDsDs::ParseConfig(CoreConfig& config) noexcept {
     config::ParseNetworkOptions(config);
     config::ParseScreenOptions(config);
     config::ParseVideoOptions(config);
+    config::ParsePowerOptions(config);
 }
 
 static void MelonDsDs::config::ParseSystemOptions(CoreConfig& config) noexcept {
@@ -217,6 +221,22 @@ static void MelonDsDs::config::ParseSystemOptions(CoreConfig& config) noexcept {
         retro::warn("Failed to get value for {}; defaulting to 15 seconds", BATTERY_UPDATE_INTERVAL);
         config.SetPowerUpdateInterval(15);
     }
+
+    if (optional<TitleProfileMode> value = ParseTitleProfileMode(get_variable(PER_GAME_PROFILES))) {
+        config.SetTitleProfileMode(*value);
+    }
+    else {
+        retro::warn("Failed to get value for {}; defaulting to {}", PER_GAME_PROFILES, values::DISABLED);
+        config.SetTitleProfileMode(TitleProfileMode::Disabled);
+    }
+
+    if (optional<bool> value = ParseBoolean(get_variable(SUSPEND_ON_EXIT))) {
+        config.SetSuspendOnExit(*value);
+    }
+    else {
+        retro::warn("Failed to get value for {}; defaulting to {}", SUSPEND_ON_EXIT, values::DISABLED);
+        config.SetSuspendOnExit(false);
+    }
 }
 
 void MelonDsDs::config::ParseTimeOptions(CoreConfig& config) noexcept {
@@ -369,6 +389,22 @@ void MelonDsDs::config::ParseOsdOptions(CoreConfig& config) noexcept {
         retro::warn("Failed to get value for {}; defaulting to {}", SENSOR_READING, definitions::ShowSensorReading.default_value);
         config.SetShowSensorReading(true);
     }
+
+    if (optional<bool> value = ParseBoolean(get_variable(osd::FRAME_STATS))) {
+        config.SetShowFrameStats(*value);
+    } else {
+        retro::warn("Failed to get value for {}; defaulting to {}", FRAME_STATS, values::DISABLED);
+        config.SetShowFrameStats(false);
+    }
+
+    if (string_view value = get_variable(osd::TRACE_RECORDER); value == values::DISABLED) {
+        config.SetTraceRecorderSeconds(nullopt);
+    } else if (optional<unsigned> seconds = ParseIntegerInList(value, TRACE_RECORDER_DURATIONS)) {
+        config.SetTraceRecorderSeconds(seconds);
+    } else {
+        retro::warn("Failed to get value for {}; defaulting to {}", TRACE_RECORDER, values::DISABLED);
+        config.SetTraceRecorderSeconds(nullopt);
+    }
 }
 
 static void MelonDsDs::config::ParseJitOptions(CoreConfig& config) noexcept {
@@ -520,6 +556,13 @@ static void MelonDsDs::config::ParseDsiStorageOptions(CoreConfig& config) noexce
         config.SetDsiNandPath(string_view(values::NOT_FOUND));
     }
 
+    if (optional<bool> value = ParseBoolean(get_variable(storage::DSI_NAND_CACHE))) {
+        config.SetDsiNandCache(*value);
+    } else {
+        retro::warn("Failed to get value for {}; defaulting to {}", storage::DSI_NAND_CACHE, values::DISABLED);
+        config.SetDsiNandCache(false);
+    }
+
     if (string_view value = get_variable(system::FIRMWARE_PATH); !value.empty()) {
         config.SetFirmwarePath(value);
     } else {
@@ -648,6 +691,20 @@ static void MelonDsDs::config::ParseAudioOptions(CoreConfig& config) noexcept {
         retro::warn("Failed to get value for {}; defaulting to {}", AUDIO_INTERPOLATION, values::DISABLED);
         config.SetInterpolation(AudioInterpolation::None);
     }
+
+    if (optional<bool> value = ParseBoolean(get_variable(AUDIO_RATE_CONTROL))) {
+        config.SetAudioRateControl(*value);
+    } else {
+        retro::warn("Failed to get value for {}; defaulting to {}", AUDIO_RATE_CONTROL, values::DISABLED);
+        config.SetAudioRateControl(false);
+    }
+
+    if (optional<bool> value = ParseBoolean(get_variable(AUDIO_LOW_LATENCY))) {
+        config.SetLowLatencyAudio(*value);
+    } else {
+        retro::warn("Failed to get value for {}; defaulting to {}", AUDIO_LOW_LATENCY, values::DISABLED);
+        config.SetLowLatencyAudio(false);
+    }
 }
 
 static void MelonDsDs::config::ParseNetworkOptions(CoreConfig& config) noexcept {
@@ -727,6 +784,20 @@ static void MelonDsDs::config::ParseNetworkOptions(CoreConfig& config) noexcept
         retro::warn("Failed to get value for {}; defaulting to existing firmware value", network::MAC_ADDRESS_MODE);
         config.SetMacAddress(nullopt);
     }
+
+    if (optional<NetplayMode> value = ParseNetplayMode(get_variable(network::NETPLAY_MODE))) {
+        config.SetNetplayMode(*value);
+    } else {
+        retro::warn("Failed to get value for {}; defaulting to {}", network::NETPLAY_MODE, values::WIRELESS);
+        config.SetNetplayMode(NetplayMode::LocalWireless);
+    }
+
+    if (optional<unsigned> value = ParseIntegerInRange<unsigned>(get_variable(network::ROLLBACK_FRAMES), 1, 16)) {
+        config.SetRollbackFrames(*value);
+    } else {
+        retro::warn("Failed to get value for {}; defaulting to {}", network::ROLLBACK_FRAMES, 8);
+        config.SetRollbackFrames(8);
+    }
 }
 
 static void MelonDsDs::config::ParseScreenOptions(CoreConfig& config) noexcept {
@@ -809,10 +880,16 @@ static void MelonDsDs::config::ParseVideoOptions(CoreConfig& config) noexcept {
     }
 
 #if defined(HAVE_THREADS) && defined(HAVE_THREADED_RENDERER)
-    if (optional<bool> value = ParseBoolean(get_variable(THREADED_RENDERER))) {
-        config.SetThreadedSoftRenderer(*value);
+    if (string_view value = get_variable(THREADED_RENDERER); value == values::AUTO) {
+        // The core will pick a value once it's measured both; until then, threading is the safer guess
+        config.SetAutoThreadedSoftRenderer(true);
+        config.SetThreadedSoftRenderer(true);
+    } else if (optional<bool> threaded = ParseBoolean(value)) {
+        config.SetAutoThreadedSoftRenderer(false);
+        config.SetThreadedSoftRenderer(*threaded);
     } else {
-        retro::warn("Failed to get value for {}; defaulting to {}", THREADED_RENDERER, values::ENABLED);
+        retro::warn("Failed to get value for {}; defaulting to {}", THREADED_RENDERER, values::AUTO);
+        config.SetAutoThreadedSoftRenderer(true);
         config.SetThreadedSoftRenderer(true);
     }
 #endif
@@ -839,6 +916,83 @@ static void MelonDsDs::config::ParseVideoOptions(CoreConfig& config) noexcept {
         config.SetBetterPolygonSplitting(false);
     }
 #endif
+
+#if defined(HAVE_OPENGL) && defined(HAVE_EGL)
+    if (optional<bool> value = ParseBoolean(get_variable(OPENGL_HEADLESS))) {
+        config.SetHeadlessOpenGl(*value);
+    } else {
+        retro::warn("Failed to get value for {}; defaulting to {}", OPENGL_HEADLESS, values::DISABLED);
+        config.SetHeadlessOpenGl(false);
+    }
+#endif
+}
+
+static void MelonDsDs::config::ParsePowerOptions(CoreConfig& config) noexcept {
+    ZoneScopedN(TracyFunction);
+    using namespace MelonDsDs::config::power;
+    using retro::get_variable;
+
+    // Each battery profile setting can be left unchanged,
+    // in which case the corresponding regular setting is used as-is
+
+    if (string_view value = get_variable(BATTERY_PROFILE_THRESHOLD); value == values::DISABLED) {
+        config.SetBatteryProfileThreshold(nullopt);
+    } else if (optional<unsigned> threshold = ParseIntegerInList(value, BATTERY_PROFILE_THRESHOLDS)) {
+        config.SetBatteryProfileThreshold(threshold);
+    } else {
+        retro::warn("Failed to get value for {}; defaulting to {}", BATTERY_PROFILE_THRESHOLD, values::DISABLED);
+        config.SetBatteryProfileThreshold(nullopt);
+    }
+
+#if defined(HAVE_THREADS) && defined(HAVE_THREADED_RENDERER)
+    if (string_view value = get_variable(BATTERY_PROFILE_THREADED_RENDERER); value == values::UNCHANGED) {
+        config.SetBatteryProfileThreadedRenderer(nullopt);
+    } else if (optional<bool> threaded = ParseBoolean(value)) {
+        config.SetBatteryProfileThreadedRenderer(threaded);
+    } else {
+        retro::warn("Failed to get value for {}; defaulting to {}", BATTERY_PROFILE_THREADED_RENDERER, values::UNCHANGED);
+        config.SetBatteryProfileThreadedRenderer(nullopt);
+    }
+#endif
+
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+    if (string_view value = get_variable(BATTERY_PROFILE_OPENGL_RESOLUTION); value == values::UNCHANGED) {
+        config.SetBatteryProfileScaleFactor(nullopt);
+    } else if (optional<int> scale = ParseIntegerInRange<int>(value, 1, video::INITIAL_MAX_OPENGL_SCALE)) {
+        config.SetBatteryProfileScaleFactor(scale);
+    } else {
+        retro::warn("Failed to get value for {}; defaulting to {}", BATTERY_PROFILE_OPENGL_RESOLUTION, values::UNCHANGED);
+        config.SetBatteryProfileScaleFactor(nullopt);
+    }
+#endif
+
+    if (string_view value = get_variable(BATTERY_PROFILE_AUDIO_INTERPOLATION); value == values::UNCHANGED) {
+        config.SetBatteryProfileInterpolation(nullopt);
+    } else if (optional<AudioInterpolation> interpolation = ParseInterpolation(value)) {
+        config.SetBatteryProfileInterpolation(interpolation);
+    } else {
+        retro::warn("Failed to get value for {}; defaulting to {}", BATTERY_PROFILE_AUDIO_INTERPOLATION, values::UNCHANGED);
+        config.SetBatteryProfileInterpolation(nullopt);
+    }
+
+    if (string_view value = get_variable(BATTERY_PROFILE_OSD); value == values::UNCHANGED || value == values::DISABLED) {
+        config.SetBatteryProfileHidesOsd(value == values::DISABLED);
+    } else {
+        retro::warn("Failed to get value for {}; defaulting to {}", BATTERY_PROFILE_OSD, values::UNCHANGED);
+        config.SetBatteryProfileHidesOsd(false);
+    }
+}
+
+void MelonDsDs::CoreConfig::HideStatusIndicators() noexcept {
+    // Warnings and errors aren't part of the OSD, so they're left alone
+    SetShowPointerCoordinates(false);
+    showMicState = false;
+    showCameraState = false;
+    showCurrentLayout = false;
+    showLidState = false;
+    _showSensorReading = false;
+    showBrightnessState = false;
+    _showFrameStats = false;
 }
 
 struct FirmwareEntry {
@@ -82,6 +82,12 @@ namespace MelonDsDs {
         [[nodiscard]] melonDS::AudioInterpolation Interpolation() const noexcept { return _interpolation; }
         void SetInterpolation(melonDS::AudioInterpolation interpolation) noexcept { _interpolation = interpolation; }
 
+        [[nodiscard]] bool AudioRateControl() const noexcept { return _audioRateControl; }
+        void SetAudioRateControl(bool enabled) noexcept { _audioRateControl = enabled; }
+
+        [[nodiscard]] bool LowLatencyAudio() const noexcept { return _lowLatencyAudio; }
+        void SetLowLatencyAudio(bool enabled) noexcept { _lowLatencyAudio = enabled; }
+
         [[nodiscard]] MelonDsDs::AlarmMode AlarmMode() const noexcept { return _alarmMode; }
         void SetAlarmMode(MelonDsDs::AlarmMode alarmMode) noexcept { _alarmMode = alarmMode; }
 
@@ -150,6 +156,12 @@ namespace MelonDsDs {
 #endif
 
 #ifdef HAVE_NETWORKING
+        [[nodiscard]] MelonDsDs::NetplayMode NetplayMode() const noexcept { return _netplayMode; }
+        void SetNetplayMode(MelonDsDs::NetplayMode mode) noexcept { _netplayMode = mode; }
+
+        [[nodiscard]] unsigned RollbackFrames() const noexcept { return _rollbackFrames; }
+        void SetRollbackFrames(unsigned frames) noexcept { _rollbackFrames = frames; }
+
         [[nodiscard]] MelonDsDs::NetworkMode NetworkMode() const noexcept { return _networkMode; }
         void SetNetworkMode(MelonDsDs::NetworkMode mode) noexcept { _networkMode = mode; }
 
@@ -192,6 +204,13 @@ namespace MelonDsDs {
         [[nodiscard]] bool ShowBrightnessState() const noexcept { return showBrightnessState; }
         void SetShowBrightnessState(bool show) noexcept { showBrightnessState = show; }
 
+        [[nodiscard]] bool ShowFrameStats() const noexcept { return _showFrameStats; }
+        void SetShowFrameStats(bool show) noexcept { _showFrameStats = show; }
+
+        /// How many seconds of scoped timings the trace recorder keeps, or nullopt if it's off
+        [[nodiscard]] optional<unsigned> TraceRecorderSeconds() const noexcept { return _traceRecorderSeconds; }
+        void SetTraceRecorderSeconds(optional<unsigned> seconds) noexcept { _traceRecorderSeconds = seconds; }
+
         [[nodiscard]] bool DldiEnable() const noexcept { return _dldiEnable; }
         void SetDldiEnable(bool enable) noexcept { _dldiEnable = enable; }
 
@@ -294,9 +313,36 @@ namespace MelonDsDs {
         [[nodiscard]] unsigned DsPowerOkayThreshold() const noexcept { return _dsPowerOkayThreshold; }
         void SetDsPowerOkayThreshold(unsigned dsPowerOkayThreshold) noexcept { _dsPowerOkayThreshold = dsPowerOkayThreshold; }
 
+        [[nodiscard]] MelonDsDs::TitleProfileMode TitleProfileMode() const noexcept { return _titleProfileMode; }
+        void SetTitleProfileMode(MelonDsDs::TitleProfileMode mode) noexcept { _titleProfileMode = mode; }
+
+        [[nodiscard]] bool SuspendOnExit() const noexcept { return _suspendOnExit; }
+        void SetSuspendOnExit(bool suspendOnExit) noexcept { _suspendOnExit = suspendOnExit; }
+
         [[nodiscard]] unsigned PowerUpdateInterval() const noexcept { return _powerUpdateInterval; }
         void SetPowerUpdateInterval(unsigned powerUpdateInterval) noexcept { _powerUpdateInterval = powerUpdateInterval; }
 
+        /// The battery percentage at or below which the battery profile is used,
+        /// or \c nullopt if it's disabled.
+        [[nodiscard]] optional<unsigned> BatteryProfileThreshold() const noexcept { return _batteryProfileThreshold; }
+        void SetBatteryProfileThreshold(optional<unsigned> threshold) noexcept { _batteryProfileThreshold = threshold; }
+
+        [[nodiscard]] optional<bool> BatteryProfileThreadedRenderer() const noexcept { return _batteryProfileThreadedRenderer; }
+        void SetBatteryProfileThreadedRenderer(optional<bool> threaded) noexcept { _batteryProfileThreadedRenderer = threaded; }
+
+        [[nodiscard]] optional<int> BatteryProfileScaleFactor() const noexcept { return _batteryProfileScaleFactor; }
+        void SetBatteryProfileScaleFactor(optional<int> scaleFactor) noexcept { _batteryProfileScaleFactor = scaleFactor; }
+
+        [[nodiscard]] optional<melonDS::AudioInterpolation> BatteryProfileInterpolation() const noexcept { return _batteryProfileInterpolation; }
+        void SetBatteryProfileInterpolation(optional<melonDS::AudioInterpolation> interpolation) noexcept { _batteryProfileInterpolation = interpolation; }
+
+        [[nodiscard]] bool BatteryProfileHidesOsd() const noexcept { return _batteryProfileHidesOsd; }
+        void SetBatteryProfileHidesOsd(bool hide) noexcept { _batteryProfileHidesOsd = hide; }
+
+        /// Turns off every on-screen status indicator (but not warnings or errors).
+        /// Call ParseConfig to restore the originals.
+        void HideStatusIndicators() noexcept;
+
         // TODO: Allow these paths to be customized
         string_view Bios9Path() const noexcept { return "bios9.bin"; }
         string_view Bios7Path() const noexcept { return "bios7.bin"; }
@@ -322,6 +368,9 @@ namespace MelonDsDs {
         void SetDsiNandPath(string_view dsiNandPath) noexcept { _dsiNandPath = dsiNandPath; }
         void SetDsiNandPath(string&& dsiNandPath) noexcept { _dsiNandPath = std::move(dsiNandPath); }
 
+        [[nodiscard]] bool DsiNandCache() const noexcept { return _dsiNandCache; }
+        void SetDsiNandCache(bool cache) noexcept { _dsiNandCache = cache; }
+
         [[nodiscard]] int ScaleFactor() const noexcept { return _scaleFactor; }
         void SetScaleFactor(int scaleFactor) noexcept { _scaleFactor = scaleFactor; }
 
@@ -331,11 +380,23 @@ namespace MelonDsDs {
         [[nodiscard]] RenderMode ConfiguredRenderer() const noexcept { return _configuredRenderer; }
         void SetConfiguredRenderer(RenderMode configuredRenderer) noexcept { _configuredRenderer = configuredRenderer; }
 
+#if defined(HAVE_OPENGL) && defined(HAVE_EGL)
+        [[nodiscard]] bool HeadlessOpenGl() const noexcept { return _headlessOpenGl; }
+        void SetHeadlessOpenGl(bool headlessOpenGl) noexcept { _headlessOpenGl = headlessOpenGl; }
+#else
+        bool HeadlessOpenGl() const noexcept { return false; }
+#endif
+
 #ifdef HAVE_THREADED_RENDERER
         [[nodiscard]] bool ThreadedSoftRenderer() const noexcept { return _threadedSoftRenderer; }
         void SetThreadedSoftRenderer(bool threadedSoftRenderer) noexcept { _threadedSoftRenderer = threadedSoftRenderer; }
+
+        /// If true, ThreadedSoftRenderer() is decided by measurement instead of by the player.
+        [[nodiscard]] bool AutoThreadedSoftRenderer() const noexcept { return _autoThreadedSoftRenderer; }
+        void SetAutoThreadedSoftRenderer(bool autoThreaded) noexcept { _autoThreadedSoftRenderer = autoThreaded; }
 #else
         bool ThreadedSoftRenderer() const noexcept { return false; }
+        bool AutoThreadedSoftRenderer() const noexcept { return false; }
 #endif
 
         [[nodiscard]] MelonDsDs::ScreenFilter ScreenFilter() const noexcept { return _screenFilter; }
@@ -395,6 +456,8 @@ namespace MelonDsDs {
         MelonDsDs::MicInputMode _micInputMode = *ParseMicInputMode(config::definitions::MicInput.default_value);
         melonDS::AudioBitDepth _bitDepth;
         melonDS::AudioInterpolation _interpolation;
+        bool _audioRateControl = false;
+        bool _lowLatencyAudio = false;
         MelonDsDs::AlarmMode _alarmMode;
         optional<unsigned> _alarmHour;
         optional<unsigned> _alarmMinute;
@@ -421,6 +484,8 @@ namespace MelonDsDs {
 
 #ifdef HAVE_NETWORKING
         MelonDsDs::NetworkMode _networkMode;
+        MelonDsDs::NetplayMode _netplayMode = MelonDsDs::NetplayMode::LocalWireless;
+        unsigned _rollbackFrames = 8;
         bool _interfacesInitialized = false;
 #   ifdef HAVE_NETWORKING_DIRECT_MODE
         string _networkInterface;
@@ -438,6 +503,8 @@ namespace MelonDsDs {
         bool showLidState = false;
         bool _showSensorReading = false;
         bool showBrightnessState = false;
+        bool _showFrameStats = false;
+        optional<unsigned> _traceRecorderSeconds = std::nullopt;
         bool _dldiEnable;
         bool _dldiFolderSync;
         string _dldiFolderPath;
@@ -465,13 +532,23 @@ namespace MelonDsDs {
         MelonDsDs::SysfileMode _sysfileMode;
         unsigned _dsPowerOkayThreshold = 20;
         unsigned _powerUpdateInterval;
+        MelonDsDs::TitleProfileMode _titleProfileMode = MelonDsDs::TitleProfileMode::Disabled;
+        bool _suspendOnExit = false;
+        optional<unsigned> _batteryProfileThreshold = std::nullopt;
+        optional<bool> _batteryProfileThreadedRenderer = std::nullopt;
+        optional<int> _batteryProfileScaleFactor = std::nullopt;
+        optional<melonDS::AudioInterpolation> _batteryProfileInterpolation = std::nullopt;
+        bool _batteryProfileHidesOsd = false;
         string _firmwarePath;
         string _dsiFirmwarePath;
         string _dsiNandPath;
+        bool _dsiNandCache = false;
         int _scaleFactor = 1;
         bool _betterPolygonSplitting = false;
         RenderMode _configuredRenderer;
+        bool _headlessOpenGl = false;
         bool _threadedSoftRenderer = false;
+        bool _autoThreadedSoftRenderer = false;
         MelonDsDs::ScreenFilter _screenFilter;
         MelonDsDs::StartTimeMode _startTimeMode = *ParseStartTimeMode(config::definitions::StartTimeMode.default_value);
         years _relativeYearOffset {};
@@ -41,6 +41,8 @@
 #include "retro/file.hpp"
 #include "retro/http.hpp"
 #include "retro/info.hpp"
+#include "sectorcache.hpp"
+#include "sparse.hpp"
 #include "types.hpp"
 
 using std::make_optional;
@@ -56,6 +58,9 @@ using melonDS::NDSHeader;
 using namespace melonDS::DSi_NAND;
 using melonDS::DSi_TMD::TitleMetadata;
 
+// Enough for the NAND's FAT, its directories, and a DSiWare title's save data
+constexpr uint64_t DSI_NAND_CACHE_SIZE = 4 * 1024 * 1024;
+
 namespace MelonDsDs {
     const char *TMD_DIR_NAME = "tmd";
     const char* SENTINEL_NAME = "melon.dat";
@@ -149,6 +154,44 @@ std::unique_ptr<melonDS::NDS> MelonDsDs::CreateConsole(
     }
 }
 
+std::unique_ptr<melonDS::NDS> MelonDsDs::CreateForkedConsole(
+    const CoreConfig& config,
+    const melonDS::NDS& parent,
+    const retro::GameInfo* ndsInfo,
+    void* userdata
+) {
+    ZoneScopedN(TracyFunction);
+    retro_assert(parent.ConsoleType == static_cast<int>(ConsoleType::DS));
+
+    melonDS::NDSArgs ndsargs {};
+    ApplyCommonArgs(config, ndsargs);
+#ifdef HAVE_JIT_FASTMEM
+    if (ndsargs.JIT) {
+        // Fast memory maps the emulated address space into the process,
+        // so only one console can use it at a time
+        ndsargs.JIT->FastMemory = false;
+    }
+#endif
+
+    // The system files were already validated when the parent was created,
+    // and they aren't part of savestates, so copy them as-is
+    ndsargs.ARM9BIOS = std::make_unique<melonDS::ARM9BIOSImage>(parent.GetARM9BIOS());
+    ndsargs.ARM7BIOS = std::make_unique<melonDS::ARM7BIOSImage>(parent.GetARM7BIOS());
+    ndsargs.Firmware = parent.GetFirmware();
+
+    if (ndsInfo) {
+        // Forks mustn't write to the parent's SD card image
+        CoreConfig forkConfig = config;
+        forkConfig.SetDldiReadOnly(true);
+        forkConfig.SetDldiFolderSync(false);
+
+        // SRAM is part of the savestate, so the cart itself doesn't need any
+        ndsargs.NDSROM = LoadNdsCart(forkConfig, *ndsInfo);
+    }
+
+    return std::make_unique<melonDS::NDS>(std::move(ndsargs), userdata);
+}
+
 void MelonDsDs::UpdateConsole(const CoreConfig& config, melonDS::NDS& nds) noexcept {
     ZoneScopedN(TracyFunction);
 
@@ -375,6 +418,11 @@ static melonDS::DSiArgs MelonDsDs::GetDSiArgs(const CoreConfig& config, const re
         throw environment_exception("Failed to get the system directory, which means the NAND image can't be loaded.");
     }
 
+    if (config.DsiNandCache()) {
+        // The NAND's file system structures are read many times over while booting
+        SectorCache::Register(*nandPath, DSI_NAND_CACHE_SIZE);
+    }
+
     NANDImage nand = LoadNANDImage(*nandPath, &(*arm7i)[0x8308]);
     unique_ptr<melonDS::NDSCart::CartCommon> ndsRom = ndsInfo ? LoadNdsCart(config, *ndsInfo) : nullptr;
 
@@ -461,6 +509,11 @@ static unique_ptr<melonDS::NDSCart::CartCommon> MelonDsDs::LoadNdsCart(const Cor
         throw invalid_rom_exception("ROM isn't valid, did you select the right file?");
     }
 
+    if (config.DldiEnable() && header.IsHomebrew()) {
+        // If melonDS is about to create (or open) the homebrew SD card image...
+        SparseImage::Register(config.DldiImagePath(), config.DldiImageSize());
+    }
+
     melonDS::NDSCart::NDSCartArgs sdargs = {
         .SDCard = config.DldiSdCardArgs(),
         .SRAM = nullptr, // SRAM is loaded separately by retro_get_memory
@@ -1315,6 +1368,8 @@ static optional<melonDS::FATStorage> MelonDsDs::LoadDSiSDCardImage(const CoreCon
     ZoneScopedN(TracyFunction);
     if (!config.DsiSdEnable()) return nullopt;
 
+    // Create the image up front so that formatting it doesn't have to write gigabytes of zeros
+    SparseImage::Register(config.DsiSdImagePath(), config.DsiSdImageSize());
     return melonDS::FATStorage(
         string(config.DsiSdImagePath()),
         config.DsiSdImageSize(),
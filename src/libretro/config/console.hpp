@@ -41,6 +41,16 @@ namespace MelonDsDs {
         const retro::GameInfo* gbaSaveInfo
     );
 
+    /// Creates a bare DS console with the same system files and game as \c parent,
+    /// without touching the disk. Its state must be loaded from \c parent separately.
+    /// \c userdata is passed to melonDS's platform callbacks.
+    std::unique_ptr<melonDS::NDS> CreateForkedConsole(
+        const CoreConfig& config,
+        const melonDS::NDS& parent,
+        const retro::GameInfo* ndsInfo,
+        void* userdata
+    );
+
     /// Modify a console instance with core options that are safe to adjust at runtime.
     void UpdateConsole(const CoreConfig& config, melonDS::NDS& nds) noexcept;
 
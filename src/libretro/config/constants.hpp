@@ -44,6 +44,8 @@ namespace MelonDsDs::config {
         static constexpr const char *const CATEGORY = "audio";
         static constexpr const char *const AUDIO_BITDEPTH = "melonds_audio_bitdepth";
         static constexpr const char *const AUDIO_INTERPOLATION = "melonds_audio_interpolation";
+        static constexpr const char *const AUDIO_LOW_LATENCY = "melonds_audio_low_latency";
+        static constexpr const char *const AUDIO_RATE_CONTROL = "melonds_audio_rate_control";
         static constexpr const char *const MIC_INPUT = "melonds_mic_input";
         static constexpr const char *const MIC_INPUT_BUTTON = "melonds_mic_input_active";
     }
@@ -75,6 +77,8 @@ namespace MelonDsDs::config {
         static constexpr const char *const NETWORK_MODE = "melonds_network_mode";
         static constexpr const char *const DIRECT_NETWORK_INTERFACE = "melonds_direct_network_interface";
         static constexpr const char *const MAC_ADDRESS_MODE = "melonds_mac_address_mode";
+        static constexpr const char *const NETPLAY_MODE = "melonds_netplay_mode";
+        static constexpr const char *const ROLLBACK_FRAMES = "melonds_rollback_frames";
     }
 
     namespace osd {
@@ -88,6 +92,17 @@ namespace MelonDsDs::config {
         static constexpr const char *const LID_STATE = "melonds_show_lid_state";
         static constexpr const char *const SENSOR_READING = "melonds_show_sensor_reading";
         static constexpr const char *const BRIGHTNESS_STATE = "melonds_show_brightness_state";
+        static constexpr const char *const FRAME_STATS = "melonds_show_frame_stats";
+        static constexpr const char *const TRACE_RECORDER = "melonds_trace_recorder";
+    }
+
+    namespace power {
+        static constexpr const char *const CATEGORY = "power";
+        static constexpr const char *const BATTERY_PROFILE_AUDIO_INTERPOLATION = "melonds_battery_profile_audio_interpolation";
+        static constexpr const char *const BATTERY_PROFILE_OPENGL_RESOLUTION = "melonds_battery_profile_opengl_resolution";
+        static constexpr const char *const BATTERY_PROFILE_OSD = "melonds_battery_profile_osd";
+        static constexpr const char *const BATTERY_PROFILE_THRESHOLD = "melonds_battery_profile_threshold";
+        static constexpr const char *const BATTERY_PROFILE_THREADED_RENDERER = "melonds_battery_profile_threaded_renderer";
     }
 
     namespace screen {
@@ -133,10 +148,12 @@ namespace MelonDsDs::config {
         static constexpr const char *const FIRMWARE_PATH = "melonds_firmware_nds_path";
         static constexpr const char *const FIRMWARE_DSI_PATH = "melonds_firmware_dsi_path";
         static constexpr const char *const OVERRIDE_FIRMWARE_SETTINGS = "melonds_override_fw_settings";
+        static constexpr const char *const PER_GAME_PROFILES = "melonds_per_game_profiles";
         static constexpr const char *const RUMBLE_INTENSITY = "melonds_rumble_intensity";
         static constexpr const char *const RUMBLE_TYPE = "melonds_rumble_type";
         static constexpr const char *const SLOT2_DEVICE = "melonds_slot2_device";
         static constexpr const char *const SOLAR_SENSOR_HOST_SENSOR = "melonds_solar_sensor_host_sensor";
+        static constexpr const char *const SUSPEND_ON_EXIT = "melonds_suspend_on_exit";
         static constexpr const char *const SYSFILE_MODE = "melonds_sysfile_mode";
     }
 
@@ -144,6 +161,7 @@ namespace MelonDsDs::config {
         static constexpr const char *const DSI_SD_READ_ONLY = "melonds_dsi_sdcard_readonly";
         static constexpr const char *const DSI_SD_SAVE_MODE = "melonds_dsi_sdcard";
         static constexpr const char *const DSI_SD_SYNC_TO_HOST = "melonds_dsi_sdcard_sync_sdcard_to_host";
+        static constexpr const char *const DSI_NAND_CACHE = "melonds_dsi_nand_cache";
         static constexpr const char *const DSI_NAND_PATH = "melonds_dsi_nand_path";
         static constexpr const char *const GBA_FLUSH_DELAY = "melonds_gba_flush_delay";
         static constexpr const char *const HOMEBREW_READ_ONLY = "melonds_homebrew_readonly";
@@ -172,6 +190,7 @@ namespace MelonDsDs::config {
         static constexpr const char *const CATEGORY = "video";
         static constexpr const char *const OPENGL_BETTER_POLYGONS = "melonds_opengl_better_polygons";
         static constexpr const char *const OPENGL_FILTERING = "melonds_opengl_filtering";
+        static constexpr const char *const OPENGL_HEADLESS = "melonds_opengl_headless";
         static constexpr const char *const OPENGL_RESOLUTION = "melonds_opengl_resolution";
         static constexpr const char *const RENDER_MODE = "melonds_render_mode";
         static constexpr const char *const THREADED_RENDERER = "melonds_threaded_renderer";
@@ -243,6 +262,7 @@ namespace MelonDsDs::config {
         static constexpr const char *const REAL = "real";
         static constexpr const char *const RELATIVE_TIME = "relative";
         static constexpr const char *const RIGHT_LEFT = "right-left";
+        static constexpr const char *const ROLLBACK = "rollback";
         static constexpr const char *const ROTATE_LEFT = "rotate-left";
         static constexpr const char *const ROTATE_RIGHT = "rotate-right";
         static constexpr const char *const RUMBLE_PAK = "rumble-pak";
@@ -260,8 +280,12 @@ namespace MelonDsDs::config {
         static constexpr const char *const TOP = "top";
         static constexpr const char *const TOUCH = "touch";
         static constexpr const char *const TOUCHING = "touching";
+        static constexpr const char *const TUNE = "tune";
+        static constexpr const char *const UNCHANGED = "unchanged";
         static constexpr const char *const UPSIDE_DOWN = "rotate-180";
+        static constexpr const char *const VIRTUAL_TIME = "virtual";
         static constexpr const char *const WEAK = "weak";
+        static constexpr const char *const WIRELESS = "wireless";
         static constexpr const char *const FROM_USERNAME = "from-username";
     }
 
@@ -26,6 +26,7 @@
 #include "config/definitions/firmware.hpp"
 #include "config/definitions/network.hpp"
 #include "config/definitions/osd.hpp"
+#include "config/definitions/power.hpp"
 #include "config/definitions/screen.hpp"
 #include "config/definitions/system.hpp"
 #include "config/definitions/time.hpp"
@@ -101,6 +102,8 @@ namespace MelonDsDs::config::definitions {
         HomebrewSdCardSyncToHost,
         BatteryUpdateInterval,
         NdsPowerOkThreshold,
+        PerGameProfiles,
+        SuspendOnExit,
 
         StartTimeMode,
         RelativeYearOffset,
@@ -118,6 +121,9 @@ namespace MelonDsDs::config::definitions {
         OpenGlScaleFactor,
         OpenGlBetterPolygons,
 #endif
+#if defined(HAVE_OPENGL) && defined(HAVE_EGL)
+        OpenGlHeadless,
+#endif
 #if defined(HAVE_THREADS) && defined(HAVE_THREADED_RENDERER)
         ThreadedSoftwareRenderer,
 #endif
@@ -132,6 +138,16 @@ namespace MelonDsDs::config::definitions {
 #ifndef NDEBUG
         ShowPointerCoordinates,
 #endif
+
+        BatteryProfileThreshold,
+#if defined(HAVE_THREADS) && defined(HAVE_THREADED_RENDERER)
+        BatteryProfileThreadedRenderer,
+#endif
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+        BatteryProfileOpenGlScaleFactor,
+#endif
+        BatteryProfileAudioInterpolation,
+        BatteryProfileOsd,
         retro_core_option_v2_definition {},
     };
 }
@@ -107,11 +107,50 @@ namespace MelonDsDs::config::definitions {
         MelonDsDs::config::values::DISABLED
     };
 
+    constexpr retro_core_option_v2_definition AudioRateControl {
+        config::audio::AUDIO_RATE_CONTROL,
+        "Audio Rate Control",
+        "Rate Control",
+        "Stretches or squeezes audio very slightly "
+        "to keep the frontend's audio buffer from running dry or filling up. "
+        "If the frontend doesn't report how full its buffer is, "
+        "follows the rate at which it runs the core instead. "
+        "Enable this if audio crackles on a frontend that doesn't do its own rate control.",
+        nullptr,
+        config::audio::CATEGORY,
+        {
+            {MelonDsDs::config::values::DISABLED, nullptr},
+            {MelonDsDs::config::values::ENABLED, nullptr},
+            {nullptr, nullptr},
+        },
+        MelonDsDs::config::values::DISABLED
+    };
+
+    constexpr retro_core_option_v2_definition AudioLowLatency {
+        config::audio::AUDIO_LOW_LATENCY,
+        "Low-Latency Audio",
+        "Low Latency",
+        "Sends each frame's audio to the frontend as soon as the frame is emulated, "
+        "instead of after it's been rendered and presented. "
+        "Doesn't affect emulation. "
+        "Enable this if your frontend is set up with a small audio buffer.",
+        nullptr,
+        config::audio::CATEGORY,
+        {
+            {MelonDsDs::config::values::DISABLED, nullptr},
+            {MelonDsDs::config::values::ENABLED, nullptr},
+            {nullptr, nullptr},
+        },
+        MelonDsDs::config::values::DISABLED
+    };
+
     constexpr std::initializer_list<retro_core_option_v2_definition> AudioOptionDefinitions {
         MicInput,
         MicInputButton,
         BitDepth,
         AudioInterpolation,
+        AudioRateControl,
+        AudioLowLatency,
     };
 }
 #endif //MELONDS_DS_AUDIO_HPP
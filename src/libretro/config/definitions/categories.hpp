@@ -71,6 +71,11 @@ namespace MelonDsDs::config::definitions {
             "On-Screen Display & Notifications",
             "Change what extra information is shown on-screen."
         },
+        retro_core_option_v2_category {
+            MelonDsDs::config::power::CATEGORY,
+            "Power Management",
+            "Trade quality for battery life when running on battery power."
+        },
         retro_core_option_v2_category {nullptr, nullptr, nullptr},
     };
 }
@@ -91,6 +91,50 @@ namespace MelonDsDs::config::definitions {
         MelonDsDs::config::values::FIRMWARE
     };
 
+    constexpr retro_core_option_v2_definition NetplayMode {
+        config::network::NETPLAY_MODE,
+        "Netplay Mode",
+        nullptr,
+        "Configures what melonDS DS does with the frontend's netplay connection.\n"
+        "\n"
+        "Local Wireless: Each player runs their own console, "
+        "connected as if by the DS's local wireless. "
+        "For games with local multiplayer.\n"
+        "Rollback: All players share one console and their buttons are combined. "
+        "Remote input is predicted so that nobody waits for the network, "
+        "and the console is rewound and replayed when a prediction was wrong.\n"
+        "\n"
+        "Changes take effect when netplay starts.",
+        nullptr,
+        config::network::CATEGORY,
+        {
+            {MelonDsDs::config::values::WIRELESS, "Local Wireless"},
+            {MelonDsDs::config::values::ROLLBACK, "Rollback"},
+            {nullptr, nullptr},
+        },
+        MelonDsDs::config::values::WIRELESS
+    };
+
+    constexpr retro_core_option_v2_definition RollbackFrames {
+        config::network::ROLLBACK_FRAMES,
+        "Rollback Frames",
+        nullptr,
+        "How many frames the console may be rewound in Rollback netplay. "
+        "Higher values tolerate more latency without pausing, "
+        "but use more memory (several megabytes per frame). "
+        "Changes take effect when netplay starts.",
+        nullptr,
+        config::network::CATEGORY,
+        {
+            {"4", nullptr},
+            {"8", nullptr},
+            {"12", nullptr},
+            {"16", nullptr},
+            {nullptr, nullptr},
+        },
+        "8"
+    };
+
     constexpr std::initializer_list<retro_core_option_v2_definition> NetworkOptionDefinitions {
 #ifdef HAVE_NETWORKING
         NetworkMode,
@@ -99,6 +143,8 @@ namespace MelonDsDs::config::definitions {
 #   endif
 #endif
         LanMacAddressMode,
+        NetplayMode,
+        RollbackFrames,
     };
 }
 
@@ -136,6 +136,46 @@ namespace MelonDsDs::config::definitions {
         MelonDsDs::config::values::ENABLED
     };
 
+    constexpr retro_core_option_v2_definition ShowFrameStats {
+        config::osd::FRAME_STATS,
+        "Show Frame Pacing",
+        nullptr,
+        "Enable to show how long the frontend waits between frames, "
+        "how much of that time the core spends emulating, "
+        "and how many vsyncs were missed. "
+        "Useful for finding out whether stutter comes from the core or from the frontend.",
+        nullptr,
+        config::osd::CATEGORY,
+        {
+            {MelonDsDs::config::values::DISABLED, nullptr},
+            {MelonDsDs::config::values::ENABLED, nullptr},
+            {nullptr, nullptr},
+        },
+        MelonDsDs::config::values::DISABLED
+    };
+
+    constexpr retro_core_option_v2_definition TraceRecorder {
+        config::osd::TRACE_RECORDER,
+        "Trace Recorder",
+        nullptr,
+        "Enable to record how long the core spends emulating, rendering, mixing audio, "
+        "running background tasks, saving, waiting on other players, and reading files. "
+        "The most recent seconds are written to a trace file in the save directory "
+        "when the game is closed; open it in ui.perfetto.dev or chrome://tracing. "
+        "Attach it to bug reports about stutter. "
+        "Leave disabled if unsure.",
+        nullptr,
+        config::osd::CATEGORY,
+        {
+            {MelonDsDs::config::values::DISABLED, nullptr},
+            {"10", "Last 10 seconds"},
+            {"30", "Last 30 seconds"},
+            {"60", "Last 60 seconds"},
+            {nullptr, nullptr},
+        },
+        MelonDsDs::config::values::DISABLED
+    };
+
 #ifndef NDEBUG
     constexpr retro_core_option_v2_definition ShowPointerCoordinates {
         config::osd::POINTER_COORDINATES,
@@ -163,6 +203,8 @@ namespace MelonDsDs::config::definitions {
         ShowCameraState,
         ShowLidState,
         ShowSensorReading,
+        ShowFrameStats,
+        TraceRecorder,
 #ifndef NDEBUG
         ShowPointerCoordinates,
 #endif
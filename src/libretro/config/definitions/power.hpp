@@ -0,0 +1,140 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <libretro.h>
+
+#include "../constants.hpp"
+
+namespace MelonDsDs::config::definitions {
+    constexpr retro_core_option_v2_definition BatteryProfileThreshold {
+        config::power::BATTERY_PROFILE_THRESHOLD,
+        "Battery Profile",
+        nullptr,
+        "If enabled, the settings in this category replace your usual ones "
+        "while your device is running on battery power "
+        "and its charge is at or below this level. "
+        "Your usual settings are restored once the device is charging "
+        "or the battery level rises a little above the threshold. "
+        "Ignored if the frontend can't query the power status. "
+        "Profiles defined in power_profiles.cfg (in the core's save directory) "
+        "are checked before this one.",
+        nullptr,
+        config::power::CATEGORY,
+        {
+            {MelonDsDs::config::values::DISABLED, nullptr},
+            {"100", "Whenever on battery"},
+            {"75", "75%"},
+            {"50", "50%"},
+            {"30", "30%"},
+            {"20", "20%"},
+            {"10", "10%"},
+            {nullptr, nullptr},
+        },
+        MelonDsDs::config::values::DISABLED
+    };
+
+#if defined(HAVE_THREADS) && defined(HAVE_THREADED_RENDERER)
+    constexpr retro_core_option_v2_definition BatteryProfileThreadedRenderer {
+        config::power::BATTERY_PROFILE_THREADED_RENDERER,
+        "Battery Profile: Threaded Software Renderer",
+        nullptr,
+        "Overrides the threaded software renderer setting "
+        "while the battery profile is active.",
+        nullptr,
+        config::power::CATEGORY,
+        {
+            {MelonDsDs::config::values::UNCHANGED, "Unchanged"},
+            {MelonDsDs::config::values::DISABLED, nullptr},
+            {MelonDsDs::config::values::ENABLED, nullptr},
+            {nullptr, nullptr},
+        },
+        MelonDsDs::config::values::UNCHANGED
+    };
+#endif
+
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+    constexpr retro_core_option_v2_definition BatteryProfileOpenGlScaleFactor {
+        config::power::BATTERY_PROFILE_OPENGL_RESOLUTION,
+        "Battery Profile: Internal Resolution",
+        nullptr,
+        "Overrides the internal resolution "
+        "while the battery profile is active. "
+        "OpenGL renderer only.",
+        nullptr,
+        config::power::CATEGORY,
+        {
+            {MelonDsDs::config::values::UNCHANGED, "Unchanged"},
+            {"1", "1x native (256 x 192)"},
+            {"2", "2x native (512 x 384)"},
+            {"3", "3x native (768 x 576)"},
+            {"4", "4x native (1024 x 768)"},
+            {nullptr, nullptr},
+        },
+        MelonDsDs::config::values::UNCHANGED
+    };
+#endif
+
+    constexpr retro_core_option_v2_definition BatteryProfileAudioInterpolation {
+        config::power::BATTERY_PROFILE_AUDIO_INTERPOLATION,
+        "Battery Profile: Audio Interpolation",
+        nullptr,
+        "Overrides the audio interpolation setting "
+        "while the battery profile is active.",
+        nullptr,
+        config::power::CATEGORY,
+        {
+            {MelonDsDs::config::values::UNCHANGED, "Unchanged"},
+            {MelonDsDs::config::values::DISABLED, nullptr},
+            {MelonDsDs::config::values::LINEAR, "Linear"},
+            {MelonDsDs::config::values::COSINE, "Cosine"},
+            {MelonDsDs::config::values::CUBIC, "Cubic"},
+            {MelonDsDs::config::values::GAUSSIAN, "Gaussian"},
+            {nullptr, nullptr},
+        },
+        MelonDsDs::config::values::UNCHANGED
+    };
+
+    constexpr retro_core_option_v2_definition BatteryProfileOsd {
+        config::power::BATTERY_PROFILE_OSD,
+        "Battery Profile: On-Screen Display",
+        nullptr,
+        "If disabled, on-screen status indicators are hidden "
+        "while the battery profile is active. "
+        "Warnings and errors are still shown.",
+        nullptr,
+        config::power::CATEGORY,
+        {
+            {MelonDsDs::config::values::UNCHANGED, "Unchanged"},
+            {MelonDsDs::config::values::DISABLED, nullptr},
+            {nullptr, nullptr},
+        },
+        MelonDsDs::config::values::UNCHANGED
+    };
+
+    constexpr std::initializer_list<retro_core_option_v2_definition> PowerOptionDefinitions {
+        BatteryProfileThreshold,
+#if defined(HAVE_THREADS) && defined(HAVE_THREADED_RENDERER)
+        BatteryProfileThreadedRenderer,
+#endif
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+        BatteryProfileOpenGlScaleFactor,
+#endif
+        BatteryProfileAudioInterpolation,
+        BatteryProfileOsd,
+    };
+}
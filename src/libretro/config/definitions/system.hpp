@@ -148,6 +148,24 @@ namespace MelonDsDs::config::definitions {
         MelonDsDs::config::values::NOT_FOUND
     };
 
+    constexpr retro_core_option_v2_definition NandCache {
+        config::storage::DSI_NAND_CACHE,
+        "DSi NAND Cache",
+        nullptr,
+        "If enabled, recently-used parts of the DSi NAND image are kept in memory, "
+        "which may speed up booting on slow storage. "
+        "Changes are still written to the image immediately. "
+        "Changes take effect at next restart.",
+        nullptr,
+        config::system::CATEGORY,
+        {
+            {MelonDsDs::config::values::DISABLED, nullptr},
+            {MelonDsDs::config::values::ENABLED, nullptr},
+            {nullptr, nullptr},
+        },
+        MelonDsDs::config::values::DISABLED
+    };
+
     constexpr retro_core_option_v2_definition BootMode {
         config::system::BOOT_MODE,
         "Boot Mode",
@@ -384,12 +402,56 @@ namespace MelonDsDs::config::definitions {
         values::ENABLED
     };
 
+    constexpr retro_core_option_v2_definition PerGameProfiles {
+        config::system::PER_GAME_PROFILES,
+        "Per-Game Profiles",
+        nullptr,
+        "If enabled, performance settings for each game "
+        "(such as JIT options and the threaded software renderer) "
+        "can be overridden by a profile in the save directory's profiles folder. "
+        "If set to Auto-Tune, the core will also try a different candidate configuration "
+        "each time the game runs (for about a minute), "
+        "then keep whichever one was fastest. "
+        "Delete the profile to start over. "
+        "Changes take effect at next restart.",
+        nullptr,
+        config::system::CATEGORY,
+        {
+            {MelonDsDs::config::values::DISABLED, nullptr},
+            {MelonDsDs::config::values::ENABLED, nullptr},
+            {MelonDsDs::config::values::TUNE, "Auto-Tune"},
+            {nullptr, nullptr},
+        },
+        MelonDsDs::config::values::DISABLED
+    };
+
+    constexpr retro_core_option_v2_definition SuspendOnExit {
+        config::system::SUSPEND_ON_EXIT,
+        "Suspend on Exit",
+        nullptr,
+        "If enabled, closing a game saves the emulated console's complete state "
+        "to a file in the save directory, "
+        "and the next launch of the same game with the same settings "
+        "resumes right where it left off instead of booting. "
+        "The file is deleted once it's been resumed. "
+        "Not supported in DSi mode.",
+        nullptr,
+        config::system::CATEGORY,
+        {
+            {values::DISABLED, nullptr},
+            {values::ENABLED, nullptr},
+            {nullptr, nullptr},
+        },
+        values::DISABLED
+    };
+
     constexpr std::initializer_list<retro_core_option_v2_definition> SystemOptionDefinitions {
         ConsoleMode,
         SysfileMode,
         FirmwarePath,
         DsiFirmwarePath,
         NandPath,
+        NandCache,
         BootMode,
         DsiSdCardSaveMode,
         DsiSdCardReadOnly,
@@ -400,6 +462,8 @@ namespace MelonDsDs::config::definitions {
         HomebrewSdCardSyncToHost,
         BatteryUpdateInterval,
         NdsPowerOkThreshold,
+        PerGameProfiles,
+        SuspendOnExit,
     };
 }
 
@@ -36,6 +36,9 @@ namespace MelonDsDs::config::definitions {
         "plus or minus a specified offset. "
         "Will be constrained to dates that the DS can represent.\n"
         "- Absolute: Start at a specific date and time, regardless of your device's clock.\n"
+        "- Virtual: Start at exactly the Absolute date and time, "
+        "then advance only with emulated time. "
+        "Never reads your device's clock, so runs are reproducible.\n"
         "\n"
         "All dates and times are in your local timezone. "
         "Changes take effect at next restart.",
@@ -46,6 +49,7 @@ namespace MelonDsDs::config::definitions {
             {values::SYNC, "Synchronized"},
             {values::RELATIVE_TIME, "Relative"},
             {values::ABSOLUTE_TIME, "Absolute"},
+            {values::VIRTUAL_TIME, "Virtual"},
             {nullptr, nullptr},
         },
         values::REAL
@@ -365,7 +369,7 @@ namespace MelonDsDs::config::definitions {
         config::time::ABSOLUTE_YEAR,
         "Starting Year",
         nullptr,
-        "The initial year to use when Starting Time Mode is Absolute. "
+        "The initial year to use when Starting Time Mode is Absolute or Virtual. "
         "Changes take effect at next restart.",
         nullptr,
         config::time::CATEGORY,
@@ -480,7 +484,7 @@ namespace MelonDsDs::config::definitions {
         config::time::ABSOLUTE_MONTH,
         "Starting Month",
         nullptr,
-        "The initial month to use when Starting Time Mode is Absolute. "
+        "The initial month to use when Starting Time Mode is Absolute or Virtual. "
         "Changes take effect at next restart.",
         nullptr,
         config::time::CATEGORY,
@@ -506,7 +510,7 @@ namespace MelonDsDs::config::definitions {
         config::time::ABSOLUTE_DAY,
         "Starting Day",
         nullptr,
-        "The initial day of the month to use when Starting Time Mode is Absolute. "
+        "The initial day of the month to use when Starting Time Mode is Absolute or Virtual. "
         "Days that extend past the end of a month will roll over to the next (e.g. April 31st will become May 1st). "
         "Changes take effect at next restart.",
         nullptr,
@@ -552,7 +556,7 @@ namespace MelonDsDs::config::definitions {
         config::time::ABSOLUTE_HOUR,
         "Starting Hour",
         nullptr,
-        "The initial hour to use when Starting Time Mode is Absolute. "
+        "The initial hour to use when Starting Time Mode is Absolute or Virtual. "
         "Changes take effect at next restart.",
         nullptr,
         config::time::CATEGORY,
@@ -590,7 +594,7 @@ namespace MelonDsDs::config::definitions {
         config::time::ABSOLUTE_MINUTE,
         "Starting Minute",
         nullptr,
-        "The initial minute to use when Starting Time Mode is Absolute. "
+        "The initial minute to use when Starting Time Mode is Absolute or Virtual. "
         "Changes take effect at next restart.",
         nullptr,
         config::time::CATEGORY,
@@ -84,22 +84,48 @@ namespace MelonDsDs::config::definitions {
         MelonDsDs::config::values::DISABLED
     };
 #endif
+#if defined(HAVE_OPENGL) && defined(HAVE_EGL)
+    constexpr retro_core_option_v2_definition OpenGlHeadless {
+        config::video::OPENGL_HEADLESS,
+        "Headless OpenGL",
+        nullptr,
+        "If enabled, the OpenGL renderer creates its own offscreen context "
+        "instead of using one from the frontend, "
+        "then sends each frame to the frontend as if it were software-rendered. "
+        "Useful for frontends without hardware rendering support. "
+        "Adds one frame of video latency. "
+        "Changes take effect when the core is restarted. "
+        "OpenGL renderer only.",
+        nullptr,
+        config::video::CATEGORY,
+        {
+            {MelonDsDs::config::values::DISABLED, nullptr},
+            {MelonDsDs::config::values::ENABLED, nullptr},
+            {nullptr, nullptr},
+        },
+        MelonDsDs::config::values::DISABLED
+    };
+#endif
 #if defined(HAVE_THREADS) && defined(HAVE_THREADED_RENDERER)
     constexpr retro_core_option_v2_definition ThreadedSoftwareRenderer {
         config::video::THREADED_RENDERER,
         "Threaded Software Renderer",
         nullptr,
         "If enabled, the software renderer will run on a separate thread. "
+        "Auto checks this device's CPU, "
+        "then tries both settings for the first few seconds of each new game "
+        "and remembers whichever is faster. "
         "Changes take effect immediately. "
-        "If unsure, leave this enabled.",
+        "If unsure, set to Auto.",
         nullptr,
         config::video::CATEGORY,
         {
+            {MelonDsDs::config::values::AUTO, "Auto"},
             {MelonDsDs::config::values::DISABLED, nullptr},
             {MelonDsDs::config::values::ENABLED, nullptr},
             {nullptr, nullptr},
         },
-        MelonDsDs::config::values::ENABLED
+        MelonDsDs::config::values::AUTO
     };
 #endif
 
@@ -109,6 +135,9 @@ namespace MelonDsDs::config::definitions {
         OpenGlScaleFactor,
         OpenGlBetterPolygons,
 #endif
+#if defined(HAVE_OPENGL) && defined(HAVE_EGL)
+        OpenGlHeadless,
+#endif
 #if defined(HAVE_THREADS) && defined(HAVE_THREADED_RENDERER)
         ThreadedSoftwareRenderer,
 #endif
@@ -136,6 +136,12 @@ namespace MelonDsDs {
         return std::nullopt;
     }
 
+    constexpr std::optional<MelonDsDs::NetplayMode> ParseNetplayMode(std::string_view value) noexcept {
+        if (value == config::values::WIRELESS) return MelonDsDs::NetplayMode::LocalWireless;
+        if (value == config::values::ROLLBACK) return MelonDsDs::NetplayMode::Rollback;
+        return std::nullopt;
+    }
+
     constexpr std::optional<MelonDsDs::ScreenLayout> ParseScreenLayout(std::string_view value) noexcept {
         using MelonDsDs::ScreenLayout;
         if (value == config::values::TOP_BOTTOM) return ScreenLayout::TopBottom;
@@ -226,11 +232,19 @@ namespace MelonDsDs {
         return std::nullopt;
     }
 
+    constexpr std::optional<MelonDsDs::TitleProfileMode> ParseTitleProfileMode(std::string_view value) noexcept {
+        if (value == config::values::DISABLED) return TitleProfileMode::Disabled;
+        if (value == config::values::ENABLED) return TitleProfileMode::Enabled;
+        if (value == config::values::TUNE) return TitleProfileMode::Tune;
+        return std::nullopt;
+    }
+
     constexpr std::optional<MelonDsDs::StartTimeMode> ParseStartTimeMode(std::string_view value) noexcept {
         if (value == config::values::REAL) return StartTimeMode::Real;
         if (value == config::values::SYNC) return StartTimeMode::Sync;
         if (value == config::values::RELATIVE_TIME) return StartTimeMode::Relative;
         if (value == config::values::ABSOLUTE_TIME) return StartTimeMode::Absolute;
+        if (value == config::values::VIRTUAL_TIME) return StartTimeMode::Virtual;
 
         return std::nullopt;
     }
@@ -171,11 +171,25 @@ namespace MelonDsDs {
         Indirect,
     };
 
+    enum class NetplayMode {
+        /// Each player runs their own console, connected by emulated local wireless
+        LocalWireless,
+        /// All players share one console, with the core predicting and correcting remote input
+        Rollback,
+    };
+
+    enum class TitleProfileMode {
+        Disabled,
+        Enabled,
+        Tune,
+    };
+
     enum class StartTimeMode {
         Real,
         Sync,
         Relative,
         Absolute,
+        Virtual,
     };
 
     enum class FormattedGLEnum {};
@@ -54,6 +54,9 @@ bool MelonDsDs::CoreOptionVisibility::Update() noexcept {
     if (!VisibilityInitialized || ShowOpenGlOptions != oldShowOpenGlOptions) {
         set_option_visible(video::OPENGL_RESOLUTION, ShowOpenGlOptions);
         set_option_visible(video::OPENGL_BETTER_POLYGONS, ShowOpenGlOptions);
+#if defined(HAVE_OPENGL) && defined(HAVE_EGL)
+        set_option_visible(video::OPENGL_HEADLESS, ShowOpenGlOptions);
+#endif
         updated = true;
     }
 #ifdef HAVE_THREADED_RENDERER
@@ -73,6 +76,7 @@ bool MelonDsDs::CoreOptionVisibility::Update() noexcept {
     if (!VisibilityInitialized || ShowDsiOptions != oldShowDsiOptions) {
         set_option_visible(config::system::FIRMWARE_DSI_PATH, ShowDsiOptions);
         set_option_visible(config::storage::DSI_NAND_PATH, ShowDsiOptions);
+        set_option_visible(config::storage::DSI_NAND_CACHE, ShowDsiOptions);
         set_option_visible(storage::DSI_SD_SAVE_MODE, ShowDsiOptions);
         updated = true;
     }
@@ -196,7 +200,7 @@ bool MelonDsDs::CoreOptionVisibility::Update() noexcept {
     }
 
     bool oldShowAbsoluteTime = ShowAbsoluteStartTime;
-    ShowAbsoluteStartTime = !timeMode || *timeMode == StartTimeMode::Absolute;
+    ShowAbsoluteStartTime = !timeMode || *timeMode == StartTimeMode::Absolute || *timeMode == StartTimeMode::Virtual;
     if (!VisibilityInitialized || ShowAbsoluteStartTime != oldShowAbsoluteTime) {
         set_option_visible(time::ABSOLUTE_YEAR, ShowAbsoluteStartTime);
         set_option_visible(time::ABSOLUTE_MONTH, ShowAbsoluteStartTime);
@@ -206,6 +210,20 @@ bool MelonDsDs::CoreOptionVisibility::Update() noexcept {
         updated = true;
     }
 
+    bool oldShowBatteryProfileOptions = ShowBatteryProfileOptions;
+    ShowBatteryProfileOptions = get_variable(power::BATTERY_PROFILE_THRESHOLD) != values::DISABLED;
+    if (!VisibilityInitialized || ShowBatteryProfileOptions != oldShowBatteryProfileOptions) {
+#if defined(HAVE_THREADS) && defined(HAVE_THREADED_RENDERER)
+        set_option_visible(power::BATTERY_PROFILE_THREADED_RENDERER, ShowBatteryProfileOptions);
+#endif
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+        set_option_visible(power::BATTERY_PROFILE_OPENGL_RESOLUTION, ShowBatteryProfileOptions);
+#endif
+        set_option_visible(power::BATTERY_PROFILE_AUDIO_INTERPOLATION, ShowBatteryProfileOptions);
+        set_option_visible(power::BATTERY_PROFILE_OSD, ShowBatteryProfileOptions);
+        updated = true;
+    }
+
     VisibilityInitialized = true;
     return updated;
 }
@@ -35,6 +35,7 @@ namespace MelonDsDs {
         unsigned NumberOfShownScreenLayouts = config::screen::MAX_SCREEN_LAYOUTS;
         bool ShowRelativeStartTime = false;
         bool ShowAbsoluteStartTime = false;
+        bool ShowBatteryProfileOptions = true;
 #ifdef JIT_ENABLED
         bool ShowJitOptions = true;
 #endif
@@ -25,4 +25,9 @@ namespace MelonDsDs {
     constexpr double FPS = 33513982.0 / 560190.0; // In frames per second
     constexpr double SAMPLE_RATE =  33513982.0 / 1024.0; // In Hz
     constexpr std::chrono::microseconds US_PER_FRAME {static_cast<int64_t>(1000000.0 / FPS)};
+
+    // The DS outputs one audio sample every 1024 cycles and runs 560190 cycles per frame
+    constexpr uint32_t CYCLES_PER_SAMPLE = 1024;
+    constexpr uint32_t CYCLES_PER_FRAME = 560190;
+    constexpr uint32_t MAX_SAMPLES_PER_FRAME = CYCLES_PER_FRAME / CYCLES_PER_SAMPLE + 1;
 }
\ No newline at end of file
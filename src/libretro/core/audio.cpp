@@ -0,0 +1,210 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#include "audio.hpp"
+
+#include <algorithm>
+
+#include <audio/audio_resampler.h>
+#include <audio/conversion/float_to_s16.h>
+#include <audio/conversion/s16_to_float.h>
+#include <retro_assert.h>
+
+#include "config/config.hpp"
+#include "environment.hpp"
+#include "tracy.hpp"
+
+using std::optional;
+using std::chrono::duration;
+
+MelonDsDs::AudioState::AudioState() noexcept {
+    // Picks the NEON implementations at runtime on ARM; a no-op elsewhere
+    convert_s16_to_float_init_simd();
+    convert_float_to_s16_init_simd();
+}
+
+MelonDsDs::AudioState::~AudioState() noexcept {
+    if (_resampler && _resamplerBackend) {
+        _resamplerBackend->free(_resampler);
+    }
+}
+
+void MelonDsDs::AudioState::SetConfig(const CoreConfig& config) noexcept {
+    ZoneScopedN(TracyFunction);
+    bool enabled = config.AudioRateControl();
+    if (enabled == _enabled)
+        return;
+
+    if (enabled) {
+        if (!_resampler) {
+            // The sinc resampler is vectorized with SSE, AVX, or NEON, depending on the build
+            if (!retro_resampler_realloc(&_resampler, &_resamplerBackend, "sinc", RESAMPLER_QUALITY_NORMAL, 1.0 - MAX_RATIO_DELTA)) {
+                retro::error("Failed to initialize the audio resampler; audio rate control will be disabled");
+                _resampler = nullptr;
+                _resamplerBackend = nullptr;
+                return;
+            }
+            retro::debug("Initialized audio resampler \"{}\"", _resamplerBackend->ident);
+        }
+
+        if (!retro::set_audio_buffer_status_callback(true)) {
+            retro::info("Frontend doesn't report its audio buffer status, so audio will be rate-controlled by frame pacing instead");
+        }
+    }
+    else {
+        retro::set_audio_buffer_status_callback(false);
+    }
+
+    retro::debug("{} audio rate control", enabled ? "Enabled" : "Disabled");
+    _enabled = enabled;
+    _lastSubmit = std::nullopt;
+    _frameInterval = 0;
+}
+
+void MelonDsDs::AudioState::Submit(std::span<const int16_t> samples) noexcept {
+    ZoneScopedN(TracyFunction);
+    size_t frames = samples.size() / 2;
+    _stats.FramesIn += frames;
+
+    clock::time_point now = clock::now();
+    if (_frameEmulated) {
+        double delayUs = duration<double, std::micro>(now - *_frameEmulated).count();
+        _stats.SubmitDelayUs += (delayUs - _stats.SubmitDelayUs) * SMOOTHING;
+        _frameEmulated = std::nullopt;
+    }
+
+    if (!_enabled) {
+        Send(samples.data(), frames);
+        _stats.Ratio = 1.0;
+        return;
+    }
+
+    if (_lastSubmit && now - *_lastSubmit < MAX_FRAME_INTERVAL) {
+        double intervalUs = duration<double, std::micro>(now - *_lastSubmit).count();
+        // Start from the nominal rate so that the first few frames don't swing the pitch
+        double previous = _frameInterval > 0 ? _frameInterval : NOMINAL_FRAME_US;
+        _frameInterval = previous + (intervalUs - previous) * PACING_SMOOTHING;
+    }
+    _lastSubmit = now;
+
+    Output(samples);
+}
+
+double MelonDsDs::AudioState::TargetRatio() noexcept {
+    optional<retro::AudioBufferStatus> status = retro::get_audio_buffer_status();
+    if (!status) {
+        _stats.RateControlSource = static_cast<int32_t>(RateControlSource::FramePacing);
+        return PacingRatio();
+    }
+
+    _stats.RateControlSource = static_cast<int32_t>(RateControlSource::BufferStatus);
+
+    // Only the frontend can see its own buffer, so without a status these stay at zero
+    if (status->UnderrunLikely || status->Occupancy == 0) {
+        _stats.Underruns++;
+    }
+    else if (status->Occupancy >= 100) {
+        _stats.Overruns++;
+    }
+
+    // Produce slightly more audio while the frontend's buffer is under half-full, and slightly less while it's over
+    double fill = status->Occupancy / 100.0;
+    return 1.0 + MAX_RATIO_DELTA * (1.0 - 2.0 * fill);
+}
+
+double MelonDsDs::AudioState::PacingRatio() noexcept {
+    if (_frameInterval <= 0)
+        return 1.0;
+
+    // If the frontend runs the core faster than the console's ~59.83 Hz (e.g. at a 60 Hz refresh rate),
+    // its audio device is still consuming at the nominal rate, so produce proportionally less audio per frame
+    double ratio = _frameInterval / NOMINAL_FRAME_US;
+    return std::clamp(ratio, 1.0 - MAX_RATIO_DELTA, 1.0 + MAX_RATIO_DELTA);
+}
+
+void MelonDsDs::AudioState::Output(std::span<const int16_t> samples) noexcept {
+    ZoneScopedN(TracyFunction);
+    size_t frames = samples.size() / 2;
+    _stats.Ratio = TargetRatio();
+
+    if (!_resampler) {
+        Send(samples.data(), frames);
+        return;
+    }
+
+    // The SPU may have built up more than a frame's worth of audio (e.g. after a skipped frame),
+    // so resample it in pieces that fit the conversion buffers
+    for (size_t offset = 0; offset < frames; offset += MAX_SAMPLES_PER_FRAME) {
+        size_t chunk = std::min<size_t>(frames - offset, MAX_SAMPLES_PER_FRAME);
+        convert_s16_to_float(_inputFloat.data(), samples.data() + offset * 2, chunk * 2, 1.0f);
+        resampler_data data {
+            .data_in = _inputFloat.data(),
+            .data_out = _outputFloat.data(),
+            .input_frames = chunk,
+            .output_frames = 0,
+            .ratio = _stats.Ratio,
+        };
+        _resamplerBackend->process(_resampler, &data);
+        retro_assert(data.output_frames <= MAX_OUTPUT_FRAMES);
+
+        convert_float_to_s16(_output.data(), _outputFloat.data(), data.output_frames * 2);
+        Send(_output.data(), data.output_frames);
+    }
+}
+
+void MelonDsDs::AudioState::Send(const int16_t* samples, size_t frames) noexcept {
+    clock::time_point start = clock::now();
+    retro::audio_sample_batch(samples, frames);
+    double callUs = duration<double, std::micro>(clock::now() - start).count();
+
+    _stats.BatchCallUs += (callUs - _stats.BatchCallUs) * SMOOTHING;
+    _stats.BatchCalls++;
+    _stats.FramesOut += frames;
+}
+
+void MelonDsDs::AudioState::Reset() noexcept {
+    if (_enabled) {
+        retro::set_audio_buffer_status_callback(false);
+    }
+
+    _enabled = false;
+    _frameEmulated = std::nullopt;
+    _lastSubmit = std::nullopt;
+    _frameInterval = 0;
+    _stats = {};
+}
+
+MelonDsDs::AudioStats MelonDsDs::AudioState::Stats() const noexcept {
+    return _stats;
+}
+
+void MelonDsDs::AudioState::LogStats() const noexcept {
+    if (_stats.FramesIn == 0)
+        return;
+
+    retro::info(
+        "Audio: {} frame(s) in, {} out; {} underrun(s), {} overrun(s); last ratio {:.4f}; "
+        "submitted {:.0f}us after emulation, {:.0f}us per audio_sample_batch call",
+        _stats.FramesIn,
+        _stats.FramesOut,
+        _stats.Underruns,
+        _stats.Overruns,
+        _stats.Ratio,
+        _stats.SubmitDelayUs,
+        _stats.BatchCallUs
+    );
+}
@@ -0,0 +1,125 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+#include "constants.hpp"
+#include "std/span.hpp"
+
+struct retro_resampler;
+
+namespace MelonDsDs {
+    class CoreConfig;
+
+    /// Audio statistics since the game was loaded.
+    /// Exposed to C callers as-is, so keep it standard-layout.
+    struct AudioStats {
+        /// Stereo frames produced by the SPU
+        uint64_t FramesIn;
+        /// Stereo frames sent to the frontend
+        uint64_t FramesOut;
+        /// Frames on which the frontend's audio buffer was empty or about to run dry
+        uint64_t Underruns;
+        /// Frames on which the frontend's audio buffer was full, so new audio would block or be dropped
+        uint64_t Overruns;
+        /// The most recent resampling ratio (output frames per input frame)
+        double Ratio;
+        /// What's steering the ratio; one of the values in RateControlSource
+        int32_t RateControlSource;
+        /// Calls to the frontend's audio_sample_batch
+        uint64_t BatchCalls;
+        /// Smoothed time from the end of emulating a frame until its audio was submitted
+        double SubmitDelayUs;
+        /// Smoothed time spent inside each audio_sample_batch call
+        double BatchCallUs;
+    };
+
+    enum class RateControlSource : int32_t {
+        /// Audio is passed through unchanged
+        None = 0,
+        /// The frontend reports how full its audio buffer is
+        BufferStatus = 1,
+        /// The frontend doesn't, so the ratio follows how often it runs the core instead
+        FramePacing = 2,
+    };
+
+    /// Sends the SPU's output to the frontend.
+    /// With rate control enabled, each frame's audio is resampled by a ratio
+    /// that nudges the frontend's audio buffer towards half-full
+    /// (or, if the frontend doesn't report its buffer, that matches the rate it runs the core at),
+    /// so that small mismatches between the emulated and host clocks don't cause crackling.
+    class AudioState {
+    public:
+        AudioState() noexcept;
+        ~AudioState() noexcept;
+        AudioState(const AudioState&) = delete;
+        AudioState& operator=(const AudioState&) = delete;
+        AudioState(AudioState&&) = delete;
+        AudioState& operator=(AudioState&&) = delete;
+
+        void SetConfig(const CoreConfig& config) noexcept;
+
+        /// Call as soon as the frame's emulation is done, before its audio is submitted.
+        void FrameEmulated() noexcept { _frameEmulated = clock::now(); }
+
+        /// Submits one frame's worth of interleaved stereo samples.
+        void Submit(std::span<const int16_t> samples) noexcept;
+
+        /// Discards statistics and stops rate control
+        /// until the next call to SetConfig.
+        void Reset() noexcept;
+        [[nodiscard]] AudioStats Stats() const noexcept;
+        void LogStats() const noexcept;
+    private:
+        using clock = std::chrono::steady_clock;
+
+        // How far the ratio may stray from 1; inaudible as a pitch change
+        static constexpr double MAX_RATIO_DELTA = 0.005;
+        // Weight of each new sample in the smoothed timings
+        static constexpr double SMOOTHING = 1.0 / 32.0;
+        // Weight of each new frame interval when estimating the frontend's frame rate;
+        // small, so that a single late frame barely moves the pitch
+        static constexpr double PACING_SMOOTHING = 1.0 / 256.0;
+        static constexpr double NOMINAL_FRAME_US = 1000000.0 / FPS;
+        // Frame intervals longer than this (pauses, menus, loading) say nothing about the frontend's rate
+        static constexpr std::chrono::microseconds MAX_FRAME_INTERVAL = US_PER_FRAME * 4;
+        static constexpr size_t MAX_OUTPUT_FRAMES = static_cast<size_t>(MAX_SAMPLES_PER_FRAME * (1.0 + MAX_RATIO_DELTA)) + 16;
+
+        [[nodiscard]] double TargetRatio() noexcept;
+        [[nodiscard]] double PacingRatio() noexcept;
+        void Output(std::span<const int16_t> samples) noexcept;
+        void Send(const int16_t* samples, size_t frames) noexcept;
+
+        bool _enabled = false;
+        std::optional<clock::time_point> _frameEmulated = std::nullopt;
+        std::optional<clock::time_point> _lastSubmit = std::nullopt;
+        // Smoothed time between calls to Submit, in microseconds
+        double _frameInterval = 0;
+        void* _resampler = nullptr;
+        const retro_resampler* _resamplerBackend = nullptr;
+        // Aligned for the SIMD sample converters
+        alignas(16) std::array<float, MAX_SAMPLES_PER_FRAME * 2> _inputFloat {};
+        alignas(16) std::array<float, MAX_OUTPUT_FRAMES * 2> _outputFloat {};
+        alignas(16) std::array<int16_t, MAX_OUTPUT_FRAMES * 2> _output {};
+        AudioStats _stats {};
+    };
+}
@@ -0,0 +1,334 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#include "cheats.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <optional>
+
+#include <NDS.h>
+
+#include "environment.hpp"
+#include "tracy.hpp"
+
+using std::vector;
+using melonDS::ARCode;
+
+namespace {
+    // Merged writes must land in the first 4MiB of main RAM,
+    // which isn't mirrored within itself on either console (so each address names exactly one byte)
+    constexpr uint32_t MERGEABLE_START = 0x02000000;
+    constexpr uint32_t MERGEABLE_END = 0x02400000;
+    constexpr uint32_t ADDRESS_MASK = 0x0FFFFFFF;
+
+    // A half-open range of addresses
+    struct Range {
+        uint32_t Start;
+        uint32_t End;
+    };
+
+    struct ConstantWrite {
+        uint32_t Address;
+        uint32_t Size;
+        uint32_t Value;
+    };
+
+    enum class CodeKind {
+        // Nothing but unconditional constant writes to main RAM
+        Constant,
+        // Conditionals and writes, all at addresses known ahead of time
+        Fixed,
+        // Uses the offset or data registers, loops, or opcodes we don't look into; could touch anything
+        Opaque,
+    };
+
+    struct CodeAnalysis {
+        CodeKind Kind = CodeKind::Constant;
+        vector<ConstantWrite> Writes {};
+        // Addresses that the code reads or writes, folded into the main RAM mirror that merged writes use
+        vector<Range> Touched {};
+    };
+
+    void AddTouched(vector<Range>& touched, uint32_t address, uint32_t size) noexcept {
+        uint32_t region = address >> 24;
+        if (region != 0x02 && region != 0x0C) {
+            // Not main RAM, so it can't overlap a merged write
+            touched.push_back({address, address + size});
+            return;
+        }
+
+        // Treat every main RAM mirror as aliasing the merged range;
+        // on the DSi this is stricter than it needs to be, but never wrong
+        uint32_t start = MERGEABLE_START | (address & (MERGEABLE_END - MERGEABLE_START - 1));
+        uint32_t end = start + size;
+        touched.push_back({start, std::min(end, MERGEABLE_END)});
+        if (end > MERGEABLE_END) {
+            touched.push_back({MERGEABLE_START, MERGEABLE_START + (end - MERGEABLE_END)});
+        }
+    }
+
+    CodeAnalysis Analyze(const ARCode& code) noexcept {
+        CodeAnalysis analysis;
+        if (code.Code.size() % 2 != 0) {
+            analysis.Kind = CodeKind::Opaque;
+            return analysis;
+        }
+
+        unsigned conditionDepth = 0;
+        for (size_t i = 0; i < code.Code.size(); i += 2) {
+            uint32_t a = code.Code[i];
+            uint32_t b = code.Code[i + 1];
+            uint32_t address = a & ADDRESS_MASK;
+            switch (a >> 28) {
+                case 0x0: // 32-bit write
+                case 0x1: // 16-bit write
+                case 0x2: { // 8-bit write
+                    uint32_t size = 4u >> (a >> 28);
+                    uint32_t value = size == 4 ? b : b & ((1u << (size * 8)) - 1);
+                    bool mergeable = conditionDepth == 0
+                        && address % size == 0
+                        && address >= MERGEABLE_START
+                        && address + size <= MERGEABLE_END;
+
+                    AddTouched(analysis.Touched, address, size);
+                    if (mergeable) {
+                        analysis.Writes.push_back({address, size, value});
+                    }
+                    else if (analysis.Kind == CodeKind::Constant) {
+                        analysis.Kind = CodeKind::Fixed;
+                    }
+                    break;
+                }
+                case 0x3: // 32-bit comparisons
+                case 0x4:
+                case 0x5:
+                case 0x6:
+                case 0x7: // 16-bit masked comparisons
+                case 0x8:
+                case 0x9:
+                case 0xA:
+                    if (address == 0) {
+                        // Some engines read from the offset register's address here, so don't guess
+                        analysis.Kind = CodeKind::Opaque;
+                        return analysis;
+                    }
+
+                    AddTouched(analysis.Touched, address, (a >> 28) <= 0x6 ? 4 : 2);
+                    ++conditionDepth;
+                    analysis.Kind = CodeKind::Fixed;
+                    break;
+                case 0xD:
+                    if ((a >> 24) == 0xD0) {
+                        // End of the innermost conditional
+                        conditionDepth = conditionDepth ? conditionDepth - 1 : 0;
+                    }
+                    else if ((a >> 24) == 0xD2) {
+                        // End of every conditional and loop, and the registers are cleared
+                        conditionDepth = 0;
+                    }
+                    else {
+                        analysis.Kind = CodeKind::Opaque;
+                        return analysis;
+                    }
+                    break;
+                default:
+                    analysis.Kind = CodeKind::Opaque;
+                    return analysis;
+            }
+        }
+
+        return analysis;
+    }
+
+    bool Overlaps(const vector<Range>& touched, const vector<ConstantWrite>& writes) noexcept {
+        for (const ConstantWrite& write : writes) {
+            for (const Range& range : touched) {
+                if (write.Address < range.End && range.Start < write.Address + write.Size)
+                    return true;
+            }
+        }
+
+        return false;
+    }
+
+    uint32_t ReadWord(const vector<uint8_t>& bytes, size_t i) noexcept {
+        return bytes[i] | (bytes[i + 1] << 8) | (bytes[i + 2] << 16) | (static_cast<uint32_t>(bytes[i + 3]) << 24);
+    }
+
+    // Writes a contiguous run of bytes with as few instructions as possible
+    void EmitRun(uint32_t address, const vector<uint8_t>& bytes, vector<uint32_t>& code) noexcept {
+        size_t i = 0;
+        while (i < bytes.size()) {
+            uint32_t target = address + i;
+            size_t remaining = bytes.size() - i;
+            if (target % 4 == 0 && remaining >= 8) {
+                // EXXXXXXX YYYYYYYY copies the Y bytes that follow to XXXXXXX;
+                // we only copy whole 8-byte blocks, so the data needs no padding
+                size_t length = remaining & ~size_t(7);
+                code.push_back(0xE0000000 | target);
+                code.push_back(length);
+                for (size_t j = 0; j < length; j += 4) {
+                    code.push_back(ReadWord(bytes, i + j));
+                }
+                i += length;
+            }
+            else if (target % 4 == 0 && remaining >= 4) {
+                code.push_back(0x00000000 | target);
+                code.push_back(ReadWord(bytes, i));
+                i += 4;
+            }
+            else if (target % 2 == 0 && remaining >= 2) {
+                code.push_back(0x10000000 | target);
+                code.push_back(bytes[i] | (bytes[i + 1] << 8));
+                i += 2;
+            }
+            else {
+                code.push_back(0x20000000 | target);
+                code.push_back(bytes[i]);
+                i += 1;
+            }
+        }
+    }
+
+    vector<uint32_t> EmitMerged(const std::map<uint32_t, uint8_t>& bytes) noexcept {
+        vector<uint32_t> code;
+        vector<uint8_t> run;
+        for (auto i = bytes.begin(); i != bytes.end();) {
+            uint32_t start = i->first;
+            run.clear();
+            for (; i != bytes.end() && i->first == start + run.size(); ++i) {
+                run.push_back(i->second);
+            }
+
+            EmitRun(start, run, code);
+        }
+
+        return code;
+    }
+}
+
+void MelonDsDs::CheatPlan::Set(unsigned index, ARCode&& code) noexcept {
+    if (index < _codes.size()) {
+        // If we're updating the state of a cheat that already exists...
+        _codes[index] = std::move(code);
+    }
+    else {
+        // If we're adding a new cheat...
+        _codes.push_back(std::move(code));
+    }
+
+    _dirty = true;
+}
+
+void MelonDsDs::CheatPlan::Clear() noexcept {
+    _codes.clear();
+    _plan.clear();
+    _dirty = true;
+}
+
+void MelonDsDs::CheatPlan::Install(melonDS::NDS& nds) noexcept {
+    ZoneScopedN(TracyFunction);
+    if (_dirty) {
+        _plan = Compile(_codes, _stats);
+        _dirty = false;
+        retro::debug(
+            "Compiled {} enabled cheat(s) ({} instructions) into {} code(s) ({} instructions) in {:.2f}ms",
+            _stats.SourceCodes,
+            _stats.SourceInstructions,
+            _stats.PlanCodes,
+            _stats.PlanInstructions,
+            _stats.CompileMs
+        );
+    }
+
+    nds.AREngine.Cheats = _plan;
+}
+
+vector<ARCode> MelonDsDs::CheatPlan::Compile(const vector<ARCode>& codes, CheatPlanStats& stats) noexcept {
+    ZoneScopedN(TracyFunction);
+    auto start = std::chrono::steady_clock::now();
+    CheatPlanStats result {};
+    result.Compilations = stats.Compilations + 1;
+
+    vector<ARCode> plan;
+    // The merged code that constant writes are currently being folded into, and the bytes it writes
+    std::optional<size_t> mergedIndex;
+    std::map<uint32_t, uint8_t> mergedBytes;
+    // What the codes after the merged one could observe, if we moved another write ahead of them
+    vector<Range> touchedSinceMerged;
+    bool opaqueSinceMerged = false;
+
+    auto finishMerged = [&] {
+        if (mergedIndex) {
+            result.MergedBytes += mergedBytes.size();
+            plan[*mergedIndex].Code = EmitMerged(mergedBytes);
+        }
+        mergedBytes.clear();
+        touchedSinceMerged.clear();
+        opaqueSinceMerged = false;
+    };
+
+    for (const ARCode& code : codes) {
+        if (!code.Enabled)
+            continue;
+
+        result.SourceCodes++;
+        result.SourceInstructions += code.Code.size() / 2;
+        CodeAnalysis analysis = Analyze(code);
+        if (analysis.Kind != CodeKind::Constant) {
+            // Keep this code where it is
+            if (analysis.Kind == CodeKind::Opaque) {
+                opaqueSinceMerged = true;
+            }
+            else {
+                touchedSinceMerged.insert(touchedSinceMerged.end(), analysis.Touched.begin(), analysis.Touched.end());
+            }
+            plan.push_back(code);
+            continue;
+        }
+
+        if (!mergedIndex || opaqueSinceMerged || Overlaps(touchedSinceMerged, analysis.Writes)) {
+            // If moving these writes back to the current merged code could change what another code sees...
+            finishMerged();
+            mergedIndex = plan.size();
+            plan.push_back(ARCode { .Name = "Merged constant writes", .Enabled = true, .Code = {} });
+        }
+
+        for (const ConstantWrite& write : analysis.Writes) {
+            for (uint32_t i = 0; i < write.Size; ++i) {
+                // Later writes replace earlier ones, just like they would if each code ran in turn
+                mergedBytes[write.Address + i] = (write.Value >> (i * 8)) & 0xFF;
+            }
+        }
+        result.MergedWrites += analysis.Writes.size();
+    }
+    finishMerged();
+
+    // Codes that only ended conditionals (or wrote nothing) have nothing left to do
+    plan.erase(std::remove_if(plan.begin(), plan.end(), [](const ARCode& code) { return code.Code.empty(); }), plan.end());
+
+    result.PlanCodes = plan.size();
+    for (const ARCode& code : plan) {
+        result.PlanInstructions += code.Code.size() / 2;
+    }
+    result.CompileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stats = result;
+
+    return plan;
+}
@@ -0,0 +1,79 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <ARCodeFile.h>
+
+namespace melonDS {
+    class NDS;
+}
+
+namespace MelonDsDs {
+    struct CheatPlanStats {
+        /// Enabled codes that went into the plan.
+        uint32_t SourceCodes;
+        /// Instruction pairs in the enabled codes.
+        uint32_t SourceInstructions;
+        /// Codes in the plan that melonDS runs every frame.
+        uint32_t PlanCodes;
+        /// Instruction pairs in the plan, counting each patch's data as one instruction per 8 bytes.
+        uint32_t PlanInstructions;
+        /// Constant writes that were folded into merged codes.
+        uint32_t MergedWrites;
+        /// Bytes written by merged codes.
+        uint32_t MergedBytes;
+        uint32_t Compilations;
+        double CompileMs;
+    };
+
+    /// The player's cheats, plus the smaller list that melonDS actually runs.
+    ///
+    /// melonDS interprets every enabled code each time the ARM7 handles a VBlank IRQ,
+    /// and large cheat databases are mostly long runs of constant writes to main RAM.
+    /// The plan folds those writes into as few block copies as possible (last write wins)
+    /// and moves them ahead of any codes that can't observe the difference.
+    /// Conditional codes and anything that depends on the offset or data registers
+    /// are kept as-is, in their original order.
+    class CheatPlan {
+    public:
+        void Set(unsigned index, melonDS::ARCode&& code) noexcept;
+        void Clear() noexcept;
+
+        /// The number of cheats the frontend gave us, including disabled ones.
+        [[nodiscard]] size_t Size() const noexcept { return _codes.size(); }
+        [[nodiscard]] bool Dirty() const noexcept { return _dirty; }
+        [[nodiscard]] const std::vector<melonDS::ARCode>& Codes() const noexcept { return _codes; }
+        [[nodiscard]] const std::vector<melonDS::ARCode>& Plan() const noexcept { return _plan; }
+        [[nodiscard]] const CheatPlanStats& Stats() const noexcept { return _stats; }
+
+        /// Rebuilds the plan if the cheats have changed since the last call,
+        /// then gives it to the console's Action Replay engine.
+        void Install(melonDS::NDS& nds) noexcept;
+
+        static std::vector<melonDS::ARCode> Compile(const std::vector<melonDS::ARCode>& codes, CheatPlanStats& stats) noexcept;
+    private:
+        std::vector<melonDS::ARCode> _codes {};
+        std::vector<melonDS::ARCode> _plan {};
+        CheatPlanStats _stats {};
+        bool _dirty = false;
+    };
+}
@@ -38,6 +38,10 @@
 #include "../message/error.hpp"
 #include "../render/render.hpp"
 #include "../retro/task_queue.hpp"
+#include "../romarchive.hpp"
+#include "../sectorcache.hpp"
+#include "../sparse.hpp"
+#include "../tracy/recorder.hpp"
 #include "render/software.hpp"
 
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
@@ -68,12 +72,48 @@ date::local_seconds LocalTime() noexcept {
     return static_cast<local_days>(date) + time;
 }
 
+static date::local_seconds ConsoleTime(melonDS::NDS& nds) noexcept {
+    using namespace std::chrono;
+
+    int y, mo, d, h, mi, s;
+    nds.RTC.GetDateTime(y, mo, d, h, mi, s);
+
+    year_month_day date {year{y}, month{static_cast<unsigned>(mo)}, day{static_cast<unsigned>(d)}};
+    seconds time = hours{h} + minutes{mi} + seconds{s};
+
+    return static_cast<local_days>(date) + time;
+}
+
+// The registries are only touched on the emulator thread,
+// so call this there once the console that opened the images is gone
+static void ForgetDiskImages() noexcept {
+    MelonDsDs::SparseImage::Clear();
+    MelonDsDs::SectorCache::Clear();
+}
+
 MelonDsDs::CoreState::~CoreState() noexcept {
     ZoneScopedN(TracyFunction);
+    _unload.Finish();
+    ForgetDiskImages();
+    _forks.Clear();
     Console = nullptr;
     melonDS::NDS::Current = nullptr;
 }
 
+size_t MelonDsDs::CoreState::ForkConsole(size_t count) noexcept {
+    ZoneScopedN(TracyFunction);
+
+    if (!Console || _messageScreen)
+        return 0;
+
+    if (count == 0) {
+        _forks.Clear();
+        return 0;
+    }
+
+    return _forks.Fork(Config, *Console, _ndsInfo ? &*_ndsInfo : nullptr, count);
+}
+
 retro_system_av_info MelonDsDs::CoreState::GetSystemAvInfo(RenderMode renderer) const noexcept {
     return {
         .geometry = _screenLayout.Geometry(renderer),
@@ -98,28 +138,114 @@ retro_system_av_info MelonDsDs::CoreState::GetSystemAvInfo() const noexcept {
 }
 
 void MelonDsDs::CoreState::UnloadGame() noexcept {
+    ZoneScopedN(TracyFunction);
+    _powerProfile.LogStats(Config);
+    if (Console && _ndsInfo && !_messageScreen && Config.SuspendOnExit() && !_suspendedSession) {
+        // If the player wants to pick up here next time
+        // (and the previous suspended session, if any, was resumed)...
+        if (Console->ConsoleType == static_cast<int>(ConsoleType::DS)) {
+            _unload.Run("Suspend session", [this] {
+                SuspendedSession::Save(*_ndsInfo, *Console, { .LayoutIndex = _screenLayout.LayoutIndex() });
+            });
+        }
+        else {
+            retro::warn("Can't suspend sessions in DSi mode");
+        }
+    }
+
+    if (_titleProfile) {
+        _unload.Submit("Title profile save", [profile=std::make_shared<const TitleProfile>(std::move(*_titleProfile))] {
+            profile->Save();
+        });
+        _titleProfile = std::nullopt;
+    }
+
+    _threadedRendererTuner = std::nullopt;
+    _inputState.LogStats();
+    _frameTimeStats.LogStats();
+    _frameTimeStats = {};
+    _audioState.LogStats();
+    _audioState.Reset();
+
+    if (trace::Recording) {
+        // If the player asked us to record a trace, save it before the session goes away
+        _unload.Submit("Trace dump", [seconds=trace::WindowSeconds()] {
+            trace::Dump(seconds);
+        });
+    }
+
     if (Console && Console->IsRunning()) {
         // If the NDS wasn't already stopped due to some internal event...
         Console->Stop();
     }
 
-    if (_ndsInfo) {
-        // If this session involved a loaded DS game...
+    // The workers take ownership of the content (which may be hundreds of megabytes),
+    // so that freeing it overlaps with the I/O
+    std::shared_ptr<const retro::GameInfo> ndsInfo = _ndsInfo ? std::make_shared<const retro::GameInfo>(std::move(*_ndsInfo)) : nullptr;
+    std::shared_ptr<const retro::GameInfo> gbaInfo = _gbaInfo ? std::make_shared<const retro::GameInfo>(std::move(*_gbaInfo)) : nullptr;
+    std::shared_ptr<const retro::GameInfo> gbaSaveInfo = _gbaSaveInfo ? std::make_shared<const retro::GameInfo>(std::move(*_gbaSaveInfo)) : nullptr;
+    _ndsInfo = std::nullopt;
+    _gbaInfo = std::nullopt;
+    _gbaSaveInfo = std::nullopt;
+    _cheats.Clear();
+
+    UnloadPipeline::Step teardown;
+    std::optional<UnloadPipeline::StepId> uninstall;
+    if (Console) {
+        if (Console->GPU.GetRenderer3D().Accelerated) {
+            // OpenGL objects must be deleted on the thread that owns the context
+            Console->GPU.SetRenderer3D(std::make_unique<melonDS::SoftRenderer>());
+        }
+
+        std::shared_ptr<melonDS::NDS> console = std::move(Console);
+        melonDS::NDS::Current = nullptr;
+
+        if (ndsInfo) {
+            // If this session involved a loaded DS game...
 
-        retro_assert(!_ndsInfo->GetData().empty());
-        const melonDS::NDSHeader& header = *reinterpret_cast<const melonDS::NDSHeader*>(_ndsInfo->GetData().data());
-        if (header.IsDSiWare()) {
-            // And that game was a DSiWare game...
-            retro_assert(Console->ConsoleType == 1);
-            retro_assert(dynamic_cast<melonDS::DSi*>(Console.get()) != nullptr);
+            retro_assert(!ndsInfo->GetData().empty());
+            const melonDS::NDSHeader& header = *reinterpret_cast<const melonDS::NDSHeader*>(ndsInfo->GetData().data());
+            if (header.IsDSiWare()) {
+                // And that game was a DSiWare game...
+                retro_assert(console->ConsoleType == 1);
+                retro_assert(dynamic_cast<melonDS::DSi*>(console.get()) != nullptr);
 
-            melonDS::DSi& dsi = *static_cast<melonDS::DSi*>(Console.get());
-            UninstallDsiware(dsi.GetNAND());
+                uninstall = _unload.Submit("DSiWare uninstall", [console, ndsInfo] {
+                    melonDS::DSi& dsi = *static_cast<melonDS::DSi*>(console.get());
+                    UninstallDsiware(dsi.GetNAND(), *ndsInfo);
+                });
+            }
         }
+
+        // The forks were made from this console (and may share its content), so they go with it
+        auto forks = std::make_shared<ConsoleForks>(std::move(_forks));
+        teardown = [console=std::move(console), forks=std::move(forks)]() mutable {
+            forks->Clear();
+            console = nullptr;
+        };
     }
 
-    Console = nullptr;
-    melonDS::NDS::Current = nullptr;
+    if (ndsInfo || gbaInfo || gbaSaveInfo) {
+        _unload.Submit("Content release", [ndsInfo=std::move(ndsInfo), gbaInfo=std::move(gbaInfo), gbaSaveInfo=std::move(gbaSaveInfo)] {});
+    }
+
+    if (teardown) {
+        // Destroying the console writes back the NAND and syncs the SD cards to their host folders,
+        // so it has to wait until the DSiWare title is gone.
+        // It also touches NDS::Current and the disk image registries, which belong to this thread,
+        // so it runs here instead of on a worker that might outlive the unload.
+        if (uninstall) {
+            _unload.Run("Console teardown", std::move(teardown), { *uninstall });
+        }
+        else {
+            _unload.Run("Console teardown", std::move(teardown));
+        }
+
+        // The SD card and NAND images are closed now
+        ForgetDiskImages();
+    }
+
+    _unload.Join(UNLOAD_TIMEOUT);
 }
 
 void MelonDsDs::CoreState::Run() noexcept {
@@ -138,11 +264,12 @@ void MelonDsDs::CoreState::Run() noexcept {
 
     retro_assert(Console != nullptr);
     melonDS::NDS& nds = *Console;
+    _frameTimeStats.BeginRun();
 
     if (retro::is_variable_updated()) [[unlikely]] {
         // If any settings have changed...
         retro::debug("At least one setting has changed; updating now");
-        ParseConfig(Config);
+        ReparseConfig();
         ApplyConfig(Config);
         UpdateConsole(Config, nds);
     }
@@ -152,12 +279,65 @@ void MelonDsDs::CoreState::Run() noexcept {
         _ndsSramInstalled = true;
     }
 
+    if (_suspendedSession) [[unlikely]] {
+        // If we're picking up where the last session left off...
+        if (_suspendedSession->Resume(nds)) {
+            _screenLayout.SetLayoutIndex(_suspendedSession->GetPresentation().LayoutIndex);
+            _framesUntilClockSync = 0;
+            _inputState.Invalidate();
+        }
+        _suspendedSession = std::nullopt;
+    }
+
     if (_renderState.Ready()) [[likely]] {
         // If the global state needed for rendering is ready...
+        if ((_rollback.Active() && !_rollback.Prepare(nds)) || !_mpState.BeginFrame()) {
+            // If netplay isn't ready for the console to advance (e.g. we're waiting on the other player),
+            // or we're too far ahead of the other local multiplayer peers...
+            _renderState.Skip(_screenLayout);
+            _idleFrameState.SubmitSilence(nds, _audioState);
+
+            // Saves and other background work shouldn't wait for the other player
+            retro::task::check();
+            _frameTimeStats.EndRun();
+            return;
+        }
+
+        if (_powerProfile.Enabled(Config)) {
+            // If we might switch profiles, measure how much each one costs
+            _powerProfile.BeginFrame();
+        }
+
+        if (_titleProfile) {
+            _titleProfile->BeginFrame();
+        }
+
+        // Only measure the threaded renderer if our choice is the one in effect
+        // (the battery profile or this game's profile may have overridden it)
+        bool tuneThreadedRenderer = _threadedRendererTuner
+            && _threadedRendererTuner->Measuring()
+            && !nds.GPU.GetRenderer3D().Accelerated
+            && Config.ThreadedSoftRenderer() == _threadedRendererTuner->Threaded();
+        if (tuneThreadedRenderer) {
+            _threadedRendererTuner->BeginFrame();
+        }
+
         _inputState.Update(_screenLayout);
-        _inputState.Apply(nds, _screenLayout, _micState);
+        if (_rollback.Active()) {
+            // Netplay decides what the console sees, since it has to include the other player's input
+            _inputState.ApplyLocal(_screenLayout, _micState);
+            _rollback.BeginFrame(nds, _inputState.GetConsoleInput());
+        }
+        else {
+            _inputState.Apply(nds, _screenLayout, _micState);
+        }
         std::array<int16_t, 735> buffer {};
         _micState.Read(buffer);
+        if (_rollback.Active()) {
+            // The mic isn't part of the input the peers share,
+            // so letting each console hear its own player would desync them
+            buffer.fill(0);
+        }
         nds.MicInputFrame(buffer.data(), buffer.size());
 
         if (_screenLayout.Dirty()) {
@@ -173,10 +353,21 @@ void MelonDsDs::CoreState::Run() noexcept {
             }
 
             _renderState.RequestRefresh();
+            _presentationPacer.Reset();
+            _idleFrameState.RequestPresent();
+
+            // Touch coordinates depend on the layout
+            _inputState.Invalidate();
         }
 
-        if (_syncClock) {
-            SetConsoleTime(nds, LocalTime());
+        if (_cheats.Dirty()) [[unlikely]] {
+            // If the player has changed their cheats since the last frame...
+            _cheats.Install(nds);
+        }
+
+        if (_syncClock && !_rollback.Active()) {
+            // (Netplay peers' clocks would disagree)
+            SyncConsoleTime(nds);
         }
 
         // NDS::RunFrame renders the Nintendo DS state to a framebuffer,
@@ -184,13 +375,57 @@ void MelonDsDs::CoreState::Run() noexcept {
         {
             ZoneScopedN("NDS::RunFrame");
             nds.RunFrame();
+            _mpState.EndFrame();
+        }
+
+        bool idle = _idleFrameState.Update(nds);
+        auto submitAudio = [&] {
+            if (idle) {
+                _idleFrameState.SubmitSilence(nds, _audioState);
+            }
+            else {
+                RenderAudio(nds);
+            }
+        };
+
+        _audioState.FrameEmulated();
+        if (Config.LowLatencyAudio()) {
+            // Don't make the frontend wait for this frame's audio while we render (and maybe block on vsync)
+            submitAudio();
         }
 
-        _renderState.Render(nds, _inputState, Config, _screenLayout);
-        RenderAudio(*Console);
+        if (idle && retro::can_dupe()) {
+            // The console is asleep with its screens off,
+            // so the last frame we presented is still accurate
+            _renderState.Skip(_screenLayout);
+        }
+        else if (_presentationPacer.ShouldPresent()) {
+            _renderState.Render(nds, _inputState, Config, _screenLayout);
+        }
+        else {
+            // The frontend won't show this frame anyway (we're fast-forwarding),
+            // so don't bother compositing it; the console itself was still fully emulated
+            _renderState.Skip(_screenLayout);
+        }
+
+        if (!Config.LowLatencyAudio()) {
+            submitAudio();
+        }
+        _powerProfile.EndFrame();
+        if (_titleProfile) {
+            _titleProfile->EndFrame();
+        }
+
+        if (tuneThreadedRenderer && _threadedRendererTuner->EndFrame()) {
+            // If it's time to try (or settle on) the other mode...
+            Config.SetThreadedSoftRenderer(_threadedRendererTuner->Threaded());
+            _renderState.UpdateRenderer(Config, nds);
+        }
 
         retro::task::check();
     }
+
+    _frameTimeStats.EndRun();
 }
 
 void MelonDsDs::CoreState::Reset() {
@@ -210,13 +445,17 @@ void MelonDsDs::CoreState::Reset() {
         task->Cancel();
     }
     retro::task::check();
+    // Cancelling the flush task hands the final writes to the unload workers,
+    // and the new console reads the same files
+    _unload.Finish();
     _savestateSize = std::nullopt;
 
     retro_assert(Console != nullptr);
     RegisterCoreOptions();
-    ParseConfig(Config);
+    ReparseConfig();
     ApplyConfig(Config);
     _syncClock = Config.StartTimeMode() == StartTimeMode::Sync;
+    _framesUntilClockSync = CLOCK_SYNC_INTERVAL;
 
     std::vector<uint8_t> ndsSram(Console->GetNDSSaveLength());
     if (Console->GetNDSSaveLength() && Console->GetNDSSave()) {
@@ -283,7 +522,7 @@ void MelonDsDs::CoreState::RenderAudio(melonDS::NDS& nds) noexcept {
     // Ensure that we don't overrun the buffer
 
     size_t read = nds.SPU.ReadOutput(audio_buffer, size);
-    retro::audio_sample_batch(audio_buffer, read);
+    _audioState.Submit({audio_buffer, read * 2});
 }
 
 bool MelonDsDs::CoreState::RunDeferredInitialization() noexcept {
@@ -377,19 +616,18 @@ void MelonDsDs::CoreState::InstallNdsSram() noexcept {
 void MelonDsDs::CoreState::SetConsoleTime(melonDS::NDS& nds) noexcept {
     ZoneScopedN(TracyFunction);
 
-    local_seconds now = LocalTime();
     local_seconds targetTime;
 
     switch (Config.StartTimeMode()) {
         case StartTimeMode::Sync:
         case StartTimeMode::Real: {
-            targetTime = now;
+            targetTime = LocalTime();
             retro::debug("Starting the RTC at {:%F %r} (local time)", ToSystemTime(targetTime));
             break;
         }
         case StartTimeMode::Relative: {
             minutes offset = Config.RelativeDateTimeOffset();
-            targetTime = now + offset;
+            targetTime = LocalTime() + offset;
             retro::debug("Starting the RTC at {:%F %r} ({}y, {}, {}, {} from now)",
                 ToSystemTime(targetTime),
                 Config.RelativeYearOffset().count(),
@@ -400,18 +638,68 @@ void MelonDsDs::CoreState::SetConsoleTime(melonDS::NDS& nds) noexcept {
             break;
         }
         case StartTimeMode::Absolute: {
-            const auto tpm = floor<seconds>(now);
+            const auto tpm = floor<seconds>(LocalTime());
             const auto dp = floor<days>(tpm);
             auto time = make_time(tpm-dp);
             targetTime = Config.AbsoluteStartDateTime() + time.seconds();
             retro::debug("Starting the RTC at {:%F %r} (ignoring the local time)", ToSystemTime(targetTime));
             break;
         }
+        case StartTimeMode::Virtual: {
+            // Never consult the host clock, not even for the seconds;
+            // from here on the RTC only advances as the console emulates time
+            targetTime = Config.AbsoluteStartDateTime();
+            retro::debug("Starting the RTC at {:%F %r} (virtual clock)", ToSystemTime(targetTime));
+            break;
+        }
     }
 
     SetConsoleTime(nds, targetTime);
 }
 
+// The emulated RTC keeps time on its own as the console runs,
+// so we only need to consult the host clock occasionally
+// to correct drift caused by fast-forwarding, rewinding, or loading states.
+void MelonDsDs::CoreState::SyncConsoleTime(melonDS::NDS& nds) noexcept {
+    if (_framesUntilClockSync > 0) {
+        --_framesUntilClockSync;
+        return;
+    }
+
+    ZoneScopedN(TracyFunction);
+    _framesUntilClockSync = CLOCK_SYNC_INTERVAL;
+
+    local_seconds now = LocalTime();
+    seconds drift = now - ConsoleTime(nds);
+    if (abs(drift) > CLOCK_DRIFT_THRESHOLD) {
+        retro::debug("Emulated RTC is {}s off from the local time, resynchronizing", drift.count());
+        SetConsoleTime(nds, now);
+    }
+}
+
+std::optional<date::local_seconds> MelonDsDs::CoreState::GetConsoleTime() const noexcept {
+    if (!Console)
+        return std::nullopt;
+
+    return ConsoleTime(*Console);
+}
+
+bool MelonDsDs::CoreState::SetConsoleTime(local_seconds time) noexcept {
+    ZoneScopedN(TracyFunction);
+    if (!Console)
+        return false;
+
+    if (_syncClock) {
+        // An explicitly-set time takes precedence over the host clock
+        retro::debug("RTC set explicitly, no longer synchronizing it to the local time");
+        _syncClock = false;
+    }
+
+    SetConsoleTime(*Console, time);
+    retro::debug("Set the RTC to {:%F %r}", ToSystemTime(time));
+    return true;
+}
+
 void MelonDsDs::CoreState::SetConsoleTime(melonDS::NDS& nds, local_seconds time) noexcept {
     auto today = year_month_day{floor<days>(time)};
     const auto tpm = floor<seconds>(time);
@@ -495,12 +783,15 @@ void MelonDsDs::CoreState::ResetRenderState() {
 }
 
 void MelonDsDs::CoreState::DestroyRenderState() {
-    _renderState.ContextDestroyed();
+    _renderState.ContextDestroyed(Console.get(), Config);
 }
 
 bool MelonDsDs::CoreState::LoadGame(unsigned type, std::span<const retro_game_info> game) noexcept try {
     ZoneScopedN(TracyFunction);
 
+    // The last game's saves might still be on their way to disk
+    _unload.Finish();
+
     InitContent(type, game);
 
     // ...then load the game.
@@ -513,9 +804,24 @@ bool MelonDsDs::CoreState::LoadGame(unsigned type, std::span<const retro_game_in
         ParseConfig(Config);
         _optionVisibility.Update();
     }
+
+    InitThreadedRendererTuner();
+    _powerProfile.Load();
+    if (_ndsInfo && Config.TitleProfileMode() != TitleProfileMode::Disabled) {
+        // If the player wants this game's settings and statistics remembered...
+        std::span<const std::byte> rom = _ndsInfo->GetData();
+        if (rom.size() >= sizeof(melonDS::NDSHeader)) {
+            const melonDS::NDSHeader& header = *reinterpret_cast<const melonDS::NDSHeader*>(rom.data());
+            _titleProfile = TitleProfile::Load(header, rom, Config, Config.TitleProfileMode() == TitleProfileMode::Tune);
+            if (_titleProfile) {
+                _titleProfile->Apply(Config);
+            }
+        }
+    }
     ApplyConfig(Config);
 
     _syncClock = Config.StartTimeMode() == StartTimeMode::Sync;
+    _framesUntilClockSync = CLOCK_SYNC_INTERVAL;
     retro_assert(Console == nullptr);
     // Instantiates the console with games and save data installed
     Console = CreateConsole(
@@ -570,7 +876,19 @@ bool MelonDsDs::CoreState::LoadGame(unsigned type, std::span<const retro_game_in
 
     InitFlushFirmwareTask();
 
-    if (_renderState.GetRenderMode() == RenderMode::OpenGl) {
+    if (_ndsInfo && Config.SuspendOnExit() && Console->ConsoleType == static_cast<int>(ConsoleType::DS)) {
+        // If the last session with this game might have been suspended...
+        // (it'll be resumed on the first frame, once SRAM is installed)
+        _suspendedSession = SuspendedSession::Load(*_ndsInfo);
+    }
+
+    if (_renderState.GetRenderMode() == RenderMode::OpenGl && _renderState.IsHeadless()) {
+        // If we're using our own OpenGL context, it's already ready
+        retro::info("Using a headless OpenGL context, proceeding now");
+        ResetRenderState();
+        StartConsole();
+    }
+    else if (_renderState.GetRenderMode() == RenderMode::OpenGl) {
         retro::info("Deferring initialization until the OpenGL context is ready");
         _deferredInitializationPending = true;
     }
@@ -609,25 +927,23 @@ catch (...) {
 }
 
 // Reset for the next time
-void MelonDsDs::CoreState::UninstallDsiware(melonDS::DSi_NAND::NANDImage& nand) noexcept {
+void MelonDsDs::CoreState::UninstallDsiware(melonDS::DSi_NAND::NANDImage& nand, const retro::GameInfo& nds_info) noexcept {
     ZoneScopedN(TracyFunction);
 
-    if (!_ndsInfo) return;
-
     retro_assert(nand);
 
-    const auto& header = *reinterpret_cast<const melonDS::NDSHeader*>(_ndsInfo->GetData().data());
+    const auto& header = *reinterpret_cast<const melonDS::NDSHeader*>(nds_info.GetData().data());
     retro_assert(header.IsDSiWare());
 
     if (NANDMount mount = NANDMount(nand)) {
         // TODO: Report an error if the title doesn't exist
         // TODO: Only delete the title if the sentinel exists
-        ExportDsiwareSaveData(mount, *_ndsInfo, header, TitleData_PublicSav);
-        ExportDsiwareSaveData(mount, *_ndsInfo, header, TitleData_PrivateSav);
-        ExportDsiwareSaveData(mount, *_ndsInfo, header, TitleData_BannerSav);
+        ExportDsiwareSaveData(mount, nds_info, header, TitleData_PublicSav);
+        ExportDsiwareSaveData(mount, nds_info, header, TitleData_PrivateSav);
+        ExportDsiwareSaveData(mount, nds_info, header, TitleData_BannerSav);
 
         mount.DeleteTitle(header.DSiTitleIDHigh, header.DSiTitleIDLow);
-        retro::info("Removed temporarily-installed DSiWare title \"{}\" from NAND image", _ndsInfo->GetPath());
+        retro::info("Removed temporarily-installed DSiWare title \"{}\" from NAND image", nds_info.GetPath());
     } else {
         retro::error("Failed to open DSi NAND for uninstallation");
     }
@@ -675,9 +991,17 @@ void MelonDsDs::CoreState::ApplyConfig(const CoreConfig& config) noexcept {
     _screenLayout.Apply(config, _renderState);
     _inputState.SetConfig(config);
     _micState.SetConfig(config);
+    _audioState.SetConfig(config);
     _netState.Apply(config);
     _screenLayout.SetDirty();
 
+    if (optional<unsigned> seconds = config.TraceRecorderSeconds()) {
+        trace::Start(*seconds);
+    }
+    else {
+        trace::Stop();
+    }
+
     if (oldMicInputMode != MicInputMode::HostMic && config.MicInputMode() == MicInputMode::HostMic) {
         // If we want to use the host's microphone, and we're coming from another setting...
         // (so that excessive warnings aren't shown)
@@ -711,6 +1035,83 @@ void MelonDsDs::CoreState::ApplyConfig(const CoreConfig& config) noexcept {
     }
 }
 
+void MelonDsDs::CoreState::ReparseConfig() noexcept {
+    ZoneScopedN(TracyFunction);
+
+    // Start over from the user's regular settings...
+    ParseConfig(Config);
+    InitThreadedRendererTuner();
+    if (_titleProfile) {
+        // ...then apply this game's own overrides...
+        _titleProfile->Apply(Config);
+    }
+
+    if (std::optional<PowerProfileSettings> powerProfile = _powerProfile.ActiveSettings(Config)) {
+        // ...then override the ones that the active power profile changes
+        powerProfile->Apply(Config);
+    }
+}
+
+void MelonDsDs::CoreState::InitThreadedRendererTuner() noexcept {
+    if (!Config.AutoThreadedSoftRenderer())
+        return;
+
+    if (!_threadedRendererTuner) {
+        // If the player just asked us to decide whether to thread the software renderer...
+        const melonDS::NDSHeader* header = nullptr;
+        std::span<const std::byte> rom;
+        if (_ndsInfo && _ndsInfo->GetData().size() >= sizeof(melonDS::NDSHeader)) {
+            rom = _ndsInfo->GetData();
+            header = reinterpret_cast<const melonDS::NDSHeader*>(rom.data());
+        }
+        _threadedRendererTuner.emplace(header, rom);
+    }
+
+    Config.SetThreadedSoftRenderer(_threadedRendererTuner->Threaded());
+}
+
+void MelonDsDs::CoreState::ApplyPowerProfile() noexcept {
+    ZoneScopedN(TracyFunction);
+    retro_assert(Console != nullptr);
+
+    ReparseConfig();
+    if (std::optional<PowerProfileSettings> powerProfile = _powerProfile.ActiveSettings(Config)) {
+        retro::info("Switched to the \"{}\" power profile", powerProfile->Name);
+    }
+    else {
+        retro::info("Switched back to the usual settings");
+    }
+
+    ApplyConfig(Config);
+    UpdateConsole(Config, *Console);
+}
+
+retro::GameInfo MelonDsDs::CoreState::LoadArchivedRom(const retro_game_info& game) {
+    ZoneScopedN(TracyFunction);
+    std::span<const std::byte> data(static_cast<const std::byte*>(game.data), game.data ? game.size : 0);
+    std::unique_ptr<RomArchive> archive = RomArchive::Open(game.path, data);
+
+    // Check the header before decompressing the whole thing,
+    // so we can give up early if the archive doesn't actually hold a DS ROM
+    melonDS::NDSHeader header {};
+    if (archive->Size() < sizeof(header) || !archive->Read(0, std::span(reinterpret_cast<std::byte*>(&header), sizeof(header)))) {
+        throw content_exception("The ROM in the loaded archive is too small to be a Nintendo DS ROM.");
+    }
+
+    if (header.ARM9ROMOffset + uint64_t(header.ARM9Size) > archive->Size() || header.ARM7ROMOffset + uint64_t(header.ARM7Size) > archive->Size()) {
+        throw content_exception("The ROM in the loaded archive isn't a valid Nintendo DS ROM.");
+    }
+
+    // Decompress straight into the buffer we'll keep, rather than extracting to a copy first
+    std::unique_ptr<std::byte[]> rom = archive->ReadAll();
+    if (!rom) {
+        throw content_exception("Failed to decompress the ROM in the loaded archive, it may be corrupt.");
+    }
+
+    archive->LogStats();
+    return retro::GameInfo(game, std::move(rom), archive->Size());
+}
+
 void MelonDsDs::CoreState::InitContent(unsigned type, std::span<const retro_game_info> game) {
     ZoneScopedN(TracyFunction);
 
@@ -742,6 +1143,12 @@ void MelonDsDs::CoreState::InitContent(unsigned type, std::span<const retro_game
                     throw content_exception("Loaded a save file instead of a ROM, ensure that you opened the right file.");
                 }
 
+                if (game[0].path && RomArchive::IsArchive(game[0].path)) {
+                    // If the frontend gave us an archive instead of extracting it (usually just its path)...
+                    _ndsInfo = LoadArchivedRom(game[0]);
+                    break;
+                }
+
                 if (game[0].size == 0) {
                     throw content_exception("Loaded an empty file as content, please load a valid Nintendo DS ROM.");
                 }
@@ -915,6 +1322,11 @@ bool MelonDsDs::CoreState::Unserialize(std::span<const std::byte> data) noexcept
         return false;
     }
 
+    // The loaded state has its own RTC time, so check for drift right away
+    _framesUntilClockSync = 0;
+
+    // ...and its own input state, so give it ours again
+    _inputState.Invalidate();
     return Console->DoSavestate(&savestate) && !savestate.Error;
 }
 
@@ -964,6 +1376,7 @@ void MelonDsDs::CoreState::CheatReset() noexcept
     ZoneScopedN(TracyFunction);
     retro::debug("retro_cheat_reset()\n");
 
+    _cheats.Clear();
     if (Console)
     {
         Console->AREngine.Cheats.clear();
@@ -1002,12 +1415,6 @@ void MelonDsDs::CoreState::CheatSet(unsigned index, bool enabled, std::string_vi
         curcode.Code.push_back(token);
     }
 
-    if (index < Console->AREngine.Cheats.size())
-    { // If we're updating the state of a cheat that already exists...
-        Console->AREngine.Cheats[index] = std::move(curcode);
-    }
-    else
-    { // If we're adding a new cheat...
-        Console->AREngine.Cheats.push_back(std::move(curcode));
-    }
+    // Frontends usually set a whole list at once, so compile it just before the next frame
+    _cheats.Set(index, std::move(curcode));
 }
@@ -28,6 +28,7 @@
 #include "../config/visibility.hpp"
 #include "../message/error.hpp"
 #include "../microphone.hpp"
+#include "../render/pacing.hpp"
 #include "../render/render.hpp"
 #include "../retro/info.hpp"
 #include "../screenlayout.hpp"
@@ -35,6 +36,17 @@
 #include "../sram.hpp"
 #include "net/net.hpp"
 #include "net/mp.hpp"
+#include "net/rollback.hpp"
+#include "audio.hpp"
+#include "cheats.hpp"
+#include "fork.hpp"
+#include "frametime.hpp"
+#include "idle.hpp"
+#include "power.hpp"
+#include "profile.hpp"
+#include "suspend.hpp"
+#include "threading.hpp"
+#include "unload.hpp"
 #include "std/span.hpp"
 
 struct retro_game_info;
@@ -91,9 +103,11 @@ namespace MelonDsDs {
         int LanSendPacket(std::span<std::byte> data) noexcept;
         int LanRecvPacket(uint8_t* data) noexcept;
 
-        void MpStarted(retro_netpacket_send_t send, retro_netpacket_poll_receive_t poll_receive) noexcept;
+        void MpStarted(uint16_t client_id, retro_netpacket_send_t send, retro_netpacket_poll_receive_t poll_receive) noexcept;
         void MpPacketReceived(const void *buf, size_t len, uint16_t client_id) noexcept;
         void MpStopped() noexcept;
+        bool MpPeerConnected(uint16_t client_id) noexcept;
+        void MpPeerDisconnected(uint16_t client_id) noexcept;
         bool MpSendPacket(const Packet &p) noexcept;
         std::optional<Packet> MpNextPacket() noexcept;
         std::optional<Packet> MpNextPacketBlock() noexcept;
@@ -105,29 +119,54 @@ namespace MelonDsDs {
         bool UpdateOptionVisibility() noexcept;
 
         const melonDS::NDS* GetConsole() const noexcept { return Console.get(); }
+        melonDS::NDS* GetConsole() noexcept { return Console.get(); }
+        [[nodiscard]] const CoreConfig& GetConfig() const noexcept { return Config; }
+        const retro::GameInfo* GetNdsInfo() const noexcept { return _ndsInfo ? &*_ndsInfo : nullptr; }
+        [[nodiscard]] std::optional<local_seconds> GetConsoleTime() const noexcept;
+        bool SetConsoleTime(local_seconds time) noexcept;
+        size_t ForkConsole(size_t count) noexcept;
+        [[nodiscard]] ConsoleForks& GetForks() noexcept { return _forks; }
+        [[nodiscard]] const FrameTimeStats& GetFrameTimeStats() const noexcept { return _frameTimeStats; }
+        [[nodiscard]] const AudioState& GetAudioState() const noexcept { return _audioState; }
+        [[nodiscard]] const RollbackNetplay& GetRollback() const noexcept { return _rollback; }
+        [[nodiscard]] const CheatPlan& GetCheats() const noexcept { return _cheats; }
+        [[nodiscard]] TitleProfile* GetTitleProfile() noexcept { return _titleProfile ? &*_titleProfile : nullptr; }
+        [[nodiscard]] std::optional<size_t> GetPowerProfile() const noexcept { return _powerProfile.Active(); }
+        [[nodiscard]] PresentationStats GetPresentationStats() const noexcept { return _presentationPacer.Stats(); }
         [[nodiscard]] const InputState& GetInputState() const noexcept { return _inputState; }
+        [[nodiscard]] const IdleFrameState& GetIdleFrameState() const noexcept { return _idleFrameState; }
         [[nodiscard]] InputState& GetInputState() noexcept { return _inputState; }
         std::optional<RenderMode> GetRenderMode() const noexcept { return _renderState.GetRenderMode(); }
         const ScreenLayoutData& GetScreenLayoutData() const noexcept { return _screenLayout; }
     private:
         static constexpr auto REGEX_OPTIONS = std::regex_constants::ECMAScript | std::regex_constants::optimize;
+        // How often sync mode compares the emulated RTC against the local time, in frames (about 5 seconds)
+        static constexpr unsigned CLOCK_SYNC_INTERVAL = 300;
+        static constexpr std::chrono::seconds CLOCK_DRIFT_THRESHOLD {2};
+        // How long UnloadGame waits for its steps before leaving them to finish in the background
+        static constexpr std::chrono::milliseconds UNLOAD_TIMEOUT {2000};
         [[gnu::cold]] void ApplyConfig(const CoreConfig& config) noexcept;
+        [[gnu::cold]] void ApplyPowerProfile() noexcept;
+        [[gnu::cold]] void ReparseConfig() noexcept;
+        [[gnu::cold]] void InitThreadedRendererTuner() noexcept;
         [[gnu::cold]] bool RunDeferredInitialization() noexcept;
         [[gnu::cold]] void InstallNdsSram() noexcept;
         [[gnu::cold]] void StartConsole();
         [[gnu::cold]] void SetConsoleTime(melonDS::NDS& nds) noexcept;
         [[gnu::cold]] void SetConsoleTime(melonDS::NDS& nds, local_seconds time) noexcept;
-        [[gnu::cold]] void UninstallDsiware(melonDS::DSi_NAND::NANDImage& nand) noexcept;
+        void SyncConsoleTime(melonDS::NDS& nds) noexcept;
+        [[gnu::cold]] static void UninstallDsiware(melonDS::DSi_NAND::NANDImage& nand, const retro::GameInfo& nds_info) noexcept;
         [[gnu::cold]] static void ExportDsiwareSaveData(
             melonDS::DSi_NAND::NANDMount& nand,
             const retro::GameInfo& nds_info,
             const melonDS::NDSHeader& header,
             int type
         ) noexcept;
-        [[gnu::hot]] static void RenderAudio(melonDS::NDS& nds) noexcept;
+        [[gnu::hot]] void RenderAudio(melonDS::NDS& nds) noexcept;
         [[gnu::cold]] bool InitErrorScreen(const config_exception& e) noexcept;
         [[gnu::cold]] void RenderErrorScreen() noexcept;
         [[gnu::cold]] void InitContent(unsigned type, std::span<const retro_game_info> game);
+        [[gnu::cold]] static retro::GameInfo LoadArchivedRom(const retro_game_info& game);
 
         const melonDS::AdapterData* SelectNetworkInterface(std::span<const melonDS::AdapterData> adapters) const noexcept;
 
@@ -135,9 +174,10 @@ namespace MelonDsDs {
         retro::task::TaskSpec OnScreenDisplayTask() noexcept;
         retro::task::TaskSpec FlushGbaSramTask() noexcept;
         void FlushGbaSram(const retro::GameInfo& gbaSaveInfo) noexcept;
+        static void WriteGbaSram(string_view save_data_path, std::span<const uint8_t> gba_sram) noexcept;
         retro::task::TaskSpec FlushFirmwareTask(string_view firmwareName) noexcept;
         void InitFlushFirmwareTask() noexcept;
-        void FlushFirmware(string_view firmwarePath, string_view wfcSettingsPath) noexcept;
+        static void FlushFirmware(const melonDS::Firmware& firmware, string_view firmwarePath, string_view wfcSettingsPath) noexcept;
         [[gnu::cold]] void InitNdsSave(const NdsCart &nds_cart);
 
         std::unique_ptr<melonDS::NDS> Console = nullptr;
@@ -147,8 +187,20 @@ namespace MelonDsDs {
         ScreenLayoutData _screenLayout {};
         InputState _inputState {};
         MicrophoneState _micState {};
+        AudioState _audioState {};
         RenderStateWrapper _renderState {};
+        PresentationPacer _presentationPacer {};
+        IdleFrameState _idleFrameState {};
+        FrameTimeStats _frameTimeStats {};
+        PowerProfileState _powerProfile {};
+        std::optional<TitleProfile> _titleProfile = std::nullopt;
+        ConsoleForks _forks {};
+        std::optional<SuspendedSession> _suspendedSession = std::nullopt;
+        std::optional<ThreadedRendererTuner> _threadedRendererTuner = std::nullopt;
         MpState _mpState {};
+        RollbackNetplay _rollback {};
+        CheatPlan _cheats {};
+        UnloadPipeline _unload {};
         std::optional<retro::GameInfo> _ndsInfo = std::nullopt;
         std::optional<retro::GameInfo> _gbaInfo = std::nullopt;
         std::optional<retro::GameInfo> _gbaSaveInfo = std::nullopt;
@@ -158,6 +210,7 @@ namespace MelonDsDs {
         std::optional<int> _timeToFirmwareFlush = std::nullopt;
         mutable std::optional<size_t> _savestateSize = std::nullopt;
         bool _syncClock = false;
+        unsigned _framesUntilClockSync = 0;
         std::unique_ptr<error::ErrorScreen> _messageScreen = nullptr;
         // TODO: Switch to compile time regular expressions (see https://compile-time.re)
         std::regex _cheatSyntax { "^\\s*[0-9A-Fa-f]{8}([+\\s-]*[0-9A-Fa-f]{8})*$", REGEX_OPTIONS };
@@ -0,0 +1,212 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include "fork.hpp"
+
+#include <chrono>
+#include <cstring>
+
+#include <NDS.h>
+#include <retro_assert.h>
+
+#include "config/console.hpp"
+#include "config/types.hpp"
+#include "core.hpp"
+#include "environment.hpp"
+#include "tracy.hpp"
+
+namespace MelonDsDs {
+    extern CoreState& Core;
+}
+
+// DS buttons are active-low; these are the bits that NDS::SetKeyMask looks at
+constexpr uint32_t KEY_MASK = 0xFFF;
+
+MelonDsDs::CurrentConsoleScope::CurrentConsoleScope(melonDS::NDS& nds) noexcept : _previous(melonDS::NDS::Current) {
+    melonDS::NDS::Current = &nds;
+}
+
+MelonDsDs::CurrentConsoleScope::~CurrentConsoleScope() noexcept {
+    melonDS::NDS::Current = _previous;
+}
+
+bool MelonDsDs::IsForkedConsole(const void* userdata) noexcept {
+    return userdata != &Core;
+}
+
+MelonDsDs::ConsoleForks::~ConsoleForks() noexcept {
+    Clear();
+}
+
+size_t MelonDsDs::ConsoleForks::Fork(
+    const CoreConfig& config,
+    melonDS::NDS& parent,
+    const retro::GameInfo* ndsInfo,
+    size_t count
+) noexcept try {
+    ZoneScopedN(TracyFunction);
+
+    if (parent.ConsoleType != static_cast<int>(ConsoleType::DS)) {
+        // DSi mode doesn't support savestates, which forking relies on
+        retro::error("Forking is not supported in DSi mode");
+        return 0;
+    }
+
+    if (parent.GetGBACart()) {
+        retro::error("Forking is not supported with a GBA cart or Slot-2 accessory inserted");
+        return 0;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    {
+        // Save the parent's state once, then load it into every fork
+        ZoneScopedN("NDS::DoSavestate");
+        melonDS::Savestate state;
+        if (!parent.DoSavestate(&state) || state.Error) {
+            retro::error("Failed to save the console's state for forking");
+            return 0;
+        }
+
+        const std::byte* buffer = reinterpret_cast<const std::byte*>(state.Buffer());
+        _state.assign(buffer, buffer + state.Length());
+    }
+
+    if (_parent != &parent || _parentCart != parent.GetNDSCart()) {
+        // If the content changed since we last forked, the old forks are running the wrong game
+        Truncate(0);
+        _parent = &parent;
+        _parentCart = parent.GetNDSCart();
+    }
+
+    Truncate(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (i == _consoles.size()) {
+            // If we need a fork that we haven't made yet...
+            _consoles.push_back(CreateForkedConsole(config, parent, ndsInfo, this));
+            CurrentConsoleScope scope(*_consoles.back());
+            _consoles.back()->Reset();
+        }
+
+        melonDS::NDS& fork = *_consoles[i];
+        bool loaded = false;
+        {
+            CurrentConsoleScope scope(fork);
+            melonDS::Savestate state(_state.data(), _state.size(), false);
+            loaded = fork.DoSavestate(&state) && !state.Error;
+            if (loaded && !fork.IsRunning()) {
+                fork.Start();
+            }
+        }
+
+        if (!loaded) {
+            retro::error("Failed to load the console's state into fork {}", i);
+            Truncate(i);
+            break;
+        }
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    _forksCreated += _consoles.size();
+    _forkTimeUs += elapsed.count();
+    retro::debug(
+        "Forked the console {} time(s) in {}us ({:.1f} forks/s overall)",
+        _consoles.size(),
+        elapsed.count(),
+        _forkTimeUs ? _forksCreated * 1'000'000.0 / _forkTimeUs : 0.0
+    );
+
+    return _consoles.size();
+}
+catch (const std::exception& e) {
+    retro::error("Failed to fork the console: {}", e.what());
+    return _consoles.size();
+}
+catch (...) {
+    retro::error("Failed to fork the console");
+    return _consoles.size();
+}
+
+bool MelonDsDs::ConsoleForks::Run(size_t index, uint32_t keys, int touchX, int touchY, bool touching) noexcept {
+    ZoneScopedN(TracyFunction);
+
+    melonDS::NDS* fork = Get(index);
+    if (!fork)
+        return false;
+
+    CurrentConsoleScope scope(*fork);
+    fork->SetKeyMask(~keys & KEY_MASK);
+    if (touching) {
+        fork->TouchScreen(touchX, touchY);
+    }
+    else {
+        fork->ReleaseScreen();
+    }
+
+    fork->RunFrame();
+
+    // Forks aren't heard, so throw away their audio before it piles up
+    fork->SPU.DrainOutput();
+    return true;
+}
+
+bool MelonDsDs::ConsoleForks::Serialize(size_t index, std::span<std::byte> data) const noexcept {
+    ZoneScopedN(TracyFunction);
+
+    if (index >= _consoles.size())
+        return false;
+
+    melonDS::Savestate state;
+    {
+        // Saving state can reach code that uses NDS::Current
+        CurrentConsoleScope scope(*_consoles[index]);
+        if (!_consoles[index]->DoSavestate(&state) || state.Error)
+            return false;
+    }
+
+    if (state.Length() > data.size()) {
+        retro::error("Expected at least {} bytes to save fork {}, got {}", state.Length(), index, data.size());
+        return false;
+    }
+
+    memcpy(data.data(), state.Buffer(), state.Length());
+    return true;
+}
+
+melonDS::NDS* MelonDsDs::ConsoleForks::Get(size_t index) noexcept {
+    return index < _consoles.size() ? _consoles[index].get() : nullptr;
+}
+
+void MelonDsDs::ConsoleForks::Truncate(size_t count) noexcept {
+    for (size_t i = count; i < _consoles.size(); ++i) {
+        // Destroying a console may still touch NDS::Current
+        CurrentConsoleScope scope(*_consoles[i]);
+        _consoles[i] = nullptr;
+    }
+
+    if (count < _consoles.size()) {
+        _consoles.resize(count);
+    }
+}
+
+void MelonDsDs::ConsoleForks::Clear() noexcept {
+    Truncate(0);
+    _parent = nullptr;
+    _parentCart = nullptr;
+    _state.clear();
+    _state.shrink_to_fit();
+}
@@ -0,0 +1,98 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "std/span.hpp"
+
+namespace melonDS {
+    class NDS;
+    namespace NDSCart {
+        class CartCommon;
+    }
+}
+
+namespace retro {
+    class GameInfo;
+}
+
+namespace MelonDsDs {
+    class CoreConfig;
+
+    /// True if a melonDS platform callback came from a forked console
+    /// instead of the one that the player sees.
+    bool IsForkedConsole(const void* userdata) noexcept;
+
+    /// Makes a forked console the current one for as long as this object exists,
+    /// since parts of melonDS still refer to NDS::Current
+    class CurrentConsoleScope {
+    public:
+        explicit CurrentConsoleScope(melonDS::NDS& nds) noexcept;
+        ~CurrentConsoleScope() noexcept;
+        CurrentConsoleScope(const CurrentConsoleScope&) = delete;
+        CurrentConsoleScope& operator=(const CurrentConsoleScope&) = delete;
+    private:
+        melonDS::NDS* _previous;
+    };
+
+    /// Independent copies of the running console,
+    /// e.g. for bots that explore many input sequences from the same starting point.
+    /// Forks never write save data, use the network, or present video or audio.
+    class ConsoleForks {
+    public:
+        ConsoleForks() noexcept = default;
+        ~ConsoleForks() noexcept;
+        ConsoleForks(const ConsoleForks&) = delete;
+        ConsoleForks& operator=(const ConsoleForks&) = delete;
+
+        /// Takes ownership of \c other's forks, e.g. to destroy them on another thread.
+        ConsoleForks(ConsoleForks&& other) noexcept = default;
+        ConsoleForks& operator=(ConsoleForks&&) = delete;
+
+        /// Makes \c count forks of \c parent in its current state.
+        /// Existing forks are reused, so forking again from a new point
+        /// costs one savestate plus one state load per fork.
+        /// Forks of a different console or cart than last time are rebuilt from scratch.
+        /// \returns The number of forks that are ready to run.
+        size_t Fork(const CoreConfig& config, melonDS::NDS& parent, const retro::GameInfo* ndsInfo, size_t count) noexcept;
+
+        /// Runs one frame of the fork at \c index.
+        /// \param keys Pressed buttons, in the same order as the DS's KEYINPUT and EXTKEYIN registers.
+        bool Run(size_t index, uint32_t keys, int touchX, int touchY, bool touching) noexcept;
+
+        /// Writes the fork's state to \c data in the same format as retro_serialize.
+        bool Serialize(size_t index, std::span<std::byte> data) const noexcept;
+        [[nodiscard]] melonDS::NDS* Get(size_t index) noexcept;
+        [[nodiscard]] size_t Size() const noexcept { return _consoles.size(); }
+        void Clear() noexcept;
+    private:
+        // Destroys every fork from index \c count onward
+        void Truncate(size_t count) noexcept;
+
+        std::vector<std::unique_ptr<melonDS::NDS>> _consoles;
+        // The console and cart that the existing forks were made from
+        const melonDS::NDS* _parent = nullptr;
+        const melonDS::NDSCart::CartCommon* _parentCart = nullptr;
+        std::vector<std::byte> _state;
+        uint64_t _forksCreated = 0;
+        uint64_t _forkTimeUs = 0;
+    };
+}
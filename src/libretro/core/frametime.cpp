@@ -0,0 +1,148 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#include "frametime.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "constants.hpp"
+#include "environment.hpp"
+#include "tracy.hpp"
+
+using std::optional;
+using std::chrono::duration;
+using std::chrono::microseconds;
+
+void MelonDsDs::FrameTimeStats::BeginRun() noexcept {
+    ZoneScopedN(TracyFunction);
+    clock::time_point now = clock::now();
+    optional<clock::time_point> lastBegin = _lastBegin;
+    optional<clock::duration> lastRunTime = _lastRunTime;
+    _lastBegin = now;
+    _runStart = now;
+    _lastRunTime = std::nullopt;
+
+    if (_framesUntilRefreshQuery-- == 0) {
+        // The refresh rate can change (e.g. when the window moves to another monitor)
+        optional<float> refreshRate = retro::get_target_refresh_rate();
+        _targetIntervalUs = 1000000.0 / (refreshRate ? *refreshRate : FPS);
+        _framesUntilRefreshQuery = REFRESH_RATE_INTERVAL;
+    }
+
+    if (!lastBegin || !lastRunTime)
+        return;
+
+    if (optional<retro_throttle_state> throttle = retro::get_throttle_state()) {
+        if (throttle->mode != RETRO_THROTTLE_NONE && throttle->mode != RETRO_THROTTLE_VSYNC) {
+            // If the frontend is deliberately running at some other speed, vsync misses are meaningless
+            return;
+        }
+    }
+
+    // Prefer the frontend's own measurement if it gives us one, since it knows when frames were presented
+    double intervalUs;
+    if (optional<microseconds> frameTime = retro::last_frame_time(); frameTime && frameTime->count() > 0) {
+        intervalUs = static_cast<double>(frameTime->count());
+    }
+    else {
+        intervalUs = duration<double, std::micro>(now - *lastBegin).count();
+    }
+
+    double runTimeUs = duration<double, std::micro>(*lastRunTime).count();
+    bool missed = intervalUs > _targetIntervalUs * MISSED_VSYNC_FACTOR;
+    if (missed) {
+        // A frame that took twice as long as it should have missed one vsync, and so on
+        _missedVsyncs += std::max<uint64_t>(1, std::llround(intervalUs / _targetIntervalUs) - 1);
+        if (runTimeUs >= _targetIntervalUs * CORE_BOUND_FACTOR) {
+            _coreBoundMisses++;
+        }
+    }
+
+    _samples[_nextSample] = { static_cast<float>(intervalUs), static_cast<float>(runTimeUs), missed };
+    _nextSample = (_nextSample + 1) % WINDOW_SIZE;
+    _sampleCount = std::min(_sampleCount + 1, WINDOW_SIZE);
+
+#ifdef HAVE_TRACY
+    TracyPlot("Frame Interval (us)", intervalUs);
+    TracyPlot("retro_run Time (us)", runTimeUs);
+#endif
+}
+
+void MelonDsDs::FrameTimeStats::EndRun() noexcept {
+    if (!_runStart)
+        return;
+
+    _lastRunTime = clock::now() - *_runStart;
+    _runStart = std::nullopt;
+}
+
+MelonDsDs::FrameTimeSummary MelonDsDs::FrameTimeStats::Summary() const noexcept {
+    FrameTimeSummary summary {};
+    summary.TargetIntervalUs = _targetIntervalUs;
+    summary.Samples = _sampleCount;
+    summary.MissedVsyncs = _missedVsyncs;
+    summary.Bottleneck = FrameBottleneck::None;
+    if (_sampleCount == 0)
+        return summary;
+
+    size_t missed = 0;
+    for (size_t i = 0; i < _sampleCount; ++i) {
+        const Sample& sample = _samples[i];
+        summary.IntervalUs += sample.IntervalUs;
+        summary.RunTimeUs += sample.RunTimeUs;
+        summary.MaxIntervalUs = std::max<double>(summary.MaxIntervalUs, sample.IntervalUs);
+        missed += sample.Missed;
+    }
+    summary.IntervalUs /= _sampleCount;
+    summary.RunTimeUs /= _sampleCount;
+
+    double variance = 0;
+    for (size_t i = 0; i < _sampleCount; ++i) {
+        double deviation = _samples[i].IntervalUs - summary.IntervalUs;
+        variance += deviation * deviation;
+    }
+    summary.JitterUs = std::sqrt(variance / _sampleCount);
+
+    if (summary.RunTimeUs >= _targetIntervalUs * CORE_BOUND_FACTOR) {
+        // If emulating a frame takes about as long as (or longer than) showing one...
+        summary.Bottleneck = FrameBottleneck::Core;
+    }
+    else if (missed > 0) {
+        // If frames are late even though we return in plenty of time...
+        summary.Bottleneck = FrameBottleneck::Frontend;
+    }
+
+    return summary;
+}
+
+void MelonDsDs::FrameTimeStats::LogStats() const noexcept {
+    if (_sampleCount == 0)
+        return;
+
+    FrameTimeSummary summary = Summary();
+    retro::info(
+        "Frame pacing: {:.0f}us between frames (±{:.0f}us, target {:.0f}us), {:.0f}us inside retro_run; "
+        "{} missed vsync(s), {} while retro_run was the bottleneck",
+        summary.IntervalUs,
+        summary.JitterUs,
+        summary.TargetIntervalUs,
+        summary.RunTimeUs,
+        _missedVsyncs,
+        _coreBoundMisses
+    );
+}
@@ -0,0 +1,86 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace MelonDsDs {
+    enum class FrameBottleneck : int32_t {
+        None,
+        /// retro_run takes most of the time between frames
+        Core,
+        /// Frames are late even though retro_run returns quickly
+        Frontend,
+    };
+
+    /// Frame-pacing statistics over the last few seconds.
+    /// Exposed to C callers as-is, so keep it standard-layout.
+    struct FrameTimeSummary {
+        double IntervalUs;
+        double RunTimeUs;
+        /// Standard deviation of IntervalUs
+        double JitterUs;
+        double MaxIntervalUs;
+        double TargetIntervalUs;
+        uint64_t Samples;
+        /// Since the game was loaded, not just within the window
+        uint64_t MissedVsyncs;
+        FrameBottleneck Bottleneck;
+    };
+
+    /// Keeps rolling statistics on how regularly the frontend calls retro_run,
+    /// and how much of that time is spent inside it.
+    class FrameTimeStats {
+    public:
+        void BeginRun() noexcept;
+        void EndRun() noexcept;
+        [[nodiscard]] FrameTimeSummary Summary() const noexcept;
+        void LogStats() const noexcept;
+    private:
+        using clock = std::chrono::steady_clock;
+
+        // Two seconds at 60 FPS
+        static constexpr size_t WINDOW_SIZE = 120;
+        // A frame that arrives this many target intervals late counts as a missed vsync
+        static constexpr double MISSED_VSYNC_FACTOR = 1.5;
+        // If retro_run takes at least this fraction of the target interval, emulation can't keep up
+        static constexpr double CORE_BOUND_FACTOR = 0.9;
+        // How often to ask the frontend for its refresh rate, in frames
+        static constexpr unsigned REFRESH_RATE_INTERVAL = 300;
+
+        struct Sample {
+            float IntervalUs;
+            float RunTimeUs;
+            bool Missed;
+        };
+
+        std::array<Sample, WINDOW_SIZE> _samples {};
+        size_t _nextSample = 0;
+        size_t _sampleCount = 0;
+        uint64_t _missedVsyncs = 0;
+        uint64_t _coreBoundMisses = 0;
+        double _targetIntervalUs = 0;
+        unsigned _framesUntilRefreshQuery = 0;
+        std::optional<clock::time_point> _lastBegin = std::nullopt;
+        std::optional<clock::time_point> _runStart = std::nullopt;
+        std::optional<clock::duration> _lastRunTime = std::nullopt;
+    };
+}
@@ -0,0 +1,72 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include "idle.hpp"
+
+#include <array>
+
+#include <NDS.h>
+
+#include "audio.hpp"
+#include "constants.hpp"
+#include "environment.hpp"
+#include "tracy.hpp"
+
+bool MelonDsDs::IdleFrameState::Update(const melonDS::NDS& nds) noexcept {
+    // melonDS already skips most emulation work while asleep,
+    // and the CPUs' own halt states are fast-forwarded to the next event,
+    // so sleep mode is the only idle state worth handling here
+    bool asleep = (nds.CPUStop & melonDS::CPUStop_Sleep) != 0;
+    if (asleep != _asleep) {
+        // If the console just fell asleep or woke up...
+        if (asleep) {
+            retro::debug("Emulated console went to sleep");
+        }
+        else {
+            retro::debug("Emulated console woke up after {} idle frames", _idleFrames);
+        }
+        _asleep = asleep;
+        _idleFrames = 0;
+        _cycleRemainder = 0;
+        return false;
+    }
+
+    if (!asleep)
+        return false;
+
+    _idleFrames++;
+    if (_presentPending) {
+        _presentPending = false;
+        return false;
+    }
+
+    return true;
+}
+
+void MelonDsDs::IdleFrameState::SubmitSilence(melonDS::NDS& nds, AudioState& audio) noexcept {
+    ZoneScopedN(TracyFunction);
+    static constexpr std::array<int16_t, MAX_SAMPLES_PER_FRAME * 2> SILENCE {};
+
+    // Whatever the SPU produced while powered down is silent anyway
+    nds.SPU.DrainOutput();
+
+    // Keep the frontend's audio fed at the usual rate, so that audio sync still paces the core
+    _cycleRemainder += CYCLES_PER_FRAME;
+    uint32_t samples = _cycleRemainder / CYCLES_PER_SAMPLE;
+    _cycleRemainder %= CYCLES_PER_SAMPLE;
+
+    audio.Submit({SILENCE.data(), samples * 2});
+}
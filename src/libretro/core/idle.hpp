@@ -0,0 +1,52 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace melonDS {
+    class NDS;
+}
+
+namespace MelonDsDs {
+    class AudioState;
+
+    /// Tracks whether the emulated console is asleep (e.g. after the game reacts to the lid closing).
+    /// A sleeping console's screens and speakers are off,
+    /// so the core can present a duplicate frame and pre-generated silence
+    /// instead of compositing and mixing output that can't change.
+    class IdleFrameState {
+    public:
+        /// Call once per frame, after NDS::RunFrame.
+        /// \returns \c true if the frame that just ran can take the idle fast path.
+        /// The first sleeping frame returns \c false, so that the blank screen is presented once.
+        bool Update(const melonDS::NDS& nds) noexcept;
+
+        /// Replaces this frame's audio with silence.
+        void SubmitSilence(melonDS::NDS& nds, AudioState& audio) noexcept;
+
+        /// Forces the next sleeping frame to be presented (e.g. after the screen layout changes).
+        void RequestPresent() noexcept { _presentPending = true; }
+        [[nodiscard]] bool Asleep() const noexcept { return _asleep; }
+        [[nodiscard]] uint64_t IdleFrames() const noexcept { return _idleFrames; }
+    private:
+        bool _asleep = false;
+        bool _presentPending = false;
+        uint64_t _idleFrames = 0;
+        uint32_t _cycleRemainder = 0;
+    };
+}
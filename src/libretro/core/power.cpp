@@ -0,0 +1,309 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#include "power.hpp"
+
+#include <memory>
+
+#include <file/config_file.h>
+#include <file/file_path.h>
+
+#include "config/config.hpp"
+#include "config/constants.hpp"
+#include "config/parse.hpp"
+#include "environment.hpp"
+#include "format.hpp"
+#include "tracy.hpp"
+
+using std::optional;
+using std::nullopt;
+using std::string;
+using std::vector;
+using namespace MelonDsDs::config;
+
+constexpr const char* const POWER_PROFILES_FILE_NAME = "power_profiles.cfg";
+constexpr unsigned MAX_USER_PROFILES = 16;
+constexpr size_t MAX_VALUE_LENGTH = 64;
+
+struct ConfigFileDeleter {
+    void operator()(config_file_t* conf) const noexcept {
+        config_file_free(conf);
+    }
+};
+
+using config_file_ptr = std::unique_ptr<config_file_t, ConfigFileDeleter>;
+
+static optional<string> GetString(config_file_t* conf, const string& key) noexcept {
+    char value[MAX_VALUE_LENGTH] {};
+    if (!config_get_array(conf, key.c_str(), value, sizeof(value)))
+        return nullopt;
+
+    return string(value);
+}
+
+static optional<MelonDsDs::PowerSource> ParsePowerSource(std::string_view value) noexcept {
+    if (value == "battery") return MelonDsDs::PowerSource::Battery;
+    if (value == "external") return MelonDsDs::PowerSource::External;
+    if (value == "any") return MelonDsDs::PowerSource::Any;
+
+    return nullopt;
+}
+
+// Each profile's settings are stored as power_profile_<n>_<key>,
+// where the keys are the same as the core options they override
+// (e.g. power_profile_0_melonds_audio_interpolation = "disabled")
+static optional<MelonDsDs::PowerProfileSettings> ReadProfile(config_file_t* conf, unsigned index) noexcept {
+    string prefix = fmt::format("power_profile_{}_", index);
+    optional<string> name = GetString(conf, prefix + "name");
+    if (!name)
+        return nullopt;
+
+    MelonDsDs::PowerProfileSettings profile;
+    profile.Name = std::move(*name);
+
+    if (optional<string> value = GetString(conf, prefix + "source")) {
+        if (optional<MelonDsDs::PowerSource> source = ParsePowerSource(*value)) {
+            profile.Source = *source;
+        } else {
+            retro::warn("Power profile \"{}\" has an invalid source \"{}\", defaulting to battery", profile.Name, *value);
+        }
+    }
+
+    if (optional<string> value = GetString(conf, prefix + "max_percent")) {
+        if (optional<unsigned> percent = MelonDsDs::ParseIntegerInRange<unsigned>(*value, 0, 100)) {
+            profile.MaxPercent = *percent;
+        } else {
+            retro::warn("Power profile \"{}\" has an invalid max_percent \"{}\", defaulting to 100", profile.Name, *value);
+        }
+    }
+
+    if (optional<string> value = GetString(conf, prefix + video::THREADED_RENDERER)) {
+        profile.ThreadedSoftRenderer = MelonDsDs::ParseBoolean(*value);
+    }
+
+    if (optional<string> value = GetString(conf, prefix + video::OPENGL_RESOLUTION)) {
+        profile.ScaleFactor = MelonDsDs::ParseIntegerInRange<int>(*value, 1, video::INITIAL_MAX_OPENGL_SCALE);
+    }
+
+    if (optional<string> value = GetString(conf, prefix + audio::AUDIO_INTERPOLATION)) {
+        profile.Interpolation = MelonDsDs::ParseInterpolation(*value);
+    }
+
+    if (optional<string> value = GetString(conf, prefix + "osd")) {
+        profile.HidesOsd = MelonDsDs::ParseBoolean(*value) == false;
+    }
+
+    return profile;
+}
+
+// The battery profile that the core options define, if it's enabled
+static optional<MelonDsDs::PowerProfileSettings> OptionsProfile(const MelonDsDs::CoreConfig& config) noexcept {
+    optional<unsigned> threshold = config.BatteryProfileThreshold();
+    if (!threshold)
+        return nullopt;
+
+    MelonDsDs::PowerProfileSettings profile;
+    profile.Name = "Battery";
+    profile.Source = MelonDsDs::PowerSource::Battery;
+    profile.MaxPercent = *threshold;
+    profile.ThreadedSoftRenderer = config.BatteryProfileThreadedRenderer();
+    profile.ScaleFactor = config.BatteryProfileScaleFactor();
+    profile.Interpolation = config.BatteryProfileInterpolation();
+    profile.HidesOsd = config.BatteryProfileHidesOsd();
+    return profile;
+}
+
+bool MelonDsDs::PowerProfileSettings::Matches(const retro_device_power& power, unsigned percentSlack) const noexcept {
+    switch (Source) {
+        case PowerSource::Battery:
+            if (power.state != RETRO_POWERSTATE_DISCHARGING)
+                return false;
+            break;
+        case PowerSource::External:
+            if (power.state != RETRO_POWERSTATE_CHARGING && power.state != RETRO_POWERSTATE_CHARGED && power.state != RETRO_POWERSTATE_PLUGGED_IN)
+                return false;
+            break;
+        case PowerSource::Any:
+            break;
+    }
+
+    if (power.percent == RETRO_POWERSTATE_NO_ESTIMATE) {
+        // If we don't know how much charge is left, assume the worst
+        return true;
+    }
+
+    return static_cast<unsigned>(power.percent) <= MaxPercent + percentSlack;
+}
+
+void MelonDsDs::PowerProfileSettings::Apply(CoreConfig& config) const noexcept {
+#if defined(HAVE_THREADS) && defined(HAVE_THREADED_RENDERER)
+    if (ThreadedSoftRenderer)
+        config.SetThreadedSoftRenderer(*ThreadedSoftRenderer);
+#endif
+
+    if (ScaleFactor)
+        config.SetScaleFactor(*ScaleFactor);
+
+    if (Interpolation)
+        config.SetInterpolation(*Interpolation);
+
+    if (HidesOsd)
+        config.HideStatusIndicators();
+}
+
+void MelonDsDs::PowerProfileState::Load() noexcept {
+    ZoneScopedN(TracyFunction);
+
+    _userProfiles.clear();
+    _active = nullopt;
+    _wanted = nullopt;
+    _samplesWantingSwitch = 0;
+    _stats.clear();
+    _frameTimer.Reset();
+
+    optional<string> path = retro::get_save_subdir_path(POWER_PROFILES_FILE_NAME);
+    if (!path || !path_is_valid(path->c_str()))
+        return;
+
+    config_file_ptr conf(config_file_new_from_path_to_string(path->c_str()));
+    if (!conf) {
+        retro::warn("Failed to read \"{}\", only the core options' battery profile will be used", *path);
+        return;
+    }
+
+    for (unsigned i = 0; i < MAX_USER_PROFILES; ++i) {
+        if (optional<PowerProfileSettings> profile = ReadProfile(conf.get(), i)) {
+            _userProfiles.push_back(std::move(*profile));
+        }
+    }
+
+    retro::info("Loaded {} power profile(s) from \"{}\"", _userProfiles.size(), *path);
+}
+
+vector<MelonDsDs::PowerProfileSettings> MelonDsDs::PowerProfileState::Profiles(const CoreConfig& config) const noexcept {
+    vector<PowerProfileSettings> profiles = _userProfiles;
+    if (optional<PowerProfileSettings> optionsProfile = OptionsProfile(config)) {
+        profiles.push_back(std::move(*optionsProfile));
+    }
+
+    return profiles;
+}
+
+bool MelonDsDs::PowerProfileState::Enabled(const CoreConfig& config) const noexcept {
+    return !_userProfiles.empty() || config.BatteryProfileThreshold();
+}
+
+optional<MelonDsDs::PowerProfileSettings> MelonDsDs::PowerProfileState::ActiveSettings(const CoreConfig& config) const noexcept {
+    if (!_active)
+        return nullopt;
+
+    vector<PowerProfileSettings> profiles = Profiles(config);
+    if (*_active >= profiles.size())
+        return nullopt;
+
+    return std::move(profiles[*_active]);
+}
+
+optional<size_t> MelonDsDs::PowerProfileState::WantedProfile(
+    const retro_device_power& power,
+    const vector<PowerProfileSettings>& profiles
+) const noexcept {
+    for (size_t i = 0; i < profiles.size(); ++i) {
+        // Only leave the active profile once the battery is comfortably above its threshold
+        unsigned slack = _active == i ? PERCENT_HYSTERESIS : 0;
+        if (profiles[i].Matches(power, slack))
+            return i;
+    }
+
+    return nullopt;
+}
+
+bool MelonDsDs::PowerProfileState::Update(const retro_device_power& power, const CoreConfig& config) noexcept {
+    ZoneScopedN(TracyFunction);
+
+    vector<PowerProfileSettings> profiles = Profiles(config);
+    optional<size_t> wanted = WantedProfile(power, profiles);
+    if (wanted == _active) {
+        _wanted = nullopt;
+        _samplesWantingSwitch = 0;
+        return false;
+    }
+
+    if (wanted != _wanted) {
+        // If we want a different profile than we did last time, start counting over
+        _wanted = wanted;
+        _samplesWantingSwitch = 0;
+    }
+
+    bool activeRemoved = _active && *_active >= profiles.size();
+    if (activeRemoved || ++_samplesWantingSwitch >= SAMPLES_TO_SWITCH) {
+        // If the active profile was just disabled, or the new power state has persisted for long enough...
+        LogStats(config);
+        _active = wanted;
+        _wanted = nullopt;
+        _samplesWantingSwitch = 0;
+        return true;
+    }
+
+    return false;
+}
+
+void MelonDsDs::PowerProfileState::BeginFrame() noexcept {
+    _frameTimer.Start();
+}
+
+void MelonDsDs::PowerProfileState::EndFrame() noexcept {
+    optional<std::chrono::steady_clock::duration> time = _frameTimer.Stop();
+    if (!time)
+        return;
+
+    size_t slot = _active ? *_active + 1 : 0;
+    if (slot >= _stats.size()) {
+        _stats.resize(slot + 1);
+    }
+
+    Stats& stats = _stats[slot];
+    stats.Frames++;
+    stats.Time += *time;
+}
+
+optional<double> MelonDsDs::PowerProfileState::TimePerFrame(optional<size_t> profile) const noexcept {
+    size_t slot = profile ? *profile + 1 : 0;
+    if (slot >= _stats.size() || _stats[slot].Frames == 0)
+        return nullopt;
+
+    const Stats& stats = _stats[slot];
+    return std::chrono::duration<double, std::micro>(stats.Time).count() / stats.Frames;
+}
+
+uint64_t MelonDsDs::PowerProfileState::FramesMeasured(optional<size_t> profile) const noexcept {
+    size_t slot = profile ? *profile + 1 : 0;
+    return slot < _stats.size() ? _stats[slot].Frames : 0;
+}
+
+void MelonDsDs::PowerProfileState::LogStats(const CoreConfig& config) const noexcept {
+    if (optional<double> normal = TimePerFrame(nullopt)) {
+        retro::info("Usual settings: {:.0f}us per frame over {} frames", *normal, FramesMeasured(nullopt));
+    }
+
+    vector<PowerProfileSettings> profiles = Profiles(config);
+    for (size_t i = 0; i < profiles.size(); ++i) {
+        if (optional<double> time = TimePerFrame(i)) {
+            retro::info("{} profile: {:.0f}us per frame over {} frames", profiles[i].Name, *time, FramesMeasured(i));
+        }
+    }
+}
@@ -0,0 +1,107 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libretro.h>
+#include <SPU.h>
+
+#include "worktime.hpp"
+
+namespace MelonDsDs {
+    class CoreConfig;
+
+    enum class PowerSource {
+        Any,
+        Battery,
+        External,
+    };
+
+    /// A set of settings to use while the device's power state matches the given conditions.
+    /// Unset fields leave the corresponding setting alone.
+    struct PowerProfileSettings {
+        std::string Name;
+        PowerSource Source = PowerSource::Battery;
+        // The profile applies at or below this charge level
+        unsigned MaxPercent = 100;
+        std::optional<bool> ThreadedSoftRenderer;
+        std::optional<int> ScaleFactor;
+        std::optional<melonDS::AudioInterpolation> Interpolation;
+        bool HidesOsd = false;
+
+        [[nodiscard]] bool Matches(const retro_device_power& power, unsigned percentSlack) const noexcept;
+        void Apply(CoreConfig& config) const noexcept;
+    };
+
+    /// Decides which performance profile to use based on the device's power state,
+    /// and keeps track of how long each profile takes per frame.
+    /// Profiles come from power_profiles.cfg in the core's save directory,
+    /// followed by the battery profile defined in the core options (if enabled).
+    /// The first profile that matches is used; if none match, the player's usual settings are.
+    class PowerProfileState {
+    public:
+        /// Reads the player's own profiles and forgets the active profile and any statistics.
+        void Load() noexcept;
+
+        /// Feeds a new power status sample to the state machine.
+        /// @returns true if the active profile changed.
+        bool Update(const retro_device_power& power, const CoreConfig& config) noexcept;
+
+        /// Index of the active profile, or \c nullopt if the usual settings are active.
+        [[nodiscard]] std::optional<size_t> Active() const noexcept { return _active; }
+        [[nodiscard]] std::optional<PowerProfileSettings> ActiveSettings(const CoreConfig& config) const noexcept;
+
+        /// True if there's any profile that could be switched to.
+        [[nodiscard]] bool Enabled(const CoreConfig& config) const noexcept;
+
+        void BeginFrame() noexcept;
+        void EndFrame() noexcept;
+
+        /// Average time spent emulating and rendering each frame while the given profile (or the usual settings) was active, in microseconds.
+        [[nodiscard]] std::optional<double> TimePerFrame(std::optional<size_t> profile) const noexcept;
+        [[nodiscard]] uint64_t FramesMeasured(std::optional<size_t> profile) const noexcept;
+        void LogStats(const CoreConfig& config) const noexcept;
+    private:
+        // A profile keeps applying until the battery is this much above its threshold,
+        // so that a battery hovering around the threshold doesn't cause constant switching
+        static constexpr unsigned PERCENT_HYSTERESIS = 5;
+        // A new profile must be wanted for this many consecutive samples before we switch to it
+        static constexpr unsigned SAMPLES_TO_SWITCH = 2;
+
+        [[nodiscard]] std::vector<PowerProfileSettings> Profiles(const CoreConfig& config) const noexcept;
+        [[nodiscard]] std::optional<size_t> WantedProfile(const retro_device_power& power, const std::vector<PowerProfileSettings>& profiles) const noexcept;
+
+        struct Stats {
+            uint64_t Frames = 0;
+            std::chrono::steady_clock::duration Time {};
+        };
+
+        std::vector<PowerProfileSettings> _userProfiles {};
+        std::optional<size_t> _active = std::nullopt;
+        std::optional<size_t> _wanted = std::nullopt;
+        unsigned _samplesWantingSwitch = 0;
+        // Index 0 is for the usual settings, the rest are for each profile in order
+        std::vector<Stats> _stats {};
+        WorkTimer _frameTimer {};
+    };
+}
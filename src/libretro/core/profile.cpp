@@ -0,0 +1,504 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include "profile.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <file/config_file.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+
+#include <NDS_Header.h>
+
+#include "config/config.hpp"
+#include "config/constants.hpp"
+#include "config/parse.hpp"
+#include "environment.hpp"
+#include "format.hpp"
+#include "tracy.hpp"
+
+using std::optional;
+using std::nullopt;
+using std::string;
+using std::string_view;
+using namespace MelonDsDs::config;
+
+constexpr const char* const PROFILE_DIR_NAME = "profiles";
+constexpr size_t MAX_VALUE_LENGTH = 64;
+
+struct ConfigFileDeleter {
+    void operator()(config_file_t* conf) const noexcept {
+        config_file_free(conf);
+    }
+};
+
+using config_file_ptr = std::unique_ptr<config_file_t, ConfigFileDeleter>;
+
+static optional<string> GetString(config_file_t* conf, const char* key) noexcept {
+    char value[MAX_VALUE_LENGTH] {};
+    if (!config_get_array(conf, key, value, sizeof(value)))
+        return nullopt;
+
+    return string(value);
+}
+
+template<typename T>
+static optional<T> GetInteger(config_file_t* conf, const char* key, T min, T max) noexcept {
+    optional<string> value = GetString(conf, key);
+    return value ? MelonDsDs::ParseIntegerInRange<T>(*value, min, max) : nullopt;
+}
+
+static optional<double> GetDouble(config_file_t* conf, const char* key) noexcept {
+    optional<string> value = GetString(conf, key);
+    if (!value)
+        return nullopt;
+
+    char* end = nullptr;
+    double parsed = std::strtod(value->c_str(), &end);
+    return end != value->c_str() ? std::make_optional(parsed) : nullopt;
+}
+
+static optional<bool> GetBoolean(config_file_t* conf, const char* key) noexcept {
+    optional<string> value = GetString(conf, key);
+    return value ? MelonDsDs::ParseBoolean(*value) : nullopt;
+}
+
+static const char* InterpolationValue(melonDS::AudioInterpolation interpolation) noexcept {
+    switch (interpolation) {
+        case melonDS::AudioInterpolation::Linear: return values::LINEAR;
+        case melonDS::AudioInterpolation::Cosine: return values::COSINE;
+        case melonDS::AudioInterpolation::Cubic: return values::CUBIC;
+        case melonDS::AudioInterpolation::SNESGaussian: return values::GAUSSIAN;
+        default: return values::DISABLED;
+    }
+}
+
+// Overrides are stored under the same keys and values as the core options they replace
+static MelonDsDs::TitleOverrides ReadOverrides(config_file_t* conf) noexcept {
+    MelonDsDs::TitleOverrides overrides;
+    overrides.MaxBlockSize = GetInteger<unsigned>(conf, cpu::JIT_BLOCK_SIZE, 1, 32);
+    overrides.BranchOptimizations = GetBoolean(conf, cpu::JIT_BRANCH_OPTIMISATIONS);
+    overrides.LiteralOptimizations = GetBoolean(conf, cpu::JIT_LITERAL_OPTIMISATIONS);
+    overrides.FastMemory = GetBoolean(conf, cpu::JIT_FAST_MEMORY);
+    overrides.ThreadedSoftRenderer = GetBoolean(conf, video::THREADED_RENDERER);
+    if (optional<string> value = GetString(conf, audio::AUDIO_INTERPOLATION)) {
+        overrides.Interpolation = MelonDsDs::ParseInterpolation(*value);
+    }
+
+    return overrides;
+}
+
+static void WriteOverrides(config_file_t* conf, const MelonDsDs::TitleOverrides& overrides) noexcept {
+    if (overrides.MaxBlockSize)
+        config_set_string(conf, cpu::JIT_BLOCK_SIZE, fmt::format("{}", *overrides.MaxBlockSize).c_str());
+
+    if (overrides.BranchOptimizations)
+        config_set_string(conf, cpu::JIT_BRANCH_OPTIMISATIONS, *overrides.BranchOptimizations ? values::ENABLED : values::DISABLED);
+
+    if (overrides.LiteralOptimizations)
+        config_set_string(conf, cpu::JIT_LITERAL_OPTIMISATIONS, *overrides.LiteralOptimizations ? values::ENABLED : values::DISABLED);
+
+    if (overrides.FastMemory)
+        config_set_string(conf, cpu::JIT_FAST_MEMORY, *overrides.FastMemory ? values::ENABLED : values::DISABLED);
+
+    if (overrides.ThreadedSoftRenderer)
+        config_set_string(conf, video::THREADED_RENDERER, *overrides.ThreadedSoftRenderer ? values::ENABLED : values::DISABLED);
+
+    if (overrides.Interpolation)
+        config_set_string(conf, audio::AUDIO_INTERPOLATION, InterpolationValue(*overrides.Interpolation));
+}
+
+// Each session while tuning runs with one of these applied on top of the player's settings
+// (including this game's existing overrides). The first is the baseline, so it changes nothing;
+// every other candidate changes exactly one setting away from its current value.
+static std::vector<MelonDsDs::TitleOverrides> MakeCandidates(const MelonDsDs::CoreConfig& config) noexcept {
+    using MelonDsDs::TitleOverrides;
+    std::vector<TitleOverrides> candidates { TitleOverrides {} };
+
+#ifdef HAVE_JIT
+    if (config.JitEnable()) {
+        for (unsigned blockSize : { 32u, 16u, 8u }) {
+            if (blockSize != config.MaxBlockSize()) {
+                candidates.push_back({ .MaxBlockSize = blockSize });
+            }
+        }
+
+        candidates.push_back({ .BranchOptimizations = !config.BranchOptimizations() });
+        candidates.push_back({ .LiteralOptimizations = !config.LiteralOptimizations() });
+#   ifdef HAVE_JIT_FASTMEM
+        candidates.push_back({ .FastMemory = !config.FastMemory() });
+#   endif
+    }
+#endif
+
+#if defined(HAVE_THREADS) && defined(HAVE_THREADED_RENDERER)
+    if (config.ConfiguredRenderer() == MelonDsDs::RenderMode::Software && !config.AutoThreadedSoftRenderer()) {
+        // If the threaded renderer tuner isn't already deciding this setting...
+        candidates.push_back({ .ThreadedSoftRenderer = !config.ThreadedSoftRenderer() });
+    }
+#endif
+
+    return candidates;
+}
+
+// Results are stored under each candidate's name rather than its index,
+// since the list of candidates depends on the player's settings
+static string CandidateName(const MelonDsDs::TitleOverrides& candidate) noexcept {
+    if (candidate.MaxBlockSize)
+        return fmt::format("block_size_{}", *candidate.MaxBlockSize);
+
+    if (candidate.BranchOptimizations)
+        return *candidate.BranchOptimizations ? "branch_optimizations_on" : "branch_optimizations_off";
+
+    if (candidate.LiteralOptimizations)
+        return *candidate.LiteralOptimizations ? "literal_optimizations_on" : "literal_optimizations_off";
+
+    if (candidate.FastMemory)
+        return *candidate.FastMemory ? "fast_memory_on" : "fast_memory_off";
+
+    if (candidate.ThreadedSoftRenderer)
+        return *candidate.ThreadedSoftRenderer ? "threaded_renderer_on" : "threaded_renderer_off";
+
+    return "baseline";
+}
+
+// Identifies the settings that the baseline was measured with,
+// so that results measured under different settings aren't compared
+static string BaselineName(const MelonDsDs::CoreConfig& config) noexcept {
+    string name = "interpreter";
+#ifdef HAVE_JIT
+    if (config.JitEnable()) {
+        name = fmt::format(
+            "jit,block_size_{},branch_{},literal_{}",
+            config.MaxBlockSize(),
+            config.BranchOptimizations(),
+            config.LiteralOptimizations()
+        );
+#   ifdef HAVE_JIT_FASTMEM
+        name += fmt::format(",fast_memory_{}", config.FastMemory());
+#   endif
+    }
+#endif
+
+#if defined(HAVE_THREADS) && defined(HAVE_THREADED_RENDERER)
+    if (config.ConfiguredRenderer() == MelonDsDs::RenderMode::Software) {
+        name += fmt::format(",threaded_renderer_{}", config.AutoThreadedSoftRenderer() ? "auto" : config.ThreadedSoftRenderer() ? "on" : "off");
+    }
+#endif
+
+    return name;
+}
+
+uint32_t MelonDsDs::TitleChecksum(const melonDS::NDSHeader& header, std::span<const std::byte> rom) noexcept {
+    ZoneScopedN(TracyFunction);
+
+    auto hashRange = [&rom](uint32_t hash, uint32_t offset, uint32_t length) noexcept {
+        if (offset >= rom.size())
+            return hash;
+
+        length = std::min<size_t>(length, rom.size() - offset);
+        return encoding_crc32(hash, reinterpret_cast<const uint8_t*>(rom.data() + offset), length);
+    };
+
+    uint32_t hash = hashRange(0, 0, sizeof(melonDS::NDSHeader));
+    hash = hashRange(hash, header.ARM9ROMOffset, header.ARM9Size);
+    hash = hashRange(hash, header.ARM7ROMOffset, header.ARM7Size);
+
+    return hash;
+}
+
+void MelonDsDs::TitleOverrides::Apply(CoreConfig& config) const noexcept {
+#ifdef HAVE_JIT
+    if (MaxBlockSize)
+        config.SetMaxBlockSize(*MaxBlockSize);
+
+    if (BranchOptimizations)
+        config.SetBranchOptimizations(*BranchOptimizations);
+
+    if (LiteralOptimizations)
+        config.SetLiteralOptimizations(*LiteralOptimizations);
+
+#   ifdef HAVE_JIT_FASTMEM
+    if (FastMemory)
+        config.SetFastMemory(*FastMemory);
+#   endif
+#endif
+
+#ifdef HAVE_THREADED_RENDERER
+    if (ThreadedSoftRenderer)
+        config.SetThreadedSoftRenderer(*ThreadedSoftRenderer);
+#endif
+
+    if (Interpolation)
+        config.SetInterpolation(*Interpolation);
+}
+
+void MelonDsDs::TitleOverrides::Merge(const TitleOverrides& other) noexcept {
+    if (other.MaxBlockSize) MaxBlockSize = other.MaxBlockSize;
+    if (other.BranchOptimizations) BranchOptimizations = other.BranchOptimizations;
+    if (other.LiteralOptimizations) LiteralOptimizations = other.LiteralOptimizations;
+    if (other.FastMemory) FastMemory = other.FastMemory;
+    if (other.ThreadedSoftRenderer) ThreadedSoftRenderer = other.ThreadedSoftRenderer;
+    if (other.Interpolation) Interpolation = other.Interpolation;
+}
+
+optional<MelonDsDs::TitleProfile> MelonDsDs::TitleProfile::Load(
+    const melonDS::NDSHeader& header,
+    std::span<const std::byte> rom,
+    const CoreConfig& config,
+    bool tune
+) noexcept {
+    ZoneScopedN(TracyFunction);
+
+    TitleProfile profile;
+    profile._gameCode = string(header.GameCode, strnlen(header.GameCode, sizeof(header.GameCode)));
+    profile._romCrc32 = TitleChecksum(header, rom);
+
+    char filename[PATH_MAX] {};
+    fmt::format_to_n(filename, sizeof(filename) - 1, "{}/{}-{:08x}.cfg", PROFILE_DIR_NAME, profile._gameCode, profile._romCrc32);
+    optional<string> path = retro::get_save_subdir_path(filename);
+    if (!path) {
+        retro::warn("Failed to get the path to this game's profile, per-game profiles won't be used");
+        return nullopt;
+    }
+    profile._path = std::move(*path);
+
+    config_file_ptr conf;
+    if (path_is_valid(profile._path.c_str())) {
+        // If this game already has a profile...
+        conf.reset(config_file_new_from_path_to_string(profile._path.c_str()));
+        if (conf) {
+            profile._overrides = ReadOverrides(conf.get());
+            profile._totalFrames = GetInteger<uint64_t>(conf.get(), "stats_frames", 0, UINT64_MAX).value_or(0);
+            profile._averageFrameTimeUs = GetDouble(conf.get(), "stats_frame_time_us").value_or(0);
+            profile._bestCandidate = GetString(conf.get(), "tuning_best");
+            retro::info("Loaded profile for {} from \"{}\"", profile._gameCode, profile._path);
+        }
+        else {
+            retro::warn("Failed to read \"{}\", starting a new profile", profile._path);
+        }
+    }
+
+    if (!profile._bestCandidate) {
+        // If tuning isn't finished, pick up where the last session left off
+        // (even if we're not tuning this session, so that saving doesn't lose progress)
+        CoreConfig tuned = config;
+        profile._overrides.Apply(tuned);
+        profile._candidates = MakeCandidates(tuned);
+        profile._baseline = BaselineName(tuned);
+        profile._results.resize(profile._candidates.size());
+
+        optional<string> baseline = conf ? GetString(conf.get(), "tuning_baseline") : nullopt;
+        if (baseline == profile._baseline) {
+            for (size_t i = 0; i < profile._candidates.size(); ++i) {
+                string name = CandidateName(profile._candidates[i]);
+                CandidateResult& result = profile._results[i];
+                result.Frames = GetInteger<uint64_t>(conf.get(), fmt::format("tuning_{}_frames", name).c_str(), 0, UINT64_MAX).value_or(0);
+                result.FrameTimeUs = GetDouble(conf.get(), fmt::format("tuning_{}_frame_time_us", name).c_str()).value_or(0);
+                result.Attempts = GetInteger<unsigned>(conf.get(), fmt::format("tuning_{}_attempts", name).c_str(), 0, UINT_MAX).value_or(0);
+            }
+        }
+        else if (baseline) {
+            retro::info("Settings for {} changed since tuning started, starting over", profile._gameCode);
+        }
+    }
+
+    if (tune && !profile._bestCandidate) {
+        // If we're tuning and haven't yet settled on a configuration...
+        profile.StartNextCandidate();
+    }
+
+    return profile;
+}
+
+void MelonDsDs::TitleProfile::StartNextCandidate() noexcept {
+    ZoneScopedN(TracyFunction);
+
+    auto next = std::find_if(_results.begin(), _results.end(), [](const CandidateResult& result) {
+        return result.Frames < MEASURED_FRAMES && result.Attempts < MAX_ATTEMPTS;
+    });
+
+    if (next == _results.end()) {
+        // If every candidate has either been measured or given up on...
+        FinishTuning();
+        return;
+    }
+
+    _candidate = next - _results.begin();
+    _candidateFrames = 0;
+    _candidateFrameTimeUs = 0;
+
+    // Count the attempt now, so that a candidate that crashes the core will eventually be skipped
+    next->Attempts++;
+    Save();
+    retro::info("Tuning {}: trying {} ({} of {})", _gameCode, CandidateName(_candidates[*_candidate]), *_candidate + 1, _candidates.size());
+}
+
+void MelonDsDs::TitleProfile::FinishTuning() noexcept {
+    ZoneScopedN(TracyFunction);
+
+    // Candidates that never finished a full measurement are considered unstable
+    optional<size_t> best;
+    for (size_t i = 0; i < _results.size(); ++i) {
+        if (_results[i].Frames < MEASURED_FRAMES)
+            continue;
+
+        if (!best || _results[i].FrameTimeUs < _results[*best].FrameTimeUs) {
+            best = i;
+        }
+    }
+
+    const CandidateResult& baseline = _results[0];
+    if (best && *best != 0 && baseline.Frames >= MEASURED_FRAMES && _results[*best].FrameTimeUs > baseline.FrameTimeUs * MIN_IMPROVEMENT) {
+        // If the fastest candidate isn't meaningfully faster than the baseline, don't bother with it
+        best = 0;
+    }
+
+    size_t kept = best.value_or(0);
+    _bestCandidate = CandidateName(_candidates[kept]);
+    _candidate = nullopt;
+    _overrides.Merge(_candidates[kept]);
+    retro::info("Finished tuning {}; kept {} ({:.0f}us per frame)", _gameCode, *_bestCandidate, _results[kept].FrameTimeUs);
+    Save();
+}
+
+void MelonDsDs::TitleProfile::Apply(CoreConfig& config) const noexcept {
+    _overrides.Apply(config);
+    if (_candidate) {
+        _candidates[*_candidate].Apply(config);
+    }
+}
+
+void MelonDsDs::TitleProfile::BeginFrame() noexcept {
+    _frameTimer.Start();
+}
+
+void MelonDsDs::TitleProfile::EndFrame() noexcept {
+    optional<std::chrono::steady_clock::duration> frameTime = _frameTimer.Stop();
+    if (!frameTime)
+        return;
+
+    double frameTimeUs = std::chrono::duration<double, std::micro>(*frameTime).count();
+
+    if (++_sessionFrames <= WARMUP_FRAMES) {
+        // If the JIT and caches are still warming up, these frames aren't representative
+        return;
+    }
+
+    // Incremental means, so that we don't need to keep every sample
+    _totalFrames++;
+    _averageFrameTimeUs += (frameTimeUs - _averageFrameTimeUs) / _totalFrames;
+
+    if (_candidate) {
+        _candidateFrames++;
+        _candidateFrameTimeUs += (frameTimeUs - _candidateFrameTimeUs) / _candidateFrames;
+        if (_candidateFrames >= MEASURED_FRAMES) {
+            // If we've measured this candidate for long enough...
+            _results[*_candidate].Frames = _candidateFrames;
+            _results[*_candidate].FrameTimeUs = _candidateFrameTimeUs;
+            retro::info("Tuning {}: {} took {:.0f}us per frame", _gameCode, CandidateName(_candidates[*_candidate]), _candidateFrameTimeUs);
+            _candidate = nullopt;
+
+            // The next candidate will be tried next session, since some settings only apply at startup
+            if (std::none_of(_results.begin(), _results.end(), [](const CandidateResult& result) {
+                return result.Frames < MEASURED_FRAMES && result.Attempts < MAX_ATTEMPTS;
+            })) {
+                FinishTuning();
+            }
+            else {
+                Save();
+            }
+        }
+    }
+}
+
+bool MelonDsDs::TitleProfile::Save() const noexcept {
+    ZoneScopedN(TracyFunction);
+
+    char dir[PATH_MAX] {};
+    strlcpy(dir, _path.c_str(), sizeof(dir));
+    path_basedir(dir);
+    if (!path_mkdir(dir)) {
+        retro::warn("Failed to create \"{}\", can't save this game's profile", dir);
+        return false;
+    }
+
+    config_file_ptr conf(config_file_new_alloc());
+    if (!conf) {
+        retro::error("Failed to allocate this game's profile");
+        return false;
+    }
+
+    config_set_string(conf.get(), "game_code", _gameCode.c_str());
+    config_set_string(conf.get(), "rom_crc32", fmt::format("{:08x}", _romCrc32).c_str());
+    WriteOverrides(conf.get(), _overrides);
+    config_set_string(conf.get(), "stats_frames", fmt::format("{}", _totalFrames).c_str());
+    config_set_string(conf.get(), "stats_frame_time_us", fmt::format("{:.1f}", _averageFrameTimeUs).c_str());
+
+    if (_bestCandidate) {
+        config_set_string(conf.get(), "tuning_best", _bestCandidate->c_str());
+    }
+    else if (!_candidates.empty()) {
+        config_set_string(conf.get(), "tuning_baseline", _baseline.c_str());
+    }
+
+    for (size_t i = 0; i < _results.size(); ++i) {
+        const CandidateResult& result = _results[i];
+        if (_bestCandidate || result.Attempts == 0)
+            continue;
+
+        string name = CandidateName(_candidates[i]);
+        config_set_string(conf.get(), fmt::format("tuning_{}_frames", name).c_str(), fmt::format("{}", result.Frames).c_str());
+        config_set_string(conf.get(), fmt::format("tuning_{}_frame_time_us", name).c_str(), fmt::format("{:.1f}", result.FrameTimeUs).c_str());
+        config_set_string(conf.get(), fmt::format("tuning_{}_attempts", name).c_str(), fmt::format("{}", result.Attempts).c_str());
+    }
+
+    if (!config_file_write(conf.get(), _path.c_str(), true)) {
+        retro::warn("Failed to write this game's profile to \"{}\"", _path);
+        return false;
+    }
+
+    retro::debug("Saved this game's profile to \"{}\"", _path);
+    return true;
+}
+
+bool MelonDsDs::TitleProfile::Reset() noexcept {
+    ZoneScopedN(TracyFunction);
+
+    _overrides = {};
+    _results.assign(_candidates.size(), CandidateResult {});
+    _candidate = nullopt;
+    _bestCandidate = nullopt;
+    _totalFrames = 0;
+    _averageFrameTimeUs = 0;
+    _candidateFrames = 0;
+    _candidateFrameTimeUs = 0;
+
+    if (path_is_valid(_path.c_str()) && filestream_delete(_path.c_str()) != 0) {
+        retro::warn("Failed to delete \"{}\"", _path);
+        return false;
+    }
+
+    retro::info("Reset the profile for {}; changes take effect at next restart", _gameCode);
+    return true;
+}
@@ -0,0 +1,110 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <SPU.h>
+
+#include "std/span.hpp"
+#include "worktime.hpp"
+
+namespace melonDS {
+    struct NDSHeader;
+}
+
+namespace MelonDsDs {
+    class CoreConfig;
+
+    /// A CRC32 of the ROM's header and its ARM9 and ARM7 binaries;
+    /// enough to tell revisions and hacks apart without hashing the entire ROM.
+    uint32_t TitleChecksum(const melonDS::NDSHeader& header, std::span<const std::byte> rom) noexcept;
+
+    /// Settings that a per-game profile may override.
+    /// Unset fields leave the corresponding core option alone.
+    struct TitleOverrides {
+        std::optional<unsigned> MaxBlockSize;
+        std::optional<bool> BranchOptimizations;
+        std::optional<bool> LiteralOptimizations;
+        std::optional<bool> FastMemory;
+        std::optional<bool> ThreadedSoftRenderer;
+        std::optional<melonDS::AudioInterpolation> Interpolation;
+
+        void Apply(CoreConfig& config) const noexcept;
+        void Merge(const TitleOverrides& other) noexcept;
+    };
+
+    /// Per-game settings and performance statistics,
+    /// stored in the save directory and keyed by game code and a hash of the ROM's code.
+    /// Can also tune itself by trying one candidate configuration per session
+    /// and keeping whichever one runs fastest.
+    class TitleProfile {
+    public:
+        /// @param config The player's settings, which tuning candidates are measured against.
+        [[nodiscard]] static std::optional<TitleProfile> Load(const melonDS::NDSHeader& header, std::span<const std::byte> rom, const CoreConfig& config, bool tune) noexcept;
+
+        void Apply(CoreConfig& config) const noexcept;
+        void BeginFrame() noexcept;
+        void EndFrame() noexcept;
+        bool Save() const noexcept;
+
+        /// Deletes the stored profile and forgets everything measured so far.
+        bool Reset() noexcept;
+        [[nodiscard]] const std::string& Path() const noexcept { return _path; }
+    private:
+        // Frames to skip at the start of each session while the JIT warms up
+        static constexpr uint64_t WARMUP_FRAMES = 600;
+        // Frames to measure for each candidate (about a minute)
+        static constexpr uint64_t MEASURED_FRAMES = 3600;
+        // A candidate that doesn't finish its measurement in this many sessions is considered unstable
+        static constexpr unsigned MAX_ATTEMPTS = 3;
+        // A candidate must beat the baseline by this factor to be kept
+        static constexpr double MIN_IMPROVEMENT = 0.98;
+
+        struct CandidateResult {
+            uint64_t Frames = 0;
+            double FrameTimeUs = 0;
+            unsigned Attempts = 0;
+        };
+
+        TitleProfile() noexcept = default;
+        void StartNextCandidate() noexcept;
+        void FinishTuning() noexcept;
+
+        std::string _path;
+        std::string _gameCode;
+        uint32_t _romCrc32 = 0;
+        TitleOverrides _overrides {};
+        // Empty once tuning is finished
+        std::vector<TitleOverrides> _candidates;
+        std::vector<CandidateResult> _results;
+        std::string _baseline;
+        std::optional<size_t> _candidate = std::nullopt;
+        std::optional<std::string> _bestCandidate = std::nullopt;
+
+        uint64_t _totalFrames = 0;
+        double _averageFrameTimeUs = 0;
+        uint64_t _sessionFrames = 0;
+        uint64_t _candidateFrames = 0;
+        double _candidateFrameTimeUs = 0;
+        WorkTimer _frameTimer {};
+    };
+}
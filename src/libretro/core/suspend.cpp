@@ -0,0 +1,236 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include "suspend.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+#include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+
+#include <NDS.h>
+#include <NDS_Header.h>
+
+#include "config/definitions.hpp"
+#include "environment.hpp"
+#include "format.hpp"
+#include "profile.hpp"
+#include "retro/file.hpp"
+#include "tracy.hpp"
+
+using std::optional;
+using std::nullopt;
+using std::string;
+using std::string_view;
+
+constexpr std::array<char, 8> SUSPEND_MAGIC = {'M', 'D', 'S', 'S', 'U', 'S', 'P', '\0'};
+constexpr uint32_t SUSPEND_VERSION = 1;
+
+// Precedes the savestate in each suspend file.
+struct SuspendHeader {
+    std::array<char, 8> Magic;
+    uint32_t Version;
+    uint32_t ContentChecksum;
+    uint32_t OptionsChecksum;
+    uint32_t StateLength;
+    uint32_t StateChecksum;
+    uint32_t LayoutIndex;
+    uint32_t HeaderChecksum; // Covers all preceding fields
+};
+
+static uint32_t HeaderChecksum(const SuspendHeader& header) noexcept {
+    return encoding_crc32(0, reinterpret_cast<const uint8_t*>(&header), offsetof(SuspendHeader, HeaderChecksum));
+}
+
+optional<string> MelonDsDs::SuspendedSession::GetPath(const retro::GameInfo& ndsInfo) noexcept {
+    char name[PATH_MAX] {};
+    string_view path = ndsInfo.GetPath();
+    const char* basename = path.empty() ? nullptr : path_basename(path.data());
+    strlcpy(name, basename ? basename : "unknown", sizeof(name));
+    path_remove_extension(name);
+    strlcat(name, ".suspend", sizeof(name));
+
+    return retro::get_save_subdir_path(name);
+}
+
+uint32_t MelonDsDs::SuspendedSession::ContentChecksum(const retro::GameInfo& ndsInfo) noexcept {
+    std::span<const std::byte> rom = ndsInfo.GetData();
+    if (rom.size() < sizeof(melonDS::NDSHeader))
+        return 0;
+
+    return TitleChecksum(*reinterpret_cast<const melonDS::NDSHeader*>(rom.data()), rom);
+}
+
+uint32_t MelonDsDs::SuspendedSession::OptionsChecksum() noexcept {
+    ZoneScopedN(TracyFunction);
+
+    // Any option could affect the console's state, so a suspended session is only valid under the same settings
+    uint32_t hash = 0;
+    for (const retro_core_option_v2_definition& definition : config::definitions::CoreOptionDefinitions) {
+        if (!definition.key)
+            continue;
+
+        string_view value = retro::get_variable(definition.key);
+        hash = encoding_crc32(hash, reinterpret_cast<const uint8_t*>(definition.key), strlen(definition.key));
+        hash = encoding_crc32(hash, reinterpret_cast<const uint8_t*>("="), 1);
+        hash = encoding_crc32(hash, reinterpret_cast<const uint8_t*>(value.data()), value.size());
+        hash = encoding_crc32(hash, reinterpret_cast<const uint8_t*>(""), 1);
+    }
+
+    return hash;
+}
+
+optional<MelonDsDs::SuspendedSession> MelonDsDs::SuspendedSession::Load(const retro::GameInfo& ndsInfo) noexcept {
+    ZoneScopedN(TracyFunction);
+
+    optional<string> path = GetPath(ndsInfo);
+    if (!path || !path_is_valid(path->c_str()))
+        return nullopt;
+
+    auto start = std::chrono::steady_clock::now();
+    SuspendedSession session;
+    session._path = std::move(*path);
+
+    {
+        // Read the whole file at once; the savestate must be contiguous anyway
+        retro::rfile_ptr file = retro::make_rfile(session._path, RETRO_VFS_FILE_ACCESS_READ);
+        int64_t size = file ? filestream_get_size(file.get()) : -1;
+        if (size < static_cast<int64_t>(sizeof(SuspendHeader))) {
+            retro::warn("Suspended session \"{}\" is invalid, discarding it", session._path);
+            file = nullptr;
+            filestream_delete(session._path.c_str());
+            return nullopt;
+        }
+
+        session._buffer.resize(size);
+        if (filestream_read(file.get(), session._buffer.data(), size) != size) {
+            retro::warn("Failed to read suspended session \"{}\", discarding it", session._path);
+            file = nullptr;
+            filestream_delete(session._path.c_str());
+            return nullopt;
+        }
+    }
+
+    SuspendHeader header {};
+    memcpy(&header, session._buffer.data(), sizeof(header));
+    if (header.Magic != SUSPEND_MAGIC || header.HeaderChecksum != HeaderChecksum(header)) {
+        retro::warn("Suspended session \"{}\" has a corrupt header, discarding it", session._path);
+        filestream_delete(session._path.c_str());
+        return nullopt;
+    }
+
+    if (header.Version != SUSPEND_VERSION || header.ContentChecksum != ContentChecksum(ndsInfo) || header.OptionsChecksum != OptionsChecksum()) {
+        // If the core, the game, or the settings have changed since this session was suspended...
+        retro::info("Suspended session \"{}\" doesn't match this game or its settings, discarding it", session._path);
+        filestream_delete(session._path.c_str());
+        return nullopt;
+    }
+
+    if (header.StateLength != session._buffer.size() - sizeof(header)) {
+        retro::warn("Suspended session \"{}\" is truncated, discarding it", session._path);
+        filestream_delete(session._path.c_str());
+        return nullopt;
+    }
+
+    session._state = std::span(session._buffer).subspan(sizeof(header), header.StateLength);
+    if (encoding_crc32(0, reinterpret_cast<const uint8_t*>(session._state.data()), session._state.size()) != header.StateChecksum) {
+        retro::warn("Suspended session \"{}\" failed its checksum, discarding it", session._path);
+        filestream_delete(session._path.c_str());
+        return nullopt;
+    }
+
+    session._presentation.LayoutIndex = header.LayoutIndex;
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    retro::info("Read {}-byte suspended session from \"{}\" in {}us", session._buffer.size(), session._path, elapsed.count());
+    return session;
+}
+
+bool MelonDsDs::SuspendedSession::Save(const retro::GameInfo& ndsInfo, melonDS::NDS& nds, const Presentation& presentation) noexcept {
+    ZoneScopedN(TracyFunction);
+
+    optional<string> path = GetPath(ndsInfo);
+    if (!path) {
+        retro::warn("No save directory available, can't suspend this session");
+        return false;
+    }
+
+    melonDS::Savestate state;
+    if (!nds.DoSavestate(&state) || state.Error) {
+        retro::error("Failed to save the console's state, can't suspend this session");
+        return false;
+    }
+
+    SuspendHeader header {
+        .Magic = SUSPEND_MAGIC,
+        .Version = SUSPEND_VERSION,
+        .ContentChecksum = ContentChecksum(ndsInfo),
+        .OptionsChecksum = OptionsChecksum(),
+        .StateLength = state.Length(),
+        .StateChecksum = encoding_crc32(0, reinterpret_cast<const uint8_t*>(state.Buffer()), state.Length()),
+        .LayoutIndex = presentation.LayoutIndex,
+    };
+    header.HeaderChecksum = HeaderChecksum(header);
+
+    std::vector<uint8_t> buffer(sizeof(header) + state.Length());
+    memcpy(buffer.data(), &header, sizeof(header));
+    memcpy(buffer.data() + sizeof(header), state.Buffer(), state.Length());
+
+    // Write to a temporary file first, so that a crash can't leave a half-written session behind
+    string tempPath = *path + ".tmp";
+    if (!filestream_write_file(tempPath.c_str(), buffer.data(), buffer.size())) {
+        retro::error("Failed to write {}-byte suspended session to \"{}\"", buffer.size(), tempPath);
+        filestream_delete(tempPath.c_str());
+        return false;
+    }
+
+    filestream_delete(path->c_str());
+    if (filestream_rename(tempPath.c_str(), path->c_str()) != 0) {
+        retro::error("Failed to move suspended session to \"{}\"", *path);
+        filestream_delete(tempPath.c_str());
+        return false;
+    }
+
+    retro::info("Suspended this session to \"{}\" ({} bytes)", *path, buffer.size());
+    return true;
+}
+
+bool MelonDsDs::SuspendedSession::Resume(melonDS::NDS& nds) noexcept {
+    ZoneScopedN(TracyFunction);
+
+    melonDS::Savestate state(_state.data(), _state.size(), false);
+    bool ok = !state.Error && nds.DoSavestate(&state) && !state.Error;
+
+    // Whether or not it worked, this session shouldn't be resumed again
+    filestream_delete(_path.c_str());
+    _buffer.clear();
+    _buffer.shrink_to_fit();
+    _state = {};
+
+    if (ok) {
+        retro::info("Resumed suspended session from \"{}\"", _path);
+    }
+    else {
+        retro::error("Failed to resume suspended session from \"{}\"", _path);
+    }
+
+    return ok;
+}
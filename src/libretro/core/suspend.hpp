@@ -0,0 +1,68 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "std/span.hpp"
+
+namespace melonDS {
+    class NDS;
+}
+
+namespace retro {
+    class GameInfo;
+}
+
+namespace MelonDsDs {
+    /// \brief A complete emulator session saved to a single file in the save directory,
+    /// so that the next launch can resume it instead of booting.
+    ///
+    /// Each file is keyed by the loaded game and by the values of all core options;
+    /// a mismatch on either (or a failed checksum) discards the file.
+    class SuspendedSession {
+    public:
+        /// Presentation state that isn't part of melonDS's savestates,
+        /// and that doesn't depend on the active renderer.
+        struct Presentation {
+            uint32_t LayoutIndex = 0;
+        };
+
+        /// \returns The session suspended for this game, or \c nullopt if there isn't a usable one.
+        [[nodiscard]] static std::optional<SuspendedSession> Load(const retro::GameInfo& ndsInfo) noexcept;
+
+        /// Saves \c nds and \c presentation so that the next launch of this game can resume them.
+        static bool Save(const retro::GameInfo& ndsInfo, melonDS::NDS& nds, const Presentation& presentation) noexcept;
+
+        /// Loads the suspended state into \c nds, then deletes the file.
+        bool Resume(melonDS::NDS& nds) noexcept;
+        [[nodiscard]] const Presentation& GetPresentation() const noexcept { return _presentation; }
+    private:
+        SuspendedSession() noexcept = default;
+        [[nodiscard]] static std::optional<std::string> GetPath(const retro::GameInfo& ndsInfo) noexcept;
+        [[nodiscard]] static uint32_t ContentChecksum(const retro::GameInfo& ndsInfo) noexcept;
+        [[nodiscard]] static uint32_t OptionsChecksum() noexcept;
+
+        std::string _path;
+        std::vector<std::byte> _buffer;
+        std::span<std::byte> _state;
+        Presentation _presentation {};
+    };
+}
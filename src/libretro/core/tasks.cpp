@@ -119,6 +119,12 @@ retro::task::TaskSpec MelonDsDs::CoreState::PowerStatusUpdateTask() noexcept {
                         break;
                     }
                 }
+
+                if (_powerProfile.Update(*devicePower, Config)) {
+                    // If we should switch performance profiles...
+                    // (tasks run between frames, so this won't happen mid-frame)
+                    ApplyPowerProfile();
+                }
             }
             else {
                 retro::warn("Failed to get device power status\n");
@@ -136,17 +142,13 @@ retro::task::TaskSpec MelonDsDs::CoreState::PowerStatusUpdateTask() noexcept {
 }
 
 
-void MelonDsDs::CoreState::FlushFirmware(string_view firmwarePath, string_view wfcSettingsPath) noexcept {
+void MelonDsDs::CoreState::FlushFirmware(const Firmware& firmware, string_view firmwarePath, string_view wfcSettingsPath) noexcept {
     ZoneScopedN(TracyFunction);
 
     retro_assert(!firmwarePath.empty());
     retro_assert(path_is_absolute(firmwarePath.data()));
     retro_assert(!wfcSettingsPath.empty());
     retro_assert(path_is_absolute(wfcSettingsPath.data()));
-    retro_assert(Console != nullptr);
-
-    const Firmware& firmware = Console->GetFirmware();
-
     retro_assert(firmware.Buffer() != nullptr);
 
     if (firmware.GetHeader().Identifier != GENERATED_FIRMWARE_IDENTIFIER) {
@@ -226,8 +228,12 @@ retro::task::TaskSpec MelonDsDs::CoreState::FlushGbaSramTask() noexcept {
         },
         nullptr,
         [this](retro::task::TaskHandle& task) noexcept {
-            if (_gbaSaveInfo) {
-                FlushGbaSram(*_gbaSaveInfo);
+            if (_gbaSaveInfo && _gbaSaveManager && _gbaSaveManager->Sram()) {
+                // Write a snapshot of the SRAM on a worker, so that unloading the game doesn't wait for it
+                const u8* sram = _gbaSaveManager->Sram();
+                _unload.Submit("GBA SRAM flush", [path=string(_gbaSaveInfo->GetPath()), sram=std::vector<u8>(sram, sram + _gbaSaveManager->SramLength())] {
+                    WriteGbaSram(path, sram);
+                });
                 _timeToGbaFlush = nullopt;
             }
         },
@@ -251,7 +257,18 @@ void MelonDsDs::CoreState::FlushGbaSram(const retro::GameInfo& gbaSaveInfo) noex
         return; // TODO: Report this error
     }
 
-    if (!filestream_write_file(save_data_path.data(), gba_sram, gba_sram_length)) {
+    WriteGbaSram(save_data_path, std::span(gba_sram, gba_sram_length));
+}
+
+void MelonDsDs::CoreState::WriteGbaSram(string_view save_data_path, std::span<const u8> gba_sram) noexcept {
+    ZoneScopedN(TracyFunction);
+    u32 gba_sram_length = gba_sram.size();
+
+    if (save_data_path.empty() || gba_sram_length == 0) {
+        return;
+    }
+
+    if (!filestream_write_file(save_data_path.data(), gba_sram.data(), gba_sram_length)) {
         retro::error("Failed to write {}-byte GBA SRAM to \"{}\"", gba_sram_length, save_data_path);
         // TODO: Report this to the user
     } else {
@@ -282,13 +299,18 @@ retro::task::TaskSpec MelonDsDs::CoreState::FlushFirmwareTask(string_view firmwa
             if (_timeToFirmwareFlush != nullopt && (*_timeToFirmwareFlush)-- <= 0) {
                 // If it's time to flush the firmware...
                 retro::debug("Firmware flush timer expired, flushing data now");
-                FlushFirmware(firmwarePath, wfcSettingsPath);
+                FlushFirmware(Console->GetFirmware(), firmwarePath, wfcSettingsPath);
                 _timeToFirmwareFlush = nullopt; // Reset the timer
             }
         },
         nullptr,
         [this, path=*firmwarePath, wfcSettingsPath=*wfcSettingsPath](retro::task::TaskHandle&) noexcept {
-            FlushFirmware(path, wfcSettingsPath);
+            if (Console) {
+                // Write a copy of the firmware on a worker, so that unloading the game doesn't wait for it
+                _unload.Submit("Firmware flush", [firmware=std::make_shared<const Firmware>(Console->GetFirmware()), path, wfcSettingsPath] {
+                    FlushFirmware(*firmware, path, wfcSettingsPath);
+                });
+            }
             _timeToFirmwareFlush = nullopt;
         },
         retro::task::ASAP,
@@ -380,6 +402,35 @@ retro::task::TaskSpec MelonDsDs::CoreState::OnScreenDisplayTask() noexcept {
                 }
             }
 
+            if (Config.ShowFrameStats()) {
+                FrameTimeSummary stats = _frameTimeStats.Summary();
+                if (stats.Samples > 0) {
+                    // If we've seen enough frames to say anything useful...
+                    const char* bottleneck = "";
+                    switch (stats.Bottleneck) {
+                        case FrameBottleneck::Core:
+                            bottleneck = " (core-bound)";
+                            break;
+                        case FrameBottleneck::Frontend:
+                            bottleneck = " (frontend-bound)";
+                            break;
+                        default:
+                            break;
+                    }
+
+                    fmt::format_to(
+                        inserter,
+                        "{}Frame {:.1f}ms ±{:.1f} | Run {:.1f}ms | Missed {}{}",
+                        buf.size() == 0 ? "" : OSD_DELIMITER,
+                        stats.IntervalUs / 1000.0,
+                        stats.JitterUs / 1000.0,
+                        stats.RunTimeUs / 1000.0,
+                        stats.MissedVsyncs,
+                        bottleneck
+                    );
+                }
+            }
+
             // fmt::format_to does not append a null terminator
             buf.push_back('\0');
 
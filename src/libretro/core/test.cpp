@@ -16,10 +16,29 @@
 
 #include "test.hpp"
 
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <GPU3D_Soft.h>
+#include <NDS.h>
+#include <compat/strl.h>
+#include <streams/file_stream.h>
 #include <string/stdstring.h>
 
 #include "core.hpp"
 #include "environment.hpp"
+#include "exceptions.hpp"
+#include "libretro.hpp"
+#include "romarchive.hpp"
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+#include "render/programcache.hpp"
+#endif
+#include "sectorcache.hpp"
+#include "tracy/recorder.hpp"
 
 namespace MelonDsDs
 {
@@ -182,13 +201,39 @@ extern "C" bool melondsds_is_software_renderer() {
     return mode && *mode == RenderMode::Software;
 }
 
+// True if the console is using the software renderer with the threading that the player asked for
+extern "C" bool melondsds_is_configured_software_renderer() {
+    using namespace MelonDsDs;
+    const melonDS::NDS* console = Core.GetConsole();
+    if (!console)
+        return false;
+
+    const auto* renderer = dynamic_cast<const melonDS::SoftRenderer*>(&console->GPU.GetRenderer3D());
+    return renderer && renderer->IsThreaded() == Core.GetConfig().ThreadedSoftRenderer();
+}
+
+// Always false in builds without headless OpenGL support, whatever the option says
+extern "C" bool melondsds_is_headless_opengl_configured() {
+    return MelonDsDs::Core.GetConfig().HeadlessOpenGl();
+}
+
+// Calls the hardware render callbacks the way a frontend would when it loses and then recreates its context
+extern "C" void melondsds_destroy_hw_context() {
+    MelonDsDs::HardwareContextDestroyed();
+}
+
+extern "C" void melondsds_reset_hw_context() {
+    MelonDsDs::HardwareContextReset();
+}
+
 extern "C" unsigned melondsds_num_cheats() {
     using namespace MelonDsDs;
     const auto *console = Core.GetConsole();
     if (!console)
         return 0;
 
-    return console->AREngine.Cheats.size();
+    // Not the console's own list, since the cheat plan may have merged some of them
+    return Core.GetCheats().Size();
 }
 
 extern "C" uint32_t melondsds_get_gba_cart_type() {
@@ -224,6 +269,620 @@ extern "C" unsigned melondsds_get_controller_port_device(unsigned port) noexcept
     return Core.GetInputState().GetControllerPortDevice(port);
 }
 
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+extern "C" bool melondsds_get_program_cache_stats(MelonDsDs::ProgramCacheStats* stats) {
+    if (!stats)
+        return false;
+
+    *stats = MelonDsDs::ProgramBinaryCache::Stats();
+    return true;
+}
+#endif
+
+// Seconds since 1970-01-01 00:00:00 in the console's local time, or -1 if there's no console
+extern "C" int64_t melondsds_get_rtc_time() {
+    using namespace MelonDsDs;
+    std::optional<local_seconds> time = Core.GetConsoleTime();
+
+    return time ? time->time_since_epoch().count() : -1;
+}
+
+extern "C" bool melondsds_set_rtc_time(int64_t time) {
+    using namespace MelonDsDs;
+
+    return Core.SetConsoleTime(local_seconds(seconds(time)));
+}
+
+extern "C" bool melondsds_get_presentation_stats(MelonDsDs::PresentationStats* stats) {
+    using namespace MelonDsDs;
+
+    if (!stats)
+        return false;
+
+    *stats = Core.GetPresentationStats();
+    return true;
+}
+
+extern "C" int melondsds_get_power_profile() {
+    using namespace MelonDsDs;
+
+    // 0 for the usual settings, or 1 + the index of the active power profile
+    std::optional<size_t> profile = Core.GetPowerProfile();
+    return profile ? static_cast<int>(*profile) + 1 : 0;
+}
+
+extern "C" const char* melondsds_get_title_profile_path() {
+    using namespace MelonDsDs;
+
+    TitleProfile* profile = Core.GetTitleProfile();
+    return profile ? profile->Path().c_str() : nullptr;
+}
+
+extern "C" bool melondsds_reset_title_profile() {
+    using namespace MelonDsDs;
+
+    TitleProfile* profile = Core.GetTitleProfile();
+    return profile && profile->Reset();
+}
+
+extern "C" size_t melondsds_fork_console(size_t count) {
+    using namespace MelonDsDs;
+
+    return Core.ForkConsole(count);
+}
+
+extern "C" size_t melondsds_get_fork_count() {
+    using namespace MelonDsDs;
+
+    return Core.GetForks().Size();
+}
+
+extern "C" bool melondsds_run_fork(size_t index, uint32_t keys, int touch_x, int touch_y, bool touching) {
+    using namespace MelonDsDs;
+
+    return Core.GetForks().Run(index, keys, touch_x, touch_y, touching);
+}
+
+extern "C" bool melondsds_serialize_fork(size_t index, void* data, size_t size) {
+    using namespace MelonDsDs;
+
+    return Core.GetForks().Serialize(index, std::span(static_cast<std::byte*>(data), size));
+}
+
+extern "C" const void* melondsds_get_fork_main_ram(size_t index) {
+    using namespace MelonDsDs;
+
+    const melonDS::NDS* fork = Core.GetForks().Get(index);
+    return fork ? fork->MainRAM : nullptr;
+}
+
+// Puts the console to sleep the same way a game does when the lid closes
+extern "C" bool melondsds_enter_sleep_mode() {
+    using namespace MelonDsDs;
+
+    melonDS::NDS* console = Core.GetConsole();
+    if (!console)
+        return false;
+
+    console->EnterSleepMode();
+    return true;
+}
+
+extern "C" uint64_t melondsds_get_idle_frames() {
+    using namespace MelonDsDs;
+
+    const IdleFrameState& idle = Core.GetIdleFrameState();
+    return idle.Asleep() ? idle.IdleFrames() : 0;
+}
+
+extern "C" bool melondsds_get_input_stats(MelonDsDs::InputStats* stats) {
+    using namespace MelonDsDs;
+
+    if (!stats)
+        return false;
+
+    *stats = Core.GetInputState().Stats();
+    return true;
+}
+
+extern "C" bool melondsds_get_frame_stats(MelonDsDs::FrameTimeSummary* stats) {
+    using namespace MelonDsDs;
+
+    if (!stats)
+        return false;
+
+    *stats = Core.GetFrameTimeStats().Summary();
+    return true;
+}
+
+extern "C" bool melondsds_get_audio_stats(MelonDsDs::AudioStats* stats) {
+    using namespace MelonDsDs;
+
+    if (!stats)
+        return false;
+
+    *stats = Core.GetAudioState().Stats();
+    return true;
+}
+
+extern "C" bool melondsds_get_nand_cache_stats(MelonDsDs::SectorCacheStats* stats) {
+    using namespace MelonDsDs;
+
+    if (!stats)
+        return false;
+
+    *stats = SectorCache::RegisteredStats();
+    return true;
+}
+
+extern "C" bool melondsds_get_rollback_stats(MelonDsDs::RollbackStats* stats) {
+    using namespace MelonDsDs;
+
+    if (!stats)
+        return false;
+
+    *stats = Core.GetRollback().Stats();
+    return true;
+}
+
+extern "C" bool melondsds_get_cheat_plan_stats(MelonDsDs::CheatPlanStats* stats) {
+    using namespace MelonDsDs;
+
+    if (!stats)
+        return false;
+
+    *stats = Core.GetCheats().Stats();
+    return true;
+}
+
+extern "C" void melondsds_trace_start(unsigned seconds) {
+    MelonDsDs::trace::Start(seconds);
+}
+
+extern "C" void melondsds_trace_stop() {
+    MelonDsDs::trace::Stop();
+}
+
+// Writes the last \c seconds of the trace to the save directory and copies the new file's path into \c path
+extern "C" bool melondsds_trace_dump(double seconds, char* path, size_t length) {
+    std::optional<std::string> written = MelonDsDs::trace::Dump(seconds);
+    if (!written)
+        return false;
+
+    if (path && length > 0) {
+        strlcpy(path, written->c_str(), length);
+    }
+
+    return true;
+}
+
+extern "C" bool melondsds_get_trace_stats(MelonDsDs::trace::TraceStats* stats) {
+    if (!stats)
+        return false;
+
+    *stats = MelonDsDs::trace::Stats();
+    return true;
+}
+
+// Reports how the last unload went; kept across retro_deinit, so a test can check it from its next session
+extern "C" bool melondsds_get_last_unload_stats(MelonDsDs::UnloadStats* stats) {
+    if (!stats)
+        return false;
+
+    *stats = MelonDsDs::UnloadPipeline::LastStats();
+    return true;
+}
+
+#ifdef HAVE_TEST_PROCS
+// These drive forks of the running console (replacing any the player made) and spin up threads and fake peers,
+// so they're only built for the test suite
+
+// Two MpStates on their own threads, connected to each other instead of to a frontend
+namespace {
+    struct LoopbackPeer {
+        MelonDsDs::MpState State;
+        std::mutex Mutex;
+        std::deque<std::vector<uint8_t>> Inbox;
+    };
+
+    LoopbackPeer* LoopbackPeers[2] {};
+
+    template<int Self>
+    void LoopbackSend(int flags, const void* buf, size_t len, uint16_t client_id) {
+        if (!buf || len == 0)
+            return;
+
+        LoopbackPeer& other = *LoopbackPeers[1 - Self];
+        std::lock_guard lock(other.Mutex);
+        other.Inbox.emplace_back(static_cast<const uint8_t*>(buf), static_cast<const uint8_t*>(buf) + len);
+    }
+
+    template<int Self>
+    void LoopbackPoll() {
+        LoopbackPeer& self = *LoopbackPeers[Self];
+        std::deque<std::vector<uint8_t>> inbox;
+        {
+            std::lock_guard lock(self.Mutex);
+            inbox.swap(self.Inbox);
+        }
+
+        for (const std::vector<uint8_t>& message : inbox) {
+            self.State.PacketReceived(message.data(), message.size(), 1 - Self);
+        }
+    }
+}
+
+struct MelonDsDsMpLoopbackResult {
+    uint64_t Frames;
+    double Seconds;
+    MelonDsDs::MpTraffic Host;
+    MelonDsDs::MpTraffic Client;
+};
+
+// Runs the multiplayer exchange that melonDS does each frame (data packets, then a command and its reply)
+// between two peers over an in-memory loopback, and reports how much traffic it took
+extern "C" bool melondsds_mp_loopback(unsigned frames, unsigned packets_per_frame, MelonDsDsMpLoopbackResult* result) {
+    using namespace MelonDsDs;
+
+    if (!result || LoopbackPeers[0])
+        return false;
+
+    LoopbackPeer host, client;
+    LoopbackPeers[0] = &host;
+    LoopbackPeers[1] = &client;
+    host.State.SetSendFn(LoopbackSend<0>);
+    host.State.SetPollFn(LoopbackPoll<0>);
+    client.State.SetSendFn(LoopbackSend<1>);
+    client.State.SetPollFn(LoopbackPoll<1>);
+    host.State.Reset();
+    client.State.Reset();
+
+    const uint8_t payload[32] {};
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::thread hostThread([&] {
+        for (unsigned frame = 0; frame < frames; ++frame) {
+            while (!host.State.BeginFrame()) {
+                // Keep trying until the client catches up, like a frontend calling retro_run
+            }
+            for (unsigned i = 0; i < packets_per_frame; ++i) {
+                host.State.SendPacket(Packet(payload, sizeof(payload), frame, 0, Packet::Type::Other));
+            }
+            host.State.SendPacket(Packet(payload, sizeof(payload), frame, 0, Packet::Type::Cmd));
+            while (std::optional<Packet> reply = host.State.NextPacketBlock()) {
+                if (reply->PacketType() == Packet::Type::Reply)
+                    break;
+            }
+            host.State.EndFrame();
+        }
+    });
+
+    std::thread clientThread([&] {
+        for (unsigned frame = 0; frame < frames; ++frame) {
+            while (!client.State.BeginFrame()) {
+            }
+            while (std::optional<Packet> cmd = client.State.NextPacketBlock()) {
+                if (cmd->PacketType() == Packet::Type::Cmd) {
+                    client.State.SendPacket(Packet(payload, sizeof(payload), frame, 1, Packet::Type::Reply));
+                    break;
+                }
+            }
+            client.State.EndFrame();
+        }
+    });
+
+    hostThread.join();
+    clientThread.join();
+
+    // Deliver each peer's last frame sync, which the other may have finished too early to see
+    LoopbackPoll<0>();
+    LoopbackPoll<1>();
+
+    result->Frames = frames;
+    result->Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result->Host = host.State.Traffic();
+    result->Client = client.State.Traffic();
+    host.State.LogStats();
+    client.State.LogStats();
+
+    LoopbackPeers[0] = nullptr;
+    LoopbackPeers[1] = nullptr;
+    return true;
+}
+
+struct MelonDsDsMpSyncResult {
+    uint32_t FramesBeforeDeferral;
+    double LongestBeginFrameMs;
+    uint64_t MessagesRejected;
+    bool ResumedWithoutIncompatiblePeer;
+};
+
+// Runs one peer ahead of another that never advances, then has the stalled peer send a message in an older format
+extern "C" bool melondsds_mp_sync_check(MelonDsDsMpSyncResult* result) {
+    using namespace MelonDsDs;
+
+    if (!result || LoopbackPeers[0])
+        return false;
+
+    LoopbackPeer host, client;
+    LoopbackPeers[0] = &host;
+    LoopbackPeers[1] = &client;
+    host.State.SetSendFn(LoopbackSend<0>);
+    host.State.SetPollFn(LoopbackPoll<0>);
+    client.State.SetSendFn(LoopbackSend<1>);
+    client.State.SetPollFn(LoopbackPoll<1>);
+    host.State.Reset();
+    client.State.Reset();
+    *result = {};
+
+    // The client finishes one frame, then stops
+    client.State.EndFrame();
+
+    double longest = 0;
+    for (uint32_t frame = 0; frame < 32; ++frame) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool ready = host.State.BeginFrame();
+        longest = std::max(longest, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        if (!ready)
+            break;
+
+        host.State.EndFrame();
+        result->FramesBeforeDeferral++;
+    }
+    result->LongestBeginFrameMs = longest;
+
+    // The format used before messages had a header: just the packet (a frame sync, in this case)
+    const uint8_t legacyMessage[HeaderSize] { 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 1 };
+    host.State.PacketReceived(legacyMessage, sizeof(legacyMessage), 1);
+    result->MessagesRejected = host.State.Traffic().MessagesRejected;
+    result->ResumedWithoutIncompatiblePeer = host.State.BeginFrame();
+
+    LoopbackPeers[0] = nullptr;
+    LoopbackPeers[1] = nullptr;
+    return true;
+}
+
+// Two rollback netplay peers, each driving its own fork of the running console,
+// connected to each other through queues that hold messages back for a fixed number of steps
+namespace {
+    struct RollbackPeer {
+        MelonDsDs::RollbackNetplay Netplay;
+        std::deque<std::pair<unsigned, std::vector<uint8_t>>> Inbox;
+    };
+
+    RollbackPeer* RollbackPeers[2] {};
+    unsigned RollbackStep = 0;
+    unsigned RollbackLatency = 0;
+
+    template<int Self>
+    void RollbackSend(int flags, const void* buf, size_t len, uint16_t client_id) {
+        if (!buf || len == 0)
+            return;
+
+        RollbackPeer& other = *RollbackPeers[1 - Self];
+        const uint8_t* bytes = static_cast<const uint8_t*>(buf);
+        other.Inbox.emplace_back(RollbackStep + RollbackLatency, std::vector<uint8_t>(bytes, bytes + len));
+    }
+
+    template<int Self>
+    void RollbackPoll() {
+        RollbackPeer& self = *RollbackPeers[Self];
+        while (!self.Inbox.empty() && self.Inbox.front().first <= RollbackStep) {
+            std::vector<uint8_t> message = std::move(self.Inbox.front().second);
+            self.Inbox.pop_front();
+            self.Netplay.PacketReceived(message.data(), message.size(), 1 - Self);
+        }
+    }
+
+    // Each player holds a pseudo-random set of buttons for a while, then switches to another
+    MelonDsDs::ConsoleInput RollbackScriptedInput(int peer, uint32_t frame) noexcept {
+        uint32_t hash = (frame / (7 + 4 * peer) + 1) * 2654435761u ^ (peer + 1) * 40503u;
+        return MelonDsDs::ConsoleInput { (hash >> 7) & MelonDsDs::ConsoleInput::BUTTONS };
+    }
+}
+
+struct MelonDsDsRollbackLoopbackResult {
+    MelonDsDs::RollbackStats Host;
+    MelonDsDs::RollbackStats Client;
+    uint64_t Steps;
+    bool Identical;
+};
+
+// Plays \c frames frames of rollback netplay between two forks of the running console,
+// with each message arriving \c latency steps after it's sent,
+// then reports both peers' statistics and whether they ended up with the same console state
+extern "C" bool melondsds_rollback_loopback(unsigned frames, unsigned latency, unsigned max_rollback, MelonDsDsRollbackLoopbackResult* result) {
+    using namespace MelonDsDs;
+
+    if (!result || RollbackPeers[0])
+        return false;
+
+    if (Core.ForkConsole(2) < 2)
+        return false;
+
+    melonDS::NDS* consoles[2] { Core.GetForks().Get(0), Core.GetForks().Get(1) };
+    RollbackPeer host, client;
+    RollbackPeers[0] = &host;
+    RollbackPeers[1] = &client;
+    RollbackStep = 0;
+    RollbackLatency = latency;
+    host.Netplay.Start(0, RollbackSend<0>, RollbackPoll<0>, max_rollback);
+    client.Netplay.Start(1, RollbackSend<1>, RollbackPoll<1>, max_rollback);
+    host.Netplay.PeerConnected(1);
+
+    RollbackPeer* peers[2] { &host, &client };
+    const unsigned maxSteps = (frames + 60) * (latency + 2);
+    for (; RollbackStep < maxSteps; ++RollbackStep) {
+        if (host.Netplay.Frame() >= frames && client.Netplay.Frame() >= frames)
+            break;
+
+        for (int i = 0; i < 2; ++i) {
+            RollbackNetplay& netplay = peers[i]->Netplay;
+            melonDS::NDS& nds = *consoles[i];
+            CurrentConsoleScope scope(nds);
+            if (netplay.Frame() >= frames || !netplay.Prepare(nds))
+                continue;
+
+            netplay.BeginFrame(nds, RollbackScriptedInput(i, netplay.Frame()));
+            nds.RunFrame();
+            nds.SPU.DrainOutput();
+        }
+    }
+
+    // Deliver the last frames' input, and correct whatever it shows we got wrong
+    RollbackStep += latency + 1;
+    for (int i = 0; i < 2; ++i) {
+        CurrentConsoleScope scope(*consoles[i]);
+        peers[i]->Netplay.Settle(*consoles[i]);
+    }
+
+    bool identical = host.Netplay.Frame() == client.Netplay.Frame();
+    melonDS::Savestate states[2];
+    for (int i = 0; i < 2; ++i) {
+        CurrentConsoleScope scope(*consoles[i]);
+        identical = identical && consoles[i]->DoSavestate(&states[i]) && !states[i].Error;
+    }
+
+    identical = identical
+        && states[0].Length() == states[1].Length()
+        && memcmp(states[0].Buffer(), states[1].Buffer(), states[0].Length()) == 0;
+
+    result->Host = host.Netplay.Stats();
+    result->Client = client.Netplay.Stats();
+    result->Steps = RollbackStep;
+    result->Identical = identical;
+    host.Netplay.LogStats();
+    client.Netplay.LogStats();
+
+    RollbackPeers[0] = nullptr;
+    RollbackPeers[1] = nullptr;
+    return true;
+}
+
+struct MelonDsDsCheatBenchmarkResult {
+    MelonDsDs::CheatPlanStats Plan;
+    double SourceUsPerRun;
+    double PlanUsPerRun;
+    bool Identical;
+};
+
+// Runs the enabled cheats as given on one fork of the running console and the compiled plan on another,
+// \c iterations times each, then reports how long one pass took and whether both forks ended up the same
+extern "C" bool melondsds_benchmark_cheats(unsigned iterations, MelonDsDsCheatBenchmarkResult* result) {
+    using namespace MelonDsDs;
+
+    if (!result || iterations == 0)
+        return false;
+
+    if (Core.ForkConsole(2) < 2)
+        return false;
+
+    std::vector<melonDS::ARCode> lists[2];
+    for (const melonDS::ARCode& code : Core.GetCheats().Codes()) {
+        if (code.Enabled)
+            lists[0].push_back(code);
+    }
+    lists[1] = CheatPlan::Compile(Core.GetCheats().Codes(), result->Plan);
+
+    melonDS::NDS* consoles[2] { Core.GetForks().Get(0), Core.GetForks().Get(1) };
+    double usPerRun[2] {};
+    melonDS::Savestate states[2];
+    bool identical = true;
+    for (int i = 0; i < 2; ++i) {
+        melonDS::NDS& nds = *consoles[i];
+        CurrentConsoleScope scope(nds);
+        nds.AREngine.Cheats = std::move(lists[i]);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (unsigned n = 0; n < iterations; ++n) {
+            nds.AREngine.RunCheats();
+        }
+        usPerRun[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        identical = identical && nds.DoSavestate(&states[i]) && !states[i].Error;
+    }
+
+    result->SourceUsPerRun = usPerRun[0];
+    result->PlanUsPerRun = usPerRun[1];
+    result->Identical = identical
+        && states[0].Length() == states[1].Length()
+        && memcmp(states[0].Buffer(), states[1].Buffer(), states[0].Length()) == 0;
+    return true;
+}
+
+struct MelonDsDsRomArchiveBenchmark {
+    MelonDsDs::RomArchiveStats Streamed;
+    double ExtractedMs;
+    uint64_t ExtractedPeakBytes;
+    uint64_t RandomReads;
+    bool Identical;
+};
+
+// Loads the archive at \c path two ways and compares both against the ROM that's already loaded:
+// the way a frontend does it (load the whole archive, extract the ROM, let the core copy it),
+// and the way the core does it (decompress straight from the file).
+// Then reads \c random_reads random ranges through the block cache.
+extern "C" bool melondsds_benchmark_rom_archive(const char* path, unsigned random_reads, MelonDsDsRomArchiveBenchmark* result) {
+    using namespace MelonDsDs;
+
+    const retro::GameInfo* ndsInfo = Core.GetNdsInfo();
+    if (!path || !result || !ndsInfo)
+        return false;
+
+    std::span<const std::byte> loaded = ndsInfo->GetData();
+    auto matches = [&loaded](const std::byte* data, uint64_t offset, uint64_t length) {
+        return offset + length <= loaded.size() && memcmp(data, loaded.data() + offset, length) == 0;
+    };
+
+    try {
+        bool identical = true;
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            void* archiveData = nullptr;
+            int64_t archiveSize = 0;
+            if (!filestream_read_file(path, &archiveData, &archiveSize))
+                return false;
+
+            std::unique_ptr<void, decltype(&free)> archiveBuffer(archiveData, free);
+            std::unique_ptr<RomArchive> extractor = RomArchive::Open(path, std::span(static_cast<const std::byte*>(archiveData), archiveSize));
+            std::unique_ptr<std::byte[]> extracted = extractor->ReadAll();
+            if (!extracted)
+                return false;
+
+            retro_game_info info { path, extracted.get(), extractor->Size(), nullptr };
+            retro::GameInfo copied(info);
+            result->ExtractedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            result->ExtractedPeakBytes = archiveSize + 2 * extractor->Size();
+            identical = extractor->Size() == loaded.size() && matches(copied.GetData().data(), 0, loaded.size());
+        }
+
+        std::unique_ptr<RomArchive> archive = RomArchive::Open(path, {});
+        std::unique_ptr<std::byte[]> rom = archive->ReadAll();
+        identical = identical && rom && archive->Size() == loaded.size() && matches(rom.get(), 0, loaded.size());
+        rom = nullptr;
+
+        std::vector<std::byte> buffer;
+        uint32_t seed = 1;
+        for (unsigned i = 0; identical && i < random_reads; ++i) {
+            seed = seed * 1664525 + 1013904223;
+            uint64_t offset = seed % archive->Size();
+            uint64_t length = std::min<uint64_t>(archive->Size() - offset, 1 + (seed >> 8) % 4096);
+            buffer.resize(length);
+            identical = archive->Read(offset, buffer) && matches(buffer.data(), offset, length);
+        }
+
+        result->Streamed = archive->Stats();
+        result->RandomReads = random_reads;
+        result->Identical = identical;
+        archive->LogStats();
+        return true;
+    }
+    catch (const content_exception& e) {
+        retro::error("Failed to benchmark {}: {}", path, e.what());
+        return false;
+    }
+}
+#endif
+
 extern "C" retro_proc_address_t MelonDsDs::GetRetroProcAddress(const char* sym) noexcept {
     if (string_is_equal(sym, "libretropy_add_integers"))
         return reinterpret_cast<retro_proc_address_t>(libretropy_add_integers);
@@ -294,6 +953,18 @@ extern "C" retro_proc_address_t MelonDsDs::GetRetroProcAddress(const char* sym)
     if (string_is_equal(sym, "melondsds_is_software_renderer"))
         return reinterpret_cast<retro_proc_address_t>(melondsds_is_software_renderer);
 
+    if (string_is_equal(sym, "melondsds_is_configured_software_renderer"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_is_configured_software_renderer);
+
+    if (string_is_equal(sym, "melondsds_is_headless_opengl_configured"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_is_headless_opengl_configured);
+
+    if (string_is_equal(sym, "melondsds_destroy_hw_context"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_destroy_hw_context);
+
+    if (string_is_equal(sym, "melondsds_reset_hw_context"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_reset_hw_context);
+
     if (string_is_equal(sym, "melondsds_num_cheats"))
         return reinterpret_cast<retro_proc_address_t>(melondsds_num_cheats);
 
@@ -306,6 +977,100 @@ extern "C" retro_proc_address_t MelonDsDs::GetRetroProcAddress(const char* sym)
     if (string_is_equal(sym, "melondsds_get_controller_port_device"))
         return reinterpret_cast<retro_proc_address_t>(melondsds_get_controller_port_device);
 
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+    if (string_is_equal(sym, "melondsds_get_program_cache_stats"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_program_cache_stats);
+#endif
+
+    if (string_is_equal(sym, "melondsds_get_rtc_time"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_rtc_time);
+
+    if (string_is_equal(sym, "melondsds_set_rtc_time"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_set_rtc_time);
+
+    if (string_is_equal(sym, "melondsds_get_presentation_stats"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_presentation_stats);
+
+    if (string_is_equal(sym, "melondsds_get_power_profile"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_power_profile);
+
+    if (string_is_equal(sym, "melondsds_get_title_profile_path"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_title_profile_path);
+
+    if (string_is_equal(sym, "melondsds_reset_title_profile"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_reset_title_profile);
+
+    if (string_is_equal(sym, "melondsds_fork_console"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_fork_console);
+
+    if (string_is_equal(sym, "melondsds_get_fork_count"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_fork_count);
+
+    if (string_is_equal(sym, "melondsds_run_fork"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_run_fork);
+
+    if (string_is_equal(sym, "melondsds_serialize_fork"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_serialize_fork);
+
+    if (string_is_equal(sym, "melondsds_get_fork_main_ram"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_fork_main_ram);
+
+    if (string_is_equal(sym, "melondsds_enter_sleep_mode"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_enter_sleep_mode);
+
+    if (string_is_equal(sym, "melondsds_get_idle_frames"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_idle_frames);
+
+    if (string_is_equal(sym, "melondsds_get_input_stats"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_input_stats);
+
+    if (string_is_equal(sym, "melondsds_get_frame_stats"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_frame_stats);
+
+    if (string_is_equal(sym, "melondsds_get_audio_stats"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_audio_stats);
+
+    if (string_is_equal(sym, "melondsds_get_rollback_stats"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_rollback_stats);
+
+    if (string_is_equal(sym, "melondsds_get_nand_cache_stats"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_nand_cache_stats);
+
+    if (string_is_equal(sym, "melondsds_get_cheat_plan_stats"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_cheat_plan_stats);
+
+    if (string_is_equal(sym, "melondsds_trace_start"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_trace_start);
+
+    if (string_is_equal(sym, "melondsds_trace_stop"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_trace_stop);
+
+    if (string_is_equal(sym, "melondsds_trace_dump"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_trace_dump);
+
+    if (string_is_equal(sym, "melondsds_get_trace_stats"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_trace_stats);
+
+    if (string_is_equal(sym, "melondsds_get_last_unload_stats"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_get_last_unload_stats);
+
+#ifdef HAVE_TEST_PROCS
+    if (string_is_equal(sym, "melondsds_mp_loopback"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_mp_loopback);
+
+    if (string_is_equal(sym, "melondsds_mp_sync_check"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_mp_sync_check);
+
+    if (string_is_equal(sym, "melondsds_rollback_loopback"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_rollback_loopback);
+
+    if (string_is_equal(sym, "melondsds_benchmark_cheats"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_benchmark_cheats);
+
+    if (string_is_equal(sym, "melondsds_benchmark_rom_archive"))
+        return reinterpret_cast<retro_proc_address_t>(melondsds_benchmark_rom_archive);
+#endif
+
     return nullptr;
 }
 
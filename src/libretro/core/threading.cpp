@@ -0,0 +1,302 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#include "threading.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+
+#include <compat/strl.h>
+#include <file/config_file.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+
+#include <NDS_Header.h>
+
+#include "environment.hpp"
+#include "format.hpp"
+#include "profile.hpp"
+#include "tracy.hpp"
+
+using std::optional;
+using std::nullopt;
+using std::string;
+using namespace std::chrono;
+
+constexpr const char* const THREADED_RENDERER_PROFILE = "profiles/threaded_renderer.cfg";
+
+#ifdef __linux__
+// Reads a small sysfs file into a string, or returns nullopt if it doesn't exist
+static optional<string> ReadSysfs(const char* path) noexcept {
+    RFILE* file = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+    if (!file)
+        return nullopt;
+
+    char buffer[256] {};
+    int64_t length = filestream_read(file, buffer, sizeof(buffer) - 1);
+    filestream_close(file);
+    if (length <= 0)
+        return nullopt;
+
+    return string(buffer, length);
+}
+#endif
+
+MelonDsDs::CpuTopology MelonDsDs::CpuTopology::Detect() noexcept {
+    ZoneScopedN(TracyFunction);
+    CpuTopology topology;
+    topology.LogicalCores = std::max(1u, std::thread::hardware_concurrency());
+    topology.PhysicalCores = topology.LogicalCores;
+    topology.BigCores = topology.LogicalCores;
+
+#if defined(_WIN32)
+    DWORD length = 0;
+    GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &length);
+    std::vector<uint8_t> buffer(length);
+    auto* info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data());
+    if (length > 0 && GetLogicalProcessorInformationEx(RelationProcessorCore, info, &length)) {
+        unsigned physical = 0;
+        unsigned big = 0;
+        BYTE bestClass = 0;
+        for (DWORD offset = 0; offset < length;) {
+            const auto* core = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+            physical++;
+            // Higher efficiency classes are faster (and hungrier) cores
+            if (core->Processor.EfficiencyClass > bestClass) {
+                bestClass = core->Processor.EfficiencyClass;
+                big = 0;
+            }
+            if (core->Processor.EfficiencyClass == bestClass) {
+                big++;
+            }
+            offset += core->Size;
+        }
+
+        topology.PhysicalCores = std::max(1u, physical);
+        topology.BigCores = std::max(1u, big);
+    }
+#elif defined(__APPLE__)
+    int value = 0;
+    size_t size = sizeof(value);
+    if (sysctlbyname("hw.physicalcpu", &value, &size, nullptr, 0) == 0 && value > 0) {
+        topology.PhysicalCores = value;
+        topology.BigCores = value;
+    }
+
+    size = sizeof(value);
+    if (sysctlbyname("hw.perflevel0.physicalcpu", &value, &size, nullptr, 0) == 0 && value > 0) {
+        // Only Apple Silicon has performance levels
+        topology.BigCores = value;
+    }
+#elif defined(__linux__)
+    std::set<string> cores;
+    std::vector<unsigned long> maxFrequencies;
+    for (unsigned i = 0; i < topology.LogicalCores; ++i) {
+        char path[PATH_MAX] {};
+        fmt::format_to_n(path, sizeof(path) - 1, "/sys/devices/system/cpu/cpu{}/topology/thread_siblings_list", i);
+        optional<string> siblings = ReadSysfs(path);
+        if (!siblings)
+            continue;
+
+        // SMT siblings share a list, so each distinct list is one physical core
+        if (!cores.insert(*siblings).second)
+            continue;
+
+        fmt::format_to_n(path, sizeof(path) - 1, "/sys/devices/system/cpu/cpu{}/cpufreq/cpuinfo_max_freq", i);
+        if (optional<string> frequency = ReadSysfs(path)) {
+            maxFrequencies.push_back(std::strtoul(frequency->c_str(), nullptr, 10));
+        }
+    }
+
+    if (!cores.empty()) {
+        topology.PhysicalCores = cores.size();
+        topology.BigCores = cores.size();
+    }
+
+    if (!maxFrequencies.empty() && maxFrequencies.size() == cores.size()) {
+        // If we know every core's maximum frequency, the fastest ones are the big cluster
+        unsigned long fastest = *std::max_element(maxFrequencies.begin(), maxFrequencies.end());
+        topology.BigCores = std::count(maxFrequencies.begin(), maxFrequencies.end(), fastest);
+    }
+#endif
+
+    topology.PhysicalCores = std::min(topology.PhysicalCores, topology.LogicalCores);
+    topology.BigCores = std::min(topology.BigCores, topology.PhysicalCores);
+    return topology;
+}
+
+string MelonDsDs::CpuTopology::Key() const noexcept {
+    if (Heterogeneous())
+        return fmt::format("{}c{}t-{}big", PhysicalCores, LogicalCores, BigCores);
+
+    return fmt::format("{}c{}t", PhysicalCores, LogicalCores);
+}
+
+struct ConfigFileDeleter {
+    void operator()(config_file_t* conf) const noexcept {
+        config_file_free(conf);
+    }
+};
+
+using config_file_ptr = std::unique_ptr<config_file_t, ConfigFileDeleter>;
+
+MelonDsDs::ThreadedRendererTuner::ThreadedRendererTuner(const melonDS::NDSHeader* header, std::span<const std::byte> rom) noexcept :
+    _topology(CpuTopology::Detect()) {
+    ZoneScopedN(TracyFunction);
+
+    // Start with whichever is more likely to win, so that a session that ends early isn't worse off
+    _measuringThreaded = _topology.BigCores >= 2;
+
+    retro::info(
+        "Detected {} logical core(s), {} physical core(s), {} in the fastest cluster{}",
+        _topology.LogicalCores,
+        _topology.PhysicalCores,
+        _topology.BigCores,
+        _topology.Smt() ? " (with SMT)" : ""
+    );
+
+    if (_topology.LogicalCores < 2) {
+        // If there's nowhere for the render thread to go...
+        Decide(false, "this device has a single core");
+        return;
+    }
+
+    if (!header) {
+        // If there's no game to remember the decision for...
+        retro::info("Measuring the software renderer with and without its own thread");
+        return;
+    }
+
+    string gameCode(header->GameCode, strnlen(header->GameCode, sizeof(header->GameCode)));
+    _key = fmt::format("{}_{:08x}_{}", gameCode, TitleChecksum(*header, rom), _topology.Key());
+    if (optional<string> path = retro::get_save_subdir_path(THREADED_RENDERER_PROFILE)) {
+        _path = std::move(*path);
+    }
+    else {
+        retro::warn("Failed to get the path to the threaded renderer profile, this session's measurement won't be saved");
+    }
+
+    if (!_path.empty() && path_is_valid(_path.c_str())) {
+        config_file_ptr conf(config_file_new_from_path_to_string(_path.c_str()));
+        bool threaded = false;
+        if (conf && config_get_bool(conf.get(), _key.c_str(), &threaded)) {
+            // If we've already measured this game on this kind of device...
+            _decision = threaded;
+            retro::info("Using the saved decision to {} the software renderer's thread for {}", threaded ? "enable" : "disable", _key);
+            return;
+        }
+    }
+
+    retro::info("Measuring the software renderer with and without its own thread");
+}
+
+bool MelonDsDs::ThreadedRendererTuner::Threaded() const noexcept {
+    return _decision ? *_decision : _measuringThreaded;
+}
+
+void MelonDsDs::ThreadedRendererTuner::Decide(bool threaded, const char* reason) noexcept {
+    _decision = threaded;
+    _frameTimer.Reset();
+    retro::info("{} the software renderer's thread because {}", threaded ? "Enabled" : "Disabled", reason);
+}
+
+void MelonDsDs::ThreadedRendererTuner::BeginFrame() noexcept {
+    if (_decision)
+        return;
+
+    _frameTimer.Start();
+}
+
+bool MelonDsDs::ThreadedRendererTuner::EndFrame() noexcept {
+    if (_decision)
+        return false;
+
+    optional<steady_clock::duration> elapsed = _frameTimer.Stop();
+    if (!elapsed)
+        return false;
+
+    if (++_frames <= WARMUP_FRAMES)
+        return false;
+
+    _time[_measuringThreaded] += *elapsed;
+    _measuredFrames[_measuringThreaded]++;
+    if ((_frames - WARMUP_FRAMES) % FRAMES_PER_ROUND != 0)
+        return false;
+
+    // We've finished measuring this mode for this round
+    _measuringThreaded = !_measuringThreaded;
+    if (_measuredFrames[0] < ROUNDS * FRAMES_PER_ROUND || _measuredFrames[1] < ROUNDS * FRAMES_PER_ROUND)
+        return true;
+
+    double unthreadedUs = duration<double, std::micro>(_time[false]).count() / _measuredFrames[false];
+    double threadedUs = duration<double, std::micro>(_time[true]).count() / _measuredFrames[true];
+    string reason = fmt::format(
+        "frames took {:.0f}us with it and {:.0f}us without it on {}",
+        threadedUs,
+        unthreadedUs,
+        _topology.Key()
+    );
+    bool oldThreaded = Threaded();
+    Decide(threadedUs < unthreadedUs * MIN_IMPROVEMENT, reason.c_str());
+    Save();
+
+    return Threaded() != oldThreaded;
+}
+
+bool MelonDsDs::ThreadedRendererTuner::Save() const noexcept {
+    ZoneScopedN(TracyFunction);
+    if (_path.empty() || _key.empty() || !_decision)
+        return false;
+
+    char dir[PATH_MAX] {};
+    strlcpy(dir, _path.c_str(), sizeof(dir));
+    path_basedir(dir);
+    if (!path_mkdir(dir)) {
+        retro::warn("Failed to create \"{}\", can't save the threaded renderer profile", dir);
+        return false;
+    }
+
+    // Other games' (and other devices') decisions live in the same file, so keep them
+    config_file_ptr conf(path_is_valid(_path.c_str()) ? config_file_new_from_path_to_string(_path.c_str()) : nullptr);
+    if (!conf) {
+        conf.reset(config_file_new_alloc());
+    }
+
+    if (!conf) {
+        retro::error("Failed to allocate the threaded renderer profile");
+        return false;
+    }
+
+    config_set_bool(conf.get(), _key.c_str(), *_decision);
+    if (!config_file_write(conf.get(), _path.c_str(), true)) {
+        retro::warn("Failed to write the threaded renderer profile to \"{}\"", _path);
+        return false;
+    }
+
+    return true;
+}
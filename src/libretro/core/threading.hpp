@@ -0,0 +1,92 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "std/span.hpp"
+#include "worktime.hpp"
+
+namespace melonDS {
+    struct NDSHeader;
+}
+
+namespace MelonDsDs {
+    /// What we could learn about the host's processors.
+    /// Fields we couldn't determine are set to the number of logical cores.
+    struct CpuTopology {
+        unsigned LogicalCores = 1;
+        unsigned PhysicalCores = 1;
+        /// Physical cores in the fastest cluster; equal to PhysicalCores on homogeneous CPUs.
+        unsigned BigCores = 1;
+
+        [[nodiscard]] static CpuTopology Detect() noexcept;
+        [[nodiscard]] bool Smt() const noexcept { return LogicalCores > PhysicalCores; }
+        [[nodiscard]] bool Heterogeneous() const noexcept { return BigCores < PhysicalCores; }
+
+        /// A short string that identifies this kind of CPU, e.g. "8c16t" or "8c8t-4big"
+        [[nodiscard]] std::string Key() const noexcept;
+    };
+
+    /// Decides whether the software renderer should run on its own thread
+    /// when the player leaves that up to us.
+    /// Rules out threading on hosts with a single core,
+    /// then times a few seconds of gameplay with and without it
+    /// and remembers whichever was faster for this device and game.
+    class ThreadedRendererTuner {
+    public:
+        /// @param header The loaded game's header, or \c nullptr if there isn't one
+        /// (in which case the result is used for this session only).
+        ThreadedRendererTuner(const melonDS::NDSHeader* header, std::span<const std::byte> rom) noexcept;
+
+        /// Whether the software renderer should be threaded right now;
+        /// may change while we're still measuring.
+        [[nodiscard]] bool Threaded() const noexcept;
+        [[nodiscard]] bool Measuring() const noexcept { return !_decision.has_value(); }
+        void BeginFrame() noexcept;
+
+        /// @returns true if Threaded() changed and the renderer should be updated.
+        bool EndFrame() noexcept;
+    private:
+        // Frames to skip before measuring, since the game is usually still booting
+        static constexpr unsigned WARMUP_FRAMES = 180;
+        // Frames to measure in one mode before switching to the other
+        static constexpr unsigned FRAMES_PER_ROUND = 60;
+        // How many times to measure each mode; alternating reduces the influence of scene changes
+        static constexpr unsigned ROUNDS = 4;
+        // Threading must be at least this much faster to be worth the extra core
+        static constexpr double MIN_IMPROVEMENT = 0.97;
+
+        void Decide(bool threaded, const char* reason) noexcept;
+        bool Save() const noexcept;
+
+        CpuTopology _topology {};
+        std::string _path;
+        std::string _key;
+        std::optional<bool> _decision = std::nullopt;
+        bool _measuringThreaded = true;
+        unsigned _frames = 0;
+        // Total frame time in each mode, indexed by whether it was threaded
+        std::chrono::steady_clock::duration _time[2] {};
+        unsigned _measuredFrames[2] {};
+        WorkTimer _frameTimer {};
+    };
+}
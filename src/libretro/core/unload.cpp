@@ -0,0 +1,218 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#include "unload.hpp"
+
+#include <algorithm>
+#include <system_error>
+
+#include <retro_assert.h>
+
+#include "environment.hpp"
+#include "tracy.hpp"
+
+using std::chrono::duration;
+using std::chrono::milliseconds;
+using Ms = duration<double, std::milli>;
+
+namespace {
+    // Outlives the core's state, so that a test can see how the last session's unload went
+    std::mutex LastStatsMutex;
+    MelonDsDs::UnloadStats LastUnloadStats {};
+}
+
+MelonDsDs::UnloadPipeline::~UnloadPipeline() noexcept {
+    Finish();
+}
+
+MelonDsDs::UnloadPipeline::StepId MelonDsDs::UnloadPipeline::Submit(const char* name, Step&& step, std::initializer_list<StepId> after) noexcept {
+    ZoneScopedN(TracyFunction);
+    retro_assert(name != nullptr);
+    std::unique_lock lock(_mutex);
+    StepId id = _steps.size();
+    for (StepId dependency : after) {
+        retro_assert(dependency < id);
+    }
+
+    _steps.push_back({ .Name = name, .Work = std::move(step), .After = after, .Submitted = clock::now() });
+
+#ifdef HAVE_THREADS
+    try {
+        // The worker waits for the lock before it does anything
+        _workers.emplace_back(&UnloadPipeline::RunStep, this, id);
+        return id;
+    }
+    catch (const std::system_error& e) {
+        retro::warn("Couldn't start a worker for unload step \"{}\" ({}), running it now", name, e.what());
+    }
+#endif
+
+    // Any dependencies were submitted before this step, so they've finished if they also ran here
+    lock.unlock();
+    RunStep(id);
+    return id;
+}
+
+void MelonDsDs::UnloadPipeline::Run(const char* name, Step&& step, std::initializer_list<StepId> after) noexcept {
+    StepId id;
+    {
+        std::lock_guard lock(_mutex);
+        id = _steps.size();
+        for (StepId dependency : after) {
+            retro_assert(dependency < id);
+        }
+
+        _steps.push_back({ .Name = name, .Work = std::move(step), .After = after, .Submitted = clock::now(), .Inline = true });
+    }
+
+    RunStep(id);
+}
+
+void MelonDsDs::UnloadPipeline::RunStep(StepId id) noexcept {
+    const char* name;
+    Step work;
+    {
+        std::unique_lock lock(_mutex);
+        _changed.wait(lock, [this, id] {
+            const std::vector<StepId>& after = _steps[id].After;
+            return std::all_of(after.begin(), after.end(), [this](StepId dependency) {
+                return _steps[dependency].Done;
+            });
+        });
+
+        StepState& state = _steps[id];
+        state.Started = clock::now();
+        name = state.Name;
+        work = std::move(state.Work);
+    }
+
+    {
+        MELONDSDS_TRACE_SCOPE(name);
+        work();
+        // Release whatever the step owned here, so that its destruction counts towards its time
+        work = nullptr;
+    }
+
+    {
+        std::lock_guard lock(_mutex);
+        StepState& state = _steps[id];
+        state.Finished = clock::now();
+        state.Done = true;
+    }
+    _changed.notify_all();
+}
+
+bool MelonDsDs::UnloadPipeline::AllDone() const noexcept {
+    return std::all_of(_steps.begin(), _steps.end(), [](const StepState& state) { return state.Done; });
+}
+
+bool MelonDsDs::UnloadPipeline::Join(milliseconds timeout) noexcept {
+    ZoneScopedN(TracyFunction);
+    clock::time_point start = clock::now();
+    std::unique_lock lock(_mutex);
+    if (_changed.wait_for(lock, timeout, [this] { return AllDone(); })) {
+        Complete(lock, Ms(clock::now() - start).count(), false, 0);
+        return true;
+    }
+
+    _blockedMs += Ms(clock::now() - start).count();
+    _overdue = 0;
+    for (const StepState& state : _steps) {
+        if (!state.Done) {
+            retro::warn("Unload step \"{}\" is still running after {}ms; letting it finish in the background", state.Name, timeout.count());
+            _overdue++;
+        }
+    }
+
+    return false;
+}
+
+void MelonDsDs::UnloadPipeline::Finish() noexcept {
+    ZoneScopedN(TracyFunction);
+    clock::time_point start = clock::now();
+    std::unique_lock lock(_mutex);
+    if (_steps.empty())
+        return;
+
+    bool timedOut = _overdue > 0;
+    _changed.wait(lock, [this] { return AllDone(); });
+    if (timedOut) {
+        retro::info("Waited {:.1f}ms for the last unload's remaining steps", Ms(clock::now() - start).count());
+    }
+
+    Complete(lock, _blockedMs + Ms(clock::now() - start).count(), timedOut, _overdue);
+}
+
+void MelonDsDs::UnloadPipeline::Complete(std::unique_lock<std::mutex>& lock, double blockedMs, bool timedOut, uint32_t overdue) noexcept {
+    retro_assert(lock.owns_lock());
+    retro_assert(AllDone());
+
+    // Every step has finished, so the workers are about to exit
+    std::vector<std::thread> workers = std::move(_workers);
+    std::deque<StepState> steps = std::move(_steps);
+    _workers.clear();
+    _steps.clear();
+    _blockedMs = 0;
+    _overdue = 0;
+    lock.unlock();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    if (steps.empty())
+        return;
+
+    UnloadStats stats {
+        .Steps = static_cast<uint32_t>(steps.size()),
+        .Overdue = overdue,
+        .BlockedMs = blockedMs,
+        .TimedOut = timedOut,
+    };
+    clock::time_point first = steps.front().Submitted;
+    clock::time_point last = steps.front().Finished;
+    for (const StepState& step : steps) {
+        double stepMs = Ms(step.Finished - step.Started).count();
+        stats.SerialMs += stepMs;
+        first = std::min(first, step.Submitted);
+        last = std::max(last, step.Finished);
+        retro::info(
+            "Unload step \"{}\" took {:.1f}ms{} (waited {:.1f}ms to start)",
+            step.Name,
+            stepMs,
+            step.Inline ? " on the emulator thread" : "",
+            Ms(step.Started - step.Submitted).count()
+        );
+    }
+    stats.WallMs = Ms(last - first).count();
+
+    retro::info(
+        "Unloaded in {:.1f}ms across {} steps ({:.1f}ms if run one at a time); the emulator thread waited {:.1f}ms",
+        stats.WallMs,
+        stats.Steps,
+        stats.SerialMs,
+        stats.BlockedMs
+    );
+
+    std::lock_guard statsLock(LastStatsMutex);
+    LastUnloadStats = stats;
+}
+
+MelonDsDs::UnloadStats MelonDsDs::UnloadPipeline::LastStats() noexcept {
+    std::lock_guard lock(LastStatsMutex);
+    return LastUnloadStats;
+}
@@ -0,0 +1,106 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MelonDsDs {
+    /// Timings of the last unload whose steps all finished.
+    /// Exposed to C callers as-is, so keep it standard-layout.
+    struct UnloadStats {
+        uint32_t Steps;
+        /// Steps that were still running when the emulator thread stopped waiting for them
+        uint32_t Overdue;
+        /// From the first step's submission to the last step's completion
+        double WallMs;
+        /// What the steps would've taken if they'd run one after another
+        double SerialMs;
+        /// How long the emulator thread waited for the steps to finish
+        double BlockedMs;
+        bool TimedOut;
+    };
+
+    /// Runs the steps of unloading a game (flushing saves, uninstalling DSiWare, destroying the console, etc.)
+    /// on worker threads, each one starting as soon as the steps it depends on have finished.
+    /// Steps must own (or share) everything they touch,
+    /// since they may outlive the unload that submitted them.
+    class UnloadPipeline {
+    public:
+        using StepId = size_t;
+        using Step = std::function<void()>;
+
+        UnloadPipeline() noexcept = default;
+        ~UnloadPipeline() noexcept;
+        UnloadPipeline(const UnloadPipeline&) = delete;
+        UnloadPipeline& operator=(const UnloadPipeline&) = delete;
+        UnloadPipeline(UnloadPipeline&&) = delete;
+        UnloadPipeline& operator=(UnloadPipeline&&) = delete;
+
+        /// Starts \c step on a new worker once every step in \c after has finished.
+        /// \param name Used for logging and tracing; must be a string literal.
+        StepId Submit(const char* name, Step&& step, std::initializer_list<StepId> after = {}) noexcept;
+
+        /// Runs \c step on this thread once every step in \c after has finished, but times it along with the others.
+        void Run(const char* name, Step&& step, std::initializer_list<StepId> after = {}) noexcept;
+
+        /// Waits up to \c timeout for every submitted step to finish, then logs how long each one took.
+        /// Steps that are still running are left to finish in the background.
+        /// \returns \c true if every step finished in time
+        bool Join(std::chrono::milliseconds timeout) noexcept;
+
+        /// Waits for every submitted step to finish, however long that takes.
+        /// Call before anything that might touch the files that the steps write.
+        void Finish() noexcept;
+
+        [[nodiscard]] static UnloadStats LastStats() noexcept;
+    private:
+        using clock = std::chrono::steady_clock;
+        struct StepState {
+            const char* Name;
+            Step Work;
+            std::vector<StepId> After;
+            clock::time_point Submitted;
+            clock::time_point Started;
+            clock::time_point Finished;
+            bool Done = false;
+            bool Inline = false;
+        };
+
+        void RunStep(StepId id) noexcept;
+        [[nodiscard]] bool AllDone() const noexcept;
+        void Complete(std::unique_lock<std::mutex>& lock, double blockedMs, bool timedOut, uint32_t overdue) noexcept;
+
+        std::mutex _mutex;
+        std::condition_variable _changed;
+        // A deque so that workers can hold references to their own state while others are added
+        std::deque<StepState> _steps;
+        std::vector<std::thread> _workers;
+        // Carried over from a Join that timed out, so the eventual Finish can report them
+        double _blockedMs = 0;
+        uint32_t _overdue = 0;
+    };
+}
@@ -0,0 +1,55 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <optional>
+
+#include "environment.hpp"
+
+namespace MelonDsDs {
+    /// Measures how long the core spends on a frame, not counting time spent
+    /// in the frontend's video and audio callbacks (which block on vsync and audio sync).
+    /// Wall time rather than thread CPU time, because the core's own threads
+    /// (e.g. the threaded software renderer) are part of the work being measured.
+    class WorkTimer {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        void Start() noexcept {
+            _start = clock::now();
+            _callbacksAtStart = retro::callback_time();
+        }
+
+        /// @returns The work time since Start(), or \c nullopt if the timer wasn't running.
+        std::optional<clock::duration> Stop() noexcept {
+            if (!_start)
+                return std::nullopt;
+
+            clock::duration elapsed = clock::now() - *_start;
+            clock::duration callbacks = retro::callback_time() - _callbacksAtStart;
+            _start = std::nullopt;
+            return elapsed > callbacks ? elapsed - callbacks : clock::duration::zero();
+        }
+
+        [[nodiscard]] bool Running() const noexcept { return _start.has_value(); }
+        void Reset() noexcept { _start = std::nullopt; }
+    private:
+        std::optional<clock::time_point> _start = std::nullopt;
+        clock::duration _callbacksAtStart {};
+    };
+}
@@ -17,6 +17,7 @@
 #include "environment.hpp"
 #include "environment.h"
 
+#include <algorithm>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
@@ -60,9 +61,13 @@ namespace retro {
     static retro_log_printf_t _log;
     static bool _supports_bitmasks;
     static bool _supportsPowerStatus;
+    static bool _canDupe;
     static bool _supportsNoGameMode;
     static bool isShuttingDown = false;
     static std::optional<std::chrono::microseconds> _lastFrameTime = std::nullopt;
+    static std::optional<AudioBufferStatus> _audioBufferStatus = std::nullopt;
+    // Only the emulator thread calls the frontend's video and audio callbacks
+    static std::chrono::steady_clock::duration _callbackTime {};
 
     static unsigned _message_interface_version = UINT_MAX;
     constexpr size_t PATH_LENGTH = PATH_MAX + 1;
@@ -145,7 +150,10 @@ void retro::input_poll() {
 size_t retro::audio_sample_batch(const int16_t* data, size_t frames) {
     ZoneScopedN(TracyFunction);
     if (_audio_sample_batch) {
-        return _audio_sample_batch(data, frames);
+        auto start = std::chrono::steady_clock::now();
+        size_t consumed = _audio_sample_batch(data, frames);
+        _callbackTime += std::chrono::steady_clock::now() - start;
+        return consumed;
     } else {
         return 0;
     }
@@ -154,10 +162,16 @@ size_t retro::audio_sample_batch(const int16_t* data, size_t frames) {
 void retro::video_refresh(const void* data, unsigned width, unsigned height, size_t pitch) {
     ZoneScopedN(TracyFunction);
     if (_video_refresh) {
+        auto start = std::chrono::steady_clock::now();
         _video_refresh(data, width, height, pitch);
+        _callbackTime += std::chrono::steady_clock::now() - start;
     }
 }
 
+std::chrono::steady_clock::duration retro::callback_time() noexcept {
+    return _callbackTime;
+}
+
 bool retro::set_screen_rotation(ScreenOrientation orientation) noexcept {
     ZoneScopedN(TracyFunction);
     bool rotated = false;
@@ -308,6 +322,31 @@ std::optional<std::chrono::microseconds> retro::last_frame_time() noexcept {
     return _lastFrameTime;
 }
 
+std::optional<float> retro::get_target_refresh_rate() noexcept {
+    float rate = 0;
+    bool ok = environment(RETRO_ENVIRONMENT_GET_TARGET_REFRESH_RATE, &rate);
+    return ok && rate > 0 ? std::make_optional(rate) : std::nullopt;
+}
+
+static void AudioBufferStatusCallback(bool active, unsigned occupancy, bool underrun_likely) noexcept {
+    if (active) {
+        retro::_audioBufferStatus = retro::AudioBufferStatus { std::min(occupancy, 100u), underrun_likely };
+    }
+    else {
+        retro::_audioBufferStatus = std::nullopt;
+    }
+}
+
+bool retro::set_audio_buffer_status_callback(bool enabled) noexcept {
+    retro_audio_buffer_status_callback callback { enabled ? AudioBufferStatusCallback : nullptr };
+    _audioBufferStatus = std::nullopt;
+    return environment(RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK, &callback);
+}
+
+std::optional<retro::AudioBufferStatus> retro::get_audio_buffer_status() noexcept {
+    return _audioBufferStatus;
+}
+
 bool retro::is_variable_updated() noexcept {
     ZoneScopedN(TracyFunction);
 
@@ -593,6 +632,10 @@ bool retro::supports_power_status() noexcept {
     return _supportsPowerStatus;
 }
 
+bool retro::can_dupe() noexcept {
+    return _canDupe;
+}
+
 optional<retro_device_power> retro::get_device_power() noexcept
 {
     ZoneScopedN(TracyFunction);
@@ -768,8 +811,10 @@ void retro::env::deinit() noexcept {
     _log = nullptr;
     _supports_bitmasks = false;
     _supportsPowerStatus = false;
+    _canDupe = false;
     _supportsNoGameMode = false;
     _lastFrameTime = std::nullopt;
+    _audioBufferStatus = std::nullopt;
     _message_interface_version = UINT_MAX;
 }
 
@@ -795,6 +840,9 @@ PUBLIC_SYMBOL void retro_set_environment(retro_environment_t cb) {
         .start = &MelonDsDs::MpStarted,
         .receive = &MelonDsDs::MpReceived,
         .stop = &MelonDsDs::MpStopped,
+        .poll = nullptr,
+        .connected = &MelonDsDs::MpConnected,
+        .disconnected = &MelonDsDs::MpDisconnected,
     };
     environment(RETRO_ENVIRONMENT_SET_NETPACKET_INTERFACE, &netpacket_callback);
 
@@ -831,6 +879,10 @@ PUBLIC_SYMBOL void retro_set_environment(retro_environment_t cb) {
     retro::_supports_bitmasks |= environment(RETRO_ENVIRONMENT_GET_INPUT_BITMASKS, nullptr);
     retro::_supportsPowerStatus |= environment(RETRO_ENVIRONMENT_GET_DEVICE_POWER, nullptr);
 
+    if (bool canDupe = false; environment(RETRO_ENVIRONMENT_GET_CAN_DUPE, &canDupe)) {
+        retro::_canDupe = canDupe;
+    }
+
     if (retro::_message_interface_version == UINT_MAX && !environment(RETRO_ENVIRONMENT_GET_MESSAGE_INTERFACE_VERSION, &retro::_message_interface_version)) {
         retro::_message_interface_version = UINT_MAX;
     }
@@ -37,6 +37,12 @@ namespace retro {
         RotatedRight = 3,
     };
 
+    struct AudioBufferStatus {
+        /// How full the frontend's audio buffer is, from 0 to 100
+        unsigned Occupancy;
+        bool UnderrunLikely;
+    };
+
     /// For use by other parts of the core
     bool environment(unsigned cmd, void *data) noexcept;
 
@@ -99,6 +105,9 @@ namespace retro {
     std::optional<std::string_view> username() noexcept;
     void set_option_visible(const char* key, bool visible) noexcept;
     bool supports_power_status() noexcept;
+
+    /// True if the frontend lets us pass NULL to video_refresh to show the previous frame again.
+    bool can_dupe() noexcept;
     std::optional<retro_device_power> get_device_power() noexcept;
     bool set_hw_render(retro_hw_render_callback& callback) noexcept;
 
@@ -110,6 +119,10 @@ namespace retro {
     size_t audio_sample_batch(const int16_t *data, size_t frames);
     void video_refresh(const void *data, unsigned width, unsigned height, size_t pitch);
 
+    /// Total time spent inside the frontend's audio_sample_batch and video_refresh,
+    /// either of which may block on audio or video sync.
+    [[nodiscard]] std::chrono::steady_clock::duration callback_time() noexcept;
+
     bool shutdown() noexcept;
     bool set_rumble_state(unsigned port, retro_rumble_effect effect, uint16_t strength) noexcept;
     bool set_rumble_state(unsigned port, uint16_t strength) noexcept;
@@ -123,6 +136,14 @@ namespace retro {
     std::optional<bool> is_fastforwarding() noexcept;
     std::optional<retro_throttle_state> get_throttle_state() noexcept;
     std::optional<std::chrono::microseconds> last_frame_time() noexcept;
+    std::optional<float> get_target_refresh_rate() noexcept;
+
+    /// Asks the frontend to report its audio buffer's status before each frame (or to stop doing so).
+    bool set_audio_buffer_status_callback(bool enabled) noexcept;
+
+    /// The status that the frontend last reported,
+    /// or \c nullopt if it isn't reporting one or its audio is inactive.
+    std::optional<AudioBufferStatus> get_audio_buffer_status() noexcept;
 
     std::optional<std::string_view> get_save_directory() noexcept;
     std::optional<std::string_view> get_save_subdirectory() noexcept;
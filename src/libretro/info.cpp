@@ -32,6 +32,13 @@ const struct retro_system_content_info_override MelonDsDs::content_overrides[] =
         true
         // We need to keep the ROM around for reloads
     },
+    {
+        "zip|rzip",
+        true,
+        false
+        // We decompress the ROM ourselves (straight into the buffer we keep),
+        // so the frontend doesn't need to extract or even load the archive
+    },
     {}
 };
 
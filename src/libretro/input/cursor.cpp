@@ -105,12 +105,15 @@ void CursorState::Update(const ScreenLayoutData& layout, const PointerState& poi
     }
 
     _consoleTouchPosition = ConsoleTouchPosition(layout);
+    Tick();
 
+    _cursorSettingsDirty = false;
+}
+
+void CursorState::Tick() noexcept {
     if (_cursorMode == CursorMode::Timeout && _cursorTimeout > 0) {
         _cursorTimeout--;
     }
-
-    _cursorSettingsDirty = false;
 }
 
 void CursorState::Apply(melonDS::NDS& nds) const noexcept {
@@ -36,6 +36,9 @@ namespace MelonDsDs {
         void SetConfig(const CoreConfig& config) noexcept;
         void Update(const ScreenLayoutData& layout, const PointerState& pointer, const JoypadState& joypad) noexcept;
 
+        /// Advances the parts of the cursor's state that change even without new input
+        void Tick() noexcept;
+
         // Gathers the input by the pointer and joystick, and forwards one of them to the NDS
         void Apply(melonDS::NDS& nds) const noexcept;
 
@@ -47,6 +50,7 @@ namespace MelonDsDs {
         [[nodiscard]] glm::ivec2 PointerTouchPosition() const noexcept { return _pointerCursorPosition; }
         [[nodiscard]] bool IsTouching() const noexcept;
         [[nodiscard]] bool TouchReleased() const noexcept { return _isTouchReleased; }
+        [[nodiscard]] glm::uvec2 ConsoleTouchPosition() const noexcept { return _consoleTouchPosition; }
         [[nodiscard]] bool CursorVisible() const noexcept;
     private:
         [[nodiscard]] bool IsCursorInputInBounds() const noexcept;
@@ -37,6 +37,7 @@
 #include "tracy.hpp"
 #include "utils.hpp"
 
+using MelonDsDs::ConsoleInput;
 using MelonDsDs::InputState;
 using glm::ivec2;
 using glm::ivec3;
@@ -97,15 +98,17 @@ void MelonDsDs::InputState::SetControllerPortDevice(unsigned int port, unsigned
 
     _inputDeviceType = device;
     _joypad.SetControllerPortDevice(port, device);
+    Invalidate();
 }
 
 void InputState::Update(const ScreenLayoutData& layout) noexcept {
     ZoneScopedN(TracyFunction);
 
+    _frameStart = cpu_features_get_perf_counter();
     retro::input_poll();
 
     // First get the raw input from libretro itself
-    InputPollResult pollResult;
+    InputPollResult pollResult {};
 
     pollResult.JoypadButtons = retro::joypad_state(0);
     if (_touchMode == TouchMode::Joystick || _touchMode == TouchMode::Auto) {
@@ -120,38 +123,129 @@ void InputState::Update(const ScreenLayoutData& layout) noexcept {
         pollResult.PointerPosition.x = retro::input_state(0, RETRO_DEVICE_POINTER, 0, RETRO_DEVICE_ID_POINTER_X);
         pollResult.PointerPosition.y = retro::input_state(0, RETRO_DEVICE_POINTER, 0, RETRO_DEVICE_ID_POINTER_Y);
     }
-    pollResult.Timestamp = cpu_features_get_perf_counter();
+
+    auto* solar = get_if<SolarSensorState>(&_slot2);
+    if (solar) {
+        // The mouse wheel adjusts the light level if there's no real sensor
+        pollResult.MouseWheelUp = retro::input_state(0, RETRO_DEVICE_MOUSE, 0, RETRO_DEVICE_ID_MOUSE_WHEELUP) != 0;
+        pollResult.MouseWheelDown = retro::input_state(0, RETRO_DEVICE_MOUSE, 0, RETRO_DEVICE_ID_MOUSE_WHEELDOWN) != 0;
+    }
+    pollResult.Timestamp = _frameStart;
+
+    // A deflected joystick moves the cursor every frame, even if its input doesn't change
+    bool unchanged = !_dirty && pollResult.SameInput(_lastPoll) && pollResult.AnalogCursorDirection == i16vec2(0);
+    _lastPoll = pollResult;
+    _dirty = false;
+
+    // If nothing's changed since the last frame, the console already has this frame's input
+    // (the previous frame applied any changes, and any edges it triggered have already fired)
+    _applied = unchanged;
+    if (unchanged && _settled) {
+        // If the last full update also saw this same input, every device's state is exactly what it was,
+        // so only advance what changes with time
+        _cursor.Tick();
+        if (solar) {
+            // The real light sensor's readings aren't part of the poll
+            solar->Update(_joypad, pollResult);
+        }
+        return;
+    }
 
     // Update each device's internal state
     _joypad.Update(pollResult);
-    if (auto* solar = get_if<SolarSensorState>(&_slot2)) {
-        solar->Update(_joypad);
+    if (solar) {
+        solar->Update(_joypad, pollResult);
     }
     _pointer.Update(pollResult);
 
     _cursor.Update(layout, _pointer, _joypad);
+    _settled = unchanged;
 }
 
-void InputState::Apply(melonDS::NDS& nds, ScreenLayoutData& layout, MicrophoneState& mic) const noexcept {
+void InputState::Apply(melonDS::NDS& nds, ScreenLayoutData& layout, MicrophoneState& mic) noexcept {
     ZoneScopedN(TracyFunction);
 
-    // Adjust the screen layout based on the frontend's input
-    _joypad.Apply(layout);
+    if (!_applied) {
+        // Forward the frontend's button input to the emulated DS
+        _joypad.Apply(nds);
+        _cursor.Apply(nds);
+    }
 
-    // Forward the frontend's button input to the emulated DS
-    _joypad.Apply(nds);
+    if (const auto* solar = get_if<SolarSensorState>(&_slot2)) {
+        // The real light sensor's readings may change at any time
+        solar->Apply(nds);
+    }
+
+    ApplyLocal(layout, mic);
+}
+
+void InputState::ApplyLocal(ScreenLayoutData& layout, MicrophoneState& mic) noexcept {
+    ZoneScopedN(TracyFunction);
+
+    if (!_applied) {
+        // Adjust the screen layout based on the frontend's input
+        _joypad.Apply(layout);
+    }
 
     // Update the microphone's state
     _joypad.Apply(mic);
-    if (const auto* solar = get_if<SolarSensorState>(&_slot2)) {
-        solar->Apply(nds);
+
+    Cost& cost = _applied ? _cachedCost : _fullCost;
+    cost.Frames++;
+    cost.Ticks += cpu_features_get_perf_counter() - _frameStart;
+}
+
+ConsoleInput InputState::GetConsoleInput() const noexcept {
+    ConsoleInput input { ~_joypad.ConsoleButtons() & ConsoleInput::BUTTONS };
+    if (_cursor.IsTouching()) {
+        uvec2 touch = _cursor.ConsoleTouchPosition();
+        input.Bits |= ConsoleInput::TOUCHING | (touch.x << 16) | (touch.y << 24);
+    }
+
+    if (_joypad.ToggleLidPressed()) {
+        input.Bits |= ConsoleInput::TOGGLE_LID;
+    }
+
+    return input;
+}
+
+ConsoleInput ConsoleInput::Merge(ConsoleInput first, ConsoleInput second) noexcept {
+    ConsoleInput merged { (first.Bits | second.Bits) & (BUTTONS | TOGGLE_LID) };
+    const ConsoleInput& touch = first.Touching() ? first : second;
+    merged.Bits |= touch.Bits & ~(BUTTONS | TOGGLE_LID);
+    return merged;
+}
+
+void ConsoleInput::Apply(melonDS::NDS& nds) const noexcept {
+    nds.SetKeyMask(~Bits & BUTTONS);
+    if (Touching()) {
+        nds.TouchScreen(TouchX(), TouchY());
+    }
+    else {
+        nds.ReleaseScreen();
     }
 
-    _cursor.Apply(nds);
+    if (ToggleLid()) {
+        nds.SetLidClosed(!nds.IsLidClosed());
+    }
+}
+
+void InputState::LogStats() const noexcept {
+    if (_fullCost.Frames == 0)
+        return;
+
+    retro::debug(
+        "Input processing: {} full frame(s) averaging {} ticks, {} cached frame(s) averaging {} ticks",
+        _fullCost.Frames,
+        _fullCost.Ticks / _fullCost.Frames,
+        _cachedCost.Frames,
+        _cachedCost.Frames ? _cachedCost.Ticks / _cachedCost.Frames : 0
+    );
 }
 
 void InputState::SetConfig(const CoreConfig& config) noexcept {
     ZoneScopedN(TracyFunction);
+    Invalidate();
     _joypad.SetConfig(config);
     _cursor.SetConfig(config);
     _pointer.SetConfig(config);
@@ -178,6 +272,7 @@ void InputState::SetSlot2Input(const melonDS::GBACart::CartCommon& gbacart) noex
             _slot2 = std::monostate(); // "no relevant device"
             break;
     }
+    Invalidate();
 }
 
 void InputState::RumbleStart(std::chrono::milliseconds len) noexcept {
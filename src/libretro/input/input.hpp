@@ -51,7 +51,49 @@ namespace MelonDsDs {
         i16vec2 AnalogCursorDirection;
         i16vec2 PointerPosition;
         bool PointerPressed;
+        bool MouseWheelUp;
+        bool MouseWheelDown;
         retro_perf_tick_t Timestamp;
+
+        /// True if both polls saw the same input, regardless of when they were taken
+        [[nodiscard]] bool SameInput(const InputPollResult& other) const noexcept {
+            return JoypadButtons == other.JoypadButtons
+                && AnalogCursorDirection == other.AnalogCursorDirection
+                && PointerPosition == other.PointerPosition
+                && PointerPressed == other.PointerPressed
+                && MouseWheelUp == other.MouseWheelUp
+                && MouseWheelDown == other.MouseWheelDown;
+        }
+    };
+
+    struct InputStats {
+        uint64_t FullFrames;
+        uint64_t CachedFrames;
+    };
+
+    /// Everything that one frame's input does to the emulated console,
+    /// packed so that netplay peers can exchange it cheaply.
+    struct ConsoleInput {
+        /// Bits 0-11 are pressed buttons in the same order as KEYINPUT and EXTKEYIN,
+        /// bit 12 is set while the screen is touched, and bit 13 toggles the lid.
+        /// Bits 16-23 and 24-31 are the touch position.
+        uint32_t Bits = 0;
+
+        static constexpr uint32_t BUTTONS = 0xFFF;
+        static constexpr uint32_t TOUCHING = 1 << 12;
+        static constexpr uint32_t TOGGLE_LID = 1 << 13;
+
+        [[nodiscard]] bool Touching() const noexcept { return Bits & TOUCHING; }
+        [[nodiscard]] bool ToggleLid() const noexcept { return Bits & TOGGLE_LID; }
+        [[nodiscard]] unsigned TouchX() const noexcept { return (Bits >> 16) & 0xFF; }
+        [[nodiscard]] unsigned TouchY() const noexcept { return (Bits >> 24) & 0xFF; }
+        bool operator==(const ConsoleInput& other) const noexcept { return Bits == other.Bits; }
+        bool operator!=(const ConsoleInput& other) const noexcept { return Bits != other.Bits; }
+
+        /// Combines two players' input. A button is pressed if either player presses it,
+        /// and \c first's touch takes priority over \c second's.
+        [[nodiscard]] static ConsoleInput Merge(ConsoleInput first, ConsoleInput second) noexcept;
+        void Apply(melonDS::NDS& nds) const noexcept;
     };
 
     using Slot2State = std::variant<std::monostate, SolarSensorState, RumbleState>;
@@ -62,7 +104,19 @@ namespace MelonDsDs {
         void SetConfig(const CoreConfig& config) noexcept;
         void Update(const ScreenLayoutData& layout) noexcept;
         void SetSlot2Input(const melonDS::GBACart::CartCommon& gbacart) noexcept;
-        void Apply(melonDS::NDS& nds, ScreenLayoutData& layout, MicrophoneState& mic) const noexcept;
+        void Apply(melonDS::NDS& nds, ScreenLayoutData& layout, MicrophoneState& mic) noexcept;
+
+        /// Like Apply, but leaves the console alone (e.g. because netplay decides what it sees).
+        void ApplyLocal(ScreenLayoutData& layout, MicrophoneState& mic) noexcept;
+
+        /// What the last Update would do to the console, for sharing with netplay peers.
+        [[nodiscard]] ConsoleInput GetConsoleInput() const noexcept;
+
+        /// Forces the next frame's input to be fully processed and applied,
+        /// e.g. because the screen layout changed or the console's state was replaced
+        void Invalidate() noexcept { _dirty = true; }
+        void LogStats() const noexcept;
+        [[nodiscard]] InputStats Stats() const noexcept { return { _fullCost.Frames, _cachedCost.Frames }; }
         [[nodiscard]] bool CursorVisible() const noexcept { return _cursor.CursorVisible(); }
         [[nodiscard]] bool IsTouching() const noexcept { return _cursor.IsTouching(); }
         [[nodiscard]] bool TouchReleased() const noexcept {
@@ -105,5 +159,22 @@ namespace MelonDsDs {
         enum TouchMode _touchMode;
 
         Slot2State _slot2;
+
+        InputPollResult _lastPoll {};
+        bool _dirty = true;
+        // True if the last full update saw the same input as the one before it,
+        // so no edge-triggered action (e.g. toggling the lid) is pending
+        bool _settled = false;
+        // True if the console already has everything this frame's Apply would give it
+        bool _applied = false;
+
+        // Time spent in Update and Apply, split by whether the input was reprocessed
+        struct Cost {
+            uint64_t Frames = 0;
+            retro_perf_tick_t Ticks = 0;
+        };
+        Cost _fullCost {};
+        Cost _cachedCost {};
+        retro_perf_tick_t _frameStart = 0;
     };
 }
@@ -55,6 +55,10 @@ namespace MelonDsDs {
 
         [[nodiscard]] retro_perf_tick_t LastPointerUpdate() const noexcept { return _lastPointerUpdate; }
         [[nodiscard]] bool CycleLayoutPressed() const noexcept { return _cycleLayoutButton && !_previousCycleLayoutButton; }
+        [[nodiscard]] bool ToggleLidPressed() const noexcept { return _toggleLidButton && !_previousToggleLidButton; }
+
+        /// Buttons to send to the DS, active-low as NDS::SetKeyMask expects
+        [[nodiscard]] uint32_t ConsoleButtons() const noexcept { return _consoleButtons; }
         [[nodiscard]] bool MicButtonDown() const noexcept { return _micButton; }
         [[nodiscard]] bool MicButtonPressed() const noexcept { return _micButton && !_previousMicButton; }
         [[nodiscard]] bool MicButtonReleased() const noexcept { return !_micButton && _previousMicButton; }
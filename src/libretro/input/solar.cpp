@@ -21,6 +21,7 @@
 
 #include "config/config.hpp"
 #include "environment.hpp"
+#include "input.hpp"
 #include "joypad.hpp"
 #include "tracy/client.hpp"
 
@@ -67,12 +68,12 @@ SolarSensorState::SolarSensorState(SolarSensorState&& other) noexcept :
     other._lux = std::nullopt;
 }
 
-void SolarSensorState::Update(const JoypadState& joypad) noexcept {
+void SolarSensorState::Update(const JoypadState& joypad, const InputPollResult& poll) noexcept {
     ZoneScopedN(TracyFunction);
     if (_state != InterfaceState::On) {
         // If we're not using the real light sensor...
-        _buttonUp = joypad.LightLevelUpPressed() || (retro::input_state(0, RETRO_DEVICE_MOUSE, 0, RETRO_DEVICE_ID_MOUSE_WHEELUP) != 0);
-        _buttonDown = joypad.LightLevelDownPressed() || (retro::input_state(0, RETRO_DEVICE_MOUSE, 0, RETRO_DEVICE_ID_MOUSE_WHEELDOWN) != 0);
+        _buttonUp = joypad.LightLevelUpPressed() || poll.MouseWheelUp;
+        _buttonDown = joypad.LightLevelDownPressed() || poll.MouseWheelDown;
     }
     else {
         _buttonUp = false;
@@ -28,6 +28,7 @@ namespace melonDS {
 namespace MelonDsDs {
     class CoreConfig;
     class JoypadState;
+    struct InputPollResult;
 
     class SolarSensorState {
     public:
@@ -38,7 +39,7 @@ namespace MelonDsDs {
         SolarSensorState(SolarSensorState&&) noexcept;
         SolarSensorState& operator=(SolarSensorState&&) noexcept;
 
-        void Update(const JoypadState& joypad) noexcept;
+        void Update(const JoypadState& joypad, const InputPollResult& poll) noexcept;
         void SetConfig(const CoreConfig& config) noexcept;
         void Apply(melonDS::NDS& nds) const noexcept;
 
@@ -126,7 +126,8 @@ PUBLIC_SYMBOL void retro_unload_game(void) {
     // No need to flush SRAM to the buffer, Platform::WriteNDSSave has been doing that for us this whole time
     // No need to flush the homebrew save data either, the CartHomebrew destructor does that
 
-    // The cleanup handlers for each task will flush data to disk if needed
+    // The cleanup handlers for each task will hand their data to the unload pipeline,
+    // which writes it to disk on worker threads while the rest of the game is unloaded
     retro::task::reset();
     retro::task::wait();
     retro::task::deinit();
@@ -173,7 +174,7 @@ PUBLIC_SYMBOL void retro_get_system_info(struct retro_system_info *info) {
     info->block_extract = false;
     info->library_version = MELONDSDS_VERSION;
     info->need_fullpath = false;
-    info->valid_extensions = "nds|ids|dsi";
+    info->valid_extensions = "nds|ids|dsi|zip|rzip";
 }
 
 PUBLIC_SYMBOL void retro_reset(void) {
@@ -300,38 +301,48 @@ extern "C" bool MelonDsDs::UpdateOptionVisibility() noexcept {
     return Core.UpdateOptionVisibility();
 }
 
-int Platform::Net_SendPacket(u8* data, int len, void*) {
+int Platform::Net_SendPacket(u8* data, int len, void* userdata) {
     ZoneScopedN(TracyFunction);
+    if (MelonDsDs::IsForkedConsole(userdata))
+        return 0;
 
     return MelonDsDs::Core.LanSendPacket(std::span((std::byte*)data, len));
 }
 
-int Platform::Net_RecvPacket(u8* data, void*) {
+int Platform::Net_RecvPacket(u8* data, void* userdata) {
     ZoneScopedN(TracyFunction);
+    if (MelonDsDs::IsForkedConsole(userdata))
+        return 0;
 
     return MelonDsDs::Core.LanRecvPacket(data);
 }
 
-void Platform::WriteNDSSave(const u8 *savedata, u32 savelen, u32 writeoffset, u32 writelen, void*) {
+void Platform::WriteNDSSave(const u8 *savedata, u32 savelen, u32 writeoffset, u32 writelen, void* userdata) {
     ZoneScopedN(TracyFunction);
+    if (MelonDsDs::IsForkedConsole(userdata))
+        return; // Forks' saves are thrown away
 
     MelonDsDs::Core.WriteNdsSave(span((const std::byte*)savedata, savelen), writeoffset, writelen);
 }
 
-void Platform::WriteGBASave(const u8 *savedata, u32 savelen, u32 writeoffset, u32 writelen, void*) {
+void Platform::WriteGBASave(const u8 *savedata, u32 savelen, u32 writeoffset, u32 writelen, void* userdata) {
     ZoneScopedN(TracyFunction);
+    if (MelonDsDs::IsForkedConsole(userdata))
+        return;
 
     MelonDsDs::Core.WriteGbaSave(span((const std::byte*)savedata, savelen), writeoffset, writelen);
 }
 
-void Platform::WriteFirmware(const Firmware& firmware, u32 writeoffset, u32 writelen, void*) {
+void Platform::WriteFirmware(const Firmware& firmware, u32 writeoffset, u32 writelen, void* userdata) {
     ZoneScopedN(TracyFunction);
+    if (MelonDsDs::IsForkedConsole(userdata))
+        return;
 
     MelonDsDs::Core.WriteFirmware(firmware, writeoffset, writelen);
 }
 
 extern "C" void MelonDsDs::MpStarted(uint16_t client_id, retro_netpacket_send_t send_fn, retro_netpacket_poll_receive_t poll_receive_fn) noexcept {
-    MelonDsDs::Core.MpStarted(send_fn, poll_receive_fn);
+    MelonDsDs::Core.MpStarted(client_id, send_fn, poll_receive_fn);
 }
 
 extern "C" void MelonDsDs::MpReceived(const void* buf, size_t len, uint16_t client_id) noexcept {
@@ -342,6 +353,14 @@ extern "C" void MelonDsDs::MpStopped() noexcept {
     MelonDsDs::Core.MpStopped();
 }
 
+extern "C" bool MelonDsDs::MpConnected(uint16_t client_id) noexcept {
+    return MelonDsDs::Core.MpPeerConnected(client_id);
+}
+
+extern "C" void MelonDsDs::MpDisconnected(uint16_t client_id) noexcept {
+    MelonDsDs::Core.MpPeerDisconnected(client_id);
+}
+
 int DeconstructPacket(u8 *data, u64 *timestamp, const std::optional<MelonDsDs::Packet> &o_p) {
     if (!o_p.has_value()) {
         return 0;
@@ -351,20 +370,29 @@ int DeconstructPacket(u8 *data, u64 *timestamp, const std::optional<MelonDsDs::P
     return o_p->Length();
 }
 
-int Platform::MP_SendPacket(u8* data, int len, u64 timestamp, void*) {
+int Platform::MP_SendPacket(u8* data, int len, u64 timestamp, void* userdata) {
+    if (MelonDsDs::IsForkedConsole(userdata))
+        return 0;
     return MelonDsDs::Core.MpSendPacket(MelonDsDs::Packet(data, len, timestamp, 0, MelonDsDs::Packet::Type::Other)) ? len : 0;
 }
 
-int Platform::MP_RecvPacket(u8* data, u64* timestamp, void*) {
+int Platform::MP_RecvPacket(u8* data, u64* timestamp, void* userdata) {
+    if (MelonDsDs::IsForkedConsole(userdata))
+        return 0;
     std::optional<MelonDsDs::Packet> o_p = MelonDsDs::Core.MpNextPacket();
     return DeconstructPacket(data, timestamp, o_p);
 }
 
-int Platform::MP_SendCmd(u8* data, int len, u64 timestamp, void*) {
+int Platform::MP_SendCmd(u8* data, int len, u64 timestamp, void* userdata) {
+    if (MelonDsDs::IsForkedConsole(userdata))
+        return 0;
     return MelonDsDs::Core.MpSendPacket(MelonDsDs::Packet(data, len, timestamp, 0, MelonDsDs::Packet::Type::Cmd)) ? len : 0;
 }
 
-int Platform::MP_SendReply(u8 *data, int len, u64 timestamp, u16 aid, void*) {
+int Platform::MP_SendReply(u8 *data, int len, u64 timestamp, u16 aid, void* userdata) {
+    if (MelonDsDs::IsForkedConsole(userdata))
+        return 0;
+
     // aid is always less than 16,
     // otherwise sending a 16-bit wide aidmask in RecvReplies wouldn't make sense,
     // and neither would this line[1] from melonDS itself.
@@ -376,17 +404,21 @@ int Platform::MP_SendReply(u8 *data, int len, u64 timestamp, u16 aid, void*) {
     return MelonDsDs::Core.MpSendPacket(MelonDsDs::Packet(data, len, timestamp, aid, MelonDsDs::Packet::Type::Reply)) ? len : 0;
 }
 
-int Platform::MP_SendAck(u8* data, int len, u64 timestamp, void*) {
+int Platform::MP_SendAck(u8* data, int len, u64 timestamp, void* userdata) {
+    if (MelonDsDs::IsForkedConsole(userdata))
+        return 0;
     return MelonDsDs::Core.MpSendPacket(MelonDsDs::Packet(data, len, timestamp, 0, MelonDsDs::Packet::Type::Cmd)) ? len : 0;
 }
 
-int Platform::MP_RecvHostPacket(u8* data, u64 * timestamp, void*) {
+int Platform::MP_RecvHostPacket(u8* data, u64 * timestamp, void* userdata) {
+    if (MelonDsDs::IsForkedConsole(userdata))
+        return 0;
     std::optional<MelonDsDs::Packet> o_p = MelonDsDs::Core.MpNextPacketBlock();
     return DeconstructPacket(data, timestamp, o_p);
 }
 
-u16 Platform::MP_RecvReplies(u8* packets, u64 timestamp, u16 aidmask, void*) {
-    if(!MelonDsDs::Core.MpActive()) {
+u16 Platform::MP_RecvReplies(u8* packets, u64 timestamp, u16 aidmask, void* userdata) {
+    if(MelonDsDs::IsForkedConsole(userdata) || !MelonDsDs::Core.MpActive()) {
         return 0;
     }
     u16 ret = 0;
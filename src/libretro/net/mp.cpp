@@ -15,7 +15,10 @@
 */
 #include "mp.hpp"
 #include "environment.hpp"
-#include <ctime>
+#include "tracy.hpp"
+#include <algorithm>
+#include <cstring>
+#include <thread>
 #include <libretro.h>
 #include <retro_assert.h>
 #include <retro_endianness.h>
@@ -24,25 +27,39 @@ using namespace MelonDsDs;
 // How many successive timeouts before
 // the player gets notified they are not supposed to use a VPN.
 constexpr int SUCCESSIVE_TIMEOUTS_WARNING = 6;
-constexpr long RECV_TIMEOUT_MS = 25;
 
 uint64_t swapToNetwork(uint64_t n) {
     return swap_if_little64(n);
 }
 
+uint32_t swapToNetwork(uint32_t n) {
+    return swap_if_little32(n);
+}
+
+uint16_t swapToNetwork(uint16_t n) {
+    return swap_if_little16(n);
+}
+
 Packet Packet::parsePk(const void *buf, uint64_t len) {
     // Necessary because arithmetic on void* is forbidden
     const char *indexableBuf = (const char *)buf;
     const char *data = indexableBuf + HeaderSize;
     retro_assert(len >= HeaderSize);
     size_t dataLen = len - HeaderSize;
-    uint64_t timestamp = swapToNetwork(*(const uint64_t*)(indexableBuf));
+    // Packets are packed back-to-back within a message, so they may not be aligned
+    uint64_t timestamp;
+    memcpy(&timestamp, indexableBuf, sizeof(timestamp));
+    timestamp = swapToNetwork(timestamp);
     uint8_t aid = *(const uint8_t*)(indexableBuf + 8);
     uint8_t type = *(const uint8_t*)(indexableBuf + 9);
+    uint32_t frame;
+    memcpy(&frame, indexableBuf + 10, sizeof(frame));
+    frame = swapToNetwork(frame);
+    // type 3 means frame sync
     // type 2 means cmd frame
     // type 1 means reply frame
     // type 0 means anything else
-    retro_assert(type == 2 || type == 1 || type == 0);
+    retro_assert(type <= 3);
     Packet::Type pkType;
     switch (type) {
         case 0:
@@ -54,18 +71,23 @@ Packet Packet::parsePk(const void *buf, uint64_t len) {
         case 2:
             pkType = Cmd;
             break;
+        case 3:
+        default:
+            pkType = Sync;
+            break;
     }
-    return Packet(data, dataLen, timestamp, aid, pkType);
+    return Packet(data, dataLen, timestamp, aid, pkType, frame);
 }
 
-Packet::Packet(const void *data, uint64_t len, uint64_t timestamp, uint8_t aid, Packet::Type type) :
+Packet::Packet(const void *data, uint64_t len, uint64_t timestamp, uint8_t aid, Packet::Type type, uint32_t frame) :
     _data((unsigned char*)data, (unsigned char*)data + len),
     _timestamp(timestamp),
     _aid(aid),
-    _type(type){
+    _type(type),
+    _frame(frame) {
 }
 
-std::vector<uint8_t> Packet::ToBuf() const {
+std::vector<uint8_t> Packet::ToBuf(uint32_t frame) const {
     std::vector<uint8_t> ret;
     ret.reserve(HeaderSize + Length());
     uint64_t netTimestamp = swapToNetwork(_timestamp);
@@ -82,8 +104,13 @@ std::vector<uint8_t> Packet::ToBuf() const {
         case Cmd:
             numericalType = 2;
             break;
+        case Sync:
+            numericalType = 3;
+            break;
     }
     ret.push_back(numericalType);
+    uint32_t netFrame = swapToNetwork(frame);
+    ret.insert(ret.end(), (const char *)&netFrame, ((const char *)&netFrame) + sizeof(uint32_t));
     ret.insert(ret.end(), _data.begin(), _data.end());
     return ret;
 }
@@ -105,7 +132,74 @@ void MpState::SetPollFn(retro_netpacket_poll_receive_t pollFn) noexcept {
 
 void MpState::PacketReceived(const void *buf, size_t len, uint16_t client_id) noexcept {
     retro_assert(IsReady());
+    const uint8_t* bytes = static_cast<const uint8_t*>(buf);
+    if (len < 1) {
+        retro::warn("Ignoring empty multiplayer message from client {}", client_id);
+        return;
+    }
+
+    if (len < MESSAGE_HEADER_SIZE
+        || memcmp(bytes, PROTOCOL_MAGIC.data(), PROTOCOL_MAGIC.size()) != 0
+        || bytes[PROTOCOL_MAGIC.size()] != PROTOCOL_VERSION) {
+        // If this message came from a different version of melonDS DS (or something else entirely)...
+        _traffic.MessagesRejected++;
+        RejectPeer(client_id);
+        return;
+    }
+
+    if (_incompatiblePeers.count(client_id)) {
+        // A peer that sent us something unreadable may not get its frames in sync with ours
+        _traffic.MessagesRejected++;
+        return;
+    }
+
+    _traffic.MessagesReceived++;
+    uint8_t count = bytes[PACKET_COUNT_OFFSET];
+    size_t offset = MESSAGE_HEADER_SIZE;
+    for (uint8_t i = 0; i < count; ++i) {
+        uint16_t packetLength;
+        if (offset + sizeof(packetLength) > len) {
+            retro::warn("Multiplayer message from client {} was cut off after {} of {} packets", client_id, i, count);
+            return;
+        }
+        memcpy(&packetLength, bytes + offset, sizeof(packetLength));
+        packetLength = swapToNetwork(packetLength);
+        offset += sizeof(packetLength);
+
+        if (offset + packetLength > len) {
+            retro::warn("Multiplayer message from client {} was cut off after {} of {} packets", client_id, i, count);
+            return;
+        }
+
+        ReceivePacket(bytes + offset, packetLength, client_id);
+        offset += packetLength;
+    }
+}
+
+void MpState::RejectPeer(uint16_t clientId) noexcept {
+    if (!_incompatiblePeers.insert(clientId).second)
+        return;
+
+    retro::warn("Multiplayer client {} is using an incompatible version of melonDS DS, ignoring it", clientId);
+    retro::set_warn_message("Another player is using an incompatible version of melonDS DS. Everyone must use the same version.");
+
+    // Don't hold our frames back for a peer that we can't hear
+    _peers.erase(clientId);
+}
+
+void MpState::ReceivePacket(const void *buf, size_t len, uint16_t client_id) noexcept {
+    if (len < HeaderSize) {
+        retro::warn("Ignoring {}-byte multiplayer packet from client {}; is the other player using an older version?", len, client_id);
+        return;
+    }
     Packet p = Packet::parsePk(buf, len);
+    UpdatePeer(client_id, p.Frame());
+    _peers[client_id].PacketsReceived++; // UpdatePeer just made sure this peer exists
+    _traffic.PacketsReceived++;
+    if (p.PacketType() == Packet::Type::Sync) {
+        // Sync packets are only for us, melonDS doesn't need to see them
+        return;
+    }
     if(p.PacketType() == Packet::Type::Cmd) {
         _hostId = client_id;
         //retro::debug("Host client id is {}", client_id);
@@ -116,8 +210,7 @@ void MpState::PacketReceived(const void *buf, size_t len, uint16_t client_id) no
 std::optional<Packet> MpState::NextPacket() noexcept {
     retro_assert(IsReady());
     if(receivedPackets.empty()) {
-        _sendFn(RETRO_NETPACKET_FLUSH_HINT, NULL, 0, RETRO_NETPACKET_BROADCAST);
-        _pollFn();
+        Poll();
     }
     if(receivedPackets.empty()) {
         return std::nullopt;
@@ -131,17 +224,30 @@ std::optional<Packet> MpState::NextPacket() noexcept {
 
 std::optional<Packet> MpState::NextPacketBlock() noexcept {
     retro_assert(IsReady());
-    if (receivedPackets.empty()) {
-        for(std::clock_t start = std::clock(); std::clock() < (start + (RECV_TIMEOUT_MS * CLOCKS_PER_SEC / 1000));) {
-            _sendFn(RETRO_NETPACKET_FLUSH_HINT, NULL, 0, RETRO_NETPACKET_BROADCAST);
-            _pollFn();
-            if(!receivedPackets.empty()) {
-                return NextPacket();
-            }
-        }
-    } else {
+    if (!receivedPackets.empty()) {
         return NextPacket();
     }
+
+    for (clock::time_point start = clock::now(); clock::now() - start < MAX_BLOCK_TIME;) {
+        Poll();
+        if(!receivedPackets.empty()) {
+            return NextPacket();
+        }
+
+        // A peer that's still on this frame (or behind it) may yet send us something,
+        // so keep waiting while that's true; this lets a peer that's catching up
+        // (or fast-forwarding) set the pace. If we don't know where the other peers are yet,
+        // wait out the whole timeout.
+        std::optional<int64_t> slowest = SlowestPeerFrame();
+        if (slowest && *slowest > int64_t(_frame)) {
+            // If every peer has already finished this frame, nothing more is coming
+            break;
+        }
+
+        // Don't hog a core that the other peer (or the frontend) may need
+        std::this_thread::yield();
+    }
+
     _timeoutCount++;
     if (_timeoutCount >= SUCCESSIVE_TIMEOUTS_WARNING && !_warnedHighLatency) {
         retro::set_warn_message("LAN Multiplayer will NOT work using VPNs or tunnels such as Hamachi!");
@@ -151,6 +257,219 @@ std::optional<Packet> MpState::NextPacketBlock() noexcept {
     return std::nullopt;
 }
 
+void MpState::Poll() noexcept {
+    // If we're looking for a packet, another peer may be waiting on one of ours
+    Flush(true);
+    _traffic.Polls++;
+    _pollFn();
+}
+
+void MpState::Flush(bool awaitingReply) noexcept {
+    for (auto& [dest, batch] : _outgoing) {
+        if (!batch.empty()) {
+            FlushBatch(dest, batch, awaitingReply);
+        }
+    }
+}
+
+void MpState::FlushBatch(uint16_t dest, std::vector<uint8_t>& batch, bool awaitingReply) noexcept {
+    // Sent unreliably like individual packets were, since a reliable channel would hold up
+    // everything behind a lost message; the emulated wireless protocol already copes with
+    // lost packets, and a lost Sync only matters until the peer's next message
+    // (every packet carries its sender's frame number)
+    int flags = RETRO_NETPACKET_UNSEQUENCED | RETRO_NETPACKET_UNRELIABLE;
+    if (awaitingReply) {
+        flags |= RETRO_NETPACKET_FLUSH_HINT;
+        _traffic.FlushHints++;
+    }
+
+    _sendFn(flags, batch.data(), batch.size(), dest);
+    _traffic.MessagesSent++;
+    batch.clear();
+}
+
+void MpState::UpdatePeer(uint16_t clientId, uint32_t frame) noexcept {
+    clock::time_point now = clock::now();
+    auto [it, inserted] = _peers.try_emplace(clientId, PeerState {frame, now});
+    if (inserted) {
+        if (frame > _frame) {
+            // If this peer has been running for longer than we have, count frames from where it is,
+            // so that every peer's frame numbers mean the same thing
+            // (a fixed offset measured from the first packet would be off by however long it was in flight)
+            retro::info("Synchronizing frames with multiplayer client {}, skipping ahead to its frame {}", clientId, frame);
+            _frame = frame;
+        }
+        else {
+            retro::info("Synchronizing frames with multiplayer client {}", clientId);
+        }
+
+        // Tell the new peer where we are, in case we're waiting for it and won't finish a frame for a while
+        SendPacket(Packet(nullptr, 0, 0, 0, Packet::Type::Sync));
+        return;
+    }
+
+    // Unreliable packets may arrive out of order
+    it->second.Frame = std::max(it->second.Frame, frame);
+    it->second.LastHeard = now;
+}
+
+void MpState::PeerDisconnected(uint16_t clientId) noexcept {
+    _incompatiblePeers.erase(clientId);
+    if (_peers.erase(clientId)) {
+        retro::info("Multiplayer client {} disconnected, no longer synchronizing with it", clientId);
+    }
+}
+
+void MpState::DropSilentPeers() noexcept {
+    clock::time_point now = clock::now();
+    for (auto it = _peers.begin(); it != _peers.end();) {
+        if (now - it->second.LastHeard > PEER_TIMEOUT) {
+            retro::warn("Haven't heard from multiplayer client {} in a while, no longer waiting for it", it->first);
+            it = _peers.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+std::optional<int64_t> MpState::SlowestPeerFrame() const noexcept {
+    std::optional<int64_t> slowest;
+    for (const auto& [id, peer] : _peers) {
+        if (!slowest || peer.Frame < *slowest) {
+            slowest = peer.Frame;
+        }
+    }
+
+    return slowest;
+}
+
+std::optional<int64_t> MpState::FastestPeerFrame() const noexcept {
+    std::optional<int64_t> fastest;
+    for (const auto& [id, peer] : _peers) {
+        if (!fastest || peer.Frame > *fastest) {
+            fastest = peer.Frame;
+        }
+    }
+
+    return fastest;
+}
+
+bool MpState::BeginFrame() noexcept {
+    ZoneScopedN(TracyFunction);
+    if (!IsReady())
+        return true;
+
+    Poll();
+
+    auto tooFarAhead = [this] {
+        std::optional<int64_t> slowest = SlowestPeerFrame();
+        return slowest && int64_t(_frame) - *slowest >= MAX_FRAME_LEAD;
+    };
+
+    if (tooFarAhead()) {
+        // If we're too far ahead of the slowest peer, give it a little time to catch up...
+        clock::time_point start = clock::now();
+        bool waiting;
+        do {
+            // ...without hogging a core that the other peer (or the frontend) may need
+            std::this_thread::yield();
+            Poll();
+            DropSilentPeers();
+            waiting = tooFarAhead();
+        } while (waiting && clock::now() - start < MAX_STALL_TIME);
+
+        _stalls++;
+        _stallTime += clock::now() - start;
+        if (waiting) {
+            // ...but if it needs longer than that, skip this frame and check again on the next one
+            _deferredFrames++;
+            return false;
+        }
+    }
+
+    std::optional<int64_t> fastest = FastestPeerFrame();
+    bool behind = fastest && *fastest - int64_t(_frame) > 1;
+    if (behind && !_catchUpStart) {
+        // If another peer has gotten ahead of us (e.g. because we stalled)...
+        _catchUpStart = clock::now();
+    }
+    else if (!behind && _catchUpStart) {
+        // If we've caught up...
+        clock::duration elapsed = clock::now() - *_catchUpStart;
+        _catchUps++;
+        _catchUpTime += elapsed;
+        _longestCatchUp = std::max(_longestCatchUp, elapsed);
+        _catchUpStart = std::nullopt;
+        retro::debug("Caught up with the other multiplayer peers in {}ms", std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+    }
+
+    return true;
+}
+
+void MpState::EndFrame() noexcept {
+    ZoneScopedN(TracyFunction);
+    _frame++;
+    if (!IsReady())
+        return;
+
+    // The other peers can't start their next frame too far ahead of us until they get this,
+    // so send it (and anything else left over from this frame) right away
+    SendPacket(Packet(nullptr, 0, 0, 0, Packet::Type::Sync));
+    Flush(true);
+}
+
+void MpState::Reset() noexcept {
+    _peers.clear();
+    _incompatiblePeers.clear();
+    _hostId = std::nullopt;
+    receivedPackets = {};
+    _outgoing.clear();
+    _frame = 0;
+    _traffic = {};
+    _trafficStart = clock::now();
+    _stalls = 0;
+    _deferredFrames = 0;
+    _stallTime = {};
+    _catchUps = 0;
+    _catchUpTime = {};
+    _longestCatchUp = {};
+    _catchUpStart = std::nullopt;
+}
+
+void MpState::LogStats() const noexcept {
+    using std::chrono::duration_cast;
+    using std::chrono::milliseconds;
+
+    double seconds = std::chrono::duration<double>(clock::now() - _trafficStart).count();
+    if (_traffic.PacketsSent > 0 && seconds > 0) {
+        retro::info(
+            "Multiplayer traffic: sent {:.1f} packets/s in {:.1f} messages/s with {:.1f} flush hints/s; polled {:.1f} times/s",
+            _traffic.PacketsSent / seconds,
+            _traffic.MessagesSent / seconds,
+            _traffic.FlushHints / seconds,
+            _traffic.Polls / seconds
+        );
+
+        for (const auto& [id, peer] : _peers) {
+            retro::info("Multiplayer traffic: received {:.1f} packets/s from client {}", peer.PacketsReceived / seconds, id);
+        }
+    }
+
+    if (_stalls == 0 && _catchUps == 0)
+        return;
+
+    retro::info(
+        "Multiplayer sync: waited for slower peers {} time(s) ({}ms total, {} frame(s) deferred); caught up {} time(s) ({}ms average, {}ms longest)",
+        _stalls,
+        duration_cast<milliseconds>(_stallTime).count(),
+        _deferredFrames,
+        _catchUps,
+        _catchUps ? duration_cast<milliseconds>(_catchUpTime).count() / int64_t(_catchUps) : 0,
+        duration_cast<milliseconds>(_longestCatchUp).count()
+    );
+}
+
 void MpState::SendPacket(const Packet &p) noexcept {
     retro_assert(IsReady());
     uint16_t dest = RETRO_NETPACKET_BROADCAST;
@@ -160,7 +479,32 @@ void MpState::SendPacket(const Packet &p) noexcept {
     if(p.PacketType() == Packet::Type::Reply && _hostId.has_value()) {
         dest = _hostId.value();
     }
-    _sendFn(RETRO_NETPACKET_UNSEQUENCED | RETRO_NETPACKET_UNRELIABLE | RETRO_NETPACKET_FLUSH_HINT, p.ToBuf().data(), p.Length() + HeaderSize, dest);
+    std::vector<uint8_t> packet = p.ToBuf(_frame);
+    retro_assert(packet.size() <= UINT16_MAX);
+
+    std::vector<uint8_t>& batch = _outgoing[dest];
+    if (!batch.empty() && (batch.size() + sizeof(uint16_t) + packet.size() > MAX_BATCH_SIZE || batch[PACKET_COUNT_OFFSET] == UINT8_MAX)) {
+        // If this packet won't fit in the pending batch, send that batch first
+        FlushBatch(dest, batch, false);
+    }
+
+    if (batch.empty()) {
+        batch.reserve(MAX_BATCH_SIZE);
+        batch.insert(batch.end(), PROTOCOL_MAGIC.begin(), PROTOCOL_MAGIC.end());
+        batch.push_back(PROTOCOL_VERSION);
+        batch.push_back(0);
+    }
+
+    batch[PACKET_COUNT_OFFSET]++;
+    uint16_t netLength = swapToNetwork(static_cast<uint16_t>(packet.size()));
+    batch.insert(batch.end(), (const uint8_t *)&netLength, ((const uint8_t *)&netLength) + sizeof(uint16_t));
+    batch.insert(batch.end(), packet.begin(), packet.end());
+    _traffic.PacketsSent++;
+
+    if (p.PacketType() == Packet::Type::Reply) {
+        // The host is blocked until it gets every client's reply, so don't hold this one back
+        FlushBatch(dest, batch, true);
+    }
 }
 
 
@@ -14,24 +14,29 @@
     with melonDS DS. If not, see http://www.gnu.org/licenses/.
 */
 #pragma once
+#include <array>
+#include <chrono>
 #include <cstdint>
 #include <queue>
 #include <optional>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <libretro.h>
 
 namespace MelonDsDs {
-// timestamp, aid, and isReply, respectively.
-constexpr size_t HeaderSize = sizeof(uint64_t) + sizeof(uint8_t) + sizeof(uint8_t);
+// timestamp, aid, isReply, and the sender's frame number, respectively.
+constexpr size_t HeaderSize = sizeof(uint64_t) + sizeof(uint8_t) + sizeof(uint8_t) + sizeof(uint32_t);
 
 class Packet {
 public:
     enum Type {
-        Reply, Cmd, Other
+        // Sync packets carry no data; they only tell the other peers which frame the sender has finished
+        Reply, Cmd, Other, Sync
     };
 
     static Packet parsePk(const void *buf, uint64_t len);
-    explicit Packet(const void *data, uint64_t len, uint64_t timestamp, uint8_t aid, Packet::Type type);
+    explicit Packet(const void *data, uint64_t len, uint64_t timestamp, uint8_t aid, Packet::Type type, uint32_t frame = 0);
 
     [[nodiscard]] uint64_t Timestamp() const noexcept {
         return _timestamp;
@@ -48,17 +53,35 @@ public:
     [[nodiscard]] uint64_t Length() const noexcept {
         return _data.size();
     };
+    [[nodiscard]] uint32_t Frame() const noexcept {
+        return _frame;
+    }
 
-    std::vector<uint8_t> ToBuf() const;
+    std::vector<uint8_t> ToBuf(uint32_t frame) const;
 private:
     uint64_t _timestamp;
     uint8_t _aid;
     Packet::Type _type;
+    uint32_t _frame;
     std::vector<uint8_t> _data;
 };
 
+/// Counts of what MpState asked the frontend's netpacket interface to do.
+struct MpTraffic {
+    uint64_t PacketsSent = 0;
+    /// Calls to the send function with data; each may carry several packets
+    uint64_t MessagesSent = 0;
+    uint64_t FlushHints = 0;
+    uint64_t Polls = 0;
+    uint64_t PacketsReceived = 0;
+    uint64_t MessagesReceived = 0;
+    /// Messages dropped because they came from an incompatible version of the core
+    uint64_t MessagesRejected = 0;
+};
+
 class MpState {
 public:
+    /// Unpacks a batch of packets sent by another peer's MpState.
     void PacketReceived(const void *buf, size_t len, uint16_t client_id) noexcept;
     void SetSendFn(retro_netpacket_send_t sendFn) noexcept;
     void SetPollFn(retro_netpacket_poll_receive_t pollFn) noexcept;
@@ -66,12 +89,90 @@ public:
     void SendPacket(const Packet &p) noexcept;
     std::optional<Packet> NextPacket() noexcept;
     std::optional<Packet> NextPacketBlock() noexcept;
+
+    /// Waits (briefly) until this peer is no more than MAX_FRAME_LEAD frames ahead of the slowest peer.
+    /// Call before running each frame.
+    /// @returns false if we're still too far ahead, in which case the frame shouldn't run yet.
+    bool BeginFrame() noexcept;
+
+    /// Tells the other peers that this frame is finished. Call after running each frame.
+    void EndFrame() noexcept;
+    void PeerDisconnected(uint16_t clientId) noexcept;
+    void Reset() noexcept;
+    void LogStats() const noexcept;
+    [[nodiscard]] const MpTraffic& Traffic() const noexcept { return _traffic; }
 private:
+    using clock = std::chrono::steady_clock;
+
+    // How many frames a peer may run ahead of the slowest one before it waits
+    static constexpr uint32_t MAX_FRAME_LEAD = 4;
+
+    // A peer that hasn't sent anything in this long is assumed to be gone
+    static constexpr std::chrono::milliseconds PEER_TIMEOUT {5000};
+
+    // Longest that BeginFrame waits for slower peers before giving up on this frame;
+    // well under a frame, so the frontend stays responsive while we wait
+    static constexpr std::chrono::milliseconds MAX_STALL_TIME {4};
+
+    // Upper bound on waiting for a single packet, in case a peer stalls without disconnecting;
+    // melonDS calls NextPacketBlock several times per frame, so keep this short
+    static constexpr std::chrono::milliseconds MAX_BLOCK_TIME {25};
+
+    // Outgoing packets are batched into messages no bigger than this,
+    // so that a batch fits in one datagram on typical networks
+    static constexpr size_t MAX_BATCH_SIZE = 1200;
+
+    // Every message starts with these, so that peers running an incompatible build can be told apart
+    static constexpr std::array<uint8_t, 3> PROTOCOL_MAGIC {'M', 'D', 'S'};
+    // Bump this whenever the message or packet layout changes
+    static constexpr uint8_t PROTOCOL_VERSION = 2;
+    // The magic, the version, then the number of packets in the message
+    static constexpr size_t MESSAGE_HEADER_SIZE = PROTOCOL_MAGIC.size() + 2;
+    static constexpr size_t PACKET_COUNT_OFFSET = MESSAGE_HEADER_SIZE - 1;
+
+    struct PeerState {
+        // Peers agree on frame numbers, since a newly-connected peer skips ahead to match the others
+        uint32_t Frame;
+        clock::time_point LastHeard;
+        uint64_t PacketsReceived = 0;
+    };
+
+    void ReceivePacket(const void *buf, size_t len, uint16_t clientId) noexcept;
+    void RejectPeer(uint16_t clientId) noexcept;
+
+    /// Sends every batched packet.
+    /// @param awaitingReply If true, also asks the frontend to send them right away,
+    /// since we're about to wait for a response.
+    void Flush(bool awaitingReply) noexcept;
+    void FlushBatch(uint16_t dest, std::vector<uint8_t>& batch, bool awaitingReply) noexcept;
+    void Poll() noexcept;
+    void UpdatePeer(uint16_t clientId, uint32_t frame) noexcept;
+    void DropSilentPeers() noexcept;
+    [[nodiscard]] std::optional<int64_t> SlowestPeerFrame() const noexcept;
+    [[nodiscard]] std::optional<int64_t> FastestPeerFrame() const noexcept;
+
     bool _warnedHighLatency = false;
     int _timeoutCount = 0;
     retro_netpacket_send_t _sendFn;
     retro_netpacket_poll_receive_t _pollFn;
     std::optional<uint16_t> _hostId;
     std::queue<Packet> receivedPackets;
+    std::unordered_map<uint16_t, PeerState> _peers;
+    // Peers whose messages we can't read, and whose frames we therefore don't wait for
+    std::unordered_set<uint16_t> _incompatiblePeers;
+    // Packets waiting to be sent, by destination; each starts with a header, then length-prefixed packets
+    std::unordered_map<uint16_t, std::vector<uint8_t>> _outgoing;
+    uint32_t _frame = 0;
+
+    MpTraffic _traffic {};
+    clock::time_point _trafficStart = clock::now();
+
+    uint64_t _stalls = 0;
+    uint64_t _deferredFrames = 0;
+    clock::duration _stallTime {};
+    uint64_t _catchUps = 0;
+    clock::duration _catchUpTime {};
+    clock::duration _longestCatchUp {};
+    std::optional<clock::time_point> _catchUpStart;
 };
 }
@@ -0,0 +1,518 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#include "rollback.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include <NDS.h>
+
+#include "environment.hpp"
+#include "tracy.hpp"
+
+using std::optional;
+using std::span;
+
+namespace {
+    void WriteU32(std::vector<uint8_t>& out, uint32_t value) noexcept {
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    uint32_t ReadU32(span<const uint8_t> in, size_t offset) noexcept {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= uint32_t(in[offset + i]) << (i * 8);
+        }
+        return value;
+    }
+}
+
+void MelonDsDs::RollbackNetplay::Start(
+    uint16_t clientId,
+    retro_netpacket_send_t sendFn,
+    retro_netpacket_poll_receive_t pollFn,
+    unsigned maxRollback
+) noexcept {
+    ZoneScopedN(TracyFunction);
+    _sendFn = sendFn;
+    _pollFn = pollFn;
+    _clientId = clientId;
+    _maxRollback = std::clamp(maxRollback, 1u, MAX_ROLLBACK);
+    _frame = 0;
+    _inputs.clear();
+    _inputs[_clientId] = {};
+    _mispredictedFrame = std::nullopt;
+    _snapshots.assign(_maxRollback + 1, {});
+    _pendingJoin = std::nullopt;
+    _awaitingState = clientId != 0;
+    _incomingState.clear();
+    _incomingStateReceived = 0;
+    _incomingStateFrame = std::nullopt;
+    _failedStates = 0;
+    _stats = {};
+    _resimulationTime = {};
+    _snapshotTime = {};
+
+    retro::info(
+        "Starting rollback netplay as {} (up to {} frame(s) of rollback)",
+        clientId == 0 ? "the host" : "a client",
+        _maxRollback
+    );
+}
+
+void MelonDsDs::RollbackNetplay::Stop() noexcept {
+    ZoneScopedN(TracyFunction);
+    _sendFn = nullptr;
+    _pollFn = nullptr;
+    _inputs.clear();
+    _pendingJoin = std::nullopt;
+    _awaitingState = false;
+
+    // Snapshots are several megabytes each
+    _snapshots.clear();
+    _snapshots.shrink_to_fit();
+    _incomingState.clear();
+    _incomingState.shrink_to_fit();
+}
+
+void MelonDsDs::RollbackNetplay::PacketReceived(const void* buf, size_t len, uint16_t clientId) noexcept {
+    ZoneScopedN(TracyFunction);
+    if (!buf || len == 0)
+        return;
+
+    span<const uint8_t> message(static_cast<const uint8_t*>(buf), len);
+    switch (static_cast<MessageType>(message[0])) {
+        case MessageType::Input:
+            ReceiveInput(message, clientId);
+            break;
+        case MessageType::State:
+            ReceiveState(message);
+            break;
+        case MessageType::StateRequest:
+            ReceiveStateRequest(clientId);
+            break;
+        default:
+            retro::warn("Ignoring unknown rollback netplay message {} from client {}", message[0], clientId);
+            break;
+    }
+}
+
+bool MelonDsDs::RollbackNetplay::PeerConnected(uint16_t clientId) noexcept {
+    if (_clientId != 0)
+        return true; // Only the host decides who joins
+
+    if (_pendingJoin || _inputs.size() > 1) {
+        retro::warn("Rollback netplay supports two players; turning away client {}", clientId);
+        return false;
+    }
+
+    retro::info("Client {} joined; sending it the console's state before the next frame", clientId);
+    _pendingJoin = clientId;
+    return true;
+}
+
+void MelonDsDs::RollbackNetplay::PeerDisconnected(uint16_t clientId) noexcept {
+    if (_pendingJoin == clientId) {
+        _pendingJoin = std::nullopt;
+    }
+
+    if (clientId != _clientId && _inputs.erase(clientId)) {
+        retro::info("Client {} left rollback netplay at frame {}", clientId, _frame);
+    }
+}
+
+bool MelonDsDs::RollbackNetplay::Prepare(melonDS::NDS& nds) noexcept {
+    ZoneScopedN(TracyFunction);
+    if (_pollFn) {
+        _pollFn();
+    }
+
+    if (_awaitingState) {
+        if (!_incomingStateFrame || _incomingStateReceived < _incomingState.size())
+            return false;
+
+        melonDS::Savestate state(_incomingState.data(), _incomingState.size(), false);
+        if (!nds.DoSavestate(&state) || state.Error) {
+            _incomingStateFrame = std::nullopt;
+            _incomingStateReceived = 0;
+            if (++_failedStates >= MAX_STATE_ATTEMPTS) {
+                // If the host's state is never going to load (e.g. it's using a different game or version)...
+                retro::error("Failed to load the host's state {} times, stopping rollback netplay", _failedStates);
+                retro::set_error_message("Couldn't load the host's console state. Make sure everyone is using the same game and version of melonDS DS.");
+                Stop();
+                return false;
+            }
+
+            retro::error("Failed to load the host's state; asking for it again");
+            const uint8_t request[] { static_cast<uint8_t>(MessageType::StateRequest) };
+            Send(request, 0, true);
+            return false;
+        }
+
+        retro::info("Loaded the host's {}KiB state at frame {}", _incomingState.size() / 1024, _frame);
+        _awaitingState = false;
+        _incomingState.clear();
+        _incomingState.shrink_to_fit();
+    }
+
+    if (_pendingJoin) {
+        // The joining client starts from the console as it is right now,
+        // which is exact since we haven't had to predict anyone's input yet
+        SendState(nds, *_pendingJoin);
+        _pendingJoin = std::nullopt;
+    }
+
+    if (optional<uint32_t> oldest = OldestUnconfirmedFrame(); oldest && _frame >= *oldest + _maxRollback) {
+        // If we ran this frame, a late input could force a rollback deeper than we keep snapshots for
+        _stats.Stalls++;
+        return false;
+    }
+
+    return true;
+}
+
+void MelonDsDs::RollbackNetplay::BeginFrame(melonDS::NDS& nds, ConsoleInput local) noexcept {
+    ZoneScopedN(TracyFunction);
+
+    // Our own input goes out first, so that the other peer has to predict as little as possible
+    PeerInputs& self = _inputs[_clientId];
+    SendInput(local, local != self.Last || std::exchange(_resendInput, false));
+    self.Inputs[_frame % HISTORY] = local;
+    self.Last = local;
+    self.Confirmed = _frame + 1;
+
+    if (_mispredictedFrame) {
+        Rollback(nds);
+    }
+
+    if (NeedsSnapshot(_frame)) {
+        SaveSnapshot(nds, _frame);
+    }
+
+    ApplyInput(nds, _frame);
+    _frame++;
+    _stats.Frames++;
+}
+
+void MelonDsDs::RollbackNetplay::Settle(melonDS::NDS& nds) noexcept {
+    ZoneScopedN(TracyFunction);
+    if (_pollFn) {
+        _pollFn();
+    }
+
+    if (_mispredictedFrame) {
+        Rollback(nds);
+    }
+}
+
+void MelonDsDs::RollbackNetplay::Send(span<const uint8_t> message, uint16_t dest, bool flush) noexcept {
+    if (!_sendFn)
+        return;
+
+    int flags = RETRO_NETPACKET_RELIABLE;
+    if (flush) {
+        flags |= RETRO_NETPACKET_FLUSH_HINT;
+    }
+
+    _sendFn(flags, message.data(), message.size(), dest);
+}
+
+void MelonDsDs::RollbackNetplay::SendInput(ConsoleInput input, bool changed) noexcept {
+    // Most frames' input is the same as the last frame's, so then only the frame number is sent
+    std::vector<uint8_t> message;
+    message.reserve(10);
+    message.push_back(static_cast<uint8_t>(MessageType::Input));
+    WriteU32(message, _frame);
+    message.push_back(changed);
+    if (changed) {
+        WriteU32(message, input.Bits);
+    }
+
+    // Input is what the other peer is waiting on, so don't let the frontend sit on it
+    Send(message, RETRO_NETPACKET_BROADCAST, true);
+}
+
+bool MelonDsDs::RollbackNetplay::SendState(melonDS::NDS& nds, uint16_t clientId) noexcept {
+    ZoneScopedN(TracyFunction);
+    melonDS::Savestate state;
+    if (!nds.DoSavestate(&state) || state.Error) {
+        retro::error("Failed to save the console's state for client {}", clientId);
+        return false;
+    }
+
+    const uint8_t* data = static_cast<const uint8_t*>(state.Buffer());
+    uint32_t total = state.Length();
+    std::vector<uint8_t> message;
+    for (uint32_t offset = 0; offset < total; offset += STATE_CHUNK_SIZE) {
+        uint32_t length = std::min<uint32_t>(STATE_CHUNK_SIZE, total - offset);
+        message.clear();
+        message.push_back(static_cast<uint8_t>(MessageType::State));
+        WriteU32(message, _frame);
+        WriteU32(message, total);
+        WriteU32(message, offset);
+        message.insert(message.end(), data + offset, data + offset + length);
+        Send(message, clientId, offset + length == total);
+    }
+
+    AddPeer(clientId, _frame);
+    _resendInput = true;
+    retro::info("Sent the console's {}KiB state to client {} at frame {}", total / 1024, clientId, _frame);
+    return true;
+}
+
+void MelonDsDs::RollbackNetplay::ReceiveInput(span<const uint8_t> message, uint16_t clientId) noexcept {
+    if (message.size() < 6) {
+        retro::warn("Ignoring a truncated input message from client {}", clientId);
+        return;
+    }
+
+    auto it = _inputs.find(clientId);
+    if (clientId == _clientId || it == _inputs.end()) {
+        // If this is from before we joined (or from someone we don't know about)...
+        return;
+    }
+
+    uint32_t frame = ReadU32(message, 1);
+    bool changed = message[5] != 0;
+    PeerInputs& peer = it->second;
+    if (frame < peer.Confirmed)
+        return;
+
+    if (frame > peer.Confirmed) {
+        // Input arrives reliably and in order, so this shouldn't happen;
+        // treat the missing frames as unchanged, which is also what we predicted for them
+        retro::warn("Client {} skipped input for frames {} to {}", clientId, peer.Confirmed, frame - 1);
+        ConsoleInput unchanged { peer.Last.Bits & ~ConsoleInput::TOGGLE_LID };
+        for (uint32_t f = peer.Confirmed; f < frame; ++f) {
+            if (f < _frame && peer.Inputs[f % HISTORY] != unchanged) {
+                _mispredictedFrame = std::min(_mispredictedFrame.value_or(f), f);
+            }
+            peer.Inputs[f % HISTORY] = unchanged;
+        }
+    }
+
+    ConsoleInput input = peer.Last;
+    if (changed && message.size() >= 10) {
+        input.Bits = ReadU32(message, 6);
+    }
+
+    if (frame < _frame && peer.Inputs[frame % HISTORY] != input) {
+        // If we already ran this frame with a different guess...
+        _mispredictedFrame = std::min(_mispredictedFrame.value_or(frame), frame);
+    }
+
+    peer.Inputs[frame % HISTORY] = input;
+    peer.Last = input;
+    peer.Confirmed = frame + 1;
+}
+
+void MelonDsDs::RollbackNetplay::ReceiveState(span<const uint8_t> message) noexcept {
+    ZoneScopedN(TracyFunction);
+    if (message.size() < 13 || !_awaitingState)
+        return;
+
+    uint32_t frame = ReadU32(message, 1);
+    uint32_t total = ReadU32(message, 5);
+    uint32_t offset = ReadU32(message, 9);
+    span<const uint8_t> data = message.subspan(13);
+
+    if (total == 0 || total > MAX_STATE_SIZE) {
+        retro::warn("Ignoring a chunk of a {}-byte state, which is too big to have come from a compatible peer", total);
+        return;
+    }
+
+    if (size_t{offset} + data.size() > total) {
+        retro::warn("Ignoring a state chunk at offset {} that doesn't fit a {}-byte state", offset, total);
+        return;
+    }
+
+    if (_incomingStateFrame != frame) {
+        // If this is the first chunk of a new state...
+        _incomingStateFrame = frame;
+        _incomingState.assign(total, 0);
+        _incomingStateReceived = 0;
+    }
+    else if (total != _incomingState.size()) {
+        retro::warn("Ignoring a state chunk for frame {} that disagrees about the state's size ({} vs. {} bytes)", frame, total, _incomingState.size());
+        return;
+    }
+
+    memcpy(_incomingState.data() + offset, data.data(), data.size());
+    _incomingStateReceived += data.size();
+    if (_incomingStateReceived == _incomingState.size()) {
+        // From now on, frame numbers are the host's
+        _frame = frame;
+        _inputs.clear();
+        _inputs[_clientId].Confirmed = frame;
+        AddPeer(0, frame);
+    }
+}
+
+void MelonDsDs::RollbackNetplay::ReceiveStateRequest(uint16_t clientId) noexcept {
+    if (_clientId != 0 || clientId == _clientId || !_inputs.count(clientId))
+        return; // Only the host sends its state, and only to peers that it already let in
+
+    retro::info("Client {} couldn't load the console's state; sending it again before the next frame", clientId);
+    _pendingJoin = clientId;
+}
+
+void MelonDsDs::RollbackNetplay::AddPeer(uint16_t clientId, uint32_t frame) noexcept {
+    // Until its input arrives, the new peer is assumed to press nothing
+    PeerInputs& peer = _inputs[clientId];
+    peer = {};
+    peer.Confirmed = frame;
+}
+
+void MelonDsDs::RollbackNetplay::Rollback(melonDS::NDS& nds) noexcept {
+    ZoneScopedN(TracyFunction);
+    uint32_t target = *_mispredictedFrame;
+    _mispredictedFrame = std::nullopt;
+
+    uint32_t depth = _frame - target;
+    if (depth > _maxRollback || !LoadSnapshot(nds, target)) {
+        _stats.Desyncs++;
+        retro::error("Can't roll back {} frame(s) to frame {}; the peers' consoles may no longer match", depth, target);
+        return;
+    }
+
+    clock::time_point start = clock::now();
+    _stats.Rollbacks++;
+    _stats.MaxDepth = std::max(_stats.MaxDepth, depth);
+    for (uint32_t frame = target; frame < _frame; ++frame) {
+        if (frame != target && NeedsSnapshot(frame)) {
+            // The old snapshot was taken on a timeline that no longer exists
+            SaveSnapshot(nds, frame);
+        }
+
+        ApplyInput(nds, frame);
+        nds.RunFrame();
+
+        // Replayed frames aren't presented, and their audio was already heard
+        nds.SPU.DrainOutput();
+        _stats.ResimulatedFrames++;
+    }
+
+    _resimulationTime += clock::now() - start;
+}
+
+void MelonDsDs::RollbackNetplay::ApplyInput(melonDS::NDS& nds, uint32_t frame) noexcept {
+    ConsoleInput merged {};
+    for (auto& [clientId, peer] : _inputs) {
+        ConsoleInput& input = peer.Inputs[frame % HISTORY];
+        if (frame >= peer.Confirmed) {
+            // Guess that the player is still doing whatever they did last,
+            // except for toggling the lid, which only happens once per press
+            input.Bits = peer.Last.Bits & ~ConsoleInput::TOGGLE_LID;
+        }
+
+        merged = ConsoleInput::Merge(merged, input);
+    }
+
+    merged.Apply(nds);
+}
+
+bool MelonDsDs::RollbackNetplay::NeedsSnapshot(uint32_t frame) const noexcept {
+    // Frames that only ran on confirmed input will never be rolled back to
+    optional<uint32_t> oldest = OldestUnconfirmedFrame();
+    return oldest && *oldest <= frame;
+}
+
+void MelonDsDs::RollbackNetplay::SaveSnapshot(melonDS::NDS& nds, uint32_t frame) noexcept {
+    ZoneScopedN(TracyFunction);
+    clock::time_point start = clock::now();
+    Snapshot& slot = _snapshots[frame % _snapshots.size()];
+
+    bool saved = false;
+    if (!slot.Data.empty()) {
+        melonDS::Savestate state(slot.Data.data(), slot.Data.size(), true);
+        saved = nds.DoSavestate(&state) && !state.Error;
+    }
+
+    if (!saved) {
+        // If this slot is new (or the state outgrew it), let melonDS size the buffer
+        melonDS::Savestate state;
+        saved = nds.DoSavestate(&state) && !state.Error;
+        if (saved) {
+            const std::byte* buffer = reinterpret_cast<const std::byte*>(state.Buffer());
+            slot.Data.assign(buffer, buffer + state.Length());
+        }
+    }
+
+    if (!saved) {
+        retro::error("Failed to take a snapshot of frame {}", frame);
+    }
+
+    slot.Frame = saved ? optional(frame) : std::nullopt;
+    _stats.Snapshots++;
+    _snapshotTime += clock::now() - start;
+}
+
+bool MelonDsDs::RollbackNetplay::LoadSnapshot(melonDS::NDS& nds, uint32_t frame) noexcept {
+    ZoneScopedN(TracyFunction);
+    Snapshot& slot = _snapshots[frame % _snapshots.size()];
+    if (slot.Frame != frame)
+        return false;
+
+    melonDS::Savestate state(slot.Data.data(), slot.Data.size(), false);
+    return nds.DoSavestate(&state) && !state.Error;
+}
+
+optional<uint32_t> MelonDsDs::RollbackNetplay::OldestUnconfirmedFrame() const noexcept {
+    optional<uint32_t> oldest;
+    for (const auto& [clientId, peer] : _inputs) {
+        if (clientId != _clientId) {
+            oldest = std::min(oldest.value_or(peer.Confirmed), peer.Confirmed);
+        }
+    }
+
+    return oldest;
+}
+
+MelonDsDs::RollbackStats MelonDsDs::RollbackNetplay::Stats() const noexcept {
+    using std::chrono::duration;
+    RollbackStats stats = _stats;
+    stats.Peers = std::count_if(_inputs.begin(), _inputs.end(), [this](const auto& entry) {
+        return entry.first != _clientId;
+    });
+    stats.ResimulationMs = duration<double, std::milli>(_resimulationTime).count();
+    stats.SnapshotMs = duration<double, std::milli>(_snapshotTime).count();
+    return stats;
+}
+
+void MelonDsDs::RollbackNetplay::LogStats() const noexcept {
+    if (_stats.Frames == 0)
+        return;
+
+    RollbackStats stats = Stats();
+    retro::info(
+        "Rollback netplay: {} frame(s), {} rollback(s) (deepest {}), {} frame(s) replayed in {:.1f}ms, "
+        "{} snapshot(s) in {:.1f}ms, {} stall(s), {} desync(s)",
+        stats.Frames,
+        stats.Rollbacks,
+        stats.MaxDepth,
+        stats.ResimulatedFrames,
+        stats.ResimulationMs,
+        stats.Snapshots,
+        stats.SnapshotMs,
+        stats.Stalls,
+        stats.Desyncs
+    );
+}
@@ -0,0 +1,189 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+#include <libretro.h>
+
+#include "input/input.hpp"
+#include "std/span.hpp"
+
+namespace melonDS {
+    class NDS;
+}
+
+namespace MelonDsDs {
+    /// Rollback netplay statistics since netplay started.
+    /// Exposed to C callers as-is, so keep it standard-layout.
+    struct RollbackStats {
+        /// Frames that the console advanced, not counting replays
+        uint64_t Frames;
+        /// Times that a late input disagreed with its prediction
+        uint64_t Rollbacks;
+        /// Frames replayed to correct mispredictions
+        uint64_t ResimulatedFrames;
+        /// Snapshots taken of the console's state
+        uint64_t Snapshots;
+        /// Frames skipped because this peer was too far ahead of another
+        uint64_t Stalls;
+        /// Mispredictions too old to correct; the peers no longer agree on the console's state
+        uint64_t Desyncs;
+        /// Deepest rollback, in frames
+        uint32_t MaxDepth;
+        /// Remote peers
+        uint32_t Peers;
+        /// Total time spent restoring snapshots and replaying frames
+        double ResimulationMs;
+        /// Total time spent taking snapshots
+        double SnapshotMs;
+    };
+
+    /// Shares one emulated console between two netplay peers.
+    /// Each peer sends its local input for every frame over the frontend's netpacket interface
+    /// (only when it changes, otherwise just the frame number).
+    /// Remote input that hasn't arrived yet is predicted to be whatever that peer last sent;
+    /// when a prediction turns out wrong, the console is restored from an in-memory snapshot
+    /// and the frames since then are replayed without being presented.
+    class RollbackNetplay {
+    public:
+        /// \param clientId This peer's netpacket client ID; the host is 0.
+        /// Clients wait for the host to send them its console's state before they run.
+        void Start(
+            uint16_t clientId,
+            retro_netpacket_send_t sendFn,
+            retro_netpacket_poll_receive_t pollFn,
+            unsigned maxRollback
+        ) noexcept;
+        void Stop() noexcept;
+        [[nodiscard]] bool Active() const noexcept { return _sendFn != nullptr; }
+
+        void PacketReceived(const void* buf, size_t len, uint16_t clientId) noexcept;
+
+        /// Called on the host when a client wants to join.
+        /// The client gets the console's state before the next frame.
+        /// \returns \c false if the client should be turned away, since rollback netplay supports two players.
+        bool PeerConnected(uint16_t clientId) noexcept;
+        void PeerDisconnected(uint16_t clientId) noexcept;
+
+        /// Handles anything that must happen between frames, like sending or loading a joining peer's state.
+        /// \returns \c false if the console must not advance this frame,
+        /// either because it's waiting for the host's state or because it's too far ahead of another peer.
+        bool Prepare(melonDS::NDS& nds) noexcept;
+
+        /// Corrects any mispredictions that remote input revealed,
+        /// then gives the console the combined input for the frame that's about to run.
+        /// Call after Prepare returns \c true, just before NDS::RunFrame.
+        void BeginFrame(melonDS::NDS& nds, ConsoleInput local) noexcept;
+
+        /// Corrects mispredictions without advancing to a new frame.
+        void Settle(melonDS::NDS& nds) noexcept;
+
+        [[nodiscard]] uint32_t Frame() const noexcept { return _frame; }
+        [[nodiscard]] RollbackStats Stats() const noexcept;
+        void LogStats() const noexcept;
+    private:
+        using clock = std::chrono::steady_clock;
+
+        // Input history per peer, in frames; must exceed twice the deepest possible rollback,
+        // since a peer may run that far ahead of us while we're that far behind its confirmed input
+        static constexpr uint32_t HISTORY = 64;
+        static constexpr unsigned MAX_ROLLBACK = 16;
+        static_assert(HISTORY > 2 * MAX_ROLLBACK + 1);
+
+        // Large states are split into chunks this big
+        static constexpr size_t STATE_CHUNK_SIZE = 32 * 1024;
+        // Comfortably above a DSi's savestate; anything bigger didn't come from a compatible peer
+        static constexpr uint32_t MAX_STATE_SIZE = 64 * 1024 * 1024;
+        // A client gives up on netplay after failing to load this many of the host's states
+        static constexpr unsigned MAX_STATE_ATTEMPTS = 3;
+
+        enum class MessageType : uint8_t {
+            /// u32 frame, u8 changed, then (if changed) u32 input bits
+            Input = 1,
+            /// u32 frame, u32 total size, u32 offset, then part of a savestate
+            State = 2,
+            /// Nothing else; sent by a client that couldn't load the host's state
+            StateRequest = 3,
+        };
+
+        struct PeerInputs {
+            /// Indexed by frame % HISTORY; confirmed below Confirmed, predicted from there on
+            std::array<ConsoleInput, HISTORY> Inputs {};
+            /// The first frame whose input hasn't arrived
+            uint32_t Confirmed = 0;
+            ConsoleInput Last {};
+        };
+
+        struct Snapshot {
+            std::optional<uint32_t> Frame;
+            std::vector<std::byte> Data;
+        };
+
+        void Send(std::span<const uint8_t> message, uint16_t dest, bool flush) noexcept;
+        void ReceiveInput(std::span<const uint8_t> message, uint16_t clientId) noexcept;
+        void ReceiveState(std::span<const uint8_t> message) noexcept;
+        void ReceiveStateRequest(uint16_t clientId) noexcept;
+        void SendInput(ConsoleInput input, bool changed) noexcept;
+        bool SendState(melonDS::NDS& nds, uint16_t clientId) noexcept;
+        void AddPeer(uint16_t clientId, uint32_t frame) noexcept;
+
+        /// Restores the earliest mispredicted frame's snapshot and replays up to the current frame.
+        void Rollback(melonDS::NDS& nds) noexcept;
+
+        /// Gives the console frame's combined input, predicting any that hasn't arrived.
+        void ApplyInput(melonDS::NDS& nds, uint32_t frame) noexcept;
+        [[nodiscard]] bool NeedsSnapshot(uint32_t frame) const noexcept;
+        void SaveSnapshot(melonDS::NDS& nds, uint32_t frame) noexcept;
+        bool LoadSnapshot(melonDS::NDS& nds, uint32_t frame) noexcept;
+        [[nodiscard]] std::optional<uint32_t> OldestUnconfirmedFrame() const noexcept;
+
+        retro_netpacket_send_t _sendFn = nullptr;
+        retro_netpacket_poll_receive_t _pollFn = nullptr;
+        uint16_t _clientId = 0;
+        unsigned _maxRollback = 8;
+
+        /// The next frame to run
+        uint32_t _frame = 0;
+
+        /// Every peer's input, including ours; ordered by client ID, which decides whose touch wins
+        std::map<uint16_t, PeerInputs> _inputs;
+        std::optional<uint32_t> _mispredictedFrame;
+        std::vector<Snapshot> _snapshots;
+
+        /// A client that the host still needs to send its state to
+        std::optional<uint16_t> _pendingJoin;
+        /// Set when a peer joins, since its record of our last input starts out empty
+        bool _resendInput = false;
+        bool _awaitingState = false;
+        std::vector<uint8_t> _incomingState;
+        size_t _incomingStateReceived = 0;
+        std::optional<uint32_t> _incomingStateFrame;
+        unsigned _failedStates = 0;
+
+        RollbackStats _stats {};
+        clock::duration _resimulationTime {};
+        clock::duration _snapshotTime {};
+    };
+}
@@ -35,6 +35,8 @@
 #include "../config/config.hpp"
 #include "environment.hpp"
 #include "format.hpp"
+#include "sectorcache.hpp"
+#include "sparse.hpp"
 #include "tracy.hpp"
 #include "utils.hpp"
 
@@ -86,6 +88,10 @@ constexpr unsigned GetRetroVfsFileSeekOrigin(FileSeekOrigin origin) noexcept {
 struct melonDS::Platform::FileHandle {
     RFILE *file;
     unsigned hints;
+    // Set if this file is a large disk image that's mostly empty (e.g. an SD card)
+    std::shared_ptr<MelonDsDs::SparseImage> sparse;
+    // Set if this file is a disk image whose sectors are read over and over (e.g. the DSi NAND)
+    std::shared_ptr<MelonDsDs::SectorCache> cache;
 };
 
 Platform::FileHandle *Platform::OpenFile(const std::string& path, FileMode mode) {
@@ -114,6 +120,8 @@ Platform::FileHandle *Platform::OpenFile(const std::string& path, FileMode mode)
         return nullptr;
     }
 
+    handle->sparse = MelonDsDs::SparseImage::Find(path);
+    handle->cache = MelonDsDs::SectorCache::Find(path);
     retro::debug("Opened \"{}\" in FileMode {}", path, mode);
 
     return handle;
@@ -187,6 +195,10 @@ bool Platform::CloseFile(FileHandle* file)
     char path[PATH_MAX];
     strlcpy(path, filestream_get_path(file->file), sizeof(path));
     retro::debug("Closing \"{}\"", path);
+    if (file->sparse) {
+        // Closing flushes the file, and another handle may reuse its address
+        file->sparse->Close(file->file);
+    }
     bool ok = (filestream_close(file->file) == 0);
 
     if (!ok) {
@@ -238,7 +250,14 @@ u64 Platform::FileRead(void* data, u64 size, u64 count, FileHandle* file)
     if (!file || !data)
         return 0;
 
-    int64_t bytesRead = filestream_read(file->file, data, size * count);
+    int64_t bytesRead;
+    if (file->cache) {
+        bytesRead = file->cache->Read(file->file, data, size * count);
+    } else if (file->sparse) {
+        bytesRead = file->sparse->Read(file->file, data, size * count);
+    } else {
+        bytesRead = filestream_read(file->file, data, size * count);
+    }
     if (bytesRead < 0) {
         retro::error("Failed to read from file \"{}\"", filestream_get_path(file->file));
     } else if (bytesRead != size * count) {
@@ -254,6 +273,9 @@ bool Platform::FileFlush(FileHandle* file)
     if (!file)
         return false;
 
+    if (file->sparse)
+        return file->sparse->Flush(file->file);
+
     return filestream_flush(file->file) == 0;
 }
 
@@ -263,7 +285,18 @@ u64 Platform::FileWrite(const void* data, u64 size, u64 count, FileHandle* file)
     if (!file || !data)
         return 0;
 
-    u64 bytesWritten = filestream_write(file->file, data, size * count);
+    int64_t bytesWritten;
+    if (file->cache) {
+        bytesWritten = file->cache->Write(file->file, data, size * count);
+    } else if (file->sparse) {
+        bytesWritten = file->sparse->Write(file->file, data, size * count);
+    } else {
+        bytesWritten = filestream_write(file->file, data, size * count);
+    }
+    if (bytesWritten < 0) {
+        retro::error("Failed to write to file \"{}\"", filestream_get_path(file->file));
+        return 0;
+    }
 
     return bytesWritten / size;
 }
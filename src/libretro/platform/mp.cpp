@@ -23,39 +23,60 @@
 
 using namespace melonDS;
 
-constexpr retro_fastforwarding_override FASTFORWARD_OVERRIDE_FORBIDDEN = {
-    1.0f,
-    false,
-    false,
-    true,
-};
-
-void MelonDsDs::CoreState::MpStarted(retro_netpacket_send_t send, retro_netpacket_poll_receive_t poll_receive) noexcept {
+void MelonDsDs::CoreState::MpStarted(uint16_t client_id, retro_netpacket_send_t send, retro_netpacket_poll_receive_t poll_receive) noexcept {
     ZoneScopedN(TracyFunction);
+    if (Config.NetplayMode() == NetplayMode::Rollback) {
+        // The console's local wireless stays offline; both players share one console instead
+        _rollback.Start(client_id, send, poll_receive, Config.RollbackFrames());
+        return;
+    }
+
     _mpState.SetSendFn(send);
     _mpState.SetPollFn(poll_receive);
-    if (retro::set_fastforwarding_override(FASTFORWARD_OVERRIDE_FORBIDDEN)) {
-        retro::info("Disabled fastforwarding for multiplayer");
-    }
-    else {
-        retro::warn("Failed to disable fastforwarding for multiplayer");
-    }
+    _mpState.Reset();
     retro::info("Starting multiplayer on libretro side");
 }
 
 void MelonDsDs::CoreState::MpPacketReceived(const void *buf, size_t len, uint16_t client_id) noexcept {
     ZoneScopedN(TracyFunction);
+    if (_rollback.Active()) {
+        _rollback.PacketReceived(buf, len, client_id);
+        return;
+    }
+
     _mpState.PacketReceived(buf, len, client_id);
 }
 
 void MelonDsDs::CoreState::MpStopped() noexcept {
     ZoneScopedN(TracyFunction);
+    if (_rollback.Active()) {
+        _rollback.LogStats();
+        _rollback.Stop();
+        retro::info("Stopping rollback netplay");
+        return;
+    }
+
+    _mpState.LogStats();
     _mpState.SetSendFn(nullptr);
     _mpState.SetPollFn(nullptr);
-    retro::clear_fastforwarding_override();
     retro::info("Stopping multiplayer on libretro side");
 }
 
+bool MelonDsDs::CoreState::MpPeerConnected(uint16_t client_id) noexcept {
+    ZoneScopedN(TracyFunction);
+    return !_rollback.Active() || _rollback.PeerConnected(client_id);
+}
+
+void MelonDsDs::CoreState::MpPeerDisconnected(uint16_t client_id) noexcept {
+    ZoneScopedN(TracyFunction);
+    if (_rollback.Active()) {
+        _rollback.PeerDisconnected(client_id);
+        return;
+    }
+
+    _mpState.PeerDisconnected(client_id);
+}
+
 bool MelonDsDs::CoreState::MpSendPacket(const MelonDsDs::Packet &p) noexcept {
     ZoneScopedN(TracyFunction);
     if(!_mpState.IsReady()) {
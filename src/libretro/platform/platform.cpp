@@ -30,6 +30,7 @@
 #include "../environment.hpp"
 #include "../config/config.hpp"
 #include "../format.hpp"
+#include "core/fork.hpp"
 #include "retro/scaler.hpp"
 #include "sram.hpp"
 #include "tracy.hpp"
@@ -40,6 +41,11 @@ constexpr unsigned DSI_CAMERA_HEIGHT = 480;
 
 void Platform::SignalStop(Platform::StopReason reason, void* userdata) {
     retro::debug("Platform::SignalStop({})\n", reason);
+    if (MelonDsDs::IsForkedConsole(userdata)) {
+        // A fork stopping shouldn't take the real console down with it
+        return;
+    }
+
     switch (reason) {
         case StopReason::BadExceptionRegion:
             retro::set_error_message("An internal error occurred in the emulated console.");
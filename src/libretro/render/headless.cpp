@@ -0,0 +1,277 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include "headless.hpp"
+
+#include <cstring>
+
+#include <EGL/eglext.h>
+#include <glsm/glsm.h>
+
+#include "environment.hpp"
+#include "format.hpp"
+#include "tracy.hpp"
+
+// HACK: Defined in glsm.c, but we need to peek into it occasionally
+extern retro_hw_render_callback hw_render;
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+// How long to wait for the previous frame's readback before giving up on it
+constexpr GLuint64 READBACK_TIMEOUT_NS = 1'000'000'000;
+
+MelonDsDs::HeadlessGlContext* MelonDsDs::HeadlessGlContext::_current = nullptr;
+
+std::unique_ptr<MelonDsDs::HeadlessGlContext> MelonDsDs::HeadlessGlContext::New() noexcept {
+    ZoneScopedN(TracyFunction);
+    std::unique_ptr<HeadlessGlContext> context(new HeadlessGlContext());
+
+    // A surfaceless display doesn't need X11, Wayland, or a GPU with a monitor attached
+    auto eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    bool surfaceless = false;
+    if (eglGetPlatformDisplayEXT) {
+        context->_display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        surfaceless = context->_display != EGL_NO_DISPLAY;
+    }
+
+    if (context->_display == EGL_NO_DISPLAY) {
+        // If surfaceless displays aren't supported, fall back to the default display with a pbuffer
+        context->_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    if (context->_display == EGL_NO_DISPLAY) {
+        retro::error("Failed to get an EGL display");
+        return nullptr;
+    }
+
+    EGLint major = 0;
+    EGLint minor = 0;
+    if (!eglInitialize(context->_display, &major, &minor)) {
+        retro::error("Failed to initialize EGL (error {:#x})", eglGetError());
+        context->_display = EGL_NO_DISPLAY;
+        return nullptr;
+    }
+
+    retro::info("Initialized EGL {}.{} ({}, {})", major, minor, eglQueryString(context->_display, EGL_VENDOR), surfaceless ? "surfaceless" : "pbuffer");
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        retro::error("EGL display doesn't support desktop OpenGL (error {:#x})", eglGetError());
+        return nullptr;
+    }
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(context->_display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+        retro::error("Failed to find a suitable EGL config (error {:#x})", eglGetError());
+        return nullptr;
+    }
+
+    // melonDS needs at least OpenGL 3.2 core, same as with a frontend-provided context
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+        EGL_CONTEXT_MINOR_VERSION_KHR, 2,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+        EGL_NONE
+    };
+
+    context->_context = eglCreateContext(context->_display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context->_context == EGL_NO_CONTEXT) {
+        retro::error("Failed to create an OpenGL 3.2 core context with EGL (error {:#x})", eglGetError());
+        return nullptr;
+    }
+
+    if (!surfaceless) {
+        // We render to our own framebuffer anyway, so the surface only has to exist
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        context->_surface = eglCreatePbufferSurface(context->_display, config, pbufferAttribs);
+        if (context->_surface == EGL_NO_SURFACE) {
+            retro::error("Failed to create an EGL pbuffer surface (error {:#x})", eglGetError());
+            return nullptr;
+        }
+    }
+
+    if (!context->MakeCurrent()) {
+        return nullptr;
+    }
+
+    return context;
+}
+
+MelonDsDs::HeadlessGlContext::~HeadlessGlContext() noexcept {
+    ZoneScopedN(TracyFunction);
+    if (_current == this) {
+        _current = nullptr;
+    }
+
+    if (_display == EGL_NO_DISPLAY)
+        return;
+
+    eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (_surface != EGL_NO_SURFACE) {
+        eglDestroySurface(_display, _surface);
+    }
+
+    if (_context != EGL_NO_CONTEXT) {
+        eglDestroyContext(_display, _context);
+    }
+
+    eglTerminate(_display);
+}
+
+bool MelonDsDs::HeadlessGlContext::MakeCurrent() noexcept {
+    if (!eglMakeCurrent(_display, _surface, _surface, _context)) {
+        retro::error("Failed to make the headless OpenGL context current (error {:#x})", eglGetError());
+        return false;
+    }
+
+    return true;
+}
+
+void MelonDsDs::HeadlessGlContext::InstallCallbacks() noexcept {
+    _current = this;
+    hw_render.context_type = RETRO_HW_CONTEXT_OPENGL_CORE;
+    hw_render.version_major = 3;
+    hw_render.version_minor = 2;
+    hw_render.bottom_left_origin = true;
+    hw_render.get_current_framebuffer = GetCurrentFramebuffer;
+    hw_render.get_proc_address = GetProcAddress;
+}
+
+uintptr_t MelonDsDs::HeadlessGlContext::GetCurrentFramebuffer() noexcept {
+    return _current ? _current->_fbo : 0;
+}
+
+retro_proc_address_t MelonDsDs::HeadlessGlContext::GetProcAddress(const char* sym) noexcept {
+    return reinterpret_cast<retro_proc_address_t>(eglGetProcAddress(sym));
+}
+
+void MelonDsDs::HeadlessGlContext::ResizeFramebuffer(unsigned width, unsigned height) noexcept {
+    if (width == _width && height == _height && _fbo != 0)
+        return;
+
+    ZoneScopedN(TracyFunction);
+    TracyGpuZone(TracyFunction);
+    retro::debug("Resizing headless framebuffer from {}x{} to {}x{}", _width, _height, width, height);
+    DeleteFramebuffer();
+
+    glGenRenderbuffers(1, &_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, _colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenFramebuffers(1, &_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorBuffer);
+    if (GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER); status != GL_FRAMEBUFFER_COMPLETE) {
+        retro::error("Headless framebuffer is incomplete: {}", static_cast<FormattedGLEnum>(status));
+    }
+
+    glGenBuffers(PBO_COUNT, _pbos.data());
+    for (GLuint pbo : _pbos) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, width * height * sizeof(uint32_t), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    _width = width;
+    _height = height;
+    _pixels.resize(width * height);
+}
+
+const uint32_t* MelonDsDs::HeadlessGlContext::ReadPixels() noexcept {
+    ZoneScopedN(TracyFunction);
+    TracyGpuZone(TracyFunction);
+
+    size_t current = _pboIndex;
+    size_t previous = (_pboIndex + PBO_COUNT - 1) % PBO_COUNT;
+    size_t pitch = _width * sizeof(uint32_t);
+
+    // Queue up this frame's readback; glReadPixels returns immediately when a PBO is bound
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _fbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbos[current]);
+    glReadPixels(0, 0, _width, _height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr);
+    if (_fences[current]) {
+        glDeleteSync(_fences[current]);
+    }
+    _fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _pboIndex = (_pboIndex + 1) % PBO_COUNT;
+
+    const uint32_t* result = nullptr;
+    if (_fences[previous]) {
+        // If the previous frame's readback was queued, it's had a whole frame to finish
+        GLenum waitResult = glClientWaitSync(_fences[previous], GL_SYNC_FLUSH_COMMANDS_BIT, READBACK_TIMEOUT_NS);
+        glDeleteSync(_fences[previous]);
+        _fences[previous] = nullptr;
+
+        if (waitResult == GL_ALREADY_SIGNALED || waitResult == GL_CONDITION_SATISFIED) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbos[previous]);
+            const auto* mapped = static_cast<const uint8_t*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pitch * _height, GL_MAP_READ_BIT));
+            if (mapped) {
+                // OpenGL's origin is the bottom-left, but libretro's software path expects the top row first
+                auto* pixels = reinterpret_cast<uint8_t*>(_pixels.data());
+                for (unsigned y = 0; y < _height; ++y) {
+                    memcpy(pixels + y * pitch, mapped + (_height - 1 - y) * pitch, pitch);
+                }
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                result = _pixels.data();
+            }
+        }
+        else {
+            retro::warn("Timed out waiting for the previous frame's readback");
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return result;
+}
+
+void MelonDsDs::HeadlessGlContext::DeleteFramebuffer() noexcept {
+    for (GLsync& fence : _fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    if (_pbos[0] != 0) {
+        glDeleteBuffers(PBO_COUNT, _pbos.data());
+        _pbos = {};
+    }
+
+    if (_fbo != 0) {
+        glDeleteFramebuffers(1, &_fbo);
+        _fbo = 0;
+    }
+
+    if (_colorBuffer != 0) {
+        glDeleteRenderbuffers(1, &_colorBuffer);
+        _colorBuffer = 0;
+    }
+
+    _pboIndex = 0;
+    _width = 0;
+    _height = 0;
+}
@@ -0,0 +1,84 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#if defined(HAVE_OPENGL) && defined(HAVE_EGL)
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <libretro.h>
+
+#include "PlatformOGLPrivate.h"
+
+namespace MelonDsDs {
+    /// \brief An OpenGL context that the core creates for itself with EGL,
+    /// for use when the frontend can't (or won't) provide one.
+    ///
+    /// Rendered frames are read back through a ring of pixel buffer objects
+    /// and handed to the frontend through the software video_refresh path,
+    /// one frame late so that the readback never stalls the pipeline.
+    class HeadlessGlContext {
+    public:
+        /// \returns A context that's current on the calling thread, or nullptr if EGL isn't usable.
+        static std::unique_ptr<HeadlessGlContext> New() noexcept;
+        ~HeadlessGlContext() noexcept;
+        HeadlessGlContext(const HeadlessGlContext&) = delete;
+        HeadlessGlContext(HeadlessGlContext&&) = delete;
+        HeadlessGlContext& operator=(const HeadlessGlContext&) = delete;
+        HeadlessGlContext& operator=(HeadlessGlContext&&) = delete;
+
+        bool MakeCurrent() noexcept;
+
+        /// Points the global hw_render callbacks at this context
+        /// so that glsm can load function pointers and find the framebuffer.
+        void InstallCallbacks() noexcept;
+
+        /// (Re)creates the framebuffer and readback buffers if the output size changed.
+        /// Must be called with the context current and glsm's function pointers loaded.
+        void ResizeFramebuffer(unsigned width, unsigned height) noexcept;
+
+        /// Starts reading back the current frame and returns the previous one,
+        /// or nullptr if no frame is ready yet.
+        /// The returned pixels are XRGB8888, top row first, and tightly packed.
+        [[nodiscard]] const uint32_t* ReadPixels() noexcept;
+
+        /// Deletes all OpenGL objects owned by this context; it must be current.
+        void DeleteFramebuffer() noexcept;
+    private:
+        HeadlessGlContext() noexcept = default;
+        static uintptr_t GetCurrentFramebuffer() noexcept;
+        static retro_proc_address_t GetProcAddress(const char* sym) noexcept;
+        static constexpr size_t PBO_COUNT = 2;
+        static HeadlessGlContext* _current;
+
+        EGLDisplay _display = EGL_NO_DISPLAY;
+        EGLContext _context = EGL_NO_CONTEXT;
+        EGLSurface _surface = EGL_NO_SURFACE;
+        GLuint _fbo = 0;
+        GLuint _colorBuffer = 0;
+        unsigned _width = 0;
+        unsigned _height = 0;
+        std::array<GLuint, PBO_COUNT> _pbos {};
+        std::array<GLsync, PBO_COUNT> _fences {};
+        size_t _pboIndex = 0;
+        std::vector<uint32_t> _pixels;
+    };
+}
+#endif
@@ -31,6 +31,7 @@
 #include "../core/core.hpp"
 #include "exceptions.hpp"
 #include "format.hpp"
+#include "programcache.hpp"
 #include "screenlayout.hpp"
 #include "tracy.hpp"
 
@@ -134,21 +135,40 @@ constexpr unsigned GetVertexCount(ScreenLayout layout, MelonDsDs::HybridSideScre
 extern retro_hw_render_callback hw_render;
 
 static const char* const SHADER_PROGRAM_NAME = "melonDS DS Shader Program";
+static const char* const SHADER_PROGRAM_CACHE_NAME = "melondsds_screen";
 
 
-std::unique_ptr<MelonDsDs::OpenGLRenderState> MelonDsDs::OpenGLRenderState::New() noexcept {
+std::unique_ptr<MelonDsDs::OpenGLRenderState> MelonDsDs::OpenGLRenderState::New(bool headless) noexcept {
     ZoneScopedN(TracyFunction);
     try {
-        return std::make_unique<OpenGLRenderState>();
+        return std::make_unique<OpenGLRenderState>(headless);
     } catch (const opengl_not_initialized_exception& e) {
         retro::debug("OpenGL context could not be initialized: {}", e.what());
         return nullptr;
     }
 }
 
-MelonDsDs::OpenGLRenderState::OpenGLRenderState() {
+MelonDsDs::OpenGLRenderState::OpenGLRenderState(bool headless) {
     ZoneScopedN(TracyFunction);
     retro::debug(TracyFunction);
+
+    if (headless) {
+#ifdef HAVE_EGL
+        // If we're creating our own context, the frontend won't call context_reset for us
+        _headless = HeadlessGlContext::New();
+        if (!_headless) {
+            throw opengl_not_initialized_exception();
+        }
+
+        _headless->InstallCallbacks();
+        gl_query_core_context_set(true);
+        retro::info("Created headless OpenGL context");
+        return;
+#else
+        retro::warn("This build doesn't support headless OpenGL, using the frontend's context");
+#endif
+    }
+
     glsm_ctx_params_t params = {};
 
     // MelonDS needs at least OpenGL 3.2 for OpenGL renderer
@@ -166,6 +186,15 @@ MelonDsDs::OpenGLRenderState::OpenGLRenderState() {
     hw_render.debug_context = true;
 #endif
 
+    // Ask the frontend to keep the context alive across fullscreen toggles and the like,
+    // so that we don't have to rebuild the renderer
+    hw_render.cache_context = true;
+
+    // The frontend doesn't say whether it honored cache_context, but it does say whether it gives us a shared context;
+    // only then can we be sure that our objects outlive a reset that wasn't preceded by a destroy
+    _sharedContext = retro::environment(RETRO_ENVIRONMENT_SET_HW_SHARED_CONTEXT, nullptr);
+    retro::debug("Frontend {} a shared OpenGL context", _sharedContext ? "provides" : "doesn't provide");
+
     if (!glsm_ctl(GLSM_CTL_STATE_CONTEXT_INIT, &params)) {
         throw opengl_not_initialized_exception();
     }
@@ -182,20 +211,20 @@ MelonDsDs::OpenGLRenderState::~OpenGLRenderState() noexcept {
     if (_contextInitialized) {
         TracyGpuZone(TracyFunction);
         glsm_ctl(GLSM_CTL_STATE_BIND, nullptr);
-        glDeleteTextures(1, &screen_framebuffer_texture);
-
-        glDeleteVertexArrays(1, &vao);
-        glDeleteBuffers(1, &vbo);
-        glDeleteProgram(_screenProgram);
+        DeleteCoreOpenGlState();
         glsm_ctl(GLSM_CTL_STATE_UNBIND, nullptr);
-
-#ifdef HAVE_TRACY
-        _tracyCapture = std::nullopt;
-#endif
     }
     glsm_ctl(GLSM_CTL_STATE_CONTEXT_DESTROY, nullptr);
     gl_query_core_context_unset();
 
+#ifdef HAVE_EGL
+    if (_headless) {
+        // If we made this context ourselves, the frontend never knew about it
+        _headless = nullptr;
+        return;
+    }
+#endif
+
     // Disable OpenGL hardware rendering;
     // this may not actually tear down the OpenGL context
     // (i.e. the frame may still be presented with OpenGL),
@@ -209,11 +238,24 @@ void MelonDsDs::OpenGLRenderState::ContextReset(melonDS::NDS& nds, const CoreCon
     ZoneScopedN(TracyFunction);
     retro::debug(TracyFunction);
 
+#ifdef HAVE_EGL
+    if (_headless && !_headless->MakeCurrent()) {
+        throw opengl_not_initialized_exception();
+    }
+#endif
+
     // Initialize all OpenGL function pointers
     retro::debug("Initializing OpenGL function pointers");
     glsm_ctl(GLSM_CTL_STATE_CONTEXT_RESET, nullptr);
     TracyGpuContext; // Must be called AFTER the function pointers are bound!
 
+#ifdef HAVE_EGL
+    if (_headless) {
+        // The real size isn't known until the first frame, but we need a framebuffer to exist now
+        _headless->ResizeFramebuffer(NDS_SCREEN_WIDTH, NDS_SCREEN_HEIGHT * 2);
+    }
+#endif
+
     const char *vendor   = (const char*)glGetString(GL_VENDOR);
     const char *rendererName = (const char*)glGetString(GL_RENDERER);
     const char *version  = (const char*)glGetString(GL_VERSION);
@@ -240,6 +282,25 @@ void MelonDsDs::OpenGLRenderState::ContextReset(melonDS::NDS& nds, const CoreCon
         retro::debug("Bound GL state");
     }
 
+    if (_contextInitialized && (_sharedContext || Headless()) && nds.GPU.GetRenderer3D().Accelerated) {
+        // If the frontend reset the context without destroying it first,
+        // and the context is one that's guaranteed to keep our objects...
+        retro::info("OpenGL context survived the reset, reusing the existing renderer");
+        melonDS::GLRenderer& renderer = static_cast<melonDS::GLRenderer&>(nds.GPU.GetRenderer3D());
+        renderer.SetRenderSettings(config.BetterPolygonSplitting(), config.ScaleFactor());
+        _needsRefresh = true;
+
+        glsm_ctl(GLSM_CTL_STATE_UNBIND, nullptr);
+        retro::debug("OpenGL context reset successfully.");
+        return;
+    }
+
+    if (_contextInitialized) {
+        // If the context was reset without being destroyed, but we can't be sure that it kept our objects...
+        retro::warn("OpenGL context was reset without being destroyed, recreating all OpenGL objects");
+        ClearCoreOpenGlState(); // The old names may belong to the frontend now, so don't try to delete them
+    }
+
     // HACK: Makes the core resilient to context loss by cleaning up the stale OpenGL renderer
     // (The "correct" way to do this would be to add a Reinitialize() method to GLRenderer
     // that recreates all resources)
@@ -290,22 +351,32 @@ void MelonDsDs::OpenGLRenderState::SetUpCoreOpenGlState(const CoreConfig& config
 
     // TODO: Check gl_check_capability for GL_CAPS_VAO and GL_CAPS_FBO
 
-    bool shaderCompiled = melonDS::OpenGL::CompileVertexFragmentProgram(
-        _screenProgram,
+    ProgramBinaryCache programCache;
+    std::initializer_list<std::string_view> shaderSources = {
         embedded_melondsds_vertex_shader,
         embedded_melondsds_fragment_shader,
-        SHADER_PROGRAM_NAME,
-        {
-            {"vPosition", 0},
-            {"vTexcoord", 1},
-        },
-        {
-            {"oColor", 0},
-        }
-    );
+    };
+    _screenProgram = programCache.Load(SHADER_PROGRAM_CACHE_NAME, shaderSources);
+    if (_screenProgram == 0) {
+        // If there's no usable cached binary for the screen shader...
+        _screenProgram = programCache.Build(
+            SHADER_PROGRAM_NAME,
+            embedded_melondsds_vertex_shader,
+            embedded_melondsds_fragment_shader,
+            {
+                {"vPosition", 0},
+                {"vTexcoord", 1},
+            },
+            {
+                {"oColor", 0},
+            }
+        );
+
+        if (_screenProgram == 0)
+            throw shader_compilation_failed_exception("Failed to compile and link melonDS DS screen shader program.");
 
-    if (!shaderCompiled)
-        throw shader_compilation_failed_exception("Failed to compile and link melonDS DS screen shader program.");
+        programCache.Store(SHADER_PROGRAM_CACHE_NAME, shaderSources, _screenProgram);
+    }
 
     if (_openGlDebugAvailable) {
         // TODO: Fall back to glLabelObjectEXT if glObjectLabel isn't available
@@ -374,6 +445,12 @@ void MelonDsDs::OpenGLRenderState::Render(
 
     glsm_ctl(GLSM_CTL_STATE_BIND, nullptr);
 
+#ifdef HAVE_EGL
+    if (_headless) {
+        _headless->ResizeFramebuffer(screenLayout.BufferWidth(), screenLayout.BufferHeight());
+    }
+#endif
+
     GLuint current_fbo = glsm_get_current_framebuffer();
     // Tell OpenGL that we want to draw to (and read from) the screen framebuffer
     glBindFramebuffer(GL_FRAMEBUFFER, current_fbo);
@@ -438,6 +515,22 @@ void MelonDsDs::OpenGLRenderState::Render(
 
     glFlush();
 
+#ifdef HAVE_EGL
+    if (_headless) {
+        // Present the previous frame while this one is read back
+        const uint32_t* pixels = _headless->ReadPixels();
+        glsm_ctl(GLSM_CTL_STATE_UNBIND, nullptr);
+        retro::video_refresh(
+            pixels, // nullptr on the first frame, which tells the frontend to duplicate the last one
+            screenLayout.BufferWidth(),
+            screenLayout.BufferHeight(),
+            screenLayout.BufferWidth() * sizeof(uint32_t)
+        );
+        TracyGpuCollect;
+        return;
+    }
+#endif
+
     glsm_ctl(GLSM_CTL_STATE_UNBIND, nullptr);
 
 #ifdef HAVE_TRACY
@@ -456,14 +549,68 @@ void MelonDsDs::OpenGLRenderState::Render(
     TracyGpuCollect;
 }
 
-void MelonDsDs::OpenGLRenderState::ContextDestroyed() {
+bool MelonDsDs::OpenGLRenderState::Headless() const noexcept {
+#ifdef HAVE_EGL
+    return _headless != nullptr;
+#else
+    return false;
+#endif
+}
+
+void MelonDsDs::OpenGLRenderState::ContextDestroyed(melonDS::NDS* nds, const CoreConfig& config) {
     ZoneScopedN(TracyFunction);
-//    TracyGpuZone(TracyFunction);
     retro::debug(TracyFunction);
+
+    if (_contextInitialized) {
+        // The context is still current when the frontend calls this,
+        // so we can (and should) clean up after ourselves
+        glsm_ctl(GLSM_CTL_STATE_BIND, nullptr);
+        DeleteCoreOpenGlState();
+
+        if (nds && nds->GPU.GetRenderer3D().Accelerated) {
+            // If the emulator's renderer owns objects in this context,
+            // destroy it now instead of after the context is gone
+            // (and keep the player's threading choice until the context comes back)
+            auto softwareRenderer = std::make_unique<melonDS::SoftRenderer>();
+            softwareRenderer->SetThreaded(config.ThreadedSoftRenderer(), nds->GPU);
+            nds->GPU.GPU3D.SetCurrentRenderer(std::move(softwareRenderer));
+        }
+        glsm_ctl(GLSM_CTL_STATE_UNBIND, nullptr);
+    }
+
     glsm_ctl(GLSM_CTL_STATE_CONTEXT_DESTROY, nullptr);
     _openGlDebugAvailable = false;
     _needsRefresh = false;
     _contextInitialized = false;
+}
+
+// Deletes all OpenGL objects owned by this render state; the context must be bound
+void MelonDsDs::OpenGLRenderState::DeleteCoreOpenGlState() noexcept {
+    ZoneScopedN(TracyFunction);
+    TracyGpuZone(TracyFunction);
+
+#ifdef HAVE_TRACY
+    _tracyCapture = std::nullopt;
+#endif
+
+    glDeleteTextures(1, &screen_framebuffer_texture);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ubo);
+    glDeleteProgram(_screenProgram);
+#ifdef HAVE_EGL
+    if (_headless) {
+        _headless->DeleteFramebuffer();
+    }
+#endif
+    ClearCoreOpenGlState();
+}
+
+// Forgets all OpenGL objects owned by this render state without deleting them
+void MelonDsDs::OpenGLRenderState::ClearCoreOpenGlState() noexcept {
+#ifdef HAVE_TRACY
+    _tracyCapture = std::nullopt;
+#endif
     _screenProgram = 0;
     screen_framebuffer_texture = 0;
     screen_vertices = {};
@@ -472,12 +619,6 @@ void MelonDsDs::OpenGLRenderState::ContextDestroyed() {
     vbo = 0;
     GL_ShaderConfig = {};
     ubo = 0;
-    // TODO: Delete these objects, since the context hasn't been destroyed yet
-    // (just in case it's not really destroyed afterwards)
-
-#ifdef HAVE_TRACY
-    _tracyCapture = std::nullopt;
-#endif
 }
 
 void MelonDsDs::OpenGLRenderState::InitFrameState(melonDS::NDS& nds, const CoreConfig& config, const ScreenLayoutData& screenLayout) noexcept {
@@ -33,14 +33,18 @@
 #include "tracy/opengl.hpp"
 #endif
 
+#ifdef HAVE_EGL
+#include "headless.hpp"
+#endif
+
 namespace MelonDsDs {
     using glm::vec2;
     using glm::vec4;
 
     class OpenGLRenderState final : public RenderState {
     public:
-        static std::unique_ptr<OpenGLRenderState> New() noexcept;
-        OpenGLRenderState();
+        static std::unique_ptr<OpenGLRenderState> New(bool headless) noexcept;
+        explicit OpenGLRenderState(bool headless);
         ~OpenGLRenderState() noexcept override;
         OpenGLRenderState(const OpenGLRenderState&) = delete;
         OpenGLRenderState(OpenGLRenderState&&) = delete;
@@ -59,7 +63,12 @@ namespace MelonDsDs {
         }
 
         void ContextReset(melonDS::NDS& nds, const CoreConfig& config);
-        void ContextDestroyed();
+
+        // True if this render state uses its own context instead of the frontend's
+        [[nodiscard]] bool Headless() const noexcept;
+
+        // nds may be null if the context is destroyed after the console is
+        void ContextDestroyed(melonDS::NDS* nds, const CoreConfig& config);
     private:
         struct Vertex {
             vec2 position;
@@ -69,11 +78,15 @@ namespace MelonDsDs {
         static_assert(sizeof(Vertex) == sizeof(vec2::value_type) * 4);
 
         void SetUpCoreOpenGlState(const CoreConfig& config);
+        void DeleteCoreOpenGlState() noexcept;
+        void ClearCoreOpenGlState() noexcept;
         void InitFrameState(melonDS::NDS& nds, const CoreConfig& config, const ScreenLayoutData& screenLayout) noexcept;
         void InitVertices(const ScreenLayoutData& screenLayout) noexcept;
         bool _openGlDebugAvailable = false;
         bool _needsRefresh = true;
         bool _contextInitialized = false;
+        // True if the frontend gave us a context that's shared with its own, and therefore outlives its resets
+        bool _sharedContext = false;
         GLuint _screenProgram = 0;
         GLuint screen_framebuffer_texture = 0;
         std::array<Vertex, 18> screen_vertices {};
@@ -94,6 +107,10 @@ namespace MelonDsDs {
 #ifdef HAVE_TRACY
         std::optional<OpenGlTracyCapture> _tracyCapture;
 #endif
+
+#ifdef HAVE_EGL
+        std::unique_ptr<HeadlessGlContext> _headless;
+#endif
     };
 }
 
@@ -0,0 +1,86 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include "pacing.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+
+#include "constants.hpp"
+#include "environment.hpp"
+#include "tracy.hpp"
+
+bool MelonDsDs::PresentationPacer::ShouldPresent() noexcept {
+    ZoneScopedN(TracyFunction);
+
+    bool present = Decide();
+    if (present) {
+        _stats.Presented++;
+    }
+    else {
+        _stats.Skipped++;
+    }
+
+    return present;
+}
+
+bool MelonDsDs::PresentationPacer::Decide() noexcept {
+    if (!retro::can_dupe()) {
+        // If the frontend needs a real frame every time...
+        return true;
+    }
+
+    std::optional<retro_throttle_state> throttle = retro::get_throttle_state();
+    if (!throttle || (throttle->mode != RETRO_THROTTLE_FAST_FORWARD && throttle->mode != RETRO_THROTTLE_UNBLOCKED)) {
+        // If we're running at (or below) normal speed, every frame has a chance to be seen
+        _framesSincePresent = 0;
+        return true;
+    }
+
+    if (_forcePresent) {
+        _forcePresent = false;
+        _framesSincePresent = 0;
+        return true;
+    }
+
+    if (++_framesSincePresent >= PresentInterval(*throttle)) {
+        _framesSincePresent = 0;
+        return true;
+    }
+
+    return false;
+}
+
+unsigned MelonDsDs::PresentationPacer::PresentInterval(const retro_throttle_state& throttle) noexcept {
+    using std::chrono::microseconds;
+
+    double speedup;
+    if (throttle.rate > 0) {
+        // If the frontend is targeting a specific frame rate...
+        speedup = throttle.rate / FPS;
+    }
+    else if (std::optional<microseconds> frameTime = retro::last_frame_time(); frameTime && frameTime->count() > 0 && *frameTime < US_PER_FRAME) {
+        // If the frontend is running unthrottled, but is still reporting the real time between frames...
+        speedup = static_cast<double>(US_PER_FRAME.count()) / frameTime->count();
+    }
+    else {
+        // The frontend is running as fast as it can, and we don't know how fast that is
+        return MAX_PRESENT_INTERVAL;
+    }
+
+    return std::clamp(static_cast<unsigned>(speedup), 1u, MAX_PRESENT_INTERVAL);
+}
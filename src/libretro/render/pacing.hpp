@@ -0,0 +1,49 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include <libretro.h>
+
+namespace MelonDsDs {
+    struct PresentationStats {
+        uint64_t Presented;
+        uint64_t Skipped;
+    };
+
+    /// Decides which emulated frames are worth presenting to the frontend.
+    /// While fast-forwarding, the frontend can only display a fraction of the frames we produce,
+    /// so the rest can skip compositing and be submitted as dupes instead.
+    /// Emulation and audio are unaffected.
+    class PresentationPacer {
+    public:
+        [[nodiscard]] bool ShouldPresent() noexcept;
+
+        /// Forces the next frame to be presented (e.g. after the screen layout changes).
+        void Reset() noexcept { _framesSincePresent = 0; _forcePresent = true; }
+        [[nodiscard]] PresentationStats Stats() const noexcept { return _stats; }
+    private:
+        [[nodiscard]] bool Decide() noexcept;
+        // Present at least this often, even if the frontend is running much faster
+        static constexpr unsigned MAX_PRESENT_INTERVAL = 16;
+        [[nodiscard]] static unsigned PresentInterval(const retro_throttle_state& throttle) noexcept;
+        unsigned _framesSincePresent = 0;
+        bool _forcePresent = true;
+        PresentationStats _stats {};
+    };
+}
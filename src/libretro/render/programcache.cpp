@@ -0,0 +1,301 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include "programcache.hpp"
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+
+#include "environment.hpp"
+#include "format.hpp"
+#include "retro/file.hpp"
+#include "tracy.hpp"
+
+using std::string;
+using std::string_view;
+
+constexpr const char* const PROGRAM_CACHE_DIR_NAME = "shaders";
+constexpr std::array<char, 8> PROGRAM_CACHE_MAGIC = {'M', 'D', 'S', 'P', 'B', 'I', 'N', '\0'};
+constexpr uint32_t PROGRAM_CACHE_VERSION = 1;
+
+// Precedes the program binary in each cache file.
+struct ProgramCacheHeader {
+    std::array<char, 8> Magic;
+    uint32_t Version;
+    uint32_t DriverHash;
+    uint32_t SourceHash;
+    uint32_t Format;
+    uint32_t Length;
+};
+
+namespace {
+    // Counted across sessions, so that a test can check that a later launch used the cache
+    MelonDsDs::ProgramCacheStats CacheStats {};
+}
+
+static uint32_t HashStrings(std::initializer_list<string_view> strings) noexcept {
+    uint32_t hash = 0;
+    for (string_view s : strings) {
+        hash = encoding_crc32(hash, reinterpret_cast<const uint8_t*>(s.data()), s.size());
+        hash = encoding_crc32(hash, reinterpret_cast<const uint8_t*>(""), 1); // So that {"ab", "c"} != {"a", "bc"}
+    }
+
+    return hash;
+}
+
+MelonDsDs::ProgramBinaryCache::ProgramBinaryCache() noexcept {
+    ZoneScopedN(TracyFunction);
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    if (numFormats <= 0) {
+        // If the driver can't give us any program binaries...
+        retro::debug("OpenGL driver doesn't support program binaries, shaders won't be cached");
+        return;
+    }
+
+    const char* vendor = (const char*)glGetString(GL_VENDOR);
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    const char* version = (const char*)glGetString(GL_VERSION);
+    if (!vendor || !renderer || !version) {
+        retro::warn("Failed to identify the OpenGL driver, shaders won't be cached");
+        return;
+    }
+
+    _driverHash = HashStrings({vendor, renderer, version});
+    _supported = true;
+}
+
+string MelonDsDs::ProgramBinaryCache::GetPath(string_view name) const noexcept {
+    char filename[PATH_MAX] {};
+    fmt::format_to_n(filename, sizeof(filename) - 1, "{}/{}.bin", PROGRAM_CACHE_DIR_NAME, name);
+
+    return retro::get_system_subdir_path(filename).value_or(string());
+}
+
+GLuint MelonDsDs::ProgramBinaryCache::Load(string_view name, std::initializer_list<string_view> sources) const noexcept {
+    ZoneScopedN(TracyFunction);
+    if (!_supported)
+        return 0;
+
+    GLuint program = LoadBinary(name, sources);
+    if (program) {
+        CacheStats.Hits++;
+    }
+    else {
+        CacheStats.Misses++;
+    }
+
+    return program;
+}
+
+GLuint MelonDsDs::ProgramBinaryCache::LoadBinary(string_view name, std::initializer_list<string_view> sources) const noexcept {
+    string path = GetPath(name);
+    if (path.empty() || !path_is_valid(path.c_str()))
+        return 0;
+
+    retro::rfile_ptr file = retro::make_rfile(path, RETRO_VFS_FILE_ACCESS_READ);
+    if (!file) {
+        retro::warn("Failed to open cached program binary \"{}\"", path);
+        return 0;
+    }
+
+    ProgramCacheHeader header {};
+    if (filestream_read(file.get(), &header, sizeof(header)) != sizeof(header) || header.Magic != PROGRAM_CACHE_MAGIC) {
+        retro::warn("Cached program binary \"{}\" is invalid, discarding it", path);
+        file = nullptr;
+        filestream_delete(path.c_str());
+        return 0;
+    }
+
+    if (header.Version != PROGRAM_CACHE_VERSION || header.DriverHash != _driverHash || header.SourceHash != HashStrings(sources)) {
+        // If the driver or the shaders have changed since this binary was cached...
+        retro::info("Cached program binary \"{}\" is out of date, discarding it", path);
+        file = nullptr;
+        filestream_delete(path.c_str());
+        return 0;
+    }
+
+    int64_t fileSize = filestream_get_size(file.get());
+    if (header.Length == 0 || fileSize < 0 || header.Length > static_cast<uint64_t>(fileSize) - sizeof(header)) {
+        // Don't trust the header's length until we know the file actually has that much data
+        retro::warn("Cached program binary \"{}\" claims to hold {} bytes but doesn't, discarding it", path, header.Length);
+        file = nullptr;
+        filestream_delete(path.c_str());
+        return 0;
+    }
+
+    std::vector<uint8_t> binary(header.Length);
+    if (filestream_read(file.get(), binary.data(), binary.size()) != static_cast<int64_t>(binary.size())) {
+        retro::warn("Cached program binary \"{}\" is truncated, discarding it", path);
+        file = nullptr;
+        filestream_delete(path.c_str());
+        return 0;
+    }
+    file = nullptr;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.Format, binary.data(), binary.size());
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        // The driver is allowed to reject binaries for any reason (e.g. a silent update)
+        retro::info("OpenGL driver rejected cached program binary \"{}\", discarding it", path);
+        glDeleteProgram(program);
+        filestream_delete(path.c_str());
+        return 0;
+    }
+
+    retro::debug("Loaded {}-byte program binary from \"{}\"", binary.size(), path);
+    return program;
+}
+
+static GLuint CompileShader(string_view name, GLenum type, string_view source) noexcept {
+    GLuint shader = glCreateShader(type);
+    const GLchar* text = source.data();
+    GLint length = source.size();
+    glShaderSource(shader, 1, &text, &length);
+    glCompileShader(shader);
+
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        std::array<GLchar, 1024> log {};
+        glGetShaderInfoLog(shader, log.size(), nullptr, log.data());
+        retro::error("Failed to compile {} shader for \"{}\": {}", type == GL_VERTEX_SHADER ? "vertex" : "fragment", name, log.data());
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+GLuint MelonDsDs::ProgramBinaryCache::Build(
+    string_view name,
+    string_view vertexSource,
+    string_view fragmentSource,
+    std::initializer_list<std::pair<const char*, GLuint>> attributes,
+    std::initializer_list<std::pair<const char*, GLuint>> outputs
+) const noexcept {
+    ZoneScopedN(TracyFunction);
+    GLuint vertexShader = CompileShader(name, GL_VERTEX_SHADER, vertexSource);
+    GLuint fragmentShader = CompileShader(name, GL_FRAGMENT_SHADER, fragmentSource);
+    if (!vertexShader || !fragmentShader) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    for (const auto& [attribute, location] : attributes) {
+        glBindAttribLocation(program, location, attribute);
+    }
+
+    for (const auto& [output, location] : outputs) {
+        glBindFragDataLocation(program, location, output);
+    }
+
+    if (_supported) {
+        // Some drivers only provide binaries for programs linked with this hint,
+        // and it only takes effect on the next link
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    glLinkProgram(program);
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        std::array<GLchar, 1024> log {};
+        glGetProgramInfoLog(program, log.size(), nullptr, log.data());
+        retro::error("Failed to link \"{}\": {}", name, log.data());
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+bool MelonDsDs::ProgramBinaryCache::Store(string_view name, std::initializer_list<string_view> sources, GLuint program) const noexcept {
+    ZoneScopedN(TracyFunction);
+    if (!_supported || program == 0)
+        return false;
+
+    string path = GetPath(name);
+    if (path.empty()) {
+        retro::warn("No system directory available, can't cache program binary for \"{}\"", name);
+        return false;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        retro::debug("OpenGL driver didn't provide a binary for \"{}\", not caching it", name);
+        return false;
+    }
+
+    ProgramCacheHeader header {
+        .Magic = PROGRAM_CACHE_MAGIC,
+        .Version = PROGRAM_CACHE_VERSION,
+        .DriverHash = _driverHash,
+        .SourceHash = HashStrings(sources),
+    };
+    std::vector<uint8_t> buffer(sizeof(header) + length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, buffer.data() + sizeof(header));
+    if (written <= 0) {
+        retro::warn("Failed to get program binary for \"{}\"", name);
+        return false;
+    }
+
+    header.Format = format;
+    header.Length = written;
+    memcpy(buffer.data(), &header, sizeof(header));
+
+    char dir[PATH_MAX] {};
+    strlcpy(dir, path.c_str(), sizeof(dir));
+    path_basedir(dir);
+    if (!path_mkdir(dir)) {
+        retro::error("Error creating shader cache directory \"{}\"", dir);
+        return false;
+    }
+
+    if (!filestream_write_file(path.c_str(), buffer.data(), sizeof(header) + written)) {
+        retro::error("Failed to write {}-byte program binary to \"{}\"", written, path);
+        return false;
+    }
+
+    retro::debug("Cached {}-byte program binary to \"{}\"", written, path);
+    CacheStats.Stores++;
+    return true;
+}
+
+MelonDsDs::ProgramCacheStats MelonDsDs::ProgramBinaryCache::Stats() noexcept {
+    return CacheStats;
+}
@@ -0,0 +1,80 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "PlatformOGLPrivate.h"
+
+namespace MelonDsDs {
+    /// Exposed to C callers as-is, so keep it standard-layout.
+    struct ProgramCacheStats {
+        /// Programs loaded from a cached binary
+        uint32_t Hits;
+        /// Programs that had to be compiled because there was no usable binary
+        uint32_t Misses;
+        /// Binaries written to the cache
+        uint32_t Stores;
+    };
+
+    /// \brief Stores linked OpenGL program binaries in the system directory
+    /// so that later context resets can skip shader compilation.
+    ///
+    /// Each cached program is keyed by the driver's vendor, renderer, and version strings
+    /// and by a hash of its shader sources.
+    /// A mismatch on either key discards the cached binary.
+    /// Must be constructed and used while the OpenGL context is bound.
+    class ProgramBinaryCache {
+    public:
+        ProgramBinaryCache() noexcept;
+        [[nodiscard]] bool Supported() const noexcept { return _supported; }
+
+        /// \returns A linked program built from the cached binary,
+        /// or 0 if there was no usable binary.
+        [[nodiscard]] GLuint Load(std::string_view name, std::initializer_list<std::string_view> sources) const noexcept;
+
+        /// Compiles and links a program from vertex and fragment shader sources.
+        /// If binaries are supported, the program is linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+        /// so that Store can get its binary from drivers that only provide binaries on request.
+        /// \returns The linked program, or 0 if it failed to compile or link.
+        [[nodiscard]] GLuint Build(
+            std::string_view name,
+            std::string_view vertexSource,
+            std::string_view fragmentSource,
+            std::initializer_list<std::pair<const char*, GLuint>> attributes,
+            std::initializer_list<std::pair<const char*, GLuint>> outputs
+        ) const noexcept;
+
+        /// Writes the binary of an already-linked program to the cache.
+        /// Never relinks the program, since it may already be in use.
+        bool Store(std::string_view name, std::initializer_list<std::string_view> sources, GLuint program) const noexcept;
+
+        /// Totals since the core was loaded; they survive retro_deinit.
+        [[nodiscard]] static ProgramCacheStats Stats() noexcept;
+    private:
+        [[nodiscard]] std::string GetPath(std::string_view name) const noexcept;
+        [[nodiscard]] GLuint LoadBinary(std::string_view name, std::initializer_list<std::string_view> sources) const noexcept;
+        bool _supported = false;
+        uint32_t _driverHash = 0;
+    };
+}
+#endif
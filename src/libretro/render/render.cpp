@@ -23,9 +23,11 @@
 #include <retro_assert.h>
 
 #include "config/config.hpp"
+#include "environment.hpp"
 #include "message/error.hpp"
 #include "render/software.hpp"
 #include "screenlayout.hpp"
+#include "tracy.hpp"
 
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
 #include <GPU3D_OpenGL.h>
@@ -53,6 +55,12 @@ void MelonDsDs::RenderStateWrapper::Render(
     static_cast<SoftwareRenderState*>(_renderState.get())->Render(error, screenLayout);
 }
 
+void MelonDsDs::RenderStateWrapper::Skip(const ScreenLayoutData& screenLayout) noexcept {
+    ZoneScopedN(TracyFunction);
+    glm::uvec2 size = screenLayout.BufferSize();
+    retro::video_refresh(nullptr, size.x, size.y, 0);
+}
+
 void MelonDsDs::RenderStateWrapper::Apply(const CoreConfig& config) noexcept {
     SetRenderer(config);
 }
@@ -67,7 +75,7 @@ void MelonDsDs::RenderStateWrapper::SetRenderer(const CoreConfig& config) {
                 break;
             }
 
-            if (auto state = OpenGLRenderState::New()) {
+            if (auto state = OpenGLRenderState::New(config.HeadlessOpenGl())) {
                 _renderState = std::move(state);
                 retro::debug("Initialized OpenGL render state");
                 break;
@@ -110,6 +118,23 @@ void MelonDsDs::RenderStateWrapper::UpdateRenderer(const CoreConfig& config, mel
     }
 
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+    if (auto* glRender = dynamic_cast<OpenGLRenderState*>(_renderState.get()); glRender && glRender->Headless() && !glRender->Ready()) {
+        // If we're switching to headless OpenGL, no frontend will reset the context for us...
+        try {
+            glRender->ContextReset(nds, config);
+            return;
+        }
+        catch (const std::exception& e) {
+            retro::error("{}", e.what());
+            retro::set_warn_message("Failed to initialize headless OpenGL renderer, falling back to software mode.");
+            _renderState = std::make_unique<SoftwareRenderState>(config);
+            auto softwareRenderer = std::make_unique<melonDS::SoftRenderer>();
+            softwareRenderer->SetThreaded(config.ThreadedSoftRenderer(), nds.GPU);
+            nds.GPU.SetRenderer3D(std::move(softwareRenderer));
+            return;
+        }
+    }
+
     if (auto* glRender = dynamic_cast<OpenGLRenderState*>(_renderState.get()); glRender && !nds.GPU.GetRenderer3D().Accelerated) {
         // If we're configured to use the OpenGL renderer, and we aren't already...
         retro::debug("Initializing OpenGL renderer");
@@ -137,12 +162,21 @@ void MelonDsDs::RenderStateWrapper::ContextReset(melonDS::NDS& nds, const CoreCo
 #endif
 }
 
-void MelonDsDs::RenderStateWrapper::ContextDestroyed() {
+void MelonDsDs::RenderStateWrapper::ContextDestroyed(melonDS::NDS* nds, const CoreConfig& config) {
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
     if (auto glRenderState = dynamic_cast<OpenGLRenderState*>(_renderState.get())) {
-        glRenderState->ContextDestroyed();
+        glRenderState->ContextDestroyed(nds, config);
+    }
+#endif
+}
+
+bool MelonDsDs::RenderStateWrapper::IsHeadless() const noexcept {
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+    if (auto glRenderState = dynamic_cast<const OpenGLRenderState*>(_renderState.get())) {
+        return glRenderState->Headless();
     }
 #endif
+    return false;
 }
 
 std::optional<MelonDsDs::RenderMode> MelonDsDs::RenderStateWrapper::GetRenderMode() const noexcept {
@@ -51,6 +51,9 @@ namespace MelonDsDs {
         bool Ready() const noexcept { return _renderState && _renderState->Ready(); }
         void Render(melonDS::NDS& nds, const InputState& input, const CoreConfig& config, const ScreenLayoutData& screenLayout) noexcept;
         void Render(const error::ErrorScreen& error, const CoreConfig& config, const ScreenLayoutData& screenLayout) noexcept;
+
+        /// Tells the frontend to show the previous frame again, without compositing a new one.
+        void Skip(const ScreenLayoutData& screenLayout) noexcept;
         void RequestRefresh() noexcept {
             if (_renderState) {
                 _renderState->RequestRefresh();
@@ -60,7 +63,8 @@ namespace MelonDsDs {
         void Apply(const CoreConfig& config) noexcept;
         [[gnu::cold]] void UpdateRenderer(const CoreConfig& config, melonDS::NDS& nds) noexcept;
         void ContextReset(melonDS::NDS& nds, const CoreConfig& config);
-        void ContextDestroyed();
+        void ContextDestroyed(melonDS::NDS* nds, const CoreConfig& config);
+        [[nodiscard]] bool IsHeadless() const noexcept;
         std::optional<RenderMode> GetRenderMode() const noexcept;
     private:
         void SetRenderer(const CoreConfig& config);
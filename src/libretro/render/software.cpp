@@ -19,7 +19,6 @@
 #include <retro_assert.h>
 
 #include <NDS.h>
-#include <gfx/scaler/pixconv.h>
 
 #include "config/config.hpp"
 #include "config/types.hpp"
@@ -85,16 +84,13 @@ void MelonDsDs::SoftwareRenderState::Render(
 #ifdef HAVE_TRACY
     if (tracy::ProfilerAvailable()) {
         // If Tracy is connected...
-        ZoneScopedN("MelonDsDs::render::RenderSoftware::SendFrameToTracy");
-        std::unique_ptr<uint8_t[]> frame = std::make_unique<uint8_t[]>(buffer.Width() * buffer.Height() * 4);
-        {
-            ZoneScopedN("conv_argb8888_abgr8888");
-            conv_argb8888_abgr8888(frame.get(), buffer[0], buffer.Width(), buffer.Height(), buffer.Stride(), buffer.Stride());
+        if (!_tracyCapture) {
+            _tracyCapture = std::make_unique<FrameCapturePool>();
         }
-        // libretro wants pixels in XRGB8888 format,
-        // but Tracy wants them in XBGR8888 format.
 
-        FrameImage(frame.get(), buffer.Width(), buffer.Height(), 0, false);
+        // The conversion and submission happen on the pool's worker thread
+        _tracyCapture->Submit(buffer[0], buffer.Width(), buffer.Height(), buffer.Stride(), FrameCapturePool::PixelFormat::Xrgb8888, false);
+        _tracyCapture->AdvanceFrame();
     }
 #endif
 }
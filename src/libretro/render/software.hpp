@@ -28,6 +28,11 @@
 #include "screenlayout.hpp"
 #include "retro/scaler.hpp"
 
+#ifdef HAVE_TRACY
+#include <memory>
+#include "tracy/capture.hpp"
+#endif
+
 namespace MelonDsDs {
     namespace error {
         class ErrorScreen;
@@ -68,6 +73,9 @@ namespace MelonDsDs {
         // Used as a staging area for the hybrid screen to be scaled
         PixelBuffer hybridBuffer;
         retro::Scaler hybridScaler;
+#ifdef HAVE_TRACY
+        std::unique_ptr<FrameCapturePool> _tracyCapture;
+#endif
     };
 }
 
@@ -30,3 +30,10 @@ retro::GameInfo::GameInfo(const retro_game_info& info) noexcept :
     }
 }
 
+retro::GameInfo::GameInfo(const retro_game_info& info, std::unique_ptr<std::byte[]>&& data, size_t size) noexcept :
+    _path(info.path ? info.path : ""),
+    _data(std::move(data)),
+    _size(size),
+    _meta(info.meta ? info.meta : "")
+{
+}
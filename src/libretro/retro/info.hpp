@@ -32,6 +32,9 @@ namespace retro {
     public:
         GameInfo(const retro_game_info& info) noexcept;
 
+        /// Uses \c data instead of \c info.data, e.g. for a ROM that was extracted from an archive.
+        GameInfo(const retro_game_info& info, std::unique_ptr<std::byte[]>&& data, size_t size) noexcept;
+
         std::string_view GetPath() const noexcept { return _path; }
         std::span<const std::byte> GetData() const noexcept {
             return std::span(_data.get(), _size);
@@ -0,0 +1,554 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#include "romarchive.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "environment.hpp"
+#include "exceptions.hpp"
+#include "tracy.hpp"
+
+using std::span;
+using std::string_view;
+
+namespace {
+    // RZIP archives start with "#RZIPv", a version byte, and '#',
+    // then the chunk size (32-bit) and the uncompressed size (64-bit), both little-endian.
+    // Each chunk is a 32-bit compressed length followed by a zlib stream.
+    constexpr char RZIP_MAGIC[] = "#RZIPv";
+    constexpr uint8_t RZIP_VERSION = 1;
+    constexpr size_t RZIP_HEADER_SIZE = 20;
+    constexpr size_t RZIP_CHUNK_HEADER_SIZE = 4;
+    constexpr uint32_t MAX_RZIP_CHUNK_SIZE = 64 * 1024 * 1024;
+
+    constexpr uint32_t ZIP_LOCAL_HEADER = 0x04034b50;
+    constexpr uint32_t ZIP_CENTRAL_HEADER = 0x02014b50;
+    constexpr uint32_t ZIP_END_OF_DIRECTORY = 0x06054b50;
+    constexpr size_t ZIP_LOCAL_HEADER_SIZE = 30;
+    constexpr size_t ZIP_CENTRAL_HEADER_SIZE = 46;
+    constexpr size_t ZIP_END_OF_DIRECTORY_SIZE = 22;
+    constexpr size_t ZIP_MAX_COMMENT_SIZE = 0xFFFF;
+    constexpr uint16_t ZIP_METHOD_STORED = 0;
+    constexpr uint16_t ZIP_METHOD_DEFLATED = 8;
+    constexpr uint16_t ZIP_FLAG_ENCRYPTED = 1;
+    constexpr uint32_t ZIP64_SENTINEL = 0xFFFFFFFF;
+
+    // Guards against nonsense sizes in corrupt headers (the largest DS cart is 512MiB)
+    constexpr uint64_t MAX_ROM_SIZE = 1024 * 1024 * 1024;
+
+    uint16_t Read16(const uint8_t* data) noexcept {
+        return data[0] | (data[1] << 8);
+    }
+
+    uint32_t Read32(const uint8_t* data) noexcept {
+        return Read16(data) | (static_cast<uint32_t>(Read16(data + 2)) << 16);
+    }
+
+    uint64_t Read64(const uint8_t* data) noexcept {
+        return Read32(data) | (static_cast<uint64_t>(Read32(data + 4)) << 32);
+    }
+
+    bool IsRomName(string_view name) noexcept {
+        size_t dot = name.rfind('.');
+        if (dot == string_view::npos || name.back() == '/')
+            return false;
+
+        std::string extension(name.substr(dot + 1));
+        return string_is_equal_noncase(extension.c_str(), "nds")
+            || string_is_equal_noncase(extension.c_str(), "dsi")
+            || string_is_equal_noncase(extension.c_str(), "ids");
+    }
+
+    const char* FormatName(MelonDsDs::RomArchive::Format format) noexcept {
+        switch (format) {
+            case MelonDsDs::RomArchive::Format::Rzip:
+                return "RZIP";
+            case MelonDsDs::RomArchive::Format::ZipStored:
+                return "zip (stored)";
+            case MelonDsDs::RomArchive::Format::ZipDeflated:
+                return "zip (deflated)";
+            default:
+                return "<unknown>";
+        }
+    }
+}
+
+struct MelonDsDs::RomArchive::Inflater {
+#ifdef HAVE_ZLIB
+    explicit Inflater(int windowBits) noexcept {
+        Initialized = inflateInit2(&Stream, windowBits) == Z_OK;
+    }
+
+    ~Inflater() noexcept {
+        if (Initialized) {
+            inflateEnd(&Stream);
+        }
+    }
+
+    z_stream Stream {};
+    bool Initialized = false;
+#endif
+};
+
+bool MelonDsDs::RomArchive::IsArchive(string_view path) noexcept {
+    std::string pathString(path);
+    const char* extension = path_get_extension(pathString.c_str());
+    return string_is_equal_noncase(extension, "zip") || string_is_equal_noncase(extension, "rzip");
+}
+
+std::unique_ptr<MelonDsDs::RomArchive> MelonDsDs::RomArchive::Open(string_view path, span<const std::byte> data) {
+    ZoneScopedN(TracyFunction);
+    std::unique_ptr<RomArchive> archive(new RomArchive(path, data));
+
+    uint8_t magic[sizeof(RZIP_MAGIC) - 1] {};
+    if (!archive->ReadRaw(0, magic, sizeof(magic))) {
+        throw content_exception("The loaded archive is too small to contain a Nintendo DS ROM.");
+    }
+
+    if (memcmp(magic, RZIP_MAGIC, sizeof(magic)) == 0) {
+        archive->OpenRzip();
+    }
+    else if (Read32(magic) == ZIP_LOCAL_HEADER) {
+        archive->OpenZip();
+    }
+    else {
+        throw content_exception("The loaded archive isn't a zip or RZIP file, please extract the ROM first.");
+    }
+
+    archive->_stats.UncompressedSize = archive->_size;
+    archive->UpdatePeak(0);
+    retro::debug("Opened {} archive {} ({} bytes, {} compressed)", FormatName(archive->_format), path, archive->_size, archive->_archiveSize);
+    return archive;
+}
+
+MelonDsDs::RomArchive::RomArchive(string_view path, span<const std::byte> data) : _path(path), _memory(data) {
+    if (!_memory.empty()) {
+        // If the frontend already loaded the archive (e.g. it ignored our request for just the path)...
+        _archiveSize = _memory.size();
+    }
+    else {
+        _file = filestream_open(_path.c_str(), RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+        if (!_file) {
+            throw content_exception("Failed to open the loaded archive.");
+        }
+        _archiveSize = filestream_get_size(_file);
+    }
+
+    _stats.CompressedSize = _archiveSize;
+}
+
+MelonDsDs::RomArchive::~RomArchive() noexcept {
+    if (_file) {
+        filestream_close(_file);
+    }
+}
+
+void MelonDsDs::RomArchive::OpenRzip() {
+#ifdef HAVE_ZLIB
+    uint8_t header[RZIP_HEADER_SIZE];
+    if (!ReadRaw(0, header, sizeof(header))) {
+        throw content_exception("The loaded RZIP archive is truncated.");
+    }
+
+    if (header[6] != RZIP_VERSION || header[7] != '#') {
+        throw content_exception("The loaded RZIP archive uses an unsupported version of the format.");
+    }
+
+    _format = Format::Rzip;
+    _blockSize = Read32(header + 8);
+    _size = Read64(header + 12);
+    if (_blockSize == 0 || _blockSize > MAX_RZIP_CHUNK_SIZE || _size == 0 || _size > MAX_ROM_SIZE) {
+        throw content_exception("The loaded RZIP archive has an invalid header.");
+    }
+
+    // Chunks aren't indexed, but their headers are small enough that walking them is cheap
+    uint64_t numChunks = (_size + _blockSize - 1) / _blockSize;
+    uint64_t offset = RZIP_HEADER_SIZE;
+    _chunks.reserve(numChunks);
+    for (uint64_t i = 0; i < numChunks; ++i) {
+        uint8_t chunkHeader[RZIP_CHUNK_HEADER_SIZE];
+        if (!ReadRaw(offset, chunkHeader, sizeof(chunkHeader))) {
+            throw content_exception("The loaded RZIP archive is truncated.");
+        }
+
+        uint32_t length = Read32(chunkHeader);
+        offset += RZIP_CHUNK_HEADER_SIZE;
+        if (length == 0 || offset + length > _archiveSize) {
+            throw content_exception("The loaded RZIP archive is corrupt.");
+        }
+
+        _chunks.push_back({offset, length});
+        offset += length;
+    }
+
+    _inflater = std::make_unique<Inflater>(MAX_WBITS + 32); // zlib or gzip, detected automatically
+#else
+    throw content_exception("This build of melonDS DS can't read RZIP archives, please extract the ROM first.");
+#endif
+}
+
+void MelonDsDs::RomArchive::OpenZip() {
+    // The central directory is at the end of the file, after an optional comment
+    uint64_t tailLength = std::min<uint64_t>(_archiveSize, ZIP_END_OF_DIRECTORY_SIZE + ZIP_MAX_COMMENT_SIZE);
+    std::vector<uint8_t> tail(tailLength);
+    if (tailLength < ZIP_END_OF_DIRECTORY_SIZE || !ReadRaw(_archiveSize - tailLength, tail.data(), tailLength)) {
+        throw content_exception("The loaded zip archive is truncated.");
+    }
+
+    const uint8_t* end = nullptr;
+    for (size_t i = tailLength - ZIP_END_OF_DIRECTORY_SIZE + 1; i-- > 0;) {
+        if (Read32(&tail[i]) == ZIP_END_OF_DIRECTORY) {
+            end = &tail[i];
+            break;
+        }
+    }
+
+    if (!end) {
+        throw content_exception("The loaded zip archive is corrupt.");
+    }
+
+    uint16_t numEntries = Read16(end + 10);
+    uint32_t directorySize = Read32(end + 12);
+    uint32_t directoryOffset = Read32(end + 16);
+    if (directoryOffset == ZIP64_SENTINEL || directorySize == ZIP64_SENTINEL || numEntries == 0xFFFF) {
+        throw content_exception("The loaded zip archive uses the Zip64 format, please extract the ROM first.");
+    }
+
+    std::vector<uint8_t> directory(directorySize);
+    if (!ReadRaw(directoryOffset, directory.data(), directorySize)) {
+        throw content_exception("The loaded zip archive is truncated.");
+    }
+
+    size_t position = 0;
+    for (unsigned i = 0; i < numEntries; ++i) {
+        if (position + ZIP_CENTRAL_HEADER_SIZE > directory.size() || Read32(&directory[position]) != ZIP_CENTRAL_HEADER) {
+            throw content_exception("The loaded zip archive is corrupt.");
+        }
+
+        const uint8_t* entry = &directory[position];
+        uint16_t flags = Read16(entry + 8);
+        uint16_t method = Read16(entry + 10);
+        uint32_t compressedSize = Read32(entry + 20);
+        uint32_t size = Read32(entry + 24);
+        uint16_t nameLength = Read16(entry + 28);
+        uint16_t extraLength = Read16(entry + 30);
+        uint16_t commentLength = Read16(entry + 32);
+        uint32_t localHeaderOffset = Read32(entry + 42);
+        if (position + ZIP_CENTRAL_HEADER_SIZE + nameLength > directory.size()) {
+            throw content_exception("The loaded zip archive is corrupt.");
+        }
+
+        string_view name(reinterpret_cast<const char*>(entry + ZIP_CENTRAL_HEADER_SIZE), nameLength);
+        position += ZIP_CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength;
+        if (!IsRomName(name))
+            continue;
+
+        if (flags & ZIP_FLAG_ENCRYPTED) {
+            throw content_exception("The ROM in the loaded zip archive is encrypted, please extract it first.");
+        }
+
+        if (compressedSize == ZIP64_SENTINEL || size == ZIP64_SENTINEL || localHeaderOffset == ZIP64_SENTINEL) {
+            throw content_exception("The loaded zip archive uses the Zip64 format, please extract the ROM first.");
+        }
+
+        if (method == ZIP_METHOD_STORED) {
+            _format = Format::ZipStored;
+        }
+        else if (method == ZIP_METHOD_DEFLATED) {
+#ifdef HAVE_ZLIB
+            _format = Format::ZipDeflated;
+#else
+            throw content_exception("This build of melonDS DS can't read compressed zip archives, please extract the ROM first.");
+#endif
+        }
+        else {
+            throw content_exception("The ROM in the loaded zip archive uses an unsupported compression method, please extract it first.");
+        }
+
+        // The local header's name and extra field can differ from the central directory's
+        uint8_t localHeader[ZIP_LOCAL_HEADER_SIZE];
+        if (!ReadRaw(localHeaderOffset, localHeader, sizeof(localHeader)) || Read32(localHeader) != ZIP_LOCAL_HEADER) {
+            throw content_exception("The loaded zip archive is corrupt.");
+        }
+
+        _entryOffset = localHeaderOffset + ZIP_LOCAL_HEADER_SIZE + Read16(localHeader + 26) + Read16(localHeader + 28);
+        _entryLength = compressedSize;
+        _size = size;
+        if (_size == 0 || _size > MAX_ROM_SIZE || _entryOffset + _entryLength > _archiveSize) {
+            throw content_exception("The loaded zip archive is corrupt.");
+        }
+
+        if (_format == Format::ZipStored && _entryLength != _size) {
+            throw content_exception("The loaded zip archive is corrupt.");
+        }
+
+        retro::debug("Found {} in {}", name, _path);
+        _blockSize = ZIP_BLOCK_SIZE;
+        if (_format == Format::ZipDeflated) {
+            _inflater = std::make_unique<Inflater>(-MAX_WBITS); // Raw deflate, no header
+            _inputPosition = _entryOffset;
+        }
+        return;
+    }
+
+    throw content_exception("The loaded zip archive doesn't contain a Nintendo DS ROM (.nds, .dsi, or .ids).");
+}
+
+bool MelonDsDs::RomArchive::ReadRaw(uint64_t offset, void* out, uint64_t length) noexcept {
+    if (offset > _archiveSize || length > _archiveSize - offset)
+        return false;
+
+    if (!_memory.empty()) {
+        memcpy(out, _memory.data() + offset, length);
+        return true;
+    }
+
+    if (filestream_seek(_file, offset, RETRO_VFS_SEEK_POSITION_START) != 0)
+        return false;
+
+    return filestream_read(_file, out, length) == static_cast<int64_t>(length);
+}
+
+uint64_t MelonDsDs::RomArchive::BlockLength(uint64_t index) const noexcept {
+    uint64_t start = index * _blockSize;
+    return start < _size ? std::min<uint64_t>(_blockSize, _size - start) : 0;
+}
+
+void MelonDsDs::RomArchive::UpdatePeak(uint64_t extra) noexcept {
+    uint64_t current = _memory.size() + _input.capacity() + extra;
+    for (const Block& block : _cache) {
+        current += block.Data.capacity();
+    }
+
+    _stats.PeakBytes = std::max(_stats.PeakBytes, current);
+}
+
+bool MelonDsDs::RomArchive::Read(uint64_t offset, span<std::byte> out) noexcept {
+    ZoneScopedN(TracyFunction);
+    if (offset > _size || out.size() > _size - offset)
+        return false;
+
+    while (!out.empty()) {
+        uint64_t index = offset / _blockSize;
+        uint64_t within = offset % _blockSize;
+        auto cached = std::find_if(_cache.begin(), _cache.end(), [index](const Block& block) { return block.Index == index; });
+        if (cached != _cache.end()) {
+            _stats.CacheHits++;
+            _cache.splice(_cache.begin(), _cache, cached);
+        }
+        else {
+            Block block { index, {} };
+            if (_cache.size() >= CACHED_BLOCKS) {
+                // Reuse the least recently used block's buffer
+                block.Data = std::move(_cache.back().Data);
+                _cache.pop_back();
+            }
+
+            block.Data.resize(BlockLength(index));
+            if (!DecompressBlock(index, block.Data))
+                return false;
+
+            _cache.push_front(std::move(block));
+            UpdatePeak(0);
+        }
+
+        const Block& block = _cache.front();
+        size_t length = std::min<uint64_t>(out.size(), block.Data.size() - within);
+        memcpy(out.data(), block.Data.data() + within, length);
+        out = out.subspan(length);
+        offset += length;
+    }
+
+    return true;
+}
+
+bool MelonDsDs::RomArchive::DecompressBlock(uint64_t index, span<std::byte> out) noexcept {
+    _stats.BlocksDecompressed++;
+    switch (_format) {
+        case Format::Rzip:
+            return index < _chunks.size() && InflateChunk(_chunks[index], out);
+        case Format::ZipStored:
+            return ReadRaw(_entryOffset + index * _blockSize, out.data(), out.size());
+        case Format::ZipDeflated:
+            if (index < _nextBlock && !RestartStream())
+                return false;
+
+            if (_nextBlock < index) {
+                // Deflate streams can't be entered partway through, so decompress (and discard) everything before this block
+                std::vector<std::byte> skipped(_blockSize);
+                UpdatePeak(skipped.size());
+                for (; _nextBlock < index; ++_nextBlock) {
+                    if (!InflateNext(span(skipped.data(), BlockLength(_nextBlock))))
+                        return false;
+                }
+            }
+
+            if (!InflateNext(out))
+                return false;
+
+            ++_nextBlock;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool MelonDsDs::RomArchive::InflateChunk(const Chunk& chunk, span<std::byte> out) noexcept {
+#ifdef HAVE_ZLIB
+    if (!_inflater || !_inflater->Initialized || inflateReset(&_inflater->Stream) != Z_OK)
+        return false;
+
+    z_stream& stream = _inflater->Stream;
+    if (!_memory.empty()) {
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<std::byte*>(_memory.data() + chunk.Offset));
+    }
+    else {
+        _input.resize(chunk.Length);
+        if (!ReadRaw(chunk.Offset, _input.data(), chunk.Length))
+            return false;
+
+        stream.next_in = reinterpret_cast<Bytef*>(_input.data());
+    }
+    stream.avail_in = chunk.Length;
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = out.size();
+
+    return inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.avail_out == 0;
+#else
+    return false;
+#endif
+}
+
+bool MelonDsDs::RomArchive::InflateNext(span<std::byte> out) noexcept {
+#ifdef HAVE_ZLIB
+    if (!_inflater || !_inflater->Initialized)
+        return false;
+
+    z_stream& stream = _inflater->Stream;
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = out.size();
+    uint64_t entryEnd = _entryOffset + _entryLength;
+    while (stream.avail_out > 0) {
+        if (stream.avail_in == 0) {
+            // If we need more compressed data...
+            uint64_t length = std::min<uint64_t>(ZIP_BLOCK_SIZE, entryEnd - _inputPosition);
+            if (length == 0)
+                return false;
+
+            if (!_memory.empty()) {
+                stream.next_in = reinterpret_cast<Bytef*>(const_cast<std::byte*>(_memory.data() + _inputPosition));
+            }
+            else {
+                _input.resize(ZIP_BLOCK_SIZE);
+                if (!ReadRaw(_inputPosition, _input.data(), length))
+                    return false;
+
+                stream.next_in = reinterpret_cast<Bytef*>(_input.data());
+            }
+            stream.avail_in = length;
+            _inputPosition += length;
+        }
+
+        int result = inflate(&stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END)
+            return stream.avail_out == 0;
+
+        if (result != Z_OK)
+            return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool MelonDsDs::RomArchive::RestartStream() noexcept {
+#ifdef HAVE_ZLIB
+    if (!_inflater || !_inflater->Initialized || inflateReset(&_inflater->Stream) != Z_OK)
+        return false;
+
+    if (_nextBlock > 0) {
+        _stats.StreamRestarts++;
+    }
+
+    _inflater->Stream.avail_in = 0;
+    _inputPosition = _entryOffset;
+    _nextBlock = 0;
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<std::byte[]> MelonDsDs::RomArchive::ReadAll() noexcept {
+    ZoneScopedN(TracyFunction);
+    auto start = std::chrono::steady_clock::now();
+
+    // Not make_unique, since that would zero the buffer just before we overwrite it
+    std::unique_ptr<std::byte[]> rom(new std::byte[_size]);
+    bool ok = false;
+    switch (_format) {
+        case Format::Rzip:
+            ok = true;
+            for (size_t i = 0; ok && i < _chunks.size(); ++i) {
+                ok = InflateChunk(_chunks[i], span(rom.get() + i * _blockSize, BlockLength(i)));
+            }
+            break;
+        case Format::ZipStored:
+            ok = ReadRaw(_entryOffset, rom.get(), _size);
+            break;
+        case Format::ZipDeflated:
+            ok = RestartStream() && InflateNext(span(rom.get(), _size));
+            // The stream is at the end now, so the next cached read will start it over
+            _nextBlock = (_size + _blockSize - 1) / _blockSize;
+            break;
+    }
+
+    _stats.ReadAllMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    UpdatePeak(_size);
+    if (!ok) {
+        retro::error("Failed to decompress the ROM in {}", _path);
+        return nullptr;
+    }
+
+    return rom;
+}
+
+void MelonDsDs::RomArchive::LogStats() const noexcept {
+    retro::info(
+        "{} archive: decompressed {} bytes from {} in {:.1f}ms (peak memory {} bytes); {} block(s) decompressed, {} cache hit(s), {} stream restart(s)",
+        FormatName(_format),
+        _stats.UncompressedSize,
+        _stats.CompressedSize,
+        _stats.ReadAllMs,
+        _stats.PeakBytes,
+        _stats.BlocksDecompressed,
+        _stats.CacheHits,
+        _stats.StreamRestarts
+    );
+}
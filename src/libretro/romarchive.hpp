@@ -0,0 +1,137 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "std/span.hpp"
+
+struct RFILE;
+
+namespace MelonDsDs {
+    struct RomArchiveStats {
+        uint64_t CompressedSize;
+        uint64_t UncompressedSize;
+        uint64_t BlocksDecompressed;
+        uint64_t CacheHits;
+        uint64_t StreamRestarts;
+        /// The most memory the archive needed at once, including the decompressed ROM (if it was read in full)
+        uint64_t PeakBytes;
+        double ReadAllMs;
+    };
+
+    /// A DS ROM inside a compressed container, read without extracting it first.
+    ///
+    /// Two containers are supported:
+    /// - RZIP (libretro's chunked zlib format), where each chunk can be decompressed on its own
+    /// - zip, using the first entry with a DS ROM's extension; it may be stored or deflated.
+    ///
+    /// Reads go through a small cache of decompressed blocks.
+    /// Deflated zip entries can only be decompressed from the start,
+    /// so reading one of those out of order restarts the stream.
+    class RomArchive {
+    public:
+        enum class Format {
+            Rzip,
+            ZipStored,
+            ZipDeflated,
+        };
+
+        /// Block size for zip entries; RZIP archives use their own chunk size
+        static constexpr uint32_t ZIP_BLOCK_SIZE = 64 * 1024;
+        static constexpr size_t CACHED_BLOCKS = 4;
+
+        /// \returns \c true if \c path names a container that this class reads
+        [[nodiscard]] static bool IsArchive(std::string_view path) noexcept;
+
+        /// Opens the archive at \c path, or the archive in \c data if the frontend already loaded it.
+        /// \throws content_exception if the archive is corrupt or doesn't hold a ROM that we can read
+        static std::unique_ptr<RomArchive> Open(std::string_view path, std::span<const std::byte> data);
+
+        ~RomArchive() noexcept;
+        RomArchive(const RomArchive&) = delete;
+        RomArchive& operator=(const RomArchive&) = delete;
+
+        [[nodiscard]] Format GetFormat() const noexcept { return _format; }
+        [[nodiscard]] uint64_t Size() const noexcept { return _size; }
+
+        /// Reads the ROM's bytes at \c offset through the block cache.
+        /// \returns \c false if the read is out of bounds or the archive is corrupt
+        bool Read(uint64_t offset, std::span<std::byte> out) noexcept;
+
+        /// Decompresses the whole ROM into a new buffer,
+        /// straight from the archive rather than through the cache.
+        /// \returns \c nullptr if the archive is corrupt
+        std::unique_ptr<std::byte[]> ReadAll() noexcept;
+
+        [[nodiscard]] const RomArchiveStats& Stats() const noexcept { return _stats; }
+        void LogStats() const noexcept;
+    private:
+        struct Chunk {
+            uint64_t Offset;
+            uint32_t Length;
+        };
+
+        struct Block {
+            uint64_t Index;
+            std::vector<std::byte> Data;
+        };
+
+        struct Inflater;
+
+        RomArchive(std::string_view path, std::span<const std::byte> data);
+        void OpenRzip();
+        void OpenZip();
+        bool ReadRaw(uint64_t offset, void* out, uint64_t length) noexcept;
+        bool DecompressBlock(uint64_t index, std::span<std::byte> out) noexcept;
+        bool InflateChunk(const Chunk& chunk, std::span<std::byte> out) noexcept;
+        bool InflateNext(std::span<std::byte> out) noexcept;
+        bool RestartStream() noexcept;
+        [[nodiscard]] uint64_t BlockLength(uint64_t index) const noexcept;
+        void UpdatePeak(uint64_t extra) noexcept;
+
+        std::string _path;
+        std::span<const std::byte> _memory;
+        RFILE* _file = nullptr;
+        uint64_t _archiveSize = 0;
+        Format _format = Format::Rzip;
+        uint64_t _size = 0;
+        uint32_t _blockSize = ZIP_BLOCK_SIZE;
+
+        // RZIP chunks, in order
+        std::vector<Chunk> _chunks;
+
+        // Where the zip entry's data starts, and how long it is
+        uint64_t _entryOffset = 0;
+        uint64_t _entryLength = 0;
+        // How far into the deflated entry the stream has read and written
+        std::unique_ptr<Inflater> _inflater;
+        uint64_t _inputPosition = 0;
+        uint64_t _nextBlock = 0;
+
+        std::list<Block> _cache;
+        std::vector<std::byte> _input;
+        RomArchiveStats _stats {};
+    };
+}
@@ -142,6 +142,13 @@ namespace MelonDsDs {
             if (oldLayout != Layout()) _dirty = true;
         }
 
+        void SetLayoutIndex(unsigned index) noexcept {
+            if (index < _numberOfLayouts && index != _layoutIndex) {
+                _layoutIndex = index;
+                _dirty = true;
+            }
+        }
+
         void NextLayout() noexcept {
             ScreenLayout oldLayout = Layout();
             _layoutIndex = (_layoutIndex + 1) % _numberOfLayouts;
@@ -0,0 +1,199 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#include "sectorcache.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <streams/file_stream.h>
+
+#include "environment.hpp"
+#include "tracy.hpp"
+
+using std::shared_ptr;
+using std::string;
+using std::string_view;
+
+namespace {
+    // Keyed by path; only touched by the emulator thread, which clears it
+    // once the unload step that closes the registered files has finished
+    std::unordered_map<string, shared_ptr<MelonDsDs::SectorCache>> RegisteredCaches;
+}
+
+shared_ptr<MelonDsDs::SectorCache> MelonDsDs::SectorCache::Register(string_view path, uint64_t capacity) noexcept {
+    string key(path);
+    if (auto it = RegisteredCaches.find(key); it != RegisteredCaches.end())
+        return it->second;
+
+    auto cache = std::make_shared<SectorCache>(path, capacity);
+    RegisteredCaches.emplace(std::move(key), cache);
+    return cache;
+}
+
+shared_ptr<MelonDsDs::SectorCache> MelonDsDs::SectorCache::Find(string_view path) noexcept {
+    if (RegisteredCaches.empty())
+        return nullptr;
+
+    auto it = RegisteredCaches.find(string(path));
+    return it != RegisteredCaches.end() ? it->second : nullptr;
+}
+
+MelonDsDs::SectorCacheStats MelonDsDs::SectorCache::RegisteredStats() noexcept {
+    SectorCacheStats total {};
+    for (const auto& [path, cache] : RegisteredCaches) {
+        const SectorCacheStats& stats = cache->Stats();
+        total.Hits += stats.Hits;
+        total.Misses += stats.Misses;
+        total.Evictions += stats.Evictions;
+        total.BytesRead += stats.BytesRead;
+        total.BytesWritten += stats.BytesWritten;
+        total.BytesRequested += stats.BytesRequested;
+    }
+
+    return total;
+}
+
+void MelonDsDs::SectorCache::Clear() noexcept {
+    RegisteredCaches.clear();
+}
+
+MelonDsDs::SectorCache::SectorCache(string_view path, uint64_t capacity) noexcept :
+    _path(path),
+    _capacity(std::max<uint64_t>(capacity / LINE_SIZE, 1)) {
+    _index.reserve(_capacity);
+}
+
+MelonDsDs::SectorCache::~SectorCache() noexcept {
+    LogStats();
+}
+
+MelonDsDs::SectorCache::Line* MelonDsDs::SectorCache::GetLine(RFILE* file, uint64_t index) noexcept {
+    if (auto it = _index.find(index); it != _index.end()) {
+        _stats.Hits++;
+        _lines.splice(_lines.begin(), _lines, it->second);
+        return &*it->second;
+    }
+
+    _stats.Misses++;
+    if (_lines.size() >= _capacity) {
+        // Reuse the least recently used line instead of allocating another;
+        // it's never modified, so it can just be dropped
+        _index.erase(_lines.back().Index);
+        _lines.splice(_lines.begin(), _lines, std::prev(_lines.end()));
+        _stats.Evictions++;
+    }
+    else {
+        _lines.emplace_front();
+    }
+
+    Line& line = _lines.front();
+    line.Index = index;
+    line.Length = 0;
+    if (filestream_seek(file, index * LINE_SIZE, RETRO_VFS_SEEK_POSITION_START) != 0) {
+        _lines.pop_front();
+        return nullptr;
+    }
+
+    int64_t bytesRead = filestream_read(file, line.Data.data(), LINE_SIZE);
+    if (bytesRead < 0) {
+        _lines.pop_front();
+        return nullptr;
+    }
+
+    line.Length = bytesRead;
+    _stats.BytesRead += bytesRead;
+
+    // Anything past the end of the file reads as zero
+    memset(line.Data.data() + line.Length, 0, LINE_SIZE - line.Length);
+    _index[index] = _lines.begin();
+    return &line;
+}
+
+int64_t MelonDsDs::SectorCache::Read(RFILE* file, void* data, uint64_t length) noexcept {
+    ZoneScopedN(TracyFunction);
+    int64_t start = filestream_tell(file);
+    if (start < 0)
+        return filestream_read(file, data, length);
+
+    uint8_t* out = static_cast<uint8_t*>(data);
+    uint64_t offset = start;
+    uint64_t end = start + length;
+    while (offset < end) {
+        Line* line = GetLine(file, offset / LINE_SIZE);
+        if (!line)
+            break;
+
+        uint64_t lineOffset = offset % LINE_SIZE;
+        if (lineOffset >= line->Length)
+            break; // End of file
+
+        uint64_t chunk = std::min(end - offset, line->Length - lineOffset);
+        memcpy(out + (offset - start), line->Data.data() + lineOffset, chunk);
+        offset += chunk;
+    }
+
+    _stats.BytesRequested += offset - start;
+    filestream_seek(file, offset, RETRO_VFS_SEEK_POSITION_START);
+    return offset - start;
+}
+
+int64_t MelonDsDs::SectorCache::Write(RFILE* file, const void* data, uint64_t length) noexcept {
+    ZoneScopedN(TracyFunction);
+    int64_t start = filestream_tell(file);
+    int64_t written = filestream_write(file, data, length);
+    if (start < 0 || written <= 0)
+        return written;
+
+    _stats.BytesWritten += written;
+
+    // Keep any cached copies of what was just written up to date,
+    // but don't load lines just to modify them
+    const uint8_t* in = static_cast<const uint8_t*>(data);
+    uint64_t offset = start;
+    uint64_t end = start + written;
+    while (offset < end) {
+        uint64_t lineOffset = offset % LINE_SIZE;
+        uint64_t chunk = std::min(end - offset, LINE_SIZE - lineOffset);
+        if (auto it = _index.find(offset / LINE_SIZE); it != _index.end()) {
+            Line& line = *it->second;
+            memcpy(line.Data.data() + lineOffset, in + (offset - start), chunk);
+            line.Length = std::max(line.Length, lineOffset + chunk);
+        }
+        offset += chunk;
+    }
+
+    return written;
+}
+
+void MelonDsDs::SectorCache::LogStats() const noexcept {
+    uint64_t accesses = _stats.Hits + _stats.Misses;
+    if (accesses == 0)
+        return;
+
+    retro::info(
+        "\"{}\" cache: {:.1f}% of {} line accesses hit, {} eviction(s); "
+        "read {}KiB from the file to serve {}KiB, wrote {}KiB",
+        _path,
+        100.0 * _stats.Hits / accesses,
+        accesses,
+        _stats.Evictions,
+        _stats.BytesRead / 1024,
+        _stats.BytesRequested / 1024,
+        _stats.BytesWritten / 1024
+    );
+}
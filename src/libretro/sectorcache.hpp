@@ -0,0 +1,100 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct RFILE;
+
+namespace MelonDsDs {
+    /// Sector cache statistics since the cache was created.
+    /// Exposed to C callers as-is, so keep it standard-layout.
+    struct SectorCacheStats {
+        uint64_t Hits;
+        uint64_t Misses;
+        uint64_t Evictions;
+        /// Bytes read from the underlying file to fill the cache
+        uint64_t BytesRead;
+        /// Bytes written to the underlying file through the cache
+        uint64_t BytesWritten;
+        /// Bytes that callers read through the cache
+        uint64_t BytesRequested;
+    };
+
+    /// A bounded write-through LRU cache over a frequently-accessed disk image (e.g. the DSi NAND),
+    /// whose file system structures are read far more often than they change.
+    /// Writes go straight to the file (and update any lines they touch),
+    /// so nothing is lost if the frontend is killed.
+    class SectorCache {
+    public:
+        /// Bytes per cache line; a multiple of the NAND's 512-byte sectors
+        static constexpr uint64_t LINE_SIZE = 4096;
+
+        /// Makes Platform::OpenFile cache \c path from now on, holding at most \c capacity bytes.
+        static std::shared_ptr<SectorCache> Register(std::string_view path, uint64_t capacity) noexcept;
+
+        /// \returns The cache registered for \c path, or \c nullptr if there isn't one
+        [[nodiscard]] static std::shared_ptr<SectorCache> Find(std::string_view path) noexcept;
+
+        /// Combined statistics of every registered cache
+        [[nodiscard]] static SectorCacheStats RegisteredStats() noexcept;
+
+        /// Forgets every registered cache; files that are still open keep theirs.
+        static void Clear() noexcept;
+
+        SectorCache(std::string_view path, uint64_t capacity) noexcept;
+        ~SectorCache() noexcept;
+        SectorCache(const SectorCache&) = delete;
+        SectorCache& operator=(const SectorCache&) = delete;
+
+        /// Reads \c length bytes from \c file 's current position, then moves the position forward.
+        /// \returns The number of bytes read, or -1 on error
+        int64_t Read(RFILE* file, void* data, uint64_t length) noexcept;
+
+        /// Writes \c length bytes to \c file 's current position, then moves the position forward.
+        /// \returns The number of bytes written, or -1 on error
+        int64_t Write(RFILE* file, const void* data, uint64_t length) noexcept;
+
+        [[nodiscard]] const SectorCacheStats& Stats() const noexcept { return _stats; }
+        void LogStats() const noexcept;
+    private:
+        struct Line {
+            uint64_t Index;
+            /// Bytes of this line that exist in the file
+            uint64_t Length;
+            std::array<uint8_t, LINE_SIZE> Data;
+        };
+
+        /// \returns The line at \c index, loading it if necessary, or \c nullptr on error
+        Line* GetLine(RFILE* file, uint64_t index) noexcept;
+
+        std::string _path;
+        size_t _capacity;
+
+        /// Most recently used first
+        std::list<Line> _lines;
+        std::unordered_map<uint64_t, std::list<Line>::iterator> _index;
+        SectorCacheStats _stats {};
+    };
+}
@@ -0,0 +1,383 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#include "sparse.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+
+#include "environment.hpp"
+#include "retro/file.hpp"
+#include "tracy.hpp"
+
+using std::shared_ptr;
+using std::string;
+using std::string_view;
+
+namespace {
+    // Keyed by path; only touched by the emulator thread, which clears it
+    // once the unload step that closes the registered files has finished
+    std::unordered_map<string, shared_ptr<MelonDsDs::SparseImage>> RegisteredImages;
+
+    bool IsZero(const uint8_t* data, size_t length) noexcept {
+        // If the first byte is zero and every byte equals the one after it, then they're all zero
+        return length == 0 || (data[0] == 0 && memcmp(data, data + 1, length - 1) == 0);
+    }
+}
+
+shared_ptr<MelonDsDs::SparseImage> MelonDsDs::SparseImage::Register(string_view path, uint64_t size) noexcept {
+    ZoneScopedN(TracyFunction);
+    string key(path);
+    if (auto it = RegisteredImages.find(key); it != RegisteredImages.end())
+        return it->second;
+
+    bool exists = path_is_valid(key.c_str());
+    if (exists) {
+        retro::rfile_ptr file = retro::make_rfile(key.c_str(), RETRO_VFS_FILE_ACCESS_READ);
+        int64_t length = file ? filestream_get_size(file.get()) : -1;
+        if (length < 0) {
+            retro::error("Failed to get the size of \"{}\"", path);
+            return nullptr;
+        }
+
+        size = length;
+    }
+    else {
+        if (size == 0) {
+            retro::error("Can't create \"{}\" without knowing how big it should be", path);
+            return nullptr;
+        }
+
+        retro::rfile_ptr file = retro::make_rfile(key.c_str(), RETRO_VFS_FILE_ACCESS_WRITE);
+        if (!file || filestream_truncate(file.get(), size) != 0) {
+            retro::error("Failed to create {}-byte image \"{}\"", size, path);
+            return nullptr;
+        }
+
+        retro::info("Created {}MiB sparse image \"{}\"", size / (1024 * 1024), path);
+    }
+
+    auto image = std::make_shared<SparseImage>(path, size, !exists);
+    RegisteredImages.emplace(std::move(key), image);
+    return image;
+}
+
+shared_ptr<MelonDsDs::SparseImage> MelonDsDs::SparseImage::Find(string_view path) noexcept {
+    if (RegisteredImages.empty())
+        return nullptr;
+
+    auto it = RegisteredImages.find(string(path));
+    return it != RegisteredImages.end() ? it->second : nullptr;
+}
+
+void MelonDsDs::SparseImage::Clear() noexcept {
+    RegisteredImages.clear();
+}
+
+MelonDsDs::SparseImage::SparseImage(string_view path, uint64_t size, bool empty) noexcept : _path(path) {
+    ZoneScopedN(TracyFunction);
+#ifdef __linux__
+    _fd = open(_path.c_str(), O_RDWR | O_CLOEXEC);
+    if (_fd < 0) {
+        retro::warn("Failed to open \"{}\" natively; its unused blocks won't be freed", path);
+    }
+#endif
+
+    Resize(size, false);
+    if (!empty) {
+        // If this image already existed, we don't know which blocks are in use yet
+        ScanAllocatedBlocks();
+    }
+}
+
+MelonDsDs::SparseImage::~SparseImage() noexcept {
+    LogStats();
+#ifdef __linux__
+    if (_fd >= 0) {
+        close(_fd);
+    }
+#endif
+}
+
+void MelonDsDs::SparseImage::Resize(uint64_t size, bool allocated) noexcept {
+    uint64_t blocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (blocks > _blocks) {
+        _allocated.resize((blocks + 63) / 64, 0);
+        uint64_t oldBlocks = _blocks;
+        _blocks = blocks;
+        for (uint64_t block = oldBlocks; allocated && block < blocks; ++block) {
+            SetAllocated(block, true);
+        }
+    }
+
+    _size = std::max(_size, size);
+}
+
+void MelonDsDs::SparseImage::SetAllocated(uint64_t block, bool allocated) noexcept {
+    if (block >= _blocks)
+        return;
+
+    uint64_t mask = uint64_t(1) << (block % 64);
+    if (allocated) {
+        _allocated[block / 64] |= mask;
+    }
+    else {
+        _allocated[block / 64] &= ~mask;
+    }
+}
+
+void MelonDsDs::SparseImage::ScanAllocatedBlocks() noexcept {
+    ZoneScopedN(TracyFunction);
+#if defined(__linux__) && defined(SEEK_DATA)
+    if (_fd >= 0) {
+        // Ask the file system which parts of the image hold data
+        off_t offset = 0;
+        while (offset < off_t(_size)) {
+            off_t data = lseek(_fd, offset, SEEK_DATA);
+            if (data < 0 && errno == ENXIO) {
+                offset = _size; // Nothing but holes from here on
+                break;
+            }
+
+            off_t hole = data < 0 ? -1 : lseek(_fd, data, SEEK_HOLE);
+            if (hole < 0)
+                break; // This file system can't tell us, so assume the worst
+
+            for (uint64_t block = data / BLOCK_SIZE; block * BLOCK_SIZE < uint64_t(hole); ++block) {
+                SetAllocated(block, true);
+            }
+            offset = hole;
+        }
+
+        if (offset >= off_t(_size)) {
+            retro::debug("\"{}\" has {} of {} blocks in use", _path, AllocatedBlocks(), _blocks);
+            return;
+        }
+    }
+#endif
+
+    std::fill(_allocated.begin(), _allocated.end(), ~uint64_t(0));
+}
+
+uint64_t MelonDsDs::SparseImage::AllocatedBlocks() const noexcept {
+    uint64_t count = 0;
+    for (uint64_t bits : _allocated) {
+        count += __builtin_popcountll(bits);
+    }
+
+    return std::min(count, _blocks);
+}
+
+int64_t MelonDsDs::SparseImage::Read(RFILE* file, void* data, uint64_t length) noexcept {
+    ZoneScopedN(TracyFunction);
+    int64_t start = filestream_tell(file);
+    if (start < 0)
+        return filestream_read(file, data, length);
+
+    uint8_t* out = static_cast<uint8_t*>(data);
+    uint64_t end = std::min<uint64_t>(start + length, _size);
+    uint64_t offset = start;
+    uint64_t position = start;
+    while (offset < end) {
+        // Handle every neighboring block in the same state at once
+        bool allocated = IsAllocated(offset / BLOCK_SIZE);
+        uint64_t runEnd = std::min((offset / BLOCK_SIZE + 1) * BLOCK_SIZE, end);
+        while (runEnd < end && IsAllocated(runEnd / BLOCK_SIZE) == allocated) {
+            runEnd = std::min(runEnd + BLOCK_SIZE, end);
+        }
+
+        uint64_t runLength = runEnd - offset;
+        if (allocated) {
+            if (position != offset && filestream_seek(file, offset, RETRO_VFS_SEEK_POSITION_START) != 0)
+                break;
+
+            int64_t bytesRead = filestream_read(file, out + (offset - start), runLength);
+            position = offset + std::max<int64_t>(bytesRead, 0);
+            _bytesRead += std::max<int64_t>(bytesRead, 0);
+            if (bytesRead != int64_t(runLength)) {
+                offset = position;
+                break;
+            }
+        }
+        else {
+            // This block was never written, so it's all zeros
+            memset(out + (offset - start), 0, runLength);
+            _bytesReadSkipped += runLength;
+        }
+
+        offset = runEnd;
+    }
+
+    if (position != offset) {
+        filestream_seek(file, offset, RETRO_VFS_SEEK_POSITION_START);
+    }
+
+    return offset - start;
+}
+
+int64_t MelonDsDs::SparseImage::Write(RFILE* file, const void* data, uint64_t length) noexcept {
+    ZoneScopedN(TracyFunction);
+    int64_t start = filestream_tell(file);
+    if (start < 0)
+        return filestream_write(file, data, length);
+
+    const uint8_t* in = static_cast<const uint8_t*>(data);
+    uint64_t end = start + length;
+    uint64_t position = start;
+    uint64_t pendingStart = start;
+    uint64_t pendingEnd = start;
+
+    // Neighboring blocks that need writing go out in one call
+    auto writePending = [&]() noexcept {
+        if (pendingStart == pendingEnd)
+            return true;
+
+        if (position != pendingStart && filestream_seek(file, pendingStart, RETRO_VFS_SEEK_POSITION_START) != 0)
+            return false;
+
+        int64_t written = filestream_write(file, in + (pendingStart - start), pendingEnd - pendingStart);
+        position = pendingStart + std::max<int64_t>(written, 0);
+        _bytesWritten += std::max<int64_t>(written, 0);
+        _dirty.insert(file);
+        bool ok = written == int64_t(pendingEnd - pendingStart);
+        pendingStart = pendingEnd = position;
+        return ok;
+    };
+
+    uint64_t offset = start;
+    bool ok = true;
+    while (ok && offset < end) {
+        uint64_t block = offset / BLOCK_SIZE;
+        uint64_t pieceEnd = std::min((block + 1) * BLOCK_SIZE, end);
+        bool wholeBlock = offset % BLOCK_SIZE == 0 && pieceEnd - offset == BLOCK_SIZE;
+        bool zero = IsZero(in + (offset - start), pieceEnd - offset);
+        bool allocated = IsAllocated(block);
+
+        if (zero && !allocated) {
+            // This block is a hole, which already reads as zeros
+            ok = writePending();
+            pendingStart = pendingEnd = pieceEnd;
+            _bytesWriteSkipped += pieceEnd - offset;
+        }
+        else if (zero && wholeBlock && _fd >= 0 && block < _blocks) {
+            // This block is being cleared, so give it back to the file system
+            ok = writePending() && PunchHole(file, offset);
+            pendingStart = pendingEnd = pieceEnd;
+        }
+        else {
+            if (pendingStart == pendingEnd) {
+                pendingStart = offset;
+            }
+            pendingEnd = pieceEnd;
+
+            // A block that's now entirely zero can be skipped by later reads,
+            // even if we couldn't free it
+            SetAllocated(block, !(zero && wholeBlock));
+        }
+
+        offset = pieceEnd;
+    }
+
+    ok = ok && writePending();
+    if (!ok) {
+        retro::error("Failed to write to \"{}\" at offset {}", _path, position);
+    }
+
+    if (position != offset) {
+        filestream_seek(file, offset, RETRO_VFS_SEEK_POSITION_START);
+    }
+
+    // If we wrote past the end of the image, those blocks hold data now
+    Resize(offset, true);
+    return ok ? int64_t(length) : int64_t(position - start);
+}
+
+bool MelonDsDs::SparseImage::PunchHole(RFILE* file, uint64_t offset) noexcept {
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+    // Anything still buffered for this block must land before the hole does
+    if (filestream_flush(file) != 0)
+        return false;
+
+    if (fallocate(_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, BLOCK_SIZE) != 0) {
+        retro::warn("Failed to free block {} of \"{}\"; no longer trying", offset / BLOCK_SIZE, _path);
+        close(_fd);
+        _fd = -1;
+
+        // The block still has old data, so clear it the slow way
+        const uint8_t zeros[BLOCK_SIZE] {};
+        if (filestream_seek(file, offset, RETRO_VFS_SEEK_POSITION_START) != 0 || filestream_write(file, zeros, BLOCK_SIZE) != BLOCK_SIZE)
+            return false;
+
+        _dirty.insert(file);
+    }
+    else {
+        _holesPunched++;
+    }
+
+    SetAllocated(offset / BLOCK_SIZE, false);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool MelonDsDs::SparseImage::Flush(RFILE* file) noexcept {
+    if (_dirty.count(file) == 0) {
+        // Nothing changed through this handle, so don't make the OS sync a multi-gigabyte file
+        _flushesSkipped++;
+        return true;
+    }
+
+    if (filestream_flush(file) != 0)
+        return false; // Still dirty, so the next flush tries again
+
+    _dirty.erase(file);
+    return true;
+}
+
+void MelonDsDs::SparseImage::Close(RFILE* file) noexcept {
+    _dirty.erase(file);
+}
+
+void MelonDsDs::SparseImage::LogStats() const noexcept {
+    if (_bytesRead + _bytesReadSkipped + _bytesWritten + _bytesWriteSkipped == 0)
+        return;
+
+    retro::debug(
+        "\"{}\": {} of {} blocks in use; read {}KiB ({}KiB of holes skipped), "
+        "wrote {}KiB ({}KiB of zeros skipped), freed {} block(s), skipped {} flush(es)",
+        _path,
+        AllocatedBlocks(),
+        _blocks,
+        _bytesRead / 1024,
+        _bytesReadSkipped / 1024,
+        _bytesWritten / 1024,
+        _bytesWriteSkipped / 1024,
+        _holesPunched,
+        _flushesSkipped
+    );
+}
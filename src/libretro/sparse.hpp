@@ -0,0 +1,103 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+struct RFILE;
+
+namespace MelonDsDs {
+    /// A large disk image (e.g. an emulated SD card) stored as a sparse file.
+    /// A bitmap tracks which blocks have ever held data,
+    /// so blocks that were never written cost neither disk space nor I/O.
+    /// Reads of unwritten blocks return zeros without touching the file,
+    /// and writing zeros to an unwritten block is skipped.
+    /// Where the OS supports it, blocks that are zeroed out are deallocated again.
+    class SparseImage {
+    public:
+        /// Granularity of the bitmap; matches the block size of most host file systems,
+        /// so that freed blocks can be returned to the OS
+        static constexpr uint64_t BLOCK_SIZE = 4096;
+
+        /// Creates a \c size -byte image at \c path (if it doesn't already exist) without writing any of it,
+        /// and makes Platform::OpenFile use the returned object for \c path from now on.
+        /// \param size The image's size, or 0 to use an existing image's size.
+        /// \returns \c nullptr if the image couldn't be created
+        static std::shared_ptr<SparseImage> Register(std::string_view path, uint64_t size) noexcept;
+
+        /// \returns The image registered for \c path, or \c nullptr if there isn't one
+        [[nodiscard]] static std::shared_ptr<SparseImage> Find(std::string_view path) noexcept;
+
+        /// Forgets every registered image; files that are still open keep theirs.
+        static void Clear() noexcept;
+
+        SparseImage(std::string_view path, uint64_t size, bool empty) noexcept;
+        ~SparseImage() noexcept;
+        SparseImage(const SparseImage&) = delete;
+        SparseImage& operator=(const SparseImage&) = delete;
+
+        /// Reads \c length bytes from \c file 's current position, then moves the position forward.
+        /// \returns The number of bytes read, or -1 on error
+        int64_t Read(RFILE* file, void* data, uint64_t length) noexcept;
+
+        /// Writes \c length bytes to \c file 's current position, then moves the position forward.
+        /// \returns The number of bytes written, or -1 on error
+        int64_t Write(RFILE* file, const void* data, uint64_t length) noexcept;
+
+        /// Flushes \c file, unless nothing was written through it since its last flush.
+        /// Other handles to the image keep their own unflushed writes.
+        bool Flush(RFILE* file) noexcept;
+
+        /// Forgets \c file 's unflushed writes; call when closing it, which flushes it anyway.
+        void Close(RFILE* file) noexcept;
+
+        [[nodiscard]] uint64_t Size() const noexcept { return _size; }
+        [[nodiscard]] uint64_t AllocatedBlocks() const noexcept;
+        void LogStats() const noexcept;
+    private:
+        [[nodiscard]] bool IsAllocated(uint64_t block) const noexcept {
+            return block >= _blocks || (_allocated[block / 64] >> (block % 64)) & 1;
+        }
+        void SetAllocated(uint64_t block, bool allocated) noexcept;
+        void Resize(uint64_t size, bool allocated) noexcept;
+        void ScanAllocatedBlocks() noexcept;
+        bool PunchHole(RFILE* file, uint64_t offset) noexcept;
+
+        std::string _path;
+        uint64_t _size = 0;
+        uint64_t _blocks = 0;
+        /// One bit per block; set if the block may hold data
+        std::vector<uint64_t> _allocated;
+        /// A native handle to the image, for file system operations that the libretro VFS lacks
+        int _fd = -1;
+        /// Handles with writes that haven't been flushed yet
+        std::unordered_set<RFILE*> _dirty;
+
+        uint64_t _bytesRead = 0;
+        uint64_t _bytesReadSkipped = 0;
+        uint64_t _bytesWritten = 0;
+        uint64_t _bytesWriteSkipped = 0;
+        uint64_t _holesPunched = 0;
+        uint64_t _flushesSkipped = 0;
+    };
+}
@@ -0,0 +1,134 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include "capture.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <gfx/scaler/pixconv.h>
+
+#include "tracy.hpp"
+
+MelonDsDs::FrameCapturePool::FrameCapturePool() {
+    ZoneScopedN(TracyFunction);
+    for (size_t i = 0; i < POOL_SIZE; ++i) {
+        _slots[i].Pixels = std::make_unique<uint32_t[]>(MAX_WIDTH * MAX_HEIGHT);
+        _freeSlots.push(i);
+    }
+
+    _worker = std::thread(&FrameCapturePool::WorkerMain, this);
+}
+
+MelonDsDs::FrameCapturePool::~FrameCapturePool() noexcept {
+    {
+        std::lock_guard lock(_mutex);
+        _stopping = true;
+    }
+    _readyCondition.notify_one();
+    _worker.join();
+}
+
+void MelonDsDs::FrameCapturePool::Submit(const void* pixels, unsigned width, unsigned height, size_t stride, PixelFormat format, bool flip, unsigned age) noexcept {
+    ZoneScopedN(TracyFunction);
+    if (!pixels || width == 0 || height == 0)
+        return;
+
+    size_t index;
+    {
+        std::lock_guard lock(_mutex);
+        if (_freeSlots.empty()) {
+            // If the worker is falling behind, drop this frame instead of waiting
+            TracyMessageL("Dropped a captured frame; all capture buffers are busy");
+            return;
+        }
+        index = _freeSlots.front();
+        _freeSlots.pop();
+    }
+
+    // Downscale by the smallest integer factor that fits,
+    // then round down to a multiple of 4 (which Tracy requires)
+    unsigned factor = std::max((width + MAX_WIDTH - 1) / MAX_WIDTH, (height + MAX_HEIGHT - 1) / MAX_HEIGHT);
+    unsigned outWidth = (width / factor) & ~3u;
+    unsigned outHeight = (height / factor) & ~3u;
+
+    Slot& slot = _slots[index];
+    const auto* src = static_cast<const uint8_t*>(pixels);
+    if (factor == 1) {
+        // If the frame is small enough already, copy each row as-is
+        for (unsigned y = 0; y < outHeight; ++y) {
+            memcpy(&slot.Pixels[y * outWidth], src + y * stride, outWidth * sizeof(uint32_t));
+        }
+    }
+    else {
+        for (unsigned y = 0; y < outHeight; ++y) {
+            const auto* srcRow = reinterpret_cast<const uint32_t*>(src + y * factor * stride);
+            uint32_t* dstRow = &slot.Pixels[y * outWidth];
+            for (unsigned x = 0; x < outWidth; ++x) {
+                dstRow[x] = srcRow[x * factor];
+            }
+        }
+    }
+
+    slot.Width = outWidth;
+    slot.Height = outHeight;
+    slot.Format = format;
+    slot.Flip = flip;
+    uint64_t frameNumber = _frameNumber;
+    slot.FrameNumber = frameNumber - std::min<uint64_t>(age, frameNumber);
+
+    {
+        std::lock_guard lock(_mutex);
+        _readySlots.push(index);
+    }
+    _readyCondition.notify_one();
+}
+
+void MelonDsDs::FrameCapturePool::WorkerMain() noexcept {
+    tracy::SetThreadName("Tracy Frame Capture");
+    while (true) {
+        size_t index;
+        {
+            std::unique_lock lock(_mutex);
+            _readyCondition.wait(lock, [this] { return _stopping || !_readySlots.empty(); });
+            if (_stopping)
+                return;
+
+            index = _readySlots.front();
+            _readySlots.pop();
+        }
+        uint64_t currentFrame = _frameNumber;
+
+        Slot& slot = _slots[index];
+        {
+            ZoneScopedN("FrameCapturePool::Convert");
+            if (slot.Format == PixelFormat::Xrgb8888) {
+                // libretro wants pixels in XRGB8888 format,
+                // but Tracy wants them in XBGR8888 format.
+                size_t pitch = slot.Width * sizeof(uint32_t);
+                conv_argb8888_abgr8888(slot.Pixels.get(), slot.Pixels.get(), slot.Width, slot.Height, pitch, pitch);
+            }
+        }
+
+        // Tracy copies the image, so the slot can be reused as soon as this returns;
+        // the offset covers both the time spent here and any readback delay before Submit
+        uint8_t offset = static_cast<uint8_t>(std::min<uint64_t>(currentFrame - slot.FrameNumber, UINT8_MAX));
+        FrameImage(slot.Pixels.get(), slot.Width, slot.Height, offset, slot.Flip);
+
+        std::lock_guard lock(_mutex);
+        _freeSlots.push(index);
+    }
+}
@@ -0,0 +1,86 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#ifdef HAVE_TRACY
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+namespace MelonDsDs {
+    /// \brief Sends captured frames to Tracy without doing the expensive work on the emulation thread.
+    ///
+    /// Frames are copied (and downscaled, if needed) into one of a fixed pool of preallocated buffers.
+    /// A worker thread converts each buffer to the format Tracy expects and submits it.
+    /// If every buffer is busy, the frame is dropped rather than stalling the emulator.
+    class FrameCapturePool {
+    public:
+        enum class PixelFormat {
+            // libretro's XRGB8888; needs a channel swap for Tracy
+            Xrgb8888,
+            // What glReadPixels gives us with GL_RGBA; passed to Tracy as-is
+            Rgba8888,
+        };
+
+        FrameCapturePool();
+        ~FrameCapturePool() noexcept;
+        FrameCapturePool(const FrameCapturePool&) = delete;
+        FrameCapturePool(FrameCapturePool&&) = delete;
+        FrameCapturePool& operator=(const FrameCapturePool&) = delete;
+        FrameCapturePool& operator=(FrameCapturePool&&) = delete;
+
+        /// Copies a frame into a free capture buffer and queues it for submission.
+        /// \param stride The distance between rows, in bytes.
+        /// \param flip True if the rows are stored bottom-to-top (as with OpenGL).
+        /// \param age How many frames ago this frame was rendered (e.g. if it went through an asynchronous readback).
+        void Submit(const void* pixels, unsigned width, unsigned height, size_t stride, PixelFormat format, bool flip, unsigned age = 0) noexcept;
+
+        /// Call once per presented frame so that Tracy can line up captures with frames.
+        void AdvanceFrame() noexcept { _frameNumber++; }
+
+        // Tracy can't accept larger images, and it wants dimensions divisible by 4.
+        static constexpr unsigned MAX_WIDTH = 512;
+        static constexpr unsigned MAX_HEIGHT = 512;
+    private:
+        static constexpr size_t POOL_SIZE = 4;
+        struct Slot {
+            std::unique_ptr<uint32_t[]> Pixels;
+            unsigned Width;
+            unsigned Height;
+            PixelFormat Format;
+            bool Flip;
+            uint64_t FrameNumber;
+        };
+
+        void WorkerMain() noexcept;
+
+        std::array<Slot, POOL_SIZE> _slots;
+        std::queue<size_t> _freeSlots;
+        std::queue<size_t> _readySlots;
+        std::mutex _mutex;
+        std::condition_variable _readyCondition;
+        std::atomic_uint64_t _frameNumber = 0;
+        bool _stopping = false;
+        std::thread _worker;
+    };
+}
+#endif
@@ -23,8 +23,14 @@
 # define TracyFunction __FUNCSIG__
 #endif
 
+#include "recorder.hpp"
+
+// Every zone is also timed by the built-in trace recorder,
+// so that builds without Tracy can still be profiled
 #ifdef HAVE_TRACY
 #include <tracy/Tracy.hpp>
+#undef ZoneScopedN
+#define ZoneScopedN(x) ZoneNamedN(___tracy_scoped_zone, x, true); MELONDSDS_TRACE_SCOPE(x)
 #else
 #define ZoneNamed(x,y)
 #define ZoneNamedN(x,y,z)
@@ -34,10 +40,10 @@
 #define ZoneTransient(x,y)
 #define ZoneTransientN(x,y,z)
 
-#define ZoneScoped
-#define ZoneScopedN(x)
-#define ZoneScopedC(x)
-#define ZoneScopedNC(x,y)
+#define ZoneScoped ZoneScopedN(TracyFunction)
+#define ZoneScopedN(x) MELONDSDS_TRACE_SCOPE(x)
+#define ZoneScopedC(x) ZoneScoped
+#define ZoneScopedNC(x,y) ZoneScopedN(x)
 
 #define ZoneText(x,y)
 #define ZoneTextV(x,y,z)
@@ -91,16 +91,16 @@ MelonDsDs::OpenGlTracyCapture::~OpenGlTracyCapture() noexcept {
     TracyGpuZone(TracyFunction);
 
     // Clean up the textures
-    glDeleteTextures(4, _tracyTextures.data());
+    glDeleteTextures(FRAME_LAG, _tracyTextures.data());
 
     // Clean up the FBOs
-    glDeleteFramebuffers(4, _tracyFbos.data());
+    glDeleteFramebuffers(FRAME_LAG, _tracyFbos.data());
 
     // Clean up the PBOs
-    glDeleteBuffers(4, _tracyPbos.data());
+    glDeleteBuffers(FRAME_LAG, _tracyPbos.data());
 
     // Clean up the fences
-    for (int i = 0; i < 4; i++) {
+    for (int i = 0; i < FRAME_LAG; i++) {
         glDeleteSync(_tracyFences[i]);
     }
 }
@@ -138,8 +138,9 @@ void MelonDsDs::OpenGlTracyCapture::CaptureFrame(GLuint current_fbo, float scale
         // Expose the capture PBO's contents to RAM
         auto ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, NDS_SCREEN_AREA<GLuint> * 2 * 4, GL_MAP_READ_BIT);
 
-        // Send the frame to Tracy
-        FrameImage(ptr, NDS_SCREEN_WIDTH, NDS_SCREEN_HEIGHT * 2, _tracyQueue.size(), true);
+        // Hand the frame to the capture pool; it'll be sent to Tracy from another thread.
+        // It was rendered as many frames ago as there are readbacks still in flight (including this one)
+        _pool.Submit(ptr, NDS_SCREEN_WIDTH, NDS_SCREEN_HEIGHT * 2, NDS_SCREEN_WIDTH * 4, FrameCapturePool::PixelFormat::Rgba8888, true, _tracyQueue.size());
 
         // We're done with the capture PBO
         glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
@@ -182,5 +183,6 @@ void MelonDsDs::OpenGlTracyCapture::CaptureFrame(GLuint current_fbo, float scale
 
     // "Hang onto this flag for now, we'll check it again next frame."
     _tracyQueue.push(_tracyIndex);
-    _tracyIndex = (_tracyIndex + 1) % 4;
+    _tracyIndex = (_tracyIndex + 1) % FRAME_LAG;
+    _pool.AdvanceFrame();
 }
\ No newline at end of file
@@ -23,6 +23,8 @@
 #include "PlatformOGLPrivate.h"
 #include <tracy/TracyOpenGL.hpp>
 
+#include "capture.hpp"
+
 namespace MelonDsDs {
     /// \brief Class for capturing OpenGL frames for Tracy.
     /// Suitable for both OpenGL renderers.
@@ -45,6 +47,7 @@ namespace MelonDsDs {
         std::array<GLsync, FRAME_LAG> _tracyFences;
         int _tracyIndex = 0;
         std::queue<int> _tracyQueue;
+        FrameCapturePool _pool;
         bool _debug;
     };
 }
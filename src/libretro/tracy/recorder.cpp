@@ -0,0 +1,275 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+
+#include "recorder.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <compat/strl.h>
+#include <fmt/format.h>
+#include <file/file_path.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+
+#include "environment.hpp"
+
+using std::optional;
+using std::string;
+
+namespace {
+    // About 3MiB per thread that records anything;
+    // enough for a minute or so of a typical frame's events on the emulator thread
+    constexpr uint64_t EVENTS_PER_THREAD = 1 << 17;
+
+    struct Event {
+        const char* Name;
+        uint64_t Start;
+        uint64_t End;
+    };
+
+    // Buffers of threads that have exited are kept for the next dump, but only this many;
+    // every unload starts new worker threads, so they'd otherwise pile up
+    constexpr size_t MAX_EXITED_THREADS = 8;
+
+    struct ThreadBuffer {
+        explicit ThreadBuffer(uint32_t id) : Id(id), Events(EVENTS_PER_THREAD) {}
+
+        const uint32_t Id;
+        // Only contended while a trace is being dumped
+        std::mutex Mutex;
+        std::vector<Event> Events;
+        uint64_t Written = 0;
+        // Guarded by RegistryMutex
+        bool Exited = false;
+    };
+
+    std::mutex RegistryMutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> Registry;
+    uint32_t NextThreadId = 1;
+    std::atomic<uint64_t> Epoch = 0;
+    std::atomic<unsigned> DefaultWindowSeconds = 0;
+
+    /// Drops the oldest exited threads' buffers until at most \c keep remain.
+    /// Must hold RegistryMutex.
+    void PruneExited(size_t keep) noexcept {
+        size_t exited = std::count_if(Registry.begin(), Registry.end(), [](const auto& buffer) { return buffer->Exited; });
+        // The registry is in order of creation, so the oldest go first
+        for (auto it = Registry.begin(); it != Registry.end() && exited > keep;) {
+            if ((*it)->Exited) {
+                it = Registry.erase(it);
+                exited--;
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    // Marks the buffer for pruning when its thread exits
+    struct ThreadBufferHolder {
+        ~ThreadBufferHolder() noexcept {
+            if (!Buffer)
+                return;
+
+            std::lock_guard lock(RegistryMutex);
+            {
+                std::lock_guard bufferLock(Buffer->Mutex);
+                Buffer->Exited = true;
+                if (Buffer->Written == 0) {
+                    // Nothing to dump, so don't keep it around
+                    Registry.erase(std::remove(Registry.begin(), Registry.end(), Buffer), Registry.end());
+                }
+            }
+            PruneExited(MAX_EXITED_THREADS);
+        }
+
+        std::shared_ptr<ThreadBuffer> Buffer;
+    };
+    thread_local ThreadBufferHolder CurrentBuffer;
+
+    ThreadBuffer* GetThreadBuffer() noexcept try {
+        if (!CurrentBuffer.Buffer) [[unlikely]] {
+            // If this is the first event this thread has recorded...
+            std::lock_guard lock(RegistryMutex);
+            CurrentBuffer.Buffer = std::make_shared<ThreadBuffer>(NextThreadId++);
+            Registry.push_back(CurrentBuffer.Buffer);
+        }
+
+        return CurrentBuffer.Buffer.get();
+    }
+    catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+
+    void AppendEscaped(string& json, const char* text) {
+        for (const char* c = text; *c; ++c) {
+            switch (*c) {
+                case '"':
+                    json += "\\\"";
+                    break;
+                case '\\':
+                    json += "\\\\";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(*c) < 0x20) {
+                        fmt::format_to(std::back_inserter(json), "\\u{:04x}", *c);
+                    }
+                    else {
+                        json += *c;
+                    }
+            }
+        }
+    }
+}
+
+std::atomic_bool MelonDsDs::trace::Recording = false;
+
+void MelonDsDs::trace::Record(const char* name, uint64_t start, uint64_t end) noexcept {
+    ThreadBuffer* buffer = GetThreadBuffer();
+    if (!buffer)
+        return;
+
+    std::lock_guard lock(buffer->Mutex);
+    buffer->Events[buffer->Written % EVENTS_PER_THREAD] = { name, start, end };
+    buffer->Written++;
+}
+
+void MelonDsDs::trace::Start(unsigned seconds) noexcept {
+    DefaultWindowSeconds = seconds;
+    if (Recording)
+        return;
+
+    {
+        std::lock_guard lock(RegistryMutex);
+        // Threads that are gone have nothing left to record
+        PruneExited(0);
+        for (const std::shared_ptr<ThreadBuffer>& buffer : Registry) {
+            std::lock_guard bufferLock(buffer->Mutex);
+            buffer->Written = 0;
+        }
+    }
+
+    Epoch = Now();
+    Recording = true;
+    retro::info("Started the trace recorder; dumps will include the last {} seconds", seconds);
+}
+
+void MelonDsDs::trace::Stop() noexcept {
+    if (Recording.exchange(false)) {
+        retro::info("Stopped the trace recorder");
+    }
+}
+
+unsigned MelonDsDs::trace::WindowSeconds() noexcept {
+    return DefaultWindowSeconds;
+}
+
+MelonDsDs::trace::TraceStats MelonDsDs::trace::Stats() noexcept {
+    TraceStats stats {};
+    std::lock_guard lock(RegistryMutex);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : Registry) {
+        std::lock_guard bufferLock(buffer->Mutex);
+        stats.Events += std::min(buffer->Written, EVENTS_PER_THREAD);
+        stats.Dropped += buffer->Written > EVENTS_PER_THREAD ? buffer->Written - EVENTS_PER_THREAD : 0;
+        stats.Threads += buffer->Written > 0;
+    }
+    stats.Recording = Recording;
+
+    return stats;
+}
+
+string MelonDsDs::trace::ToJson(double seconds) {
+    uint64_t epoch = Epoch;
+    uint64_t now = Now();
+    uint64_t window = static_cast<uint64_t>(seconds * 1e9);
+    uint64_t cutoff = seconds > 0 && window < now - epoch ? now - window : epoch;
+
+    string json = R"({"displayTimeUnit":"ms","traceEvents":[{"name":"process_name","ph":"M","pid":1,"args":{"name":"melonDS DS"}})";
+    std::lock_guard lock(RegistryMutex);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : Registry) {
+        std::lock_guard bufferLock(buffer->Mutex);
+        uint64_t count = std::min(buffer->Written, EVENTS_PER_THREAD);
+        bool any = false;
+        for (uint64_t i = buffer->Written - count; i < buffer->Written; ++i) {
+            const Event& event = buffer->Events[i % EVENTS_PER_THREAD];
+            if (event.End < cutoff)
+                continue;
+
+            json += R"(,{"name":")";
+            AppendEscaped(json, event.Name);
+            fmt::format_to(
+                std::back_inserter(json),
+                R"(","ph":"X","ts":{:.3f},"dur":{:.3f},"pid":1,"tid":{}}})",
+                (event.Start - epoch) / 1000.0,
+                (event.End - event.Start) / 1000.0,
+                buffer->Id
+            );
+            any = true;
+        }
+
+        if (any) {
+            // Name the thread so the viewer doesn't just show a number
+            fmt::format_to(
+                std::back_inserter(json),
+                R"(,{{"name":"thread_name","ph":"M","pid":1,"tid":{0},"args":{{"name":"Thread {0}"}}}})",
+                buffer->Id
+            );
+        }
+    }
+    json += "]}";
+
+    return json;
+}
+
+optional<string> MelonDsDs::trace::Dump(double seconds) noexcept try {
+    optional<string> path = retro::get_save_subdir_path(fmt::format("trace-{}.json", std::time(nullptr)));
+    if (!path) {
+        retro::warn("No save directory available, can't write a trace");
+        return std::nullopt;
+    }
+
+    char dir[PATH_MAX] {};
+    strlcpy(dir, path->c_str(), sizeof(dir));
+    path_basedir(dir);
+    if (!path_mkdir(dir)) {
+        retro::warn("Failed to create \"{}\", can't write a trace", dir);
+        return std::nullopt;
+    }
+
+    string json = ToJson(seconds);
+    if (!filestream_write_file(path->c_str(), json.data(), json.size())) {
+        retro::error("Failed to write {}-byte trace to \"{}\"", json.size(), *path);
+        return std::nullopt;
+    }
+
+    retro::info("Wrote the last {}s of trace events to \"{}\" ({} bytes)", seconds, *path, json.size());
+    {
+        // Exited threads' events are in the dump now, and they won't record any more
+        std::lock_guard lock(RegistryMutex);
+        PruneExited(0);
+    }
+    return path;
+}
+catch (const std::exception& e) {
+    retro::error("Failed to write a trace: {}", e.what());
+    return std::nullopt;
+}
@@ -0,0 +1,82 @@
+/*
+    Copyright 2024 Jesse Talavera
+
+    melonDS DS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS DS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS DS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace MelonDsDs::trace {
+    struct TraceStats {
+        uint64_t Events;
+        /// Events that were overwritten before anyone dumped them
+        uint64_t Dropped;
+        uint32_t Threads;
+        bool Recording;
+    };
+
+    /// True while the recorder is collecting events; checked by every traced scope.
+    extern std::atomic_bool Recording;
+
+    [[nodiscard]] inline uint64_t Now() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void Record(const char* name, uint64_t start, uint64_t end) noexcept;
+
+    /// Times the enclosing scope if the recorder is running when the scope is entered.
+    /// \c name must outlive the recorder (e.g. a string literal or \c __PRETTY_FUNCTION__).
+    class Scope {
+    public:
+        explicit Scope(const char* name) noexcept :
+            _name(Recording.load(std::memory_order_relaxed) ? name : nullptr),
+            _start(_name ? Now() : 0) {
+        }
+
+        ~Scope() noexcept {
+            if (_name) [[unlikely]] {
+                Record(_name, _start, Now());
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        const char* _name;
+        uint64_t _start;
+    };
+
+    /// Starts recording into per-thread ring buffers (discarding anything recorded before),
+    /// or changes how much a dump keeps if already recording.
+    /// \param seconds How much recent history a dump includes by default
+    void Start(unsigned seconds) noexcept;
+    void Stop() noexcept;
+    [[nodiscard]] unsigned WindowSeconds() noexcept;
+    [[nodiscard]] TraceStats Stats() noexcept;
+
+    /// Renders the last \c seconds of recorded events (or all of them, if 0)
+    /// in the Chrome trace event format, which Perfetto and chrome://tracing can open.
+    [[nodiscard]] std::string ToJson(double seconds);
+
+    /// Writes the last \c seconds of recorded events to a new file in the save directory.
+    /// \returns The path of the new trace, or \c nullopt if it couldn't be written
+    std::optional<std::string> Dump(double seconds) noexcept;
+}
+
+#define MELONDSDS_TRACE_SCOPE(name) ::MelonDsDs::trace::Scope ___melondsds_trace_scope(name)
@@ -184,6 +184,32 @@ add_python_test(
     CONTENT "${NDS_ROM}"
 )
 
+add_python_test(
+    NAME "Core parses the headless OpenGL option"
+    TEST_MODULE basics.core_parses_headless_opengl_option
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core submits dupes instead of compositing frames while fast-forwarding"
+    TEST_MODULE basics.core_skips_frames_while_fast_forwarding
+    CONTENT "${NDS_ROM}"
+    TIMEOUT 60
+)
+
+add_python_test(
+    NAME "Core presents dupes and silence while the console is asleep"
+    TEST_MODULE basics.core_idles_while_asleep
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core skips reprocessing input that hasn't changed"
+    TEST_MODULE basics.core_caches_unchanged_input
+    NDS_SYSFILES  # This test needs the NDS system menu
+    TIMEOUT 30
+)
+
 add_python_test(
     NAME "Core registers support for no-content mode"
     TEST_MODULE basics.core_registers_no_content_support
@@ -337,3 +363,99 @@ add_python_test(
     TEST_MODULE basics.core_gets_power_state
     CONTENT "${NDS_ROM}"
 )
+
+add_python_test(
+    NAME "Core advances virtual RTC with emulated time"
+    TEST_MODULE basics.core_uses_virtual_rtc
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core switches to the battery profile on low battery"
+    TEST_MODULE basics.core_switches_to_battery_profile
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core saves and resets per-game profiles"
+    TEST_MODULE basics.core_saves_title_profile
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core waits only briefly for stalled or incompatible multiplayer peers"
+    TEST_MODULE basics.core_bounds_multiplayer_stalls
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core measures and saves the threaded renderer setting"
+    TEST_MODULE basics.core_tunes_threaded_renderer
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core reports frame pacing statistics"
+    TEST_MODULE basics.core_reports_frame_stats
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core batches multiplayer packets over a loopback"
+    TEST_MODULE basics.core_batches_multiplayer_packets
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core buffers audio with rate control"
+    TEST_MODULE basics.core_buffers_audio_with_rate_control
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core submits audio before rendering in low-latency mode"
+    TEST_MODULE basics.core_submits_audio_early
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core runs rollback netplay over a loopback"
+    TEST_MODULE basics.core_runs_rollback_netplay_loopback
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core forks the running console"
+    TEST_MODULE basics.core_forks_console
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core suspends and resumes sessions"
+    TEST_MODULE basics.core_suspends_and_resumes_session
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core reads ROMs from compressed archives"
+    TEST_MODULE basics.core_reads_compressed_roms
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core records a trace of the last few seconds"
+    TEST_MODULE basics.core_records_trace
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core unloads games concurrently"
+    TEST_MODULE basics.core_unloads_concurrently
+    CONTENT "${NDS_ROM}"
+)
+
+add_python_test(
+    NAME "Core switches to power profiles defined in power_profiles.cfg"
+    TEST_MODULE basics.core_loads_user_power_profiles
+    CONTENT "${NDS_ROM}"
+)
@@ -149,6 +149,36 @@ add_python_test(
     DSI_NAND
 )
 
+add_python_test(
+    NAME "DSi boot to menu with NAND cache enabled"
+    TEST_MODULE basics.core_caches_dsi_nand
+    CORE_OPTION "melonds_console_mode=dsi"
+    CORE_OPTION "melonds_firmware_dsi_path=melonDS DS/${DSI_FIRMWARE_NAME}"
+    CORE_OPTION "melonds_dsi_nand_path=melonDS DS/${DSI_NAND_NAME}"
+    CORE_OPTION "melonds_dsi_nand_cache=enabled"
+    ARM7_BIOS
+    ARM9_BIOS
+    ARM7_DSI_BIOS
+    ARM9_DSI_BIOS
+    DSI_FIRMWARE
+    DSI_NAND
+)
+
+add_python_test(
+    NAME "DSi boot to menu with NAND cache disabled"
+    TEST_MODULE basics.core_caches_dsi_nand
+    CORE_OPTION "melonds_console_mode=dsi"
+    CORE_OPTION "melonds_firmware_dsi_path=melonDS DS/${DSI_FIRMWARE_NAME}"
+    CORE_OPTION "melonds_dsi_nand_path=melonDS DS/${DSI_NAND_NAME}"
+    CORE_OPTION "melonds_dsi_nand_cache=disabled"
+    ARM7_BIOS
+    ARM9_BIOS
+    ARM7_DSI_BIOS
+    ARM9_DSI_BIOS
+    DSI_FIRMWARE
+    DSI_NAND
+)
+
 add_python_test(
     NAME "Direct DSi boot to NDS game with no NAND image fails"
     TEST_MODULE basics.core_run_frames
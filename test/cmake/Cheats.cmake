@@ -15,3 +15,9 @@ add_python_test(
     TEST_MODULE cheats.not_enabled_if_invalid
     CONTENT "${NDS_ROM}"
 )
+
+add_python_test(
+    NAME "Large cheat lists are compiled into fewer codes"
+    TEST_MODULE cheats.large_list_is_compiled
+    CONTENT "${NDS_ROM}"
+)
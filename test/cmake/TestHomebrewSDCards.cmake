@@ -65,4 +65,12 @@ add_python_test(
     CORE_OPTION "melonds_homebrew_sdcard=enabled"
     CORE_OPTION "melonds_homebrew_sync_sdcard_to_host=disabled"
     WILL_FAIL
-)
\ No newline at end of file
+)
+add_python_test(
+    NAME "Homebrew SD card image is created as a sparse file"
+    CONTENT "${GODMODE9I_ROM}"
+    TEST_MODULE save.homebrew_sd_card_is_sparse
+    CORE_OPTION "melonds_console_mode=ds"
+    CORE_OPTION "melonds_homebrew_sdcard=enabled"
+    CORE_OPTION "melonds_homebrew_sync_sdcard_to_host=disabled"
+)
@@ -73,3 +73,31 @@ add_python_test(
     REQUIRES_OPENGL
     NO_SKIP_ERROR_SCREEN
 )
+
+add_python_test(
+    NAME "Core caches the screen shader's program binary"
+    TEST_MODULE opengl.core_caches_shader_binaries
+    CONTENT "${NDS_ROM}"
+    REQUIRES_OPENGL
+    TIMEOUT 30
+)
+
+add_python_test(
+    NAME "Core keeps the configured software renderer threading across a context loss"
+    TEST_MODULE opengl.core_survives_context_loss
+    CONTENT "${NDS_ROM}"
+    REQUIRES_OPENGL
+    TIMEOUT 30
+)
+
+add_python_test(
+    NAME "Core renders with headless OpenGL through the software video path"
+    TEST_MODULE opengl.core_renders_headless
+    CONTENT "${NDS_ROM}"
+    CORE_OPTION "melonds_render_mode=opengl"
+    CORE_OPTION "melonds_opengl_headless=enabled"
+    CORE_OPTION "melonds_opengl_resolution=2"
+    REQUIRES_OPENGL
+    SKIP_RETURN_CODE 77
+    TIMEOUT 30
+)
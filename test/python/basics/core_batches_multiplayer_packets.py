@@ -0,0 +1,59 @@
+from ctypes import CFUNCTYPE, POINTER, Structure, c_bool, c_double, c_uint, c_uint64
+
+from libretro import Session
+
+import prelude
+
+
+class MpTraffic(Structure):
+    _fields_ = [
+        ("packets_sent", c_uint64),
+        ("messages_sent", c_uint64),
+        ("flush_hints", c_uint64),
+        ("polls", c_uint64),
+        ("packets_received", c_uint64),
+        ("messages_received", c_uint64),
+        ("messages_rejected", c_uint64),
+    ]
+
+
+class MpLoopbackResult(Structure):
+    _fields_ = [
+        ("frames", c_uint64),
+        ("seconds", c_double),
+        ("host", MpTraffic),
+        ("client", MpTraffic),
+    ]
+
+
+FRAMES = 120
+PACKETS_PER_FRAME = 8
+
+session: Session
+with prelude.session() as session:
+    mp_loopback = session.get_proc_address(b"melondsds_mp_loopback", CFUNCTYPE(c_bool, c_uint, c_uint, POINTER(MpLoopbackResult)))
+    assert mp_loopback is not None, "melondsds_mp_loopback not defined in the core"
+
+    result = MpLoopbackResult()
+    assert mp_loopback(FRAMES, PACKETS_PER_FRAME, result)
+
+    host = result.host
+    client = result.client
+    for name, peer in (("host", host), ("client", client)):
+        print(
+            f"{name}: {peer.packets_sent / result.seconds:.0f} packets/s in {peer.messages_sent / result.seconds:.0f} messages/s, "
+            f"{peer.flush_hints / result.seconds:.0f} flush hints/s, {peer.polls / result.seconds:.0f} polls/s"
+        )
+
+    # Every data packet, command and frame sync from the host, plus a reply and frame sync from the client;
+    # each peer also sends one extra frame sync when it first hears from the other
+    assert host.packets_sent == FRAMES * (PACKETS_PER_FRAME + 2) + 1
+    assert client.packets_sent == FRAMES * 2 + 1
+    assert client.packets_received == host.packets_sent, "Client lost packets over the loopback"
+    assert host.packets_received == client.packets_sent, "Host lost packets over the loopback"
+
+    # The host's data packets and command should go out together,
+    # so it should need far fewer messages (and flushes) than packets
+    assert host.messages_sent <= FRAMES * 2, f"Expected at most {FRAMES * 2} messages from the host, got {host.messages_sent}"
+    assert host.flush_hints <= host.messages_sent
+    assert host.messages_rejected == 0 and client.messages_rejected == 0, "Peers of the same version should accept each other's messages"
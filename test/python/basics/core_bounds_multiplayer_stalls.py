@@ -0,0 +1,33 @@
+from ctypes import CFUNCTYPE, POINTER, Structure, c_bool, c_double, c_uint32, c_uint64
+
+from libretro import Session
+
+import prelude
+
+
+class MpSyncResult(Structure):
+    _fields_ = [
+        ("frames_before_deferral", c_uint32),
+        ("longest_begin_frame_ms", c_double),
+        ("messages_rejected", c_uint64),
+        ("resumed_without_incompatible_peer", c_bool),
+    ]
+
+
+session: Session
+with prelude.session() as session:
+    mp_sync_check = session.get_proc_address(b"melondsds_mp_sync_check", CFUNCTYPE(c_bool, POINTER(MpSyncResult)))
+    assert mp_sync_check is not None, "melondsds_mp_sync_check not defined in the core"
+
+    result = MpSyncResult()
+    assert mp_sync_check(result)
+
+    print(f"Ran {result.frames_before_deferral} frames ahead, longest wait {result.longest_begin_frame_ms:.2f}ms")
+
+    assert 0 < result.frames_before_deferral < 32, "Expected the peer to stop running ahead of a stalled peer"
+
+    # Waiting on a stalled peer must leave most of the frame to the frontend
+    assert result.longest_begin_frame_ms < 12, f"Expected a short wait for the stalled peer, got {result.longest_begin_frame_ms:.2f}ms"
+
+    assert result.messages_rejected == 1, "Expected the message in the old format to be rejected"
+    assert result.resumed_without_incompatible_peer, "Expected an incompatible peer to stop holding frames back"
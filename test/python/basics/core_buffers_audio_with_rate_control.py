@@ -0,0 +1,47 @@
+from ctypes import CFUNCTYPE, POINTER, Structure, c_bool, c_double, c_int32, c_uint64
+from typing import cast
+
+from libretro import Session, ArrayAudioDriver
+
+import prelude
+
+
+class AudioStats(Structure):
+    _fields_ = [
+        ("frames_in", c_uint64),
+        ("frames_out", c_uint64),
+        ("underruns", c_uint64),
+        ("overruns", c_uint64),
+        ("ratio", c_double),
+        ("rate_control_source", c_int32),
+        ("batch_calls", c_uint64),
+        ("submit_delay_us", c_double),
+        ("batch_call_us", c_double),
+    ]
+
+
+options = {
+    b"melonds_audio_rate_control": b"enabled",
+}
+
+session: Session
+with prelude.builder().with_options(options).build() as session:
+    get_audio_stats = session.get_proc_address(b"melondsds_get_audio_stats", CFUNCTYPE(c_bool, POINTER(AudioStats)))
+    assert get_audio_stats is not None, "melondsds_get_audio_stats not defined in the core"
+
+    audio = cast(ArrayAudioDriver, session.audio)
+    for i in range(300):
+        session.run()
+
+    stats = AudioStats()
+    assert get_audio_stats(stats)
+    assert stats.frames_in > 0
+    assert stats.frames_out > 0
+    print(f"{stats.underruns} underrun(s), {stats.overruns} overrun(s) over {i + 1} frames")
+    assert stats.underruns + stats.overruns <= i + 1, "Expected at most one underrun or overrun per frame"
+    # Either the frontend's buffer status or (if it doesn't report one) its frame pacing should be steering the ratio
+    assert stats.rate_control_source in (1, 2), f"Expected rate control to be active, got {stats.rate_control_source}"
+    assert 0.99 < stats.ratio < 1.01, f"Expected a ratio close to 1, got {stats.ratio}"
+
+    assert audio.buffer is not None
+    assert any(b != 0 for b in audio.buffer), "Expected resampled audio to reach the frontend"
@@ -0,0 +1,49 @@
+import time
+from ctypes import CFUNCTYPE, POINTER, Structure, c_bool, c_uint64
+
+from libretro import Session
+
+import prelude
+
+
+class SectorCacheStats(Structure):
+    _fields_ = [
+        ("hits", c_uint64),
+        ("misses", c_uint64),
+        ("evictions", c_uint64),
+        ("bytes_read", c_uint64),
+        ("bytes_written", c_uint64),
+        ("bytes_requested", c_uint64),
+    ]
+
+
+FRAMES = 300
+cache_enabled = prelude.options.get(b"melonds_dsi_nand_cache", b"disabled") == b"enabled"
+
+start = time.perf_counter()
+session: Session
+with prelude.session() as session:
+    loaded = time.perf_counter()
+    for i in range(FRAMES):
+        session.run()
+    booted = time.perf_counter()
+
+    get_nand_cache_stats = session.get_proc_address(b"melondsds_get_nand_cache_stats", CFUNCTYPE(c_bool, POINTER(SectorCacheStats)))
+    assert get_nand_cache_stats is not None, "melondsds_get_nand_cache_stats not defined in the core"
+
+    stats = SectorCacheStats()
+    assert get_nand_cache_stats(stats)
+
+    accesses = stats.hits + stats.misses
+    print(
+        f"NAND cache {'enabled' if cache_enabled else 'disabled'}: "
+        f"loaded in {(loaded - start) * 1000:.1f}ms, ran {FRAMES} frames in {(booted - loaded) * 1000:.1f}ms; "
+        f"{stats.hits} of {accesses} line accesses hit, "
+        f"read {stats.bytes_read // 1024}KiB from the image to serve {stats.bytes_requested // 1024}KiB"
+    )
+
+    if cache_enabled:
+        # Mounting the NAND to look up titles reads the same FAT and directory sectors many times
+        assert stats.hits > 0, "Expected the NAND cache to be hit at least once"
+    else:
+        assert accesses == 0, f"Expected no NAND cache accesses with the cache disabled, got {accesses}"
@@ -0,0 +1,50 @@
+from ctypes import CFUNCTYPE, POINTER, Structure, c_bool, c_uint64
+from itertools import repeat
+
+from libretro import JoypadState
+
+import prelude
+
+
+class InputStats(Structure):
+    _fields_ = [
+        ("full_frames", c_uint64),
+        ("cached_frames", c_uint64),
+    ]
+
+
+def generate_input():
+    yield from repeat(0, 240)
+    yield JoypadState(a=True)
+    yield from repeat(0)
+
+
+with prelude.builder().with_input(generate_input).build() as session:
+    get_input_stats = session.get_proc_address(b"melondsds_get_input_stats", CFUNCTYPE(c_bool, POINTER(InputStats)))
+    assert get_input_stats is not None, "melondsds_get_input_stats not defined in the core"
+
+    for i in range(239):
+        session.run()
+
+    before = InputStats()
+    assert get_input_stats(before)
+    assert before.cached_frames > 200, f"Expected unchanged input to take the cached path, got {before.cached_frames} cached frames"
+
+    frame1 = session.video.screenshot()
+
+    # Press A, then release it
+    for i in range(3):
+        session.run()
+
+    after = InputStats()
+    assert get_input_stats(after)
+    assert after.full_frames >= before.full_frames + 2, "Expected the press and the release to be fully processed"
+
+    for i in range(240):
+        session.run()
+
+    frame2 = session.video.screenshot()
+
+    # The button press must still have reached the console;
+    # the logo screen (frame1) has a white pixel in the top left corner, whereas the main menu screen doesn't
+    assert frame1.data[0:4] != frame2.data[0:4]
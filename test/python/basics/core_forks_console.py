@@ -0,0 +1,47 @@
+from ctypes import CFUNCTYPE, c_bool, c_int, c_size_t, c_uint32, c_void_p
+
+from libretro import Session
+
+import prelude
+
+FORKS = 4
+
+session: Session
+with prelude.session() as session:
+    fork_console = session.get_proc_address(b"melondsds_fork_console", CFUNCTYPE(c_size_t, c_size_t))
+    assert fork_console is not None, "melondsds_fork_console not defined in the core"
+
+    get_fork_count = session.get_proc_address(b"melondsds_get_fork_count", CFUNCTYPE(c_size_t))
+    run_fork = session.get_proc_address(b"melondsds_run_fork", CFUNCTYPE(c_bool, c_size_t, c_uint32, c_int, c_int, c_bool))
+    get_fork_main_ram = session.get_proc_address(b"melondsds_get_fork_main_ram", CFUNCTYPE(c_void_p, c_size_t))
+
+    for i in range(30):
+        session.run()
+
+    assert fork_console(FORKS) == FORKS, f"Expected {FORKS} forks"
+    assert get_fork_count() == FORKS
+
+    for i in range(FORKS):
+        # Each fork gets a different button held down
+        for f in range(10):
+            assert run_fork(i, 1 << i, 0, 0, False), f"Failed to run fork {i}"
+
+    assert not run_fork(FORKS, 0, 0, 0, False), "Running a nonexistent fork should fail"
+
+    ram = {get_fork_main_ram(i) for i in range(FORKS)}
+    assert len(ram) == FORKS, "Expected each fork to have its own memory"
+
+    # The real console should be unaffected
+    session.run()
+
+    # Forking again reuses the existing forks
+    assert fork_console(2) == 2
+    assert fork_console(0) == 0
+    assert get_fork_count() == 0
+
+    # Forks that are still around when the game is unloaded go with it
+    assert fork_console(2) == 2
+
+with prelude.session() as session:
+    get_fork_count = session.get_proc_address(b"melondsds_get_fork_count", CFUNCTYPE(c_size_t))
+    assert get_fork_count() == 0, "Forks from the previous session should have been destroyed"
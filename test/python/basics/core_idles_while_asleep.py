@@ -0,0 +1,52 @@
+from ctypes import CFUNCTYPE, c_bool, c_uint64
+from typing import cast
+
+from libretro import Session, ArrayAudioDriver, ArrayVideoDriver
+
+import prelude
+
+
+class DupeCountingVideoDriver(ArrayVideoDriver):
+    def __init__(self, *args, **kwargs):
+        super().__init__(*args, **kwargs)
+        self.dupes = 0
+
+    def refresh(self, data, width: int, height: int, pitch: int) -> None:
+        if data is None or not isinstance(data, memoryview):
+            # libretro.py passes NULL frames through as None or as a special sentinel
+            self.dupes += 1
+
+        super().refresh(data, width, height, pitch)
+
+
+SLEEP_FRAMES = 60
+
+session: Session
+with prelude.builder().with_video(DupeCountingVideoDriver).build() as session:
+    video = cast(DupeCountingVideoDriver, session.video)
+    audio = cast(ArrayAudioDriver, session.audio)
+
+    enter_sleep_mode = session.get_proc_address(b"melondsds_enter_sleep_mode", CFUNCTYPE(c_bool))
+    assert enter_sleep_mode is not None, "melondsds_enter_sleep_mode not defined in the core"
+
+    get_idle_frames = session.get_proc_address(b"melondsds_get_idle_frames", CFUNCTYPE(c_uint64))
+    assert get_idle_frames is not None, "melondsds_get_idle_frames not defined in the core"
+
+    for i in range(60):
+        session.run()
+
+    assert get_idle_frames() == 0, "The console shouldn't be asleep yet"
+
+    assert enter_sleep_mode()
+    video.dupes = 0
+    samples_before = len(audio.buffer)
+    for i in range(SLEEP_FRAMES):
+        session.run()
+
+    assert get_idle_frames() >= SLEEP_FRAMES - 1, f"Expected the idle path to run while asleep, got {get_idle_frames()} idle frames"
+
+    # The first sleeping frame is presented so the blank screens are shown, the rest are dupes
+    assert video.dupes >= SLEEP_FRAMES - 2, f"Expected sleeping frames to be dupes, got {video.dupes}/{SLEEP_FRAMES}"
+
+    # Silence still has to reach the frontend, or audio sync would stop pacing the core
+    assert len(audio.buffer) > samples_before, "Expected audio to keep flowing while asleep"
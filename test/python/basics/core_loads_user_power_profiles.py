@@ -0,0 +1,38 @@
+import os
+from ctypes import CFUNCTYPE, c_int
+
+from libretro import Session
+from libretro.api.power import retro_device_power, PowerState
+
+import prelude
+
+profiles_path = os.path.join(prelude.core_save_dir, b"power_profiles.cfg")
+with open(profiles_path, "w") as f:
+    f.write('power_profile_0_name = "Plugged in"\n')
+    f.write('power_profile_0_source = "external"\n')
+    f.write('power_profile_0_melonds_audio_interpolation = "cubic"\n')
+    f.write('power_profile_1_name = "Low battery"\n')
+    f.write('power_profile_1_source = "battery"\n')
+    f.write('power_profile_1_max_percent = "30"\n')
+    f.write('power_profile_1_osd = "disabled"\n')
+
+options = {
+    b"melonds_battery_update_interval": b"1",
+}
+
+power = retro_device_power(PowerState.CHARGING, 3540, 80)
+session: Session
+with prelude.builder().with_options(options).with_power(power).build() as session:
+    get_power_profile = session.get_proc_address(b"melondsds_get_power_profile", CFUNCTYPE(c_int))
+    assert get_power_profile is not None, "melondsds_get_power_profile not defined in the core"
+
+    session.run()
+    assert get_power_profile() == 0, "Expected to start with the usual settings"
+
+    # The core needs to see the new power state for a couple of samples before switching
+    for i in range(300):
+        session.run()
+
+    assert get_power_profile() == 1, f"Expected the first profile in power_profiles.cfg to be active, got {get_power_profile()}"
+
+os.remove(profiles_path)
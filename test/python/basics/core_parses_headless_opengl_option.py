@@ -0,0 +1,29 @@
+from ctypes import CFUNCTYPE, c_bool
+
+import prelude
+
+options = {
+    b"melonds_render_mode": b"software",
+    b"melonds_opengl_headless": b"enabled",
+}
+
+with prelude.builder().with_options(options).build() as session:
+    is_headless_opengl_configured = session.get_proc_address(b"melondsds_is_headless_opengl_configured", CFUNCTYPE(c_bool))
+    assert is_headless_opengl_configured is not None, "melondsds_is_headless_opengl_configured not defined in the core"
+
+    definition = session.options.definitions.get(b"melonds_opengl_headless")
+    if definition is not None:
+        # Only builds with EGL define the option at all
+        assert definition.default_value == b"disabled"
+        assert {v.value for v in definition.values if v.value} == {b"disabled", b"enabled"}
+
+    session.run()
+    assert is_headless_opengl_configured() == (definition is not None)
+
+    session.options.variables["melonds_opengl_headless"] = b"invalid"
+    session.run()
+    assert not is_headless_opengl_configured(), "Invalid values should fall back to disabled"
+
+    session.options.variables["melonds_opengl_headless"] = b"disabled"
+    session.run()
+    assert not is_headless_opengl_configured()
@@ -0,0 +1,91 @@
+import os
+import struct
+import zipfile
+import zlib
+from ctypes import CFUNCTYPE, POINTER, Structure, c_bool, c_char_p, c_double, c_uint, c_uint64
+
+from libretro import Session
+
+import prelude
+
+
+class RomArchiveStats(Structure):
+    _fields_ = [
+        ("compressed_size", c_uint64),
+        ("uncompressed_size", c_uint64),
+        ("blocks_decompressed", c_uint64),
+        ("cache_hits", c_uint64),
+        ("stream_restarts", c_uint64),
+        ("peak_bytes", c_uint64),
+        ("read_all_ms", c_double),
+    ]
+
+
+class RomArchiveBenchmark(Structure):
+    _fields_ = [
+        ("streamed", RomArchiveStats),
+        ("extracted_ms", c_double),
+        ("extracted_peak_bytes", c_uint64),
+        ("random_reads", c_uint64),
+        ("identical", c_bool),
+    ]
+
+
+RANDOM_READS = 256
+RZIP_CHUNK_SIZE = 128 * 1024
+
+with open(prelude.content_path, "rb") as f:
+    rom = f.read()
+
+archive_dir = os.path.join(prelude.testdir, b"archives")
+os.makedirs(archive_dir, exist_ok=True)
+
+deflated_path = os.path.join(archive_dir, b"deflated.zip")
+with zipfile.ZipFile(deflated_path, "w", zipfile.ZIP_DEFLATED) as archive:
+    archive.writestr("readme.txt", "Not a ROM")
+    archive.writestr("game.nds", rom)
+
+stored_path = os.path.join(archive_dir, b"stored.zip")
+with zipfile.ZipFile(stored_path, "w", zipfile.ZIP_STORED) as archive:
+    archive.writestr("roms/GAME.NDS", rom)
+
+rzip_path = os.path.join(archive_dir, b"game.rzip")
+with open(rzip_path, "wb") as f:
+    f.write(b"#RZIPv\x01#" + struct.pack("<IQ", RZIP_CHUNK_SIZE, len(rom)))
+    for i in range(0, len(rom), RZIP_CHUNK_SIZE):
+        chunk = zlib.compress(rom[i:i + RZIP_CHUNK_SIZE])
+        f.write(struct.pack("<I", len(chunk)) + chunk)
+
+empty_path = os.path.join(archive_dir, b"empty.zip")
+with zipfile.ZipFile(empty_path, "w") as archive:
+    archive.writestr("readme.txt", "Not a ROM")
+
+session: Session
+with prelude.session() as session:
+    benchmark_rom_archive = session.get_proc_address(
+        b"melondsds_benchmark_rom_archive",
+        CFUNCTYPE(c_bool, c_char_p, c_uint, POINTER(RomArchiveBenchmark))
+    )
+    assert benchmark_rom_archive is not None, "melondsds_benchmark_rom_archive not defined in the core"
+
+    for path in (deflated_path, stored_path, rzip_path):
+        result = RomArchiveBenchmark()
+        assert benchmark_rom_archive(path, RANDOM_READS, result), f"Failed to read {path}"
+
+        streamed = result.streamed
+        print(
+            f"{os.path.basename(path).decode()}: {streamed.compressed_size} -> {streamed.uncompressed_size} bytes; "
+            f"extracted in {result.extracted_ms:.2f}ms (peak {result.extracted_peak_bytes} bytes), "
+            f"streamed in {streamed.read_all_ms:.2f}ms (peak {streamed.peak_bytes} bytes); "
+            f"{streamed.blocks_decompressed} blocks decompressed, {streamed.cache_hits} cache hits, "
+            f"{streamed.stream_restarts} stream restarts"
+        )
+
+        assert result.identical, f"Expected {path} to hold the same ROM as the loaded content"
+        assert streamed.uncompressed_size == len(rom)
+        assert result.random_reads == RANDOM_READS
+        assert streamed.peak_bytes < result.extracted_peak_bytes, \
+            f"Expected streaming to need less memory than extracting ({streamed.peak_bytes} vs {result.extracted_peak_bytes} bytes)"
+
+    result = RomArchiveBenchmark()
+    assert not benchmark_rom_archive(empty_path, RANDOM_READS, result), "Expected an archive without a ROM to be rejected"
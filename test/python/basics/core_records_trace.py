@@ -0,0 +1,52 @@
+import json
+import os
+from ctypes import CFUNCTYPE, POINTER, Structure, c_bool, c_char_p, c_double, c_size_t, c_uint32, c_uint64, create_string_buffer
+
+import prelude
+
+
+class TraceStats(Structure):
+    _fields_ = [
+        ("events", c_uint64),
+        ("dropped", c_uint64),
+        ("threads", c_uint32),
+        ("recording", c_bool),
+    ]
+
+
+options = {
+    b"melonds_trace_recorder": b"10"
+}
+
+with prelude.builder().with_options(options).build() as session:
+    get_trace_stats = session.get_proc_address(b"melondsds_get_trace_stats", CFUNCTYPE(c_bool, POINTER(TraceStats)))
+    assert get_trace_stats is not None, "melondsds_get_trace_stats not defined in the core"
+
+    trace_dump = session.get_proc_address(b"melondsds_trace_dump", CFUNCTYPE(c_bool, c_double, c_char_p, c_size_t))
+    assert trace_dump is not None, "melondsds_trace_dump not defined in the core"
+
+    for i in range(120):
+        session.run()
+
+    stats = TraceStats()
+    assert get_trace_stats(stats)
+    print(f"Recorded {stats.events} events on {stats.threads} threads ({stats.dropped} dropped)")
+    assert stats.recording, "Expected the trace recorder option to start recording"
+    assert stats.events >= 120, f"Expected at least one event per frame, got {stats.events}"
+
+    path = create_string_buffer(4096)
+    assert trace_dump(0, path, len(path)), "Failed to dump the trace"
+    assert os.path.isfile(path.value), f"Expected a trace at {path.value}"
+
+    with open(path.value, "rb") as f:
+        trace = json.load(f)
+
+    events = trace["traceEvents"]
+    complete = [e for e in events if e["ph"] == "X"]
+    names = {e["name"] for e in complete}
+    print(f"Trace has {len(complete)} complete events with {len(names)} distinct names")
+
+    assert "NDS::RunFrame" in names, "Expected the trace to time NDS::RunFrame"
+    assert sum(1 for e in complete if e["name"] == "NDS::RunFrame") >= 120
+    assert all(e["dur"] >= 0 and e["ts"] >= 0 for e in complete)
+    assert any(e["ph"] == "M" and e["name"] == "thread_name" for e in events)
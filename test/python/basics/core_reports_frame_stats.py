@@ -0,0 +1,36 @@
+from ctypes import CFUNCTYPE, POINTER, Structure, c_bool, c_double, c_int32, c_uint64
+
+from libretro import Session
+
+import prelude
+
+
+class FrameTimeSummary(Structure):
+    _fields_ = [
+        ("interval_us", c_double),
+        ("run_time_us", c_double),
+        ("jitter_us", c_double),
+        ("max_interval_us", c_double),
+        ("target_interval_us", c_double),
+        ("samples", c_uint64),
+        ("missed_vsyncs", c_uint64),
+        ("bottleneck", c_int32),
+    ]
+
+
+session: Session
+with prelude.session() as session:
+    get_frame_stats = session.get_proc_address(b"melondsds_get_frame_stats", CFUNCTYPE(c_bool, POINTER(FrameTimeSummary)))
+    assert get_frame_stats is not None, "melondsds_get_frame_stats not defined in the core"
+
+    for i in range(30):
+        session.run()
+
+    stats = FrameTimeSummary()
+    assert get_frame_stats(stats)
+    assert stats.samples > 0, "Expected at least one frame to be measured"
+    assert stats.interval_us > 0
+    assert stats.run_time_us > 0
+    assert stats.target_interval_us > 0
+    assert stats.max_interval_us >= stats.interval_us
+    assert stats.bottleneck in (0, 1, 2)
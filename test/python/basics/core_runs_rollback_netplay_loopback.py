@@ -0,0 +1,75 @@
+from ctypes import CFUNCTYPE, POINTER, Structure, c_bool, c_double, c_uint, c_uint32, c_uint64
+
+from libretro import Session
+
+import prelude
+
+
+class RollbackStats(Structure):
+    _fields_ = [
+        ("frames", c_uint64),
+        ("rollbacks", c_uint64),
+        ("resimulated_frames", c_uint64),
+        ("snapshots", c_uint64),
+        ("stalls", c_uint64),
+        ("desyncs", c_uint64),
+        ("max_depth", c_uint32),
+        ("peers", c_uint32),
+        ("resimulation_ms", c_double),
+        ("snapshot_ms", c_double),
+    ]
+
+
+class RollbackLoopbackResult(Structure):
+    _fields_ = [
+        ("host", RollbackStats),
+        ("client", RollbackStats),
+        ("steps", c_uint64),
+        ("identical", c_bool),
+    ]
+
+
+FRAMES = 120
+LATENCY = 3
+MAX_ROLLBACK = 8
+
+session: Session
+with prelude.session() as session:
+    rollback_loopback = session.get_proc_address(
+        b"melondsds_rollback_loopback",
+        CFUNCTYPE(c_bool, c_uint, c_uint, c_uint, POINTER(RollbackLoopbackResult))
+    )
+    assert rollback_loopback is not None, "melondsds_rollback_loopback not defined in the core"
+
+    get_rollback_stats = session.get_proc_address(b"melondsds_get_rollback_stats", CFUNCTYPE(c_bool, POINTER(RollbackStats)))
+    assert get_rollback_stats is not None, "melondsds_get_rollback_stats not defined in the core"
+
+    for i in range(30):
+        session.run()
+
+    result = RollbackLoopbackResult()
+    assert rollback_loopback(FRAMES, LATENCY, MAX_ROLLBACK, result)
+
+    for name, peer in (("host", result.host), ("client", result.client)):
+        print(
+            f"{name}: {peer.frames} frames, {peer.rollbacks} rollbacks (deepest {peer.max_depth}), "
+            f"{peer.resimulated_frames} frames replayed in {peer.resimulation_ms:.1f}ms, "
+            f"{peer.snapshots} snapshots in {peer.snapshot_ms:.1f}ms, {peer.stalls} stalls"
+        )
+
+        assert peer.frames == FRAMES, f"Expected the {name} to run {FRAMES} frames, got {peer.frames}"
+        assert peer.peers == 1, f"Expected the {name} to see one other peer, got {peer.peers}"
+        assert peer.desyncs == 0, f"The {name} couldn't correct {peer.desyncs} misprediction(s)"
+        assert peer.max_depth <= MAX_ROLLBACK
+
+    # Both players change their input every few frames, and each change arrives late
+    assert result.host.rollbacks > 0, "Expected the host to mispredict the client's input at least once"
+    assert result.client.rollbacks > 0, "Expected the client to mispredict the host's input at least once"
+    assert result.host.resimulated_frames >= result.host.rollbacks
+    assert result.identical, "Expected both peers to end up with the same console state"
+
+    # Rollback netplay wasn't started for the real console
+    stats = RollbackStats()
+    assert get_rollback_stats(stats)
+    assert stats.frames == 0
+    session.run()
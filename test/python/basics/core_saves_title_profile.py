@@ -0,0 +1,30 @@
+import os
+from ctypes import CFUNCTYPE, c_bool, c_char_p
+
+from libretro import Session
+
+import prelude
+
+options = {
+    b"melonds_per_game_profiles": b"tune",
+}
+
+session: Session
+with prelude.builder().with_options(options).build() as session:
+    get_title_profile_path = session.get_proc_address(b"melondsds_get_title_profile_path", CFUNCTYPE(c_char_p))
+    assert get_title_profile_path is not None, "melondsds_get_title_profile_path not defined in the core"
+
+    reset_title_profile = session.get_proc_address(b"melondsds_reset_title_profile", CFUNCTYPE(c_bool))
+    assert reset_title_profile is not None, "melondsds_reset_title_profile not defined in the core"
+
+    path = get_title_profile_path()
+    assert path is not None, "Expected a per-game profile to be loaded"
+
+    # Tuning records its first attempt as soon as the game loads
+    assert os.path.isfile(path), f"Expected {path} to exist"
+
+    for i in range(10):
+        session.run()
+
+    assert reset_title_profile(), "Failed to reset the per-game profile"
+    assert not os.path.exists(path), f"Expected {path} to be deleted"
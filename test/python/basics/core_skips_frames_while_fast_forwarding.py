@@ -0,0 +1,81 @@
+import time
+from ctypes import CFUNCTYPE, POINTER, Structure, c_bool, c_uint64
+from typing import cast
+
+from libretro import Session, ArrayVideoDriver
+from libretro.api.timing import retro_throttle_state
+from libretro.h import RETRO_THROTTLE_FAST_FORWARD, RETRO_THROTTLE_NONE
+
+import prelude
+
+
+class PresentationStats(Structure):
+    _fields_ = [
+        ("presented", c_uint64),
+        ("skipped", c_uint64),
+    ]
+
+
+class DupeCountingVideoDriver(ArrayVideoDriver):
+    def __init__(self, *args, **kwargs):
+        super().__init__(*args, **kwargs)
+        self.frames = 0
+        self.dupes = 0
+
+    def refresh(self, data, width: int, height: int, pitch: int) -> None:
+        self.frames += 1
+        if data is None or not isinstance(data, memoryview):
+            # libretro.py passes NULL frames through as None or as a special sentinel
+            self.dupes += 1
+
+        super().refresh(data, width, height, pitch)
+
+
+FRAMES = 240
+SPEEDUP = 4
+
+session: Session
+with prelude.builder().with_video(DupeCountingVideoDriver).build() as session:
+    video = cast(DupeCountingVideoDriver, session.video)
+    get_presentation_stats = session.get_proc_address(b"melondsds_get_presentation_stats", CFUNCTYPE(c_bool, POINTER(PresentationStats)))
+    assert get_presentation_stats is not None, "melondsds_get_presentation_stats not defined in the core"
+
+    for i in range(60):
+        # Let the console boot before measuring anything
+        session.run()
+
+    session.timing.throttle_state = retro_throttle_state(RETRO_THROTTLE_NONE, 60.0)
+    before = PresentationStats()
+    assert get_presentation_stats(before)
+    video.frames = 0
+    video.dupes = 0
+    start = time.perf_counter()
+    for i in range(FRAMES):
+        session.run()
+    normal_seconds = time.perf_counter() - start
+
+    after = PresentationStats()
+    assert get_presentation_stats(after)
+    assert after.skipped == before.skipped, "Frames should not be skipped at normal speed"
+
+    session.timing.throttle_state = retro_throttle_state(RETRO_THROTTLE_FAST_FORWARD, 60.0 * SPEEDUP)
+    before = after
+    video.frames = 0
+    video.dupes = 0
+    start = time.perf_counter()
+    for i in range(FRAMES):
+        session.run()
+    fast_forward_seconds = time.perf_counter() - start
+
+    after = PresentationStats()
+    assert get_presentation_stats(after)
+    presented = after.presented - before.presented
+    skipped = after.skipped - before.skipped
+    assert presented + skipped <= FRAMES
+    assert presented >= FRAMES // SPEEDUP, f"Expected at least one of every {SPEEDUP} frames to be presented, got {presented}/{FRAMES}"
+    assert skipped >= FRAMES // 2, f"Expected most frames to be skipped while fast-forwarding, got {skipped}/{FRAMES}"
+    # (the core may also dupe frames while the console's screens are off)
+    assert video.dupes >= skipped, f"Expected each skipped frame to be a NULL video_refresh, got {video.dupes} dupes for {skipped} skipped frames"
+
+    print(f"{FRAMES} frames at normal speed: {normal_seconds * 1000:.1f}ms ({normal_seconds * 1e6 / FRAMES:.0f}us/frame)")
+    print(f"{FRAMES} frames at {SPEEDUP}x fast-forward: {fast_forward_seconds * 1000:.1f}ms ({fast_forward_seconds * 1e6 / FRAMES:.0f}us/frame), {skipped} skipped")
@@ -0,0 +1,47 @@
+from ctypes import CFUNCTYPE, POINTER, Structure, c_bool, c_double, c_int32, c_uint64
+
+from libretro import Session
+
+import prelude
+
+
+class AudioStats(Structure):
+    _fields_ = [
+        ("frames_in", c_uint64),
+        ("frames_out", c_uint64),
+        ("underruns", c_uint64),
+        ("overruns", c_uint64),
+        ("ratio", c_double),
+        ("rate_control_source", c_int32),
+        ("batch_calls", c_uint64),
+        ("submit_delay_us", c_double),
+        ("batch_call_us", c_double),
+    ]
+
+
+session: Session
+with prelude.session() as session:
+    get_audio_stats = session.get_proc_address(b"melondsds_get_audio_stats", CFUNCTYPE(c_bool, POINTER(AudioStats)))
+    assert get_audio_stats is not None, "melondsds_get_audio_stats not defined in the core"
+
+    for i in range(120):
+        session.run()
+
+    normal = AudioStats()
+    assert get_audio_stats(normal)
+
+    session.options.variables[b"melonds_audio_low_latency"] = b"enabled"
+    for i in range(120):
+        session.run()
+
+    low = AudioStats()
+    assert get_audio_stats(low)
+
+    print(f"Submit delay: {normal.submit_delay_us:.1f}us normally, {low.submit_delay_us:.1f}us with low latency")
+    print(f"audio_sample_batch: {low.batch_call_us:.1f}us per call over {low.batch_calls} calls")
+
+    assert low.batch_calls > normal.batch_calls
+    assert low.submit_delay_us <= normal.submit_delay_us, "Expected audio to be submitted sooner after emulation"
+
+    # Submitting early changes when audio arrives, not how much of it there is
+    assert low.frames_out - normal.frames_out == low.frames_in - normal.frames_in
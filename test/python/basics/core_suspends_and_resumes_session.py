@@ -0,0 +1,37 @@
+import os
+
+import prelude
+
+options = {
+    b"melonds_suspend_on_exit": b"enabled",
+}
+
+content_name = os.path.splitext(os.path.basename(prelude.content_path))[0]
+suspend_path = os.path.join(prelude.core_save_dir, f"{content_name}.suspend".encode())
+
+with prelude.builder().with_options(options).build() as session:
+    for i in range(60):
+        session.run()
+
+    assert not os.path.exists(suspend_path), "The session shouldn't be suspended until the game is unloaded"
+
+assert os.path.isfile(suspend_path), f"Expected a suspended session at {suspend_path}"
+
+with open(suspend_path, "rb") as f:
+    assert f.read(8) == b"MDSSUSP\0", "Suspended session has the wrong magic number"
+
+with prelude.builder().with_options(options).build() as session:
+    session.run()
+
+    assert not os.path.exists(suspend_path), "The suspended session should be deleted once it's resumed"
+
+# The session was suspended again when the game was unloaded, so corrupt it;
+# the core should discard it and boot normally
+with open(suspend_path, "r+b") as f:
+    f.seek(8)
+    f.write(b"\xff" * 16)
+
+with prelude.builder().with_options(options).build() as session:
+    session.run()
+
+    assert not os.path.exists(suspend_path), "A corrupt suspended session should be discarded"
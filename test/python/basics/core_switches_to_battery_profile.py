@@ -0,0 +1,27 @@
+from ctypes import CFUNCTYPE, c_int
+
+from libretro import Session
+from libretro.api.power import retro_device_power, PowerState
+
+import prelude
+
+options = {
+    b"melonds_battery_update_interval": b"1",
+    b"melonds_battery_profile_threshold": b"20",
+    b"melonds_battery_profile_audio_interpolation": b"disabled",
+}
+
+power = retro_device_power(PowerState.DISCHARGING, 3540, 10)
+session: Session
+with prelude.builder().with_options(options).with_power(power).build() as session:
+    get_power_profile = session.get_proc_address(b"melondsds_get_power_profile", CFUNCTYPE(c_int))
+    assert get_power_profile is not None, "melondsds_get_power_profile not defined in the core"
+
+    session.run()
+    assert get_power_profile() == 0, "Expected to start with the normal profile"
+
+    # The core needs to see the low battery for a couple of samples before switching
+    for i in range(300):
+        session.run()
+
+    assert get_power_profile() == 1, "Expected the battery profile to be active"
@@ -0,0 +1,22 @@
+import os
+
+from libretro import Session
+
+import prelude
+
+options = {
+    b"melonds_render_mode": b"software",
+    b"melonds_threaded_renderer": b"auto",
+}
+
+profile_path = os.path.join(prelude.core_save_dir, b"profiles", b"threaded_renderer.cfg")
+
+session: Session
+with prelude.builder().with_options(options).build() as session:
+    # Warmup, then four rounds of each mode
+    for i in range(180 + 60 * 8 + 1):
+        session.run()
+
+if (os.cpu_count() or 1) > 1:
+    # Single-core hosts decide without measuring, so there's nothing to save
+    assert os.path.isfile(profile_path), f"Expected {profile_path} to exist"
@@ -0,0 +1,42 @@
+from ctypes import CFUNCTYPE, POINTER, Structure, c_bool, c_double, c_uint32
+
+from libretro import Session
+
+import prelude
+
+
+class UnloadStats(Structure):
+    _fields_ = [
+        ("steps", c_uint32),
+        ("overdue", c_uint32),
+        ("wall_ms", c_double),
+        ("serial_ms", c_double),
+        ("blocked_ms", c_double),
+        ("timed_out", c_bool),
+    ]
+
+
+session: Session
+with prelude.session() as session:
+    for i in range(60):
+        session.run()
+
+# The unload stats outlive the session that produced them
+with prelude.session() as session:
+    get_last_unload_stats = session.get_proc_address(b"melondsds_get_last_unload_stats", CFUNCTYPE(c_bool, POINTER(UnloadStats)))
+    assert get_last_unload_stats is not None, "melondsds_get_last_unload_stats not defined in the core"
+
+    stats = UnloadStats()
+    assert get_last_unload_stats(stats)
+    print(
+        f"Last unload: {stats.steps} steps in {stats.wall_ms:.1f}ms "
+        f"({stats.serial_ms:.1f}ms if serial), blocked for {stats.blocked_ms:.1f}ms, "
+        f"{stats.overdue} overdue"
+    )
+
+    # At least the firmware flush, the console's teardown, and the release of the ROM
+    assert stats.steps >= 3, f"Expected at least 3 unload steps, got {stats.steps}"
+    assert not stats.timed_out, "Unloading a short session shouldn't time out"
+    assert stats.overdue == 0
+    assert stats.wall_ms >= 0 and stats.serial_ms >= 0
+    assert stats.blocked_ms <= stats.wall_ms + 1, "The emulator thread shouldn't wait longer than the steps took"
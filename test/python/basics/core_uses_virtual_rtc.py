@@ -0,0 +1,37 @@
+from ctypes import CFUNCTYPE, c_bool, c_int64
+from datetime import datetime, timezone
+
+import prelude
+
+options = {
+    b"melonds_start_time_mode": b"virtual",
+    b"melonds_start_time_absolute_year": b"2010",
+    b"melonds_start_time_absolute_month": b"6",
+    b"melonds_start_time_absolute_day": b"15",
+    b"melonds_start_time_absolute_hour": b"12",
+    b"melonds_start_time_absolute_minute": b"30",
+}
+
+# The core reports local time as seconds since the epoch, so compute it as if it were UTC
+START = int(datetime(2010, 6, 15, 12, 30, tzinfo=timezone.utc).timestamp())
+SET_TIME = int(datetime(2020, 1, 1, 0, 0, tzinfo=timezone.utc).timestamp())
+
+with prelude.builder().with_options(options).build() as session:
+    get_rtc_time = session.get_proc_address(b"melondsds_get_rtc_time", CFUNCTYPE(c_int64))
+    set_rtc_time = session.get_proc_address(b"melondsds_set_rtc_time", CFUNCTYPE(c_bool, c_int64))
+    assert get_rtc_time is not None, "melondsds_get_rtc_time not defined in the core"
+    assert set_rtc_time is not None, "melondsds_set_rtc_time not defined in the core"
+
+    session.run()
+    assert get_rtc_time() == START, f"Expected the RTC to start at {START}, got {get_rtc_time()}"
+
+    for i in range(180):
+        session.run()
+
+    # About 3 seconds of emulated time have passed, regardless of how long that took on the host
+    elapsed = get_rtc_time() - START
+    assert 2 <= elapsed <= 4, f"Expected about 3 seconds of emulated time to pass, got {elapsed}"
+
+    assert set_rtc_time(SET_TIME)
+    session.run()
+    assert 0 <= get_rtc_time() - SET_TIME <= 1, f"Expected the RTC to be set to {SET_TIME}, got {get_rtc_time()}"
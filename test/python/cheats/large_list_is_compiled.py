@@ -0,0 +1,100 @@
+from ctypes import CFUNCTYPE, POINTER, Structure, c_bool, c_double, c_uint, c_uint32
+
+from libretro import Session
+from libretro.h import RETRO_MEMORY_SYSTEM_RAM
+
+import prelude
+
+
+class CheatPlanStats(Structure):
+    _fields_ = [
+        ("source_codes", c_uint32),
+        ("source_instructions", c_uint32),
+        ("plan_codes", c_uint32),
+        ("plan_instructions", c_uint32),
+        ("merged_writes", c_uint32),
+        ("merged_bytes", c_uint32),
+        ("compilations", c_uint32),
+        ("compile_ms", c_double),
+    ]
+
+
+class CheatBenchmarkResult(Structure):
+    _fields_ = [
+        ("plan", CheatPlanStats),
+        ("source_us_per_run", c_double),
+        ("plan_us_per_run", c_double),
+        ("identical", c_bool),
+    ]
+
+
+# Far enough from the start of main RAM that we won't overwrite the test ROM's code
+BASE = 0x023C0000
+WRITES = 512
+ITERATIONS = 2000
+
+session: Session
+with prelude.session() as session:
+    num_cheats = session.get_proc_address(b"melondsds_num_cheats", CFUNCTYPE(c_uint))
+    get_cheat_plan_stats = session.get_proc_address(b"melondsds_get_cheat_plan_stats", CFUNCTYPE(c_bool, POINTER(CheatPlanStats)))
+    assert get_cheat_plan_stats is not None, "melondsds_get_cheat_plan_stats not defined in the core"
+
+    benchmark_cheats = session.get_proc_address(
+        b"melondsds_benchmark_cheats",
+        CFUNCTYPE(c_bool, c_uint, POINTER(CheatBenchmarkResult))
+    )
+    assert benchmark_cheats is not None, "melondsds_benchmark_cheats not defined in the core"
+
+    # One constant write per cheat, the way big cheat databases tend to look
+    for i in range(WRITES):
+        session.core.cheat_set(i, True, f"{BASE + i * 4:08X} {0xC0DE0000 | i:08X} D2000000 00000000".encode())
+
+    # Later cheats overwrite earlier ones, and a disabled cheat does nothing
+    session.core.cheat_set(WRITES, True, f"2{BASE + 1:07X} 000000AA".encode())
+    session.core.cheat_set(WRITES + 1, False, f"{BASE + 8:08X} FFFFFFFF".encode())
+
+    # A conditional code that reads one of the constant writes, so it has to see the value written before it
+    session.core.cheat_set(WRITES + 2, True, f"5{BASE + 16:07X} C0DE0004 {BASE + WRITES * 4:08X} 600DF00D D2000000 00000000".encode())
+
+    count = num_cheats()
+    assert count == WRITES + 3, f"Expected {WRITES + 3} cheats, got {count}"
+
+    for i in range(60):
+        session.run()
+
+    memory = session.core.get_memory(RETRO_MEMORY_SYSTEM_RAM)
+    assert memory is not None
+
+    def word(address: int) -> int:
+        offset = address - 0x02000000
+        return int.from_bytes(memory[offset:offset + 4].tobytes(), "little")
+
+    assert word(BASE) == 0xC0DEAA00, f"Expected 0xC0DEAA00, got {word(BASE):#010x}"
+    assert word(BASE + 8) == 0xC0DE0002, f"Expected the disabled cheat to be ignored, got {word(BASE + 8):#010x}"
+    for i in range(1, WRITES):
+        assert word(BASE + i * 4) == 0xC0DE0000 | i, f"Expected {0xC0DE0000 | i:#010x} at {BASE + i * 4:#010x}, got {word(BASE + i * 4):#010x}"
+
+    assert word(BASE + WRITES * 4) == 0x600DF00D, f"Expected the conditional code to run, got {word(BASE + WRITES * 4):#010x}"
+
+    stats = CheatPlanStats()
+    assert get_cheat_plan_stats(stats)
+    print(
+        f"Compiled {stats.source_codes} cheats ({stats.source_instructions} instructions) "
+        f"into {stats.plan_codes} codes ({stats.plan_instructions} instructions) in {stats.compile_ms:.2f}ms"
+    )
+    assert stats.source_codes == WRITES + 2, f"Expected {WRITES + 2} enabled cheats, got {stats.source_codes}"
+    assert stats.compilations == 1, f"Expected the cheats to be compiled once, got {stats.compilations}"
+    assert stats.merged_writes == WRITES + 1
+    assert stats.plan_codes == 2, f"Expected one merged code plus the conditional, got {stats.plan_codes}"
+    assert stats.plan_instructions * 3 < stats.source_instructions, \
+        f"Expected far fewer instructions, got {stats.plan_instructions} (from {stats.source_instructions})"
+
+    result = CheatBenchmarkResult()
+    assert benchmark_cheats(ITERATIONS, result)
+    print(f"Cheats took {result.source_us_per_run:.2f}us per run as given, {result.plan_us_per_run:.2f}us compiled")
+    assert result.identical, "Expected the compiled cheats to have the same effect as the originals"
+
+    # Frames without cheat changes don't recompile anything
+    session.run()
+    assert get_cheat_plan_stats(stats)
+    assert stats.compilations == 1, f"Expected no recompilation, got {stats.compilations}"
@@ -0,0 +1,83 @@
+import os
+from ctypes import CFUNCTYPE, POINTER, Structure, c_bool, c_uint32
+
+import prelude
+
+
+class ProgramCacheStats(Structure):
+    _fields_ = [
+        ("hits", c_uint32),
+        ("misses", c_uint32),
+        ("stores", c_uint32),
+    ]
+
+
+def get_stats(session) -> ProgramCacheStats:
+    get_program_cache_stats = session.get_proc_address(
+        b"melondsds_get_program_cache_stats",
+        CFUNCTYPE(c_bool, POINTER(ProgramCacheStats))
+    )
+    assert get_program_cache_stats is not None, "melondsds_get_program_cache_stats not defined in the core"
+
+    stats = ProgramCacheStats()
+    assert get_program_cache_stats(stats)
+    return stats
+
+
+options = {
+    b"melonds_render_mode": b"opengl",
+}
+
+program_cache_path = os.path.join(prelude.core_system_dir, b"shaders", b"melondsds_screen.bin")
+
+if os.path.exists(program_cache_path):
+    os.remove(program_cache_path)
+
+with prelude.builder().with_options(options).build() as session:
+    for i in range(3):
+        session.run()
+
+    first = get_stats(session)
+    assert first.misses >= 1, "The first launch had no cached binary to load"
+    assert first.stores >= 1, "The first launch should have cached the screen shader's binary"
+
+assert os.path.isfile(program_cache_path), f"Expected a cached program binary at {program_cache_path}"
+
+with open(program_cache_path, "rb") as f:
+    assert f.read(8) == b"MDSPBIN\0", "Cached program binary has the wrong magic number"
+
+# The second launch should link the screen shader from the cached binary instead of compiling it
+with prelude.builder().with_options(options).build() as session:
+    for i in range(3):
+        session.run()
+
+    second = get_stats(session)
+    assert second.hits > first.hits, f"Expected a cache hit on the second launch ({first.hits} -> {second.hits} hits)"
+    assert second.misses == first.misses, "The second launch shouldn't have compiled the screen shader"
+
+# Claim a much larger binary than the file holds; the core should discard it instead of trusting it
+with open(program_cache_path, "r+b") as f:
+    f.seek(24)  # ProgramCacheHeader::Length
+    f.write((0xFFFFFFF0).to_bytes(4, "little"))
+
+with prelude.builder().with_options(options).build() as session:
+    for i in range(3):
+        session.run()
+
+    third = get_stats(session)
+    assert third.hits == second.hits, "A binary with a bogus length shouldn't be loaded"
+    assert third.stores == second.stores + 1, "The bogus binary should have been replaced"
+
+# Corrupt the cached binary; the core should discard it and cache a new one
+with open(program_cache_path, "r+b") as f:
+    f.seek(8)
+    f.write(b"\xff" * 16)
+
+with prelude.builder().with_options(options).build() as session:
+    for i in range(3):
+        session.run()
+
+with open(program_cache_path, "rb") as f:
+    header = f.read(24)
+    assert header[:8] == b"MDSPBIN\0", "Cached program binary has the wrong magic number"
+    assert header[8:24] != b"\xff" * 16, "Corrupted program binary should have been replaced"
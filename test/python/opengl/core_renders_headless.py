@@ -0,0 +1,27 @@
+import sys
+
+from libretro import Session, Screenshot
+
+import prelude
+
+session: Session
+with prelude.builder().build() as session:
+    if b"melonds_opengl_headless" not in session.options.definitions:
+        print("This build of the core doesn't support headless OpenGL, skipping")
+        sys.exit(77)
+
+    for i in range(70):
+        session.run()
+
+    frame1 = session.video.screenshot()
+    assert isinstance(frame1, Screenshot)
+
+    for i in range(70):
+        session.run()
+
+    frame2 = session.video.screenshot()
+    assert isinstance(frame2, Screenshot)
+
+    scale = int(session.options.variables[b"melonds_opengl_resolution"])
+    assert (frame2.width, frame2.height) == (256 * scale, 384 * scale), f"Expected a {scale}x frame, got {frame2.width}x{frame2.height}"
+    assert frame1.data != frame2.data
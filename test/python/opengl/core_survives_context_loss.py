@@ -0,0 +1,35 @@
+from ctypes import CFUNCTYPE, c_bool
+
+import prelude
+
+options = {
+    b"melonds_render_mode": b"opengl",
+    b"melonds_threaded_renderer": b"enabled",
+}
+
+with prelude.builder().with_options(options).build() as session:
+    is_opengl_renderer = session.get_proc_address(b"melondsds_is_opengl_renderer", CFUNCTYPE(c_bool))
+    assert is_opengl_renderer is not None, "melondsds_is_opengl_renderer not defined in the core"
+
+    is_configured_software_renderer = session.get_proc_address(b"melondsds_is_configured_software_renderer", CFUNCTYPE(c_bool))
+    assert is_configured_software_renderer is not None, "melondsds_is_configured_software_renderer not defined in the core"
+
+    destroy_hw_context = session.get_proc_address(b"melondsds_destroy_hw_context", CFUNCTYPE(None))
+    assert destroy_hw_context is not None, "melondsds_destroy_hw_context not defined in the core"
+
+    reset_hw_context = session.get_proc_address(b"melondsds_reset_hw_context", CFUNCTYPE(None))
+    assert reset_hw_context is not None, "melondsds_reset_hw_context not defined in the core"
+
+    for i in range(3):
+        session.run()
+
+    assert is_opengl_renderer()
+
+    destroy_hw_context()
+    assert is_configured_software_renderer(), "Placeholder renderer should honor melonds_threaded_renderer"
+
+    reset_hw_context()
+    for i in range(3):
+        session.run()
+
+    assert is_opengl_renderer(), "Core should return to OpenGL once the context is reset"
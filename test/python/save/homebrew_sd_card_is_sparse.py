@@ -0,0 +1,25 @@
+import os
+import stat
+
+from libretro import Session
+
+import prelude
+
+session: Session
+with prelude.session() as session:
+    for i in range(60):
+        session.run()
+
+    dldi_sdcard_stat = os.stat(prelude.dldi_sd_card_path)
+
+    assert stat.S_ISREG(dldi_sdcard_stat.st_mode), "dldi_sd_card.bin should be a regular file"
+    assert dldi_sdcard_stat.st_size > 0, "dldi_sd_card.bin should exist and be non-empty"
+
+    if not hasattr(dldi_sdcard_stat, "st_blocks"):
+        print("This platform doesn't report how much disk space a file uses; skipping")
+        exit(0)
+
+    # A freshly-formatted card is almost entirely free space, which shouldn't take up any room on disk
+    used = dldi_sdcard_stat.st_blocks * 512
+    print(f"dldi_sd_card.bin is {dldi_sdcard_stat.st_size} bytes, {used} on disk")
+    assert used * 64 < dldi_sdcard_stat.st_size, f"Expected dldi_sd_card.bin to be sparse, but {used} of its {dldi_sdcard_stat.st_size} bytes are on disk"